@@ -3,7 +3,39 @@
     {
       "target_name": "usnscanner",
       "sources": [
-        "native/usnscanner/addon.cpp"
+        "native/usnscanner/addon.cpp",
+        "native/usnscanner/carver.cpp",
+        "native/usnscanner/deflate.cpp",
+        "native/usnscanner/deleted_tree.cpp",
+        "native/usnscanner/deletion_analytics.cpp",
+        "native/usnscanner/deletion_watch.cpp",
+        "native/usnscanner/export_writer.cpp",
+        "native/usnscanner/format_walkers.cpp",
+        "native/usnscanner/fragment_carver.cpp",
+        "native/usnscanner/huffman.cpp",
+        "native/usnscanner/index_slack.cpp",
+        "native/usnscanner/io_profile.cpp",
+        "native/usnscanner/io_throttle.cpp",
+        "native/usnscanner/logfile.cpp",
+        "native/usnscanner/lznt1.cpp",
+        "native/usnscanner/lzx.cpp",
+        "native/usnscanner/mft_reader.cpp",
+        "native/usnscanner/multi_volume_scan.cpp",
+        "native/usnscanner/ntfs_record.cpp",
+        "native/usnscanner/record_carver.cpp",
+        "native/usnscanner/resident_export.cpp",
+        "native/usnscanner/result_export.cpp",
+        "native/usnscanner/result_store.cpp",
+        "native/usnscanner/scan_aggregate.cpp",
+        "native/usnscanner/snapshot.cpp",
+        "native/usnscanner/timeline.cpp",
+        "native/usnscanner/tree_recovery.cpp",
+        "native/usnscanner/usn_carver.cpp",
+        "native/usnscanner/usn_journal.cpp",
+        "native/usnscanner/volume_reader.cpp",
+        "native/usnscanner/wof.cpp",
+        "native/usnscanner/work_pool.cpp",
+        "native/usnscanner/xpress.cpp"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
@@ -22,6 +54,14 @@
               "AdditionalOptions": ["/std:c++17"]
             }
           }
+        }],
+        ["OS!='win'", {
+          "cflags_cc": ["-std=c++17", "-pthread"],
+          "ldflags": ["-pthread"],
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_ENABLE_CPP_EXCEPTIONS": "YES"
+          }
         }]
       ]
     }
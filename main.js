@@ -63,11 +63,11 @@ ipcMain.handle('get-drives', async () => {
     }
 });
 
-ipcMain.handle('scan-drive', async (event, drivePath) => {
+ipcMain.handle('scan-drive', async (event, drivePath, options = {}) => {
     try {
         const files = await scanForDeletedFiles(drivePath, (progress) => {
             event.sender.send('scan-progress', progress);
-        });
+        }, options);
         return files;
     } catch (error) {
         console.error('Error scanning drive:', error);
@@ -75,6 +75,13 @@ ipcMain.handle('scan-drive', async (event, drivePath) => {
     }
 });
 
+ipcMain.handle('scan-dedup-stats', async () => {
+    if (!usnScanner || typeof usnScanner.scanDedupStats !== 'function') {
+        return null;
+    }
+    return usnScanner.scanDedupStats();
+});
+
 ipcMain.handle('recover-file', async (event, fileInfo, options = {}) => {
     try {
         const result = await recoverFile(fileInfo, options);
@@ -85,6 +92,147 @@ ipcMain.handle('recover-file', async (event, fileInfo, options = {}) => {
     }
 });
 
+ipcMain.handle('scan-deleted-tree', async (event, drivePath, options = {}) => {
+    if (!usnScanner || typeof usnScanner.scanDeletedTree !== 'function') {
+        throw new Error('Deleted tree scanning requires the native scanner.');
+    }
+    return usnScanner.scanDeletedTree(String(drivePath || ''), {
+        journal: options.journal
+    });
+});
+
+ipcMain.handle('scan-all', async (event, drivePaths, options = {}) => {
+    if (!usnScanner || typeof usnScanner.scanAll !== 'function') {
+        throw new Error('Multi-volume scanning requires the native scanner.');
+    }
+    const volumes = (Array.isArray(drivePaths) ? drivePaths : []).map((drivePath) => String(drivePath || ''));
+    return usnScanner.scanAll(volumes, {
+        journal: options.journal,
+        onProgress: (volumeProgress) => event.sender.send('scan-all-progress', volumeProgress)
+    });
+});
+
+ipcMain.handle('expand-tree', async (event, scanId, nodeId, options = {}) => {
+    return usnScanner.expandTree(scanId, nodeId, options);
+});
+
+ipcMain.handle('aggregate-scan', async (event, scanId, groupBy, options = {}) => {
+    return usnScanner.aggregate(scanId, groupBy, options);
+});
+
+ipcMain.handle('export-results', async (event, scanId, format, outputPath, options = {}) => {
+    return usnScanner.exportResults(scanId, format, String(outputPath || ''), options);
+});
+
+ipcMain.handle('release-scan', async (event, scanId) => {
+    return usnScanner ? usnScanner.releaseScan(scanId) : false;
+});
+
+ipcMain.handle('recover-tree', async (event, scanId, nodeId, outputDir, options = {}) => {
+    if (!usnScanner || typeof usnScanner.recoverTree !== 'function') {
+        throw new Error('Folder recovery requires the native scanner.');
+    }
+    return usnScanner.recoverTree(scanId, nodeId, String(outputDir || ''), {
+        streams: options.streams,
+        device: options.device,
+        onProgress: (progress) => event.sender.send('recover-tree-progress', progress)
+    });
+});
+
+ipcMain.handle('set-io-limits', async (event, limits = {}) => {
+    if (!usnScanner || typeof usnScanner.setIoLimits !== 'function') {
+        throw new Error('I/O limits require the native scanner.');
+    }
+    return usnScanner.setIoLimits({
+        bytesPerSecond: limits.bytesPerSecond,
+        iops: limits.iops,
+        background: Boolean(limits.background)
+    });
+});
+
+ipcMain.handle('io-throttle-stats', async () => {
+    if (!usnScanner || typeof usnScanner.ioThrottleStats !== 'function') {
+        return null;
+    }
+    return usnScanner.ioThrottleStats();
+});
+
+ipcMain.handle('probe-io', async (event, drivePath) => {
+    if (!usnScanner || typeof usnScanner.probeIo !== 'function') {
+        throw new Error('The I/O probe requires the native scanner.');
+    }
+    return usnScanner.probeIo(String(drivePath || ''));
+});
+
+ipcMain.handle('analyze-deletions', async (event, drivePath, options = {}) => {
+    if (!usnScanner || typeof usnScanner.analyzeDeletions !== 'function') {
+        throw new Error('Deletion analytics require the native scanner.');
+    }
+    return usnScanner.analyzeDeletions(String(drivePath || ''), options);
+});
+
+ipcMain.handle('build-timeline', async (event, drivePath, options = {}) => {
+    if (!usnScanner || typeof usnScanner.buildTimeline !== 'function') {
+        throw new Error('Timeline export requires the native scanner.');
+    }
+    return usnScanner.buildTimeline(String(drivePath || ''), options);
+});
+
+ipcMain.handle('save-snapshot', async (event, drivePath, snapshotPath) => {
+    if (!usnScanner || typeof usnScanner.saveSnapshot !== 'function') {
+        throw new Error('Snapshots require the native scanner.');
+    }
+    return usnScanner.saveSnapshot(String(drivePath || ''), String(snapshotPath || ''));
+});
+
+ipcMain.handle('diff-snapshots', async (event, oldPath, newPath, options = {}) => {
+    if (!usnScanner || typeof usnScanner.diffSnapshots !== 'function') {
+        throw new Error('Snapshots require the native scanner.');
+    }
+    return usnScanner.diffSnapshots(String(oldPath || ''), String(newPath || ''), options);
+});
+
+const deletionWatches = new Map();
+
+ipcMain.handle('watch-start', async (event, drivePath, options = {}) => {
+    if (!usnScanner || typeof usnScanner.watch !== 'function') {
+        throw new Error('Live deletion monitoring requires the native scanner.');
+    }
+    const sender = event.sender;
+    const handle = usnScanner.watch(String(drivePath || ''), {
+        pollMs: options.pollMs,
+        batchMs: options.batchMs,
+        fromStart: options.fromStart,
+        onEvents: (events) => {
+            if (!sender.isDestroyed()) {
+                sender.send('watch-events', { watchId: handle.id, events });
+            }
+        },
+        onError: (error) => {
+            deletionWatches.delete(handle.id);
+            if (!sender.isDestroyed()) {
+                sender.send('watch-error', { watchId: handle.id, message: error.message || String(error) });
+            }
+        }
+    });
+    deletionWatches.set(handle.id, handle);
+    sender.once('destroyed', () => {
+        if (deletionWatches.delete(handle.id)) {
+            handle.stop();
+        }
+    });
+    return handle.id;
+});
+
+ipcMain.handle('watch-stop', async (event, watchId) => {
+    const handle = deletionWatches.get(watchId);
+    if (!handle) {
+        return null;
+    }
+    deletionWatches.delete(watchId);
+    return handle.stop();
+});
+
 ipcMain.handle('select-recovery-directory', async () => {
     try {
         const { canceled, filePaths } = await dialog.showOpenDialog({
@@ -369,7 +517,7 @@ async function getLinuxDrives() {
 }
 
 // Scan for deleted files (simplified implementation)
-async function scanForDeletedFiles(drivePath, progressCallback) {
+async function scanForDeletedFiles(drivePath, progressCallback, options = {}) {
     if (process.platform !== 'win32') {
         throw new Error('Native deleted-file scanning is only implemented for Windows in this build.');
     }
@@ -396,13 +544,43 @@ async function scanForDeletedFiles(drivePath, progressCallback) {
     if (usnScanner) {
         progress(70);
         try {
-            usnResults = await scanWindowsUsnJournal(driveLetter);
+            usnResults = await scanWindowsUsnJournal(driveLetter, { carveJournal: Boolean(options.deepScan) });
         } catch (error) {
             console.warn('USN journal scan failed:', error);
         }
     }
 
-    const combined = mergeDeletionResults(recycleResults, usnResults);
+    let carvedResults = [];
+    if (usnScanner && options.deepScan) {
+        progress(80);
+        try {
+            carvedResults = await carveWindowsFreeSpace(driveLetter);
+        } catch (error) {
+            console.warn('Free space carving failed:', error);
+        }
+    }
+
+    let slackResults = [];
+    if (usnScanner && options.deepScan) {
+        progress(90);
+        try {
+            slackResults = await scanWindowsIndexSlack(driveLetter);
+        } catch (error) {
+            console.warn('Directory index slack scan failed:', error);
+        }
+    }
+
+    let logResults = [];
+    if (usnScanner && options.deepScan) {
+        progress(95);
+        try {
+            logResults = await scanWindowsLogFile(driveLetter);
+        } catch (error) {
+            console.warn('$LogFile scan failed:', error);
+        }
+    }
+
+    const combined = mergeDeletionResults(recycleResults, usnResults, carvedResults.concat(slackResults, logResults));
     progress(100);
     return combined;
 }
@@ -426,16 +604,24 @@ async function recoverFile(fileInfo, options = {}) {
     if (
         usnScanner &&
         fileInfo &&
-        fileInfo.source === 'usn-journal' &&
+        (fileInfo.source === 'usn-journal' || fileInfo.source === 'i30-slack') &&
         fileInfo.metadata &&
-        fileInfo.metadata.fileReferenceNumber
+        fileInfo.metadata.fileReferenceNumber &&
+        fileInfo.metadata.fileReferenceNumber !== '0'
     ) {
         const drive = extractDriveLetter(fileInfo) || (fileInfo.metadata.drive || '').toUpperCase();
         if (!drive) {
             throw new Error('Unable to determine drive letter for USN recovery.');
         }
 
+        if (fileInfo.metadata.slotReused) {
+            throw new Error('The MFT record was reused by another file; the data cannot be recovered.');
+        }
+
         const record = await usnScanner.getFileRecord(drive, fileInfo.metadata.fileReferenceNumber);
+        if (record.slotReused) {
+            throw new Error('The MFT record was reused by another file; the data cannot be recovered.');
+        }
         const attributes = Array.isArray(record.attributes) ? record.attributes : [];
         const dataAttribute = attributes.find((attr) => attr.type === 0x80 && (!attr.name || attr.name.length === 0))
             || attributes.find((attr) => attr.type === 0x80);
@@ -444,6 +630,34 @@ async function recoverFile(fileInfo, options = {}) {
             throw new Error('Data attribute not found in MFT record.');
         }
 
+        // CompactOS / compact.exe files keep a sparse unnamed stream and the
+        // real contents in the WofCompressedData stream.
+        const wofAttribute = record.wofAlgorithm !== undefined
+            ? attributes.find((attr) => attr.type === 0x80 && attr.name === 'WofCompressedData')
+            : null;
+        if (wofAttribute) {
+            const wofOptions = { wofAlgorithm: record.wofAlgorithm, uncompressedSize: dataAttribute.dataSize };
+            if (wofAttribute.nonResident) {
+                await usnScanner.recoverDataRuns(
+                    drive,
+                    Array.isArray(wofAttribute.runs) ? wofAttribute.runs : [],
+                    record.clusterSize,
+                    wofAttribute.dataSize,
+                    outputPath,
+                    wofOptions
+                );
+            } else {
+                const stream = Buffer.from(wofAttribute.residentDataBase64 || '', 'base64');
+                const result = await usnScanner.decompressWof(stream, {
+                    algorithm: record.wofAlgorithm,
+                    size: dataAttribute.dataSize
+                });
+                await fsp.writeFile(outputPath, result.data);
+            }
+            fileInfo.size = Number.parseInt(dataAttribute.dataSize, 10);
+            return { success: true, outputPath };
+        }
+
         const fileSizeString = dataAttribute.dataSize || dataAttribute.allocatedSize || '0';
         const clusterSizeString = record.clusterSize || String(record.bytesPerSector * record.sectorsPerCluster || 0);
         const parsedSize = Number.parseInt(fileSizeString, 10);
@@ -462,7 +676,8 @@ async function recoverFile(fileInfo, options = {}) {
                 runs,
                 clusterSizeString,
                 fileSizeString,
-                outputPath
+                outputPath,
+                { compressionUnit: dataAttribute.compressionUnit || 0, device: options.device }
             );
             return { success: true, outputPath };
         }
@@ -477,6 +692,54 @@ async function recoverFile(fileInfo, options = {}) {
         throw new Error('Resident data missing payload for recovery.');
     }
 
+    if (usnScanner && fileInfo && fileInfo.source === 'carved' && fileInfo.metadata) {
+        const drive = (fileInfo.metadata.drive || fileInfo.drive || '').toUpperCase();
+        const alignment = Number.parseInt(fileInfo.metadata.alignment, 10);
+        const length = BigInt(fileInfo.metadata.length);
+        if (!drive || !Number.isFinite(alignment) || alignment <= 0) {
+            throw new Error('Carved entry lacks its drive or alignment.');
+        }
+
+        // Carved hits start on an allocation unit boundary, so each fragment
+        // (the whole hit unless bifragment carving split it) maps onto one
+        // run of `alignment`-sized clusters.
+        const unit = BigInt(alignment);
+        const fragments = Array.isArray(fileInfo.metadata.fragments) && fileInfo.metadata.fragments.length
+            ? fileInfo.metadata.fragments
+            : [{ offset: fileInfo.metadata.offset, length: fileInfo.metadata.length }];
+        const runs = fragments.map((fragment) => ({
+            lcn: (BigInt(fragment.offset) / unit).toString(),
+            length: ((BigInt(fragment.length) + unit - 1n) / unit).toString()
+        }));
+
+        await usnScanner.recoverDataRuns(drive, runs, String(alignment), length.toString(), outputPath, { device: options.device });
+        return { success: true, outputPath };
+    }
+
+    if (usnScanner && fileInfo && (fileInfo.source === 'mft-carved' || fileInfo.source === 'logfile') && fileInfo.metadata) {
+        const drive = (fileInfo.metadata.drive || fileInfo.drive || '').toUpperCase();
+        if (fileInfo.metadata.residentDataBase64) {
+            const buffer = Buffer.from(fileInfo.metadata.residentDataBase64, 'base64');
+            await fsp.writeFile(outputPath, buffer);
+            return { success: true, outputPath };
+        }
+
+        const runs = Array.isArray(fileInfo.metadata.runs) ? fileInfo.metadata.runs : [];
+        if (!drive || !runs.length) {
+            throw new Error('Orphan MFT record lacks data runs.');
+        }
+
+        await usnScanner.recoverDataRuns(
+            drive,
+            runs,
+            fileInfo.metadata.clusterSize,
+            fileInfo.metadata.dataSize,
+            outputPath,
+            { compressionUnit: fileInfo.metadata.compressionUnit || 0, device: options.device }
+        );
+        return { success: true, outputPath };
+    }
+
     throw new Error('Binary source not available for this file.');
 }
 
@@ -578,7 +841,7 @@ async function scanWindowsRecycleBin(driveLetter, progressCallback) {
     return results;
 }
 
-async function scanWindowsUsnJournal(driveLetter) {
+async function scanWindowsUsnJournal(driveLetter, scanOptions = {}) {
     if (!usnScanner || typeof usnScanner.scan !== 'function') {
         return [];
     }
@@ -588,7 +851,7 @@ async function scanWindowsUsnJournal(driveLetter) {
         return [];
     }
 
-    const entries = await usnScanner.scan(letter);
+    const entries = await usnScanner.scan(letter, scanOptions);
     const normalized = [];
 
     entries.forEach((entry) => {
@@ -604,17 +867,28 @@ async function scanWindowsUsnJournal(driveLetter) {
         normalized.push({
             name: baseName,
             path: directory,
-            size: 0,
+            size: Number.isFinite(entry.size) ? entry.size : 0,
             deletedTime: timestamp,
-            recoveryChance: 25,
+            // Entries from stale journal pages are older, so their clusters
+            // are more likely to have been reused. A reused MFT slot means the
+            // record already describes another file.
+            recoveryChance: entry.slotReused ? 0 : (entry.carved ? 10 : 25),
             type: inferFileType(normalizedPath),
             recycleBinPath: null,
             source: 'usn-journal',
             drive: letter,
             metadata: {
                 reason: entry.reason,
+                usn: entry.usn,
+                carved: Boolean(entry.carved),
+                slotReused: Boolean(entry.slotReused),
+                allocatedSize: entry.allocatedSize,
+                fragments: entry.fragments,
+                resident: entry.resident,
                 fileReferenceNumber: entry.fileReferenceNumber,
                 parentReferenceNumber: entry.parentReferenceNumber,
+                // Every name the file had; hard links share one recovery.
+                paths: Array.isArray(entry.paths) ? entry.paths : [entry.path],
                 isDirectory: entry.isDirectory,
                 drive: letter
             }
@@ -624,7 +898,157 @@ async function scanWindowsUsnJournal(driveLetter) {
     return normalized;
 }
 
-function mergeDeletionResults(recycleEntries, usnEntries) {
+async function carveWindowsFreeSpace(driveLetter) {
+    if (!usnScanner || typeof usnScanner.carve !== 'function') {
+        return [];
+    }
+
+    const letter = String(driveLetter || '').trim().toUpperCase();
+    if (!letter) {
+        return [];
+    }
+
+    const result = await usnScanner.carve(letter, { bifragment: true, fileRecords: true });
+    const hits = Array.isArray(result.hits) ? result.hits : [];
+    const records = Array.isArray(result.records) ? result.records : [];
+
+    const carved = hits.map((hit) => {
+        const name = `carved_${hit.offset}.${hit.extension}`;
+        return {
+            name,
+            path: `${letter}:\\(carved)`,
+            size: Number(hit.length),
+            deletedTime: null,
+            // Structure-validated hits score close to recycle bin entries;
+            // bare header matches stay at the bottom of the list.
+            recoveryChance: hit.confidence,
+            type: inferFileType(name),
+            recycleBinPath: null,
+            source: 'carved',
+            drive: letter,
+            metadata: {
+                offset: hit.offset,
+                length: hit.length,
+                alignment: result.alignment,
+                complete: hit.complete,
+                fragments: hit.fragments || null,
+                drive: letter
+            }
+        };
+    });
+
+    // Orphaned MFT records keep the original name and run list, so they are
+    // recovered like journal entries rather than by byte range.
+    const orphans = records
+        .filter((record) => !record.isDirectory)
+        .map((record) => ({
+            name: record.name,
+            path: `${letter}:\\(orphan MFT records)`,
+            size: Number(record.dataSize),
+            deletedTime: null,
+            recoveryChance: record.recoveryChance,
+            type: inferFileType(record.name),
+            recycleBinPath: null,
+            source: 'mft-carved',
+            drive: letter,
+            metadata: {
+                offset: record.offset,
+                fileReferenceNumber: record.fileReference,
+                parentReferenceNumber: record.parentReference,
+                modified: record.modified,
+                dataSize: record.dataSize,
+                clusterSize: result.clusterSize,
+                compressionUnit: record.compressionUnit,
+                runs: record.runs,
+                residentDataBase64: record.residentDataBase64 || null,
+                drive: letter
+            }
+        }));
+
+    return carved.concat(orphans);
+}
+
+async function scanWindowsIndexSlack(driveLetter) {
+    if (!usnScanner || typeof usnScanner.scanIndexSlack !== 'function') {
+        return [];
+    }
+
+    const letter = String(driveLetter || '').trim().toUpperCase();
+    if (!letter) {
+        return [];
+    }
+
+    const result = await usnScanner.scanIndexSlack(letter, {});
+    const entries = Array.isArray(result.entries) ? result.entries : [];
+
+    return entries
+        .filter((entry) => entry.slack && !entry.isDirectory)
+        .map((entry) => ({
+            name: entry.name,
+            path: entry.directoryPath,
+            size: Number(entry.dataSize),
+            deletedTime: null,
+            // The key only proves the name existed; the MFT record behind it
+            // may already describe another file.
+            recoveryChance: entry.slotReused ? 0 : (entry.fileReferenceNumber !== '0' ? 15 : 5),
+            type: inferFileType(entry.name),
+            recycleBinPath: null,
+            source: 'i30-slack',
+            drive: letter,
+            metadata: {
+                fileReferenceNumber: entry.fileReferenceNumber,
+                parentReferenceNumber: entry.parentReferenceNumber,
+                slotReused: Boolean(entry.slotReused),
+                modified: entry.modified,
+                mftModified: entry.mftModified,
+                drive: letter
+            }
+        }));
+}
+
+async function scanWindowsLogFile(driveLetter) {
+    if (!usnScanner || typeof usnScanner.parseLogFile !== 'function') {
+        return [];
+    }
+
+    const letter = String(driveLetter || '').trim().toUpperCase();
+    if (!letter) {
+        return [];
+    }
+
+    const result = await usnScanner.parseLogFile(letter, {});
+    const records = Array.isArray(result.records) ? result.records : [];
+
+    return records
+        .filter((record) => record.deallocated && !record.isDirectory)
+        .map((record) => ({
+            name: record.name,
+            path: `${letter}:\\($LogFile)`,
+            size: Number(record.dataSize),
+            deletedTime: null,
+            // Resident data comes straight out of the log; clusters named by
+            // a run list may have been reallocated since.
+            recoveryChance: record.resident ? 90 : 30,
+            type: inferFileType(record.name),
+            recycleBinPath: null,
+            source: 'logfile',
+            drive: letter,
+            metadata: {
+                lsn: record.lsn,
+                fileReferenceNumber: record.fileReference,
+                parentReferenceNumber: record.parentReference,
+                modified: record.modified,
+                dataSize: record.dataSize,
+                clusterSize: result.clusterSize,
+                compressionUnit: record.compressionUnit,
+                runs: record.runs,
+                residentDataBase64: record.residentDataBase64 || null,
+                drive: letter
+            }
+        }));
+}
+
+function mergeDeletionResults(recycleEntries, usnEntries, carvedEntries = []) {
     const combined = new Map();
 
     const addEntry = (entry) => {
@@ -649,12 +1073,16 @@ function mergeDeletionResults(recycleEntries, usnEntries) {
 
     (recycleEntries || []).forEach(addEntry);
     (usnEntries || []).forEach(addEntry);
+    (carvedEntries || []).forEach(addEntry);
 
     return Array.from(combined.values()).sort((a, b) => {
         if (a.deletedTime && b.deletedTime) {
             return b.deletedTime.localeCompare(a.deletedTime);
         }
-        return 0;
+        if (a.deletedTime || b.deletedTime) {
+            return a.deletedTime ? -1 : 1;
+        }
+        return (b.recoveryChance || 0) - (a.recoveryChance || 0);
     });
 }
 
@@ -1,15 +1,210 @@
 #include <napi.h>
+#ifdef _WIN32
 #include <windows.h>
 #include <winioctl.h>
+#endif
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <cstring>
 #include <cwctype>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "carver.h"
+#include "deleted_tree.h"
+#include "deletion_analytics.h"
+#include "deletion_watch.h"
+#include "fragment_carver.h"
+#include "index_slack.h"
+#include "io_profile.h"
+#include "io_throttle.h"
+#include "logfile.h"
+#include "lznt1.h"
+#include "mft_reader.h"
+#include "multi_volume_scan.h"
+#include "ntfs_record.h"
+#include "record_carver.h"
+#include "resident_export.h"
+#include "result_export.h"
+#include "result_store.h"
+#include "scan_aggregate.h"
+#include "snapshot.h"
+#include "timeline.h"
+#include "tree_recovery.h"
+#include "usn_carver.h"
+#include "usn_journal.h"
+#include "volume_reader.h"
+#include "wof.h"
 
 namespace {
 
+std::string Base64Encode(const uint8_t *data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    output.reserve(((length + 2) / 3) * 4);
+
+    size_t i = 0;
+    while (i + 2 < length) {
+        uint32_t triple = (static_cast<uint32_t>(data[i]) << 16) |
+                          (static_cast<uint32_t>(data[i + 1]) << 8) |
+                          static_cast<uint32_t>(data[i + 2]);
+        output.push_back(alphabet[(triple >> 18) & 0x3F]);
+        output.push_back(alphabet[(triple >> 12) & 0x3F]);
+        output.push_back(alphabet[(triple >> 6) & 0x3F]);
+        output.push_back(alphabet[triple & 0x3F]);
+        i += 3;
+    }
+
+    if (i < length) {
+        uint32_t triple = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < length) {
+            triple |= static_cast<uint32_t>(data[i + 1]) << 8;
+        }
+
+        output.push_back(alphabet[(triple >> 18) & 0x3F]);
+        output.push_back(alphabet[(triple >> 12) & 0x3F]);
+        if (i + 1 < length) {
+            output.push_back(alphabet[(triple >> 6) & 0x3F]);
+        } else {
+            output.push_back('=');
+        }
+        output.push_back('=');
+    }
+
+    return output;
+}
+
+// Reads the "device" option shared by the recovery bindings: "auto" (or
+// nothing), "rotational", "ssd" or "probe".
+bool ReadIoProfileMode(const Napi::Value &value, usnscanner::IoProfileMode &mode) {
+    mode = usnscanner::IoProfileMode::Detect;
+    if (value.IsUndefined() || value.IsNull()) {
+        return true;
+    }
+    return value.IsString() && usnscanner::ParseIoProfileMode(value.As<Napi::String>(), mode);
+}
+
+Napi::Object IoProfileValue(const Napi::Env &env, const usnscanner::IoProfile &profile) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("device", Napi::String::New(env, usnscanner::DeviceClassName(profile.deviceClass)));
+    result.Set("basis", Napi::String::New(env, usnscanner::IoProfileBasisName(profile.basis)));
+    result.Set("readSize", Napi::Number::New(env, static_cast<double>(profile.readSize)));
+    result.Set("gatherGap", Napi::Number::New(env, static_cast<double>(profile.gatherGap)));
+    result.Set("queueDepth", Napi::Number::New(env, static_cast<double>(profile.queueDepth)));
+    return result;
+}
+
+// Enumerations in flight (scan, scanDeletedTree and scanAll), keyed by
+// binding, source and options. A request identical to one still running
+// joins it instead of walking the volume a second time, and gets its own
+// copy of the results when that scan finishes. Only touched on the JS thread.
+struct ScanFlight {
+    std::vector<Napi::FunctionReference> joined;
+    // Progress callbacks of joined scanAll requests.
+    std::vector<Napi::FunctionReference> progress;
+};
+
+struct ScanFlightCounters {
+    uint64_t started;
+    uint64_t joined;
+};
+
+std::unordered_map<std::string, ScanFlight> scanFlights;
+ScanFlightCounters scanFlightCounters{};
+
+// "C", "c:" and "C:\" name the same volume; image paths are taken as given.
+std::string FlightSource(const std::string &source) {
+    char letter = 0;
+    if (usnscanner::IsDriveLetterSource(source, letter)) {
+        return std::string(1, static_cast<char>(::toupper(static_cast<unsigned char>(letter)))) + ":";
+    }
+    return source;
+}
+
+// Joins the flight for `key` when one is running and returns true; otherwise
+// opens one for the caller to start. An empty key never coalesces.
+bool JoinScanFlight(const std::string &key, const Napi::Function &callback, const Napi::Function &onProgress = Napi::Function()) {
+    if (key.empty()) {
+        return false;
+    }
+    auto flight = scanFlights.find(key);
+    if (flight == scanFlights.end()) {
+        scanFlights.emplace(key, ScanFlight{});
+        ++scanFlightCounters.started;
+        return false;
+    }
+    flight->second.joined.push_back(Napi::Persistent(callback));
+    if (!onProgress.IsEmpty()) {
+        flight->second.progress.push_back(Napi::Persistent(onProgress));
+    }
+    ++scanFlightCounters.joined;
+    return true;
+}
+
+// Hands the outcome to the request that ran the scan and to every identical
+// one that joined while it ran; `outcome` is evaluated once per caller, so
+// each gets its own value. The flight is closed first, so a callback that
+// scans again starts afresh; an exception thrown by one callback is held
+// until the others have run.
+void DeliverScanFlight(
+    Napi::Env env,
+    const std::string &key,
+    const Napi::FunctionReference &own,
+    bool failed,
+    const std::function<Napi::Value(Napi::Env)> &outcome) {
+    std::vector<Napi::FunctionReference> joined;
+    auto flight = scanFlights.find(key);
+    if (!key.empty() && flight != scanFlights.end()) {
+        joined = std::move(flight->second.joined);
+        scanFlights.erase(flight);
+    }
+
+    auto call = [&](const Napi::FunctionReference &callback) {
+        Napi::Value value = outcome(env);
+        if (failed) {
+            callback.Call({ value, env.Undefined() });
+        } else {
+            callback.Call({ env.Null(), value });
+        }
+    };
+    call(own);
+    Napi::Error thrown;
+    for (const auto &callback : joined) {
+        if (env.IsExceptionPending()) {
+            Napi::Error error = env.GetAndClearPendingException();
+            if (thrown.IsEmpty()) {
+                thrown = std::move(error);
+            }
+        }
+        call(callback);
+    }
+    if (!thrown.IsEmpty() && !env.IsExceptionPending()) {
+        thrown.ThrowAsJavaScriptException();
+    }
+}
+
+// Counters of the scan coalescing: enumerations actually started,
+// requests that joined one already running, and how many are running now.
+Napi::Value ScanDedupStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    size_t waiting = 0;
+    for (const auto &flight : scanFlights) {
+        waiting += flight.second.joined.size();
+    }
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("started", Napi::Number::New(env, static_cast<double>(scanFlightCounters.started)));
+    result.Set("joined", Napi::Number::New(env, static_cast<double>(scanFlightCounters.joined)));
+    result.Set("inFlight", Napi::Number::New(env, static_cast<double>(scanFlights.size())));
+    result.Set("waiting", Napi::Number::New(env, static_cast<double>(waiting)));
+    return result;
+}
+
+#ifdef _WIN32
+
 struct FileEntry {
     ULONGLONG parentRef;
     std::string name;
@@ -23,9 +218,11 @@ struct DeletedRecord {
     bool isDirectory;
     double timestampMs;
     DWORD reason;
+    ULONGLONG usn;
+    // Recovered from a stale journal page rather than the live journal.
+    bool carved;
 };
 
-#pragma pack(push, 1)
 #pragma pack(push, 1)
 struct NtfsFileRecordInputBuffer {
     ULONGLONG FileReferenceNumber;
@@ -36,71 +233,14 @@ struct NtfsFileRecordOutputBuffer {
     DWORD FileRecordLength;
     BYTE FileRecordBuffer[1];
 };
-
-struct FileRecordHeader {
-    DWORD Magic; // 'FILE'
-    WORD UpdateSequenceOffset;
-    WORD UpdateSequenceSize;
-    ULONGLONG LogFileSequenceNumber;
-    WORD SequenceNumber;
-    WORD HardLinkCount;
-    WORD FirstAttributeOffset;
-    WORD Flags;
-    DWORD BytesInUse;
-    DWORD BytesAllocated;
-    ULONGLONG BaseFileRecord;
-    WORD NextAttributeId;
-    WORD Padding;
-    DWORD MftRecordNumber;
-};
-
-struct AttributeRecordHeader {
-    DWORD Type;
-    DWORD Length;
-    BYTE NonResident;
-    BYTE NameLength;
-    WORD NameOffset;
-    WORD Flags;
-    WORD Instance;
-    union {
-        struct {
-            DWORD ValueLength;
-            WORD ValueOffset;
-            BYTE Flags;
-            BYTE Reserved;
-        } Resident;
-        struct {
-            ULONGLONG LowestVcn;
-            ULONGLONG HighestVcn;
-            WORD RunOffset;
-            WORD CompressionUnit;
-            DWORD Padding;
-            ULONGLONG AllocatedSize;
-            ULONGLONG DataSize;
-            ULONGLONG InitializedSize;
-            ULONGLONG CompressedSize;
-        } NonResidentData;
-    };
-};
 #pragma pack(pop)
 
-struct DataRunSegment {
-    long long vcnStart;
-    long long lcn;
-    long long length;
-    bool sparse;
-};
-
-struct AttributeInfo {
-    DWORD type;
-    std::string typeName;
-    bool nonResident;
-    std::string name;
-    ULONGLONG dataSize;
-    ULONGLONG allocatedSize;
-    std::vector<DataRunSegment> runs;
-    std::vector<uint8_t> residentData;
-};
+// Raw volume handles opened here bypass VolumeReader, so their enumeration
+// ioctls pass through the process-wide I/O limits on their own.
+BOOL ThrottledDeviceIoControl(HANDLE handle, DWORD code, void *in, DWORD inLength, void *out, DWORD outLength, DWORD *returned) {
+    usnscanner::IoThrottleScope throttle(outLength);
+    return ::DeviceIoControl(handle, code, in, inLength, out, outLength, returned, nullptr);
+}
 
 std::string WideToUtf8(const std::wstring &input) {
     if (input.empty()) {
@@ -132,42 +272,6 @@ std::wstring Utf8ToWide(const std::string &input) {
     return output;
 }
 
-std::string Base64Encode(const uint8_t *data, size_t length) {
-    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string output;
-    output.reserve(((length + 2) / 3) * 4);
-
-    size_t i = 0;
-    while (i + 2 < length) {
-        uint32_t triple = (static_cast<uint32_t>(data[i]) << 16) |
-                          (static_cast<uint32_t>(data[i + 1]) << 8) |
-                          static_cast<uint32_t>(data[i + 2]);
-        output.push_back(alphabet[(triple >> 18) & 0x3F]);
-        output.push_back(alphabet[(triple >> 12) & 0x3F]);
-        output.push_back(alphabet[(triple >> 6) & 0x3F]);
-        output.push_back(alphabet[triple & 0x3F]);
-        i += 3;
-    }
-
-    if (i < length) {
-        uint32_t triple = static_cast<uint32_t>(data[i]) << 16;
-        if (i + 1 < length) {
-            triple |= static_cast<uint32_t>(data[i + 1]) << 8;
-        }
-
-        output.push_back(alphabet[(triple >> 18) & 0x3F]);
-        output.push_back(alphabet[(triple >> 12) & 0x3F]);
-        if (i + 1 < length) {
-            output.push_back(alphabet[(triple >> 6) & 0x3F]);
-        } else {
-            output.push_back('=');
-        }
-        output.push_back('=');
-    }
-
-    return output;
-}
-
 double FileTimeToUnixMilliseconds(const LARGE_INTEGER &time) {
     const long long WINDOWS_EPOCH_OFFSET_MS = 11644473600000LL;
     const long long HUNDRED_NANOSECONDS_PER_MILLISECOND = 10000LL;
@@ -177,97 +281,6 @@ double FileTimeToUnixMilliseconds(const LARGE_INTEGER &time) {
     return static_cast<double>(unixMs);
 }
 
-std::string AttributeTypeToString(DWORD type) {
-    switch (type) {
-        case 0x10: return "StandardInformation";
-        case 0x20: return "AttributeList";
-        case 0x30: return "FileName";
-        case 0x40: return "ObjectId";
-        case 0x50: return "SecurityDescriptor";
-        case 0x60: return "VolumeName";
-        case 0x70: return "VolumeInformation";
-        case 0x80: return "Data";
-        case 0x90: return "IndexRoot";
-        case 0xA0: return "IndexAllocation";
-        case 0xB0: return "Bitmap";
-        case 0xC0: return "ReparsePoint";
-        case 0xD0: return "EAInformation";
-        case 0xE0: return "EA";
-        case 0xF0: return "PropertySet";
-        case 0x100: return "LoggedUtilityStream";
-        default: return "Unknown";
-    }
-}
-
-std::string ExtractAttributeName(const AttributeRecordHeader *header) {
-    if (!header || header->NameLength == 0) {
-        return std::string();
-    }
-
-    const WCHAR *namePtr = reinterpret_cast<const WCHAR *>(
-        reinterpret_cast<const BYTE *>(header) + header->NameOffset
-    );
-    std::wstring wide(namePtr, header->NameLength);
-    return WideToUtf8(wide);
-}
-
-long long ReadSignedValue(const BYTE *data, int size) {
-    if (size <= 0 || size > 8) {
-        return 0;
-    }
-
-    long long value = 0;
-    for (int i = 0; i < size; ++i) {
-        value |= static_cast<long long>(data[i]) << (8 * i);
-    }
-
-    if (size < 8 && (data[size - 1] & 0x80)) {
-        value |= -1LL << (size * 8);
-    }
-
-    return value;
-}
-
-std::vector<DataRunSegment> ParseRunList(const AttributeRecordHeader *header) {
-    std::vector<DataRunSegment> runs;
-    if (!header || header->NonResident == 0) {
-        return runs;
-    }
-
-    const BYTE *base = reinterpret_cast<const BYTE *>(header);
-    const BYTE *runPtr = base + header->NonResidentData.RunOffset;
-    const BYTE *end = base + header->Length;
-
-    long long currentVCN = static_cast<long long>(header->NonResidentData.LowestVcn);
-    long long currentLCN = 0;
-
-    while (runPtr < end && *runPtr != 0) {
-        BYTE headerByte = *runPtr++;
-        int lengthFieldSize = headerByte & 0x0F;
-        int offsetFieldSize = (headerByte >> 4) & 0x0F;
-
-        if (lengthFieldSize <= 0 || offsetFieldSize < 0 || runPtr + lengthFieldSize + offsetFieldSize > end) {
-            break;
-        }
-
-        long long runLength = 0;
-        for (int i = 0; i < lengthFieldSize; ++i) {
-            runLength |= static_cast<long long>(runPtr[i]) << (8 * i);
-        }
-        runPtr += lengthFieldSize;
-
-        bool sparse = (offsetFieldSize == 0);
-        long long runOffset = ReadSignedValue(runPtr, offsetFieldSize);
-        runPtr += offsetFieldSize;
-
-        currentLCN += runOffset;
-        runs.push_back({ currentVCN, currentLCN, runLength, sparse });
-        currentVCN += runLength;
-    }
-
-    return runs;
-}
-
 bool TryParseUnsigned(const std::string &input, ULONGLONG &output) {
     try {
         size_t idx = 0;
@@ -288,84 +301,21 @@ bool TryParseSigned(const std::string &input, long long &output) {
     }
 }
 
-struct FileRecordDetails {
-    bool inUse;
-    bool isDirectory;
-    ULONGLONG baseReference;
-    DWORD hardLinkCount;
-    DWORD flags;
-    std::vector<AttributeInfo> attributes;
-    DWORD bytesPerSector;
-    DWORD sectorsPerCluster;
-    ULONGLONG clusterSize;
-};
-
-bool ParseFileRecord(const BYTE *buffer, DWORD length, FileRecordDetails &details) {
-    if (!buffer || length < sizeof(FileRecordHeader)) {
-        return false;
-    }
-
-    const FileRecordHeader *header = reinterpret_cast<const FileRecordHeader *>(buffer);
-    if (header->Magic != 0x454C4946) { // 'FILE'
-        return false;
+std::string ScanFlightKey(const std::string &drive, bool carveJournal) {
+    if (drive.empty()) {
+        return std::string();
     }
-
-    details.inUse = (header->Flags & 0x0001) != 0;
-    details.isDirectory = (header->Flags & 0x0002) != 0;
-    details.baseReference = header->BaseFileRecord;
-    details.hardLinkCount = header->HardLinkCount;
-    details.flags = header->Flags;
-    details.attributes.clear();
-    details.bytesPerSector = 0;
-    details.sectorsPerCluster = 0;
-    details.clusterSize = 0;
-
-    const BYTE *attrPtr = buffer + header->FirstAttributeOffset;
-    const BYTE *end = buffer + length;
-
-    while (attrPtr + sizeof(AttributeRecordHeader) <= end) {
-        const AttributeRecordHeader *attr = reinterpret_cast<const AttributeRecordHeader *>(attrPtr);
-        if (attr->Type == 0xFFFFFFFF || attr->Length == 0) {
-            break;
-        }
-        if (attrPtr + attr->Length > end) {
-            break;
-        }
-
-        AttributeInfo info{};
-        info.type = attr->Type;
-        info.typeName = AttributeTypeToString(attr->Type);
-        info.nonResident = attr->NonResident != 0;
-        info.name = ExtractAttributeName(attr);
-        info.dataSize = 0;
-        info.allocatedSize = 0;
-
-        if (info.nonResident) {
-            info.dataSize = attr->NonResidentData.DataSize;
-            info.allocatedSize = attr->NonResidentData.AllocatedSize;
-            info.runs = ParseRunList(attr);
-        } else {
-            info.dataSize = attr->Resident.ValueLength;
-            info.allocatedSize = attr->Resident.ValueLength;
-            DWORD valueOffset = attr->Resident.ValueOffset;
-            DWORD valueLength = attr->Resident.ValueLength;
-            if (valueOffset + valueLength <= attr->Length && valueLength > 0) {
-                const BYTE *valuePtr = reinterpret_cast<const BYTE *>(attr) + valueOffset;
-                info.residentData.assign(valuePtr, valuePtr + valueLength);
-            }
-        }
-
-        details.attributes.push_back(std::move(info));
-        attrPtr += attr->Length;
+    std::string key(1, static_cast<char>(::toupper(static_cast<unsigned char>(drive[0]))));
+    if (carveJournal) {
+        key += "+carve";
     }
-
-    return true;
+    return key;
 }
 
 class ScanUsnWorker : public Napi::AsyncWorker {
   public:
-    ScanUsnWorker(const std::string &driveLetter, const Napi::Function &callback)
-        : Napi::AsyncWorker(callback), drive_(driveLetter) {}
+    ScanUsnWorker(const std::string &driveLetter, bool carveJournal, const std::string &flightKey, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), drive_(driveLetter), carveJournal_(carveJournal), flightKey_(flightKey) {}
 
     void Execute() override {
         if (drive_.empty()) {
@@ -374,7 +324,7 @@ class ScanUsnWorker : public Napi::AsyncWorker {
         }
 
         wchar_t driveChar = static_cast<wchar_t>(::towupper(static_cast<unsigned char>(drive_[0])));
-        std::wstring volumePath = L"\\.\\";
+        std::wstring volumePath = L"\\\\.\\";
         volumePath.push_back(driveChar);
         volumePath.push_back(L':');
 
@@ -425,15 +375,14 @@ class ScanUsnWorker : public Napi::AsyncWorker {
 
         while (true) {
             DWORD bytesReturned = 0;
-            BOOL ok = ::DeviceIoControl(
+            BOOL ok = ThrottledDeviceIoControl(
                 volumeHandle,
                 FSCTL_ENUM_USN_DATA,
                 &med,
                 sizeof(med),
                 buffer.data(),
                 bufferSize,
-                &bytesReturned,
-                nullptr
+                &bytesReturned
             );
 
             if (!ok) {
@@ -471,7 +420,9 @@ class ScanUsnWorker : public Napi::AsyncWorker {
                 std::string name = WideToUtf8(wName);
                 bool isDirectory = (record->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 
-                fileTable[fileRef] = { parentRef, name, isDirectory };
+                // Files with several hard links are enumerated once per link;
+                // paths only need one name per directory, so the first stays.
+                fileTable.emplace(fileRef, FileEntry{ parentRef, name, isDirectory });
 
                 if (record->Reason & USN_REASON_FILE_DELETE) {
                     DeletedRecord item{};
@@ -481,6 +432,8 @@ class ScanUsnWorker : public Napi::AsyncWorker {
                     item.isDirectory = isDirectory;
                     item.timestampMs = FileTimeToUnixMilliseconds(record->TimeStamp);
                     item.reason = record->Reason;
+                    item.usn = static_cast<ULONGLONG>(record->Usn);
+                    item.carved = false;
                     deleted.push_back(item);
                 }
 
@@ -493,122 +446,352 @@ class ScanUsnWorker : public Napi::AsyncWorker {
 
         ::CloseHandle(volumeHandle);
 
-        results_.reserve(deleted.size());
-        const char upperDriveChar = drive_.empty() ? '?' : static_cast<char>(::toupper(static_cast<unsigned char>(drive_[0])));
+        if (carveJournal_ && !CarveStaleJournal(fileTable, deleted)) {
+            return;
+        }
 
+        // One result per file reference: a file deleted through several links,
+        // or seen both live and carved, is recovered once and reports every
+        // name it had.
+        std::unordered_map<ULONGLONG, size_t> byReference;
+        results_.reserve(deleted.size());
         for (const auto &item : deleted) {
-            std::string fullPath;
-            fullPath.push_back(upperDriveChar);
-            fullPath.append(":\\");
-
-            std::vector<std::string> segments;
-            segments.push_back(item.name);
-
-            ULONGLONG current = item.parentRef;
-            int guard = 0;
-            const int maxDepth = 1024;
-            while (current != 0 && guard < maxDepth) {
-                auto it = fileTable.find(current);
-                if (it == fileTable.end()) {
-                    break;
-                }
-                if (!it->second.name.empty()) {
-                    segments.push_back(it->second.name);
-                }
-                if (current == it->second.parentRef) {
-                    break;
-                }
-                current = it->second.parentRef;
-                guard++;
-            }
-
-            for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
-                if (!fullPath.empty() && fullPath.back() != '\\') {
-                    fullPath.push_back('\\');
+            auto found = byReference.find(item.fileRef);
+            if (found != byReference.end()) {
+                Result &existing = results_[found->second];
+                if (existing.parentRef != item.parentRef || existing.name != item.name) {
+                    usnscanner::AddNameLink(nameLinks_, existing.links, item.parentRef, item.name);
                 }
-                fullPath += *it;
+                continue;
             }
+            byReference.emplace(item.fileRef, results_.size());
 
             Result result;
             result.fileRef = item.fileRef;
             result.parentRef = item.parentRef;
             result.name = item.name;
-            result.fullPath = fullPath;
+            result.links = usnscanner::kNoNameLink;
             result.isDirectory = item.isDirectory;
             result.timestampMs = item.timestampMs;
             result.reason = item.reason;
+            result.usn = item.usn;
+            result.carved = item.carved;
+            result.sizeKnown = false;
+            result.slotReused = false;
+            result.resident = false;
+            result.size = 0;
+            result.allocatedSize = 0;
+            result.fragments = 0;
             results_.push_back(result);
         }
+
+        ReadRecordState();
+
+        for (auto &result : results_) {
+            result.fullPath = BuildPath(fileTable, result.parentRef, result.name);
+            for (uint32_t link = result.links; link != usnscanner::kNoNameLink; link = nameLinks_[link].next) {
+                result.otherPaths.push_back(BuildPath(fileTable, nameLinks_[link].parentReference, nameLinks_[link].name));
+            }
+        }
     }
 
     void OnOK() override {
         Napi::Env env = Env();
         Napi::HandleScope scope(env);
+        DeliverScanFlight(env, flightKey_, Callback(), false, [this](Napi::Env env) -> Napi::Value { return BuildResults(env); });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Napi::Value error = e.Value();
+        DeliverScanFlight(env, flightKey_, Callback(), true, [error](Napi::Env) { return error; });
+    }
+
+  private:
+    struct Result {
+        ULONGLONG fileRef;
+        ULONGLONG parentRef;
+        std::string name;
+        // Further names, chained through nameLinks_ until paths are built.
+        uint32_t links;
+        std::string fullPath;
+        std::vector<std::string> otherPaths;
+        bool isDirectory;
+        double timestampMs;
+        DWORD reason;
+        ULONGLONG usn;
+        bool carved;
+        // Filled from the (possibly deallocated) MFT record when readable.
+        bool sizeKnown;
+        // The record slot now holds another file; nothing is recoverable.
+        bool slotReused;
+        bool resident;
+        ULONGLONG size;
+        ULONGLONG allocatedSize;
+        uint32_t fragments;
+    };
 
+    Napi::Array BuildResults(Napi::Env env) const {
         Napi::Array arr = Napi::Array::New(env, results_.size());
         for (size_t i = 0; i < results_.size(); ++i) {
             const auto &res = results_[i];
             Napi::Object obj = Napi::Object::New(env);
             obj.Set("name", Napi::String::New(env, res.name));
             obj.Set("path", Napi::String::New(env, res.fullPath));
+            Napi::Array paths = Napi::Array::New(env, res.otherPaths.size() + 1);
+            paths.Set(0u, Napi::String::New(env, res.fullPath));
+            for (size_t p = 0; p < res.otherPaths.size(); ++p) {
+                paths.Set(static_cast<uint32_t>(p + 1), Napi::String::New(env, res.otherPaths[p]));
+            }
+            obj.Set("paths", paths);
             obj.Set("fileReferenceNumber", Napi::String::New(env, std::to_string(res.fileRef)));
+            obj.Set("recordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(res.fileRef))));
+            obj.Set("sequence", Napi::Number::New(env, usnscanner::ReferenceSequence(res.fileRef)));
             obj.Set("parentReferenceNumber", Napi::String::New(env, std::to_string(res.parentRef)));
+            obj.Set("parentRecordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(res.parentRef))));
+            obj.Set("slotReused", Napi::Boolean::New(env, res.slotReused));
             obj.Set("isDirectory", Napi::Boolean::New(env, res.isDirectory));
             obj.Set("timestampMs", Napi::Number::New(env, res.timestampMs));
             obj.Set("reason", Napi::Number::New(env, static_cast<double>(res.reason)));
+            obj.Set("usn", Napi::String::New(env, std::to_string(res.usn)));
+            obj.Set("carved", Napi::Boolean::New(env, res.carved));
+            if (res.sizeKnown) {
+                obj.Set("size", Napi::Number::New(env, static_cast<double>(res.size)));
+                obj.Set("allocatedSize", Napi::Number::New(env, static_cast<double>(res.allocatedSize)));
+                obj.Set("fragments", Napi::Number::New(env, res.fragments));
+                obj.Set("resident", Napi::Boolean::New(env, res.resident));
+            }
             obj.Set("drive", Napi::String::New(env, drive_));
             arr.Set(i, obj);
         }
 
-        Callback().Call({ env.Null(), arr });
-    }
-
-    void OnError(const Napi::Error &e) override {
-        Napi::Env env = Env();
-        Napi::HandleScope scope(env);
-        Callback().Call({ e.Value(), env.Undefined() });
+        return arr;
     }
 
-  private:
-    struct Result {
-        ULONGLONG fileRef;
-        ULONGLONG parentRef;
-        std::string name;
+    std::string BuildPath(const std::unordered_map<ULONGLONG, FileEntry> &fileTable, ULONGLONG parentRef, const std::string &name) const {
         std::string fullPath;
-        bool isDirectory;
-        double timestampMs;
-        DWORD reason;
-    };
-
-    std::string drive_;
-    std::string errorMessage_;
-    std::vector<Result> results_;
-};
+        fullPath.push_back(drive_.empty() ? '?' : static_cast<char>(::toupper(static_cast<unsigned char>(drive_[0]))));
+        fullPath.append(":\\");
+
+        std::vector<const std::string *> segments;
+        segments.push_back(&name);
+
+        ULONGLONG current = parentRef;
+        int guard = 0;
+        const int maxDepth = 1024;
+        while (current != 0 && guard < maxDepth) {
+            auto it = fileTable.find(current);
+            if (it == fileTable.end()) {
+                break;
+            }
+            if (!it->second.name.empty()) {
+                segments.push_back(&it->second.name);
+            }
+            if (current == it->second.parentRef) {
+                break;
+            }
+            current = it->second.parentRef;
+            guard++;
+        }
 
-class FileRecordWorker : public Napi::AsyncWorker {
-  public:
-    FileRecordWorker(const std::string &driveLetter, ULONGLONG fileReference, const Napi::Function &callback)
-        : Napi::AsyncWorker(callback), drive_(driveLetter), fileRef_(fileReference) {}
+        for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+            if (!fullPath.empty() && fullPath.back() != '\\') {
+                fullPath.push_back('\\');
+            }
+            fullPath += **it;
+        }
+        return fullPath;
+    }
 
-    void Execute() override {
-        if (drive_.empty()) {
-            SetError("Drive letter is required");
+    // Reads every result's MFT record in one sorted, batched pass. A record
+    // whose sequence number shows the slot was reused is flagged instead;
+    // otherwise the $DATA sizes and extent count are taken from it (deleted
+    // records keep their attributes until the slot is reused), along with the
+    // hard links the journal did not name. Failures only leave sizes unknown.
+    void ReadRecordState() {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (results_.empty() || !reader.Open(drive_, error)) {
+            return;
+        }
+        usnscanner::MftReader mft(reader);
+        if (!mft.Open(error)) {
             return;
         }
 
-        wchar_t driveChar = static_cast<wchar_t>(::towupper(static_cast<unsigned char>(drive_[0])));
-        std::wstring volumePath = L"\\\\.\\";
-        volumePath.push_back(driveChar);
-        volumePath.push_back(L':');
+        std::vector<std::pair<uint64_t, size_t>> wanted;
+        wanted.reserve(results_.size());
+        for (size_t i = 0; i < results_.size(); ++i) {
+            wanted.emplace_back(usnscanner::ReferenceRecordNumber(results_[i].fileRef), i);
+        }
+        std::sort(wanted.begin(), wanted.end());
+        std::vector<uint64_t> recordNumbers;
+        recordNumbers.reserve(wanted.size());
+        for (const auto &item : wanted) {
+            recordNumbers.push_back(item.first);
+        }
 
-        DWORD sectorsPerCluster = 0;
-        DWORD bytesPerSector = 0;
-        DWORD numberOfFreeClusters = 0;
-        DWORD totalNumberOfClusters = 0;
+        size_t next = 0;
+        mft.ReadRecords(recordNumbers, [&](uint64_t recordNumber, const uint8_t *record, uint32_t size) {
+            while (next < wanted.size() && wanted[next].first < recordNumber) {
+                ++next;
+            }
+            usnscanner::FileRecordDetails details{};
+            if (next >= wanted.size() || wanted[next].first != recordNumber || !usnscanner::ParseFileRecord(record, size, details)) {
+                return;
+            }
 
-        std::wstring rootPath;
-        rootPath.push_back(driveChar);
-        rootPath.append(L":\\");
+            size_t first = next;
+            bool anyIntact = false;
+            for (; next < wanted.size() && wanted[next].first == recordNumber; ++next) {
+                Result &result = results_[wanted[next].second];
+                result.slotReused = usnscanner::SlotReused(result.fileRef, details.sequenceNumber, details.inUse);
+                anyIntact = anyIntact || !result.slotReused;
+            }
+            if (!anyIntact) {
+                return;
+            }
+
+            std::vector<usnscanner::FileNameInfo> names = usnscanner::ReadLinkNames(details);
+            for (size_t i = first; i < next; ++i) {
+                Result &result = results_[wanted[i].second];
+                if (result.slotReused) {
+                    continue;
+                }
+                for (const auto &name : names) {
+                    if (name.parentReference != result.parentRef || name.name != result.name) {
+                        usnscanner::AddNameLink(nameLinks_, result.links, name.parentReference, name.name);
+                    }
+                }
+            }
+
+            usnscanner::DataStreamSummary data = usnscanner::SummarizeData(details);
+            if (!data.present) {
+                // $DATA lives in extension records; the $FILE_NAME copy of the
+                // size is as of the last rename but better than nothing.
+                for (const auto &attribute : details.attributes) {
+                    usnscanner::FileNameInfo name{};
+                    if (attribute.type == usnscanner::kAttributeFileName && !attribute.nonResident &&
+                        usnscanner::ParseFileName(attribute.residentData, name)) {
+                        data.present = true;
+                        data.dataSize = name.dataSize;
+                        data.allocatedSize = name.allocatedSize;
+                        break;
+                    }
+                }
+            }
+            if (!data.present) {
+                return;
+            }
+
+            for (size_t i = first; i < next; ++i) {
+                Result &result = results_[wanted[i].second];
+                if (result.slotReused) {
+                    continue;
+                }
+                result.sizeKnown = true;
+                result.resident = data.resident;
+                result.size = data.dataSize;
+                result.allocatedSize = data.allocatedSize;
+                result.fragments = data.fragments;
+            }
+        }, error);
+    }
+
+    // Deletions that already rotated out of $J survive in journal pages left
+    // in free clusters. Their create/rename records also name directories that
+    // are gone from the MFT, so they feed path reconstruction as well; live
+    // entries always take precedence.
+    bool CarveStaleJournal(std::unordered_map<ULONGLONG, FileEntry> &fileTable, std::vector<DeletedRecord> &deleted) {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(drive_, error)) {
+            SetError(error);
+            return false;
+        }
+
+        uint64_t clusterSize = 0;
+        std::vector<usnscanner::ByteRange> ranges;
+        if (!usnscanner::QueryFreeSpaceRanges(reader, clusterSize, ranges, error)) {
+            SetError(error);
+            return false;
+        }
+
+        usnscanner::UsnRecordScanner scanner(static_cast<uint32_t>(clusterSize), 0, 0);
+        usnscanner::CarveEngine engine(reader, { 0, 0, 0 });
+        engine.AddScanner(&scanner);
+        if (!engine.Run(ranges, error)) {
+            SetError(error);
+            return false;
+        }
+
+        std::unordered_set<ULONGLONG> liveUsns;
+        for (const auto &item : deleted) {
+            liveUsns.insert(item.usn);
+        }
+
+        std::unordered_map<ULONGLONG, FileEntry> staleNames;
+        for (const auto &record : scanner.Records()) {
+            bool isDirectory = (record.attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            // Records are in USN order, so the last name seen is the newest.
+            staleNames[record.fileRef] = { record.parentRef, record.name, isDirectory };
+
+            if ((record.reason & USN_REASON_FILE_DELETE) == 0 || liveUsns.count(record.usn) != 0) {
+                continue;
+            }
+
+            DeletedRecord item{};
+            item.fileRef = record.fileRef;
+            item.parentRef = record.parentRef;
+            item.name = record.name;
+            item.isDirectory = isDirectory;
+            item.timestampMs = usnscanner::FileTimeToUnixMs(record.timestamp);
+            item.reason = record.reason;
+            item.usn = record.usn;
+            item.carved = true;
+            deleted.push_back(item);
+        }
+
+        for (auto &entry : staleNames) {
+            fileTable.emplace(entry.first, std::move(entry.second));
+        }
+        return true;
+    }
+
+    std::string drive_;
+    bool carveJournal_;
+    // Empty when the request is not shared.
+    std::string flightKey_;
+    std::string errorMessage_;
+    std::vector<Result> results_;
+    std::vector<usnscanner::NameLink> nameLinks_;
+};
+
+class FileRecordWorker : public Napi::AsyncWorker {
+  public:
+    FileRecordWorker(const std::string &driveLetter, ULONGLONG fileReference, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), drive_(driveLetter), fileRef_(fileReference), slotReused_(false) {}
+
+    void Execute() override {
+        if (drive_.empty()) {
+            SetError("Drive letter is required");
+            return;
+        }
+
+        wchar_t driveChar = static_cast<wchar_t>(::towupper(static_cast<unsigned char>(drive_[0])));
+        std::wstring volumePath = L"\\\\.\\";
+        volumePath.push_back(driveChar);
+        volumePath.push_back(L':');
+
+        DWORD sectorsPerCluster = 0;
+        DWORD bytesPerSector = 0;
+        DWORD numberOfFreeClusters = 0;
+        DWORD totalNumberOfClusters = 0;
+
+        std::wstring rootPath;
+        rootPath.push_back(driveChar);
+        rootPath.append(L":\\");
         ::GetDiskFreeSpaceW(
             rootPath.c_str(),
             &sectorsPerCluster,
@@ -641,15 +824,14 @@ class FileRecordWorker : public Napi::AsyncWorker {
         input.FileReferenceNumber = fileRef_;
 
         DWORD bytesReturned = 0;
-        BOOL ok = ::DeviceIoControl(
+        BOOL ok = ThrottledDeviceIoControl(
             volumeHandle,
             FSCTL_GET_NTFS_FILE_RECORD,
             &input,
             sizeof(input),
             buffer.data(),
             bufferSize,
-            &bytesReturned,
-            nullptr
+            &bytesReturned
         );
 
         if (!ok) {
@@ -668,11 +850,20 @@ class FileRecordWorker : public Napi::AsyncWorker {
         }
 
         auto *output = reinterpret_cast<NtfsFileRecordOutputBuffer *>(buffer.data());
-        FileRecordDetails details{};
-        if (!ParseFileRecord(output->FileRecordBuffer, output->FileRecordLength, details)) {
+        usnscanner::FileRecordDetails details{};
+        const uint64_t recordNumber = usnscanner::ReferenceRecordNumber(fileRef_);
+        if (usnscanner::ReferenceRecordNumber(output->FileReferenceNumber) != recordNumber) {
+            // The FSCTL returns the nearest in-use record at or below the one
+            // asked for, so a freed slot comes back as some other file. Read
+            // the slot itself from the raw MFT instead.
+            if (!ReadFreeRecord(recordNumber, details)) {
+                return;
+            }
+        } else if (!usnscanner::ParseFileRecord(output->FileRecordBuffer, output->FileRecordLength, details)) {
             SetError("Failed to parse file record");
             return;
         }
+        slotReused_ = usnscanner::SlotReused(fileRef_, details.sequenceNumber, details.inUse);
 
         details.bytesPerSector = bytesPerSector;
         details.sectorsPerCluster = sectorsPerCluster;
@@ -687,12 +878,22 @@ class FileRecordWorker : public Napi::AsyncWorker {
         Napi::Object result = Napi::Object::New(env);
         result.Set("inUse", Napi::Boolean::New(env, details_.inUse));
         result.Set("isDirectory", Napi::Boolean::New(env, details_.isDirectory));
+        result.Set("recordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(fileRef_))));
+        result.Set("sequence", Napi::Number::New(env, usnscanner::ReferenceSequence(fileRef_)));
+        result.Set("recordSequence", Napi::Number::New(env, details_.sequenceNumber));
+        result.Set("slotReused", Napi::Boolean::New(env, slotReused_));
         result.Set("baseReference", Napi::String::New(env, std::to_string(details_.baseReference)));
         result.Set("hardLinkCount", Napi::Number::New(env, details_.hardLinkCount));
         result.Set("flags", Napi::Number::New(env, details_.flags));
         result.Set("bytesPerSector", Napi::Number::New(env, details_.bytesPerSector));
         result.Set("sectorsPerCluster", Napi::Number::New(env, details_.sectorsPerCluster));
         result.Set("clusterSize", Napi::String::New(env, std::to_string(details_.clusterSize)));
+        for (const auto &attr : details_.attributes) {
+            uint32_t algorithm = 0;
+            if (attr.type == usnscanner::kAttributeReparsePoint && !attr.nonResident && usnscanner::ParseWofReparsePoint(attr.residentData, algorithm)) {
+                result.Set("wofAlgorithm", Napi::Number::New(env, algorithm));
+            }
+        }
 
         Napi::Array attrArray = Napi::Array::New(env, details_.attributes.size());
         for (size_t i = 0; i < details_.attributes.size(); ++i) {
@@ -706,6 +907,9 @@ class FileRecordWorker : public Napi::AsyncWorker {
             }
             attrObj.Set("dataSize", Napi::String::New(env, std::to_string(attr.dataSize)));
             attrObj.Set("allocatedSize", Napi::String::New(env, std::to_string(attr.allocatedSize)));
+            if (attr.compressionUnit != 0) {
+                attrObj.Set("compressionUnit", Napi::Number::New(env, attr.compressionUnit));
+            }
 
             if (!attr.runs.empty()) {
                 Napi::Array runs = Napi::Array::New(env, attr.runs.size());
@@ -740,19 +944,53 @@ class FileRecordWorker : public Napi::AsyncWorker {
     }
 
   private:
+    bool ReadFreeRecord(uint64_t recordNumber, usnscanner::FileRecordDetails &details) {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(drive_, error)) {
+            SetError(error);
+            return false;
+        }
+        usnscanner::MftReader mft(reader);
+        if (!mft.Open(error)) {
+            SetError(error);
+            return false;
+        }
+        std::vector<uint8_t> record;
+        if (!mft.ReadRecord(recordNumber, record) ||
+            !usnscanner::ParseFileRecord(record.data(), static_cast<uint32_t>(record.size()), details)) {
+            SetError("Failed to read file record " + std::to_string(recordNumber));
+            return false;
+        }
+        return true;
+    }
+
     std::string drive_;
     ULONGLONG fileRef_;
     std::string errorMessage_;
-    FileRecordDetails details_;
+    usnscanner::FileRecordDetails details_;
+    bool slotReused_;
+};
+
+// How the bytes named by a run list are turned into file contents.
+struct RecoveryOptions {
+    // log2 clusters per NTFS compression unit; 0 copies runs verbatim.
+    uint8_t compressionUnit;
+    // WOF format of a WofCompressedData stream, or -1.
+    int32_t wofAlgorithm;
+    ULONGLONG uncompressedSize;
+    // How to size reads of plain runs.
+    usnscanner::IoProfileMode device;
 };
 
 class DataRunRecoveryWorker : public Napi::AsyncWorker {
   public:
     DataRunRecoveryWorker(
         const std::string &driveLetter,
-        std::vector<DataRunSegment> runs,
+        std::vector<usnscanner::DataRunSegment> runs,
         ULONGLONG clusterSize,
         ULONGLONG fileSize,
+        const RecoveryOptions &options,
         const std::wstring &outputPath,
         const Napi::Function &callback)
         : Napi::AsyncWorker(callback),
@@ -760,10 +998,14 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
           runs_(std::move(runs)),
           clusterSize_(clusterSize),
           fileSize_(fileSize),
+          compressionUnit_(options.compressionUnit),
+          wofAlgorithm_(options.wofAlgorithm),
+          uncompressedSize_(options.uncompressedSize),
+          device_(options.device),
           outputPath_(outputPath),
-          badSectorCount_(0),
-          recoveredBytes_(0),
-          totalBytes_(fileSize) {}
+          profile_(usnscanner::DefaultIoProfile(usnscanner::DeviceClass::Unknown)),
+          compressedUnits_(0),
+          corruptUnits_(0) {}
 
     void Execute() override {
         if (drive_.empty()) {
@@ -786,24 +1028,21 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
             return;
         }
 
-        wchar_t driveChar = static_cast<wchar_t>(::towupper(static_cast<unsigned char>(drive_[0])));
-        std::wstring volumePath = L"\\\\.\\";
-        volumePath.push_back(driveChar);
-        volumePath.push_back(L':');
+        if (compressionUnit_ != 0 && (clusterSize_ << compressionUnit_) > kMaxCompressionUnitBytes) {
+            SetError("Compression unit is too large");
+            return;
+        }
 
-        HANDLE volumeHandle = ::CreateFileW(
-            volumePath.c_str(),
-            GENERIC_READ,
-            FILE_SHARE_READ | FILE_SHARE_WRITE,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            nullptr
-        );
+        if (wofAlgorithm_ >= 0 && (fileSize_ > kMaxWofStreamBytes || uncompressedSize_ > kMaxWofStreamBytes)) {
+            SetError("WOF-compressed file is too large to recover in memory");
+            return;
+        }
 
-        if (volumeHandle == INVALID_HANDLE_VALUE) {
-            DWORD err = ::GetLastError();
-            SetError("CreateFile (volume) failed with error " + std::to_string(err));
+        // One reader serves the device class query and every read.
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(drive_, error)) {
+            SetError(error);
             return;
         }
 
@@ -819,12 +1058,30 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
 
         if (outHandle == INVALID_HANDLE_VALUE) {
             DWORD err = ::GetLastError();
-            ::CloseHandle(volumeHandle);
             SetError("CreateFile (output) failed with error " + std::to_string(err));
             return;
         }
 
-        const size_t chunkClusters = 16;
+        if (wofAlgorithm_ >= 0) {
+            CopyWofStream(reader, outHandle);
+            ::CloseHandle(outHandle);
+            return;
+        }
+
+        if (compressionUnit_ != 0) {
+            CopyCompressedUnits(reader, outHandle);
+            ::CloseHandle(outHandle);
+            return;
+        }
+
+        // Plain runs are copied in order, one read at a time, in reads as long
+        // as the device likes them. A device of unknown class keeps the
+        // 16-cluster reads used before profiles existed.
+        profile_ = usnscanner::SelectIoProfile(reader, device_);
+        if (profile_.deviceClass == usnscanner::DeviceClass::Unknown) {
+            profile_.readSize = 16 * clusterSize_;
+        }
+        const ULONGLONG chunkClusters = std::max<ULONGLONG>(1, profile_.readSize / clusterSize_);
         std::vector<BYTE> buffer(static_cast<size_t>(clusterSize_ * chunkClusters));
         std::vector<BYTE> zeroBuffer(buffer.size(), 0);
 
@@ -849,53 +1106,30 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
                     if (!::WriteFile(outHandle, zeroBuffer.data(), static_cast<DWORD>(chunk), &written, nullptr)) {
                         DWORD err = ::GetLastError();
                         ::CloseHandle(outHandle);
-                        ::CloseHandle(volumeHandle);
                         SetError("WriteFile (sparse) failed with error " + std::to_string(err));
                         return;
                     }
                     produced += written;
                 }
             } else {
-                LONGLONG absoluteOffset = static_cast<LONGLONG>(run.lcn) * static_cast<LONGLONG>(clusterSize_);
-                LARGE_INTEGER distance;
-                distance.QuadPart = absoluteOffset;
-                if (!::SetFilePointerEx(volumeHandle, distance, nullptr, FILE_BEGIN)) {
-                    DWORD err = ::GetLastError();
-                    ::CloseHandle(outHandle);
-                    ::CloseHandle(volumeHandle);
-                    SetError("SetFilePointerEx failed with error " + std::to_string(err));
-                    return;
-                }
-
+                const ULONGLONG absoluteOffset = static_cast<ULONGLONG>(run.lcn) * clusterSize_;
                 ULONGLONG processed = 0;
                 while (processed < bytesToCopy) {
-                    ULONGLONG chunk = std::min<ULONGLONG>(bytesToCopy - processed, buffer.size());
-                    DWORD read = 0;
-                    if (!::ReadFile(volumeHandle, buffer.data(), static_cast<DWORD>(chunk), &read, nullptr)) {
-                        DWORD err = ::GetLastError();
-                        ::CloseHandle(outHandle);
-                        ::CloseHandle(volumeHandle);
-                        SetError("ReadFile failed with error " + std::to_string(err));
-                        return;
-                    }
-
-                    if (read == 0) {
+                    const DWORD chunk = static_cast<DWORD>(std::min<ULONGLONG>(bytesToCopy - processed, buffer.size()));
+                    if (!ReadVolume(reader, absoluteOffset + processed, buffer.data(), chunk)) {
                         ::CloseHandle(outHandle);
-                        ::CloseHandle(volumeHandle);
-                        SetError("Unexpected end of volume data while reading run");
                         return;
                     }
 
                     DWORD written = 0;
-                    if (!::WriteFile(outHandle, buffer.data(), read, &written, nullptr) || written != read) {
+                    if (!::WriteFile(outHandle, buffer.data(), chunk, &written, nullptr) || written != chunk) {
                         DWORD err = ::GetLastError();
                         ::CloseHandle(outHandle);
-                        ::CloseHandle(volumeHandle);
                         SetError("WriteFile failed with error " + std::to_string(err));
                         return;
                     }
 
-                    processed += read;
+                    processed += chunk;
                 }
             }
 
@@ -909,7 +1143,6 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
                 if (!::WriteFile(outHandle, zeroBuffer.data(), static_cast<DWORD>(chunk), &written, nullptr)) {
                     DWORD err = ::GetLastError();
                     ::CloseHandle(outHandle);
-                    ::CloseHandle(volumeHandle);
                     SetError("WriteFile (padding) failed with error " + std::to_string(err));
                     return;
                 }
@@ -918,13 +1151,16 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
         }
 
         ::CloseHandle(outHandle);
-        ::CloseHandle(volumeHandle);
     }
 
     void OnOK() override {
         Napi::Env env = Env();
         Napi::HandleScope scope(env);
-        Callback().Call({ env.Null(), env.Null() });
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("compressedUnits", Napi::Number::New(env, static_cast<double>(compressedUnits_)));
+        result.Set("corruptUnits", Napi::Number::New(env, static_cast<double>(corruptUnits_)));
+        result.Set("io", IoProfileValue(env, profile_));
+        Callback().Call({ env.Null(), result });
     }
 
     void OnError(const Napi::Error &e) override {
@@ -934,11 +1170,117 @@ class DataRunRecoveryWorker : public Napi::AsyncWorker {
     }
 
   private:
+    static const ULONGLONG kMaxCompressionUnitBytes = 16 * 1024 * 1024;
+    static const ULONGLONG kMaxWofStreamBytes = 1024ULL * 1024 * 1024;
+
+    // NTFS compresses every unit of 2^compressionUnit clusters on its own: a
+    // unit without clusters is sparse, a fully allocated one is stored as is,
+    // anything in between holds LZNT1 data in its leading clusters. Corrupt
+    // units keep what decoded and are counted rather than failing the copy.
+    bool CopyCompressedUnits(usnscanner::VolumeReader &reader, HANDLE outHandle) {
+        const ULONGLONG unitClusters = 1ULL << compressionUnit_;
+        const size_t unitBytes = static_cast<size_t>(unitClusters * clusterSize_);
+        std::vector<BYTE> stored(unitBytes);
+        std::vector<BYTE> unit(unitBytes);
+        std::vector<usnscanner::ByteRange> extents;
+
+        ULONGLONG remaining = fileSize_;
+        for (ULONGLONG vcn = 0; remaining > 0; vcn += unitClusters) {
+            uint64_t allocated = usnscanner::MapCompressionUnit(runs_, clusterSize_, vcn, unitClusters, extents);
+            size_t storedBytes = 0;
+            for (const auto &extent : extents) {
+                if (!ReadVolume(reader, extent.offset, stored.data() + storedBytes, static_cast<size_t>(extent.length))) {
+                    return false;
+                }
+                storedBytes += static_cast<size_t>(extent.length);
+            }
+
+            if (allocated != 0 && allocated < unitClusters) {
+                ++compressedUnits_;
+            }
+            if (!usnscanner::DecodeCompressionUnit(stored.data(), storedBytes, unit.data(), unitBytes)) {
+                ++corruptUnits_;
+            }
+
+            DWORD chunk = static_cast<DWORD>(std::min<ULONGLONG>(remaining, unitBytes));
+            DWORD written = 0;
+            if (!::WriteFile(outHandle, unit.data(), chunk, &written, nullptr) || written != chunk) {
+                SetError("WriteFile failed with error " + std::to_string(::GetLastError()));
+                return false;
+            }
+            remaining -= chunk;
+        }
+        return true;
+    }
+
+    // A WofCompressedData stream is read whole (its runs cover fileSize_
+    // bytes), then its chunks are decoded in parallel into the real contents.
+    bool CopyWofStream(usnscanner::VolumeReader &reader, HANDLE outHandle) {
+        std::vector<BYTE> stream(static_cast<size_t>(fileSize_), 0);
+        size_t filled = 0;
+        for (const auto &run : runs_) {
+            if (filled >= stream.size()) {
+                break;
+            }
+            if (run.length <= 0) {
+                continue;
+            }
+            size_t bytes = static_cast<size_t>(std::min<ULONGLONG>(static_cast<ULONGLONG>(run.length) * clusterSize_, stream.size() - filled));
+            if (!run.sparse && run.lcn > 0 &&
+                !ReadVolume(reader, static_cast<ULONGLONG>(run.lcn) * clusterSize_, stream.data() + filled, bytes)) {
+                return false;
+            }
+            filled += bytes;
+        }
+
+        std::vector<BYTE> output(static_cast<size_t>(uncompressedSize_));
+        usnscanner::WofStats stats{};
+        std::string error;
+        if (!usnscanner::WofDecompress(stream.data(), stream.size(), static_cast<uint32_t>(wofAlgorithm_), uncompressedSize_, output.data(), 0, stats, error)) {
+            SetError(error);
+            return false;
+        }
+        compressedUnits_ = stats.chunks - stats.storedChunks;
+        corruptUnits_ = stats.corruptChunks;
+
+        const size_t writeChunk = 1024 * 1024;
+        for (size_t done = 0; done < output.size();) {
+            DWORD chunk = static_cast<DWORD>(std::min(writeChunk, output.size() - done));
+            DWORD written = 0;
+            if (!::WriteFile(outHandle, output.data() + done, chunk, &written, nullptr) || written != chunk) {
+                SetError("WriteFile failed with error " + std::to_string(::GetLastError()));
+                return false;
+            }
+            done += chunk;
+        }
+        return true;
+    }
+
+    bool ReadVolume(usnscanner::VolumeReader &reader, ULONGLONG offset, BYTE *buffer, size_t length) {
+        const long long read = reader.ReadAt(offset, buffer, length);
+        if (read < 0) {
+            SetError("ReadFile failed with error " + std::to_string(usnscanner::VolumeReader::LastError()));
+            return false;
+        }
+        if (static_cast<size_t>(read) < length) {
+            SetError("Unexpected end of volume data while reading run");
+            return false;
+        }
+        return true;
+    }
+
     std::string drive_;
-    std::vector<DataRunSegment> runs_;
+    std::vector<usnscanner::DataRunSegment> runs_;
     ULONGLONG clusterSize_;
     ULONGLONG fileSize_;
+    uint8_t compressionUnit_;
+    int32_t wofAlgorithm_;
+    ULONGLONG uncompressedSize_;
+    usnscanner::IoProfileMode device_;
     std::wstring outputPath_;
+    usnscanner::IoProfile profile_;
+    uint64_t compressedUnits_;
+    uint64_t corruptUnits_;
 };
 Napi::Value ScanUsn(const Napi::CallbackInfo &info) {
     Napi::Env env = info.Env();
@@ -953,20 +1295,39 @@ Napi::Value ScanUsn(const Napi::CallbackInfo &info) {
         return env.Undefined();
     }
 
-    if (!info[1].IsFunction()) {
+    // scan(drive, callback) or scan(drive, options, callback).
+    size_t callbackIndex = info.Length() >= 3 ? 2 : 1;
+    if (!info[callbackIndex].IsFunction()) {
         Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
+    bool carveJournal = false;
+    if (callbackIndex == 2) {
+        if (!info[1].IsObject()) {
+            Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        Napi::Value value = info[1].As<Napi::Object>().Get("carveJournal");
+        carveJournal = value.IsBoolean() && value.As<Napi::Boolean>().Value();
+    }
+
     std::string drive = info[0].As<Napi::String>();
-    Napi::Function callback = info[1].As<Napi::Function>();
+    Napi::Function callback = info[callbackIndex].As<Napi::Function>();
 
-    auto *worker = new ScanUsnWorker(drive, callback);
+    // Each caller gets its own results array, so one caller editing its
+    // results cannot affect another.
+    std::string flightKey = ScanFlightKey(drive, carveJournal);
+    if (JoinScanFlight(flightKey, callback)) {
+        return env.Undefined();
+    }
+
+    auto *worker = new ScanUsnWorker(drive, carveJournal, flightKey, callback);
     worker->Queue();
     return env.Undefined();
 }
 
-bool ParseRunsArray(const Napi::Env &env, const Napi::Array &array, std::vector<DataRunSegment> &out, std::string &error) {
+bool ParseRunsArray(const Napi::Env &env, const Napi::Array &array, std::vector<usnscanner::DataRunSegment> &out, std::string &error) {
     out.clear();
     const uint32_t length = array.Length();
     out.reserve(length);
@@ -1023,7 +1384,7 @@ bool ParseRunsArray(const Napi::Env &env, const Napi::Array &array, std::vector<
             vcnValue = static_cast<long long>(vcnField.As<Napi::Number>().DoubleValue());
         }
 
-        DataRunSegment segment{};
+        usnscanner::DataRunSegment segment{};
         segment.vcnStart = vcnValue;
         segment.lcn = lcnValue;
         segment.length = lengthClusters;
@@ -1140,12 +1501,55 @@ Napi::Value RecoverDataRuns(const Napi::CallbackInfo &info) {
         return env.Undefined();
     }
 
-    if (!info[5].IsFunction()) {
+    // Optional options object between the output path and the callback.
+    size_t callbackIndex = 5;
+    RecoveryOptions recovery{ 0, -1, 0, usnscanner::IoProfileMode::Detect };
+    if (info.Length() >= 7 && info[5].IsObject()) {
+        Napi::Object options = info[5].As<Napi::Object>();
+        Napi::Value unit = options.Get("compressionUnit");
+        if (!unit.IsUndefined()) {
+            if (!unit.IsNumber() || unit.As<Napi::Number>().DoubleValue() < 0 || unit.As<Napi::Number>().DoubleValue() > 8) {
+                Napi::TypeError::New(env, "Invalid compression unit").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            recovery.compressionUnit = static_cast<uint8_t>(unit.As<Napi::Number>().Uint32Value());
+        }
+
+        Napi::Value algorithm = options.Get("wofAlgorithm");
+        if (!algorithm.IsUndefined() && !algorithm.IsNull()) {
+            if (!algorithm.IsNumber() || usnscanner::WofChunkSize(algorithm.As<Napi::Number>().Uint32Value()) == 0) {
+                Napi::TypeError::New(env, "Invalid WOF compression format").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            recovery.wofAlgorithm = static_cast<int32_t>(algorithm.As<Napi::Number>().Uint32Value());
+
+            Napi::Value size = options.Get("uncompressedSize");
+            bool sizeOk = false;
+            if (size.IsString()) {
+                sizeOk = TryParseUnsigned(size.As<Napi::String>(), recovery.uncompressedSize);
+            } else if (size.IsNumber() && size.As<Napi::Number>().DoubleValue() >= 0) {
+                recovery.uncompressedSize = static_cast<ULONGLONG>(size.As<Napi::Number>().DoubleValue());
+                sizeOk = true;
+            }
+            if (!sizeOk) {
+                Napi::TypeError::New(env, "WOF recovery needs the uncompressed size").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+        }
+
+        if (!ReadIoProfileMode(options.Get("device"), recovery.device)) {
+            Napi::TypeError::New(env, "device must be 'auto', 'rotational', 'ssd' or 'probe'").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        callbackIndex = 6;
+    }
+
+    if (!info[callbackIndex].IsFunction()) {
         Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    std::vector<DataRunSegment> runs;
+    std::vector<usnscanner::DataRunSegment> runs;
     std::string parseError;
     if (!ParseRunsArray(env, info[1].As<Napi::Array>(), runs, parseError)) {
         Napi::TypeError::New(env, parseError).ThrowAsJavaScriptException();
@@ -1154,17 +1558,2957 @@ Napi::Value RecoverDataRuns(const Napi::CallbackInfo &info) {
 
     std::string drive = info[0].As<Napi::String>();
     std::wstring outputPath = Utf8ToWide(info[4].As<Napi::String>());
-    Napi::Function callback = info[5].As<Napi::Function>();
+    Napi::Function callback = info[callbackIndex].As<Napi::Function>();
 
-    auto *worker = new DataRunRecoveryWorker(drive, std::move(runs), clusterSize, fileSize, outputPath, callback);
+    auto *worker = new DataRunRecoveryWorker(drive, std::move(runs), clusterSize, fileSize, recovery, outputPath, callback);
     worker->Queue();
     return env.Undefined();
 }
 
-Napi::Object Init(Napi::Env env, Napi::Object exports) {
-    exports.Set("scan", Napi::Function::New(env, ScanUsn));
-    exports.Set("getFileRecord", Napi::Function::New(env, GetFileRecord));
-    exports.Set("recoverDataRuns", Napi::Function::New(env, RecoverDataRuns));
+#endif // _WIN32
+
+bool ReadUnsignedValue(const Napi::Value &value, uint64_t &output) {
+    if (value.IsString()) {
+        std::string text = value.As<Napi::String>();
+        try {
+            size_t idx = 0;
+            output = std::stoull(text, &idx, 10);
+            return idx == text.size();
+        } catch (...) {
+            return false;
+        }
+    }
+
+    if (value.IsNumber()) {
+        double number = value.As<Napi::Number>().DoubleValue();
+        if (number < 0) {
+            return false;
+        }
+        output = static_cast<uint64_t>(number);
+        return true;
+    }
+
+    return false;
+}
+
+Napi::Value FileTimeValue(const Napi::Env &env, uint64_t fileTime) {
+    if (fileTime == 0) {
+        return env.Null();
+    }
+    return Napi::Number::New(env, usnscanner::FileTimeToUnixMs(fileTime));
+}
+
+Napi::Array RunsToArray(const Napi::Env &env, const std::vector<usnscanner::DataRunSegment> &segments) {
+    Napi::Array runs = Napi::Array::New(env, segments.size());
+    for (size_t r = 0; r < segments.size(); ++r) {
+        const auto &run = segments[r];
+        Napi::Object runObj = Napi::Object::New(env);
+        runObj.Set("vcn", Napi::String::New(env, std::to_string(run.vcnStart)));
+        runObj.Set("lcn", Napi::String::New(env, std::to_string(run.lcn)));
+        runObj.Set("length", Napi::String::New(env, std::to_string(run.length)));
+        runObj.Set("sparse", Napi::Boolean::New(env, run.sparse));
+        runs.Set(r, runObj);
+    }
+    return runs;
+}
+
+struct CarveRequest {
+    std::vector<usnscanner::ByteRange> ranges;
+    std::vector<usnscanner::CarveSignature> signatures;
+    usnscanner::CarveOptions options;
+    uint32_t alignment;
+    bool freeSpaceOnly;
+    bool bifragment;
+    uint64_t maxGap;
+    bool fileRecords;
+    bool usnRecords;
+};
+
+class CarveWorker : public Napi::AsyncWorker {
+  public:
+    CarveWorker(const std::string &source, CarveRequest request, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback),
+          source_(source),
+          request_(std::move(request)),
+          bytesScanned_(0),
+          elapsedMs_(0),
+          alignment_(0),
+          rejected_(0),
+          bifragmentRan_(false),
+          bifragmentStats_{},
+          recordsRan_(false),
+          clusterSize_(0),
+          tornRecords_(0),
+          extensionRecords_(0),
+          usnRan_(false),
+          usnDuplicates_(0) {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+
+        uint32_t alignment = request_.alignment;
+        uint64_t clusterSize = 0;
+        std::vector<usnscanner::ByteRange> ranges = request_.ranges;
+        if (ranges.empty()) {
+            if (reader.IsVolume() && request_.freeSpaceOnly) {
+                if (!usnscanner::QueryFreeSpaceRanges(reader, clusterSize, ranges, error)) {
+                    SetError(error);
+                    return;
+                }
+                if (alignment == 0) {
+                    alignment = static_cast<uint32_t>(clusterSize);
+                }
+            } else {
+                ranges.push_back({ 0, reader.Size() });
+            }
+        }
+        if (alignment == 0) {
+            alignment = 512;
+        }
+
+        // Images and unmounted volumes only tell their geometry through the
+        // boot sector; orphan records need it to map run lists to bytes and
+        // journal carving to check USNs against page offsets.
+        usnscanner::NtfsGeometry geometry{};
+        bool ntfs = (request_.fileRecords || request_.usnRecords) && usnscanner::ReadNtfsGeometry(reader, geometry);
+        if (clusterSize == 0 && ntfs) {
+            clusterSize = geometry.clusterSize;
+        }
+
+        usnscanner::SignatureScanner scanner(request_.signatures, alignment);
+        usnscanner::FileRecordScanner recordScanner(ntfs ? geometry.recordSize : 0);
+        usnscanner::UsnRecordScanner usnScanner(static_cast<uint32_t>(clusterSize), 0, 0);
+        usnscanner::CarveEngine engine(reader, request_.options);
+        engine.AddScanner(&scanner);
+        if (request_.fileRecords) {
+            engine.AddScanner(&recordScanner);
+        }
+        if (request_.usnRecords) {
+            engine.AddScanner(&usnScanner);
+        }
+        if (!engine.Run(ranges, error)) {
+            SetError(error);
+            return;
+        }
+
+        signatures_ = scanner.Signatures();
+        hits_ = scanner.Hits();
+        if (request_.bifragment) {
+            usnscanner::BifragmentCarver fragments(reader, signatures_, { alignment, request_.maxGap, 0, request_.options.threads });
+            fragments.Run(hits_, ranges);
+            bifragmentStats_ = fragments.Stats();
+            bifragmentRan_ = true;
+        }
+        if (request_.fileRecords) {
+            recordScanner.Score(ranges, clusterSize);
+            records_ = recordScanner.Records();
+            tornRecords_ = recordScanner.Torn();
+            extensionRecords_ = recordScanner.Extensions();
+            clusterSize_ = clusterSize;
+            recordsRan_ = true;
+        }
+        if (request_.usnRecords) {
+            usnRecords_ = usnScanner.Records();
+            usnDuplicates_ = usnScanner.Duplicates();
+            usnRan_ = true;
+        }
+        threadStats_ = engine.ThreadStats();
+        threadHits_.clear();
+        for (size_t i = 0; i < threadStats_.size(); ++i) {
+            threadHits_.push_back(scanner.WorkerHits(i));
+        }
+        unreadable_ = engine.UnreadableRanges();
+        bytesScanned_ = engine.BytesScanned();
+        elapsedMs_ = engine.ElapsedMs();
+        alignment_ = alignment;
+        rejected_ = scanner.Rejected();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array hits = Napi::Array::New(env, hits_.size());
+        for (size_t i = 0; i < hits_.size(); ++i) {
+            const auto &hit = hits_[i];
+            const auto &signature = signatures_[hit.signature];
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("offset", Napi::String::New(env, std::to_string(hit.offset)));
+            obj.Set("length", Napi::String::New(env, std::to_string(hit.length)));
+            obj.Set("type", Napi::String::New(env, signature.type));
+            obj.Set("extension", Napi::String::New(env, hit.extension ? std::string(hit.extension) : signature.extension));
+            obj.Set("complete", Napi::Boolean::New(env, hit.complete));
+            obj.Set("confidence", Napi::Number::New(env, hit.confidence));
+            if (hit.fragmentLength != 0) {
+                Napi::Array fragments = Napi::Array::New(env, 2);
+                Napi::Object head = Napi::Object::New(env);
+                head.Set("offset", Napi::String::New(env, std::to_string(hit.offset)));
+                head.Set("length", Napi::String::New(env, std::to_string(hit.fragmentLength)));
+                Napi::Object tail = Napi::Object::New(env);
+                tail.Set("offset", Napi::String::New(env, std::to_string(hit.offset + hit.fragmentLength + hit.gap)));
+                tail.Set("length", Napi::String::New(env, std::to_string(hit.length - hit.fragmentLength)));
+                fragments.Set(static_cast<uint32_t>(0), head);
+                fragments.Set(static_cast<uint32_t>(1), tail);
+                obj.Set("fragments", fragments);
+            }
+            hits.Set(i, obj);
+        }
+
+        Napi::Array threads = Napi::Array::New(env, threadStats_.size());
+        for (size_t i = 0; i < threadStats_.size(); ++i) {
+            const auto &stats = threadStats_[i];
+            double busyMs = stats.readMs + stats.scanMs;
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("bytesRead", Napi::String::New(env, std::to_string(stats.bytesRead)));
+            obj.Set("chunks", Napi::Number::New(env, static_cast<double>(stats.chunks)));
+            obj.Set("stolen", Napi::Number::New(env, static_cast<double>(stats.stolen)));
+            obj.Set("hits", Napi::Number::New(env, static_cast<double>(threadHits_[i])));
+            obj.Set("readErrors", Napi::Number::New(env, static_cast<double>(stats.readErrors)));
+            obj.Set("readMs", Napi::Number::New(env, stats.readMs));
+            obj.Set("scanMs", Napi::Number::New(env, stats.scanMs));
+            obj.Set("mbPerSecond", Napi::Number::New(env, busyMs > 0 ? (stats.bytesRead / 1048576.0) / (busyMs / 1000.0) : 0.0));
+            threads.Set(i, obj);
+        }
+
+        Napi::Array unreadable = Napi::Array::New(env, unreadable_.size());
+        for (size_t i = 0; i < unreadable_.size(); ++i) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("offset", Napi::String::New(env, std::to_string(unreadable_[i].offset)));
+            obj.Set("length", Napi::String::New(env, std::to_string(unreadable_[i].length)));
+            unreadable.Set(i, obj);
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("hits", hits);
+        result.Set("threads", threads);
+        result.Set("unreadable", unreadable);
+        result.Set("bytesScanned", Napi::String::New(env, std::to_string(bytesScanned_)));
+        result.Set("elapsedMs", Napi::Number::New(env, elapsedMs_));
+        result.Set("alignment", Napi::Number::New(env, alignment_));
+        result.Set("rejected", Napi::Number::New(env, static_cast<double>(rejected_)));
+        if (bifragmentRan_) {
+            Napi::Object bifragment = Napi::Object::New(env);
+            bifragment.Set("candidates", Napi::Number::New(env, static_cast<double>(bifragmentStats_.candidates)));
+            bifragment.Set("repaired", Napi::Number::New(env, static_cast<double>(bifragmentStats_.repaired)));
+            bifragment.Set("tests", Napi::Number::New(env, static_cast<double>(bifragmentStats_.tests)));
+            bifragment.Set("pruned", Napi::Number::New(env, static_cast<double>(bifragmentStats_.pruned)));
+            bifragment.Set("cacheHits", Napi::Number::New(env, static_cast<double>(bifragmentStats_.cacheHits)));
+            bifragment.Set("cacheMisses", Napi::Number::New(env, static_cast<double>(bifragmentStats_.cacheMisses)));
+            bifragment.Set("elapsedMs", Napi::Number::New(env, bifragmentStats_.elapsedMs));
+            result.Set("bifragment", bifragment);
+        }
+        if (recordsRan_) {
+            result.Set("records", BuildRecords(env));
+            result.Set("tornRecords", Napi::Number::New(env, static_cast<double>(tornRecords_)));
+            result.Set("extensionRecords", Napi::Number::New(env, static_cast<double>(extensionRecords_)));
+            result.Set("clusterSize", Napi::String::New(env, std::to_string(clusterSize_)));
+        }
+        if (usnRan_) {
+            Napi::Array usnRecords = Napi::Array::New(env, usnRecords_.size());
+            for (size_t i = 0; i < usnRecords_.size(); ++i) {
+                const auto &record = usnRecords_[i];
+                Napi::Object obj = Napi::Object::New(env);
+                obj.Set("offset", Napi::String::New(env, std::to_string(record.offset)));
+                obj.Set("usn", Napi::String::New(env, std::to_string(record.usn)));
+                obj.Set("fileReferenceNumber", Napi::String::New(env, std::to_string(record.fileRef)));
+                obj.Set("parentReferenceNumber", Napi::String::New(env, std::to_string(record.parentRef)));
+                obj.Set("name", Napi::String::New(env, record.name));
+                obj.Set("isDirectory", Napi::Boolean::New(env, (record.attributes & usnscanner::kFileAttributeDirectory) != 0));
+                obj.Set("timestampMs", Napi::Number::New(env, usnscanner::FileTimeToUnixMs(record.timestamp)));
+                obj.Set("reason", Napi::Number::New(env, static_cast<double>(record.reason)));
+                obj.Set("majorVersion", Napi::Number::New(env, record.majorVersion));
+                usnRecords.Set(i, obj);
+            }
+            result.Set("usnRecords", usnRecords);
+            result.Set("usnDuplicates", Napi::Number::New(env, static_cast<double>(usnDuplicates_)));
+        }
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    Napi::Array BuildRecords(const Napi::Env &env) const {
+        Napi::Array records = Napi::Array::New(env, records_.size());
+        for (size_t i = 0; i < records_.size(); ++i) {
+            const auto &record = records_[i];
+            const auto &name = record.fileName;
+            // $STANDARD_INFORMATION follows every change to the file;
+            // $FILE_NAME times only move on rename or move.
+            uint64_t created = record.hasStandardInformation ? record.standardInformation.created : name.created;
+            uint64_t modified = record.hasStandardInformation ? record.standardInformation.modified : name.modified;
+            uint64_t mftModified = record.hasStandardInformation ? record.standardInformation.mftModified : name.mftModified;
+            uint64_t accessed = record.hasStandardInformation ? record.standardInformation.accessed : name.accessed;
+
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("offset", Napi::String::New(env, std::to_string(record.offset)));
+            obj.Set("recordSize", Napi::Number::New(env, record.recordSize));
+            obj.Set("recordNumber", Napi::String::New(env, std::to_string(record.recordNumber)));
+            obj.Set("sequence", Napi::Number::New(env, record.sequence));
+            obj.Set("fileReference", Napi::String::New(env, std::to_string(usnscanner::MakeFileReference(record.recordNumber, record.sequence))));
+            obj.Set("parentReference", Napi::String::New(env, std::to_string(name.parentReference)));
+            obj.Set("name", Napi::String::New(env, name.name));
+            obj.Set("nameSpace", Napi::Number::New(env, name.nameSpace));
+            obj.Set("inUse", Napi::Boolean::New(env, record.inUse));
+            obj.Set("isDirectory", Napi::Boolean::New(env, record.isDirectory));
+            obj.Set("created", FileTimeValue(env, created));
+            obj.Set("modified", FileTimeValue(env, modified));
+            obj.Set("mftModified", FileTimeValue(env, mftModified));
+            obj.Set("accessed", FileTimeValue(env, accessed));
+            obj.Set("dataSize", Napi::String::New(env, std::to_string(record.hasData ? record.dataSize : name.dataSize)));
+            obj.Set("allocatedSize", Napi::String::New(env, std::to_string(record.hasData ? record.allocatedSize : name.allocatedSize)));
+            obj.Set("resident", Napi::Boolean::New(env, record.resident));
+            obj.Set("compressionUnit", Napi::Number::New(env, record.compressionUnit));
+            obj.Set("recoveryChance", Napi::Number::New(env, record.recoveryChance));
+
+            obj.Set("runs", RunsToArray(env, record.runs));
+            if (record.resident && !record.residentData.empty()) {
+                obj.Set("residentDataBase64", Napi::String::New(env, Base64Encode(record.residentData.data(), record.residentData.size())));
+            }
+            records.Set(i, obj);
+        }
+        return records;
+    }
+
+    std::string source_;
+    CarveRequest request_;
+    std::vector<usnscanner::CarveSignature> signatures_;
+    std::vector<usnscanner::CarveHit> hits_;
+    std::vector<usnscanner::CarveThreadStats> threadStats_;
+    std::vector<uint64_t> threadHits_;
+    std::vector<usnscanner::ByteRange> unreadable_;
+    uint64_t bytesScanned_;
+    double elapsedMs_;
+    uint32_t alignment_;
+    uint64_t rejected_;
+    bool bifragmentRan_;
+    usnscanner::BifragmentStats bifragmentStats_;
+    bool recordsRan_;
+    std::vector<usnscanner::CarvedFileRecord> records_;
+    uint64_t clusterSize_;
+    uint64_t tornRecords_;
+    uint64_t extensionRecords_;
+    bool usnRan_;
+    std::vector<usnscanner::CarvedUsnRecord> usnRecords_;
+    uint64_t usnDuplicates_;
+};
+
+bool ParseCarveOptions(const Napi::Object &options, CarveRequest &request, std::string &error) {
+    request.options = { 0, 0, 0 };
+    request.alignment = 0;
+    request.freeSpaceOnly = true;
+    request.bifragment = false;
+    request.maxGap = 0;
+    request.fileRecords = false;
+    request.usnRecords = false;
+    request.ranges.clear();
+    request.signatures.clear();
+
+    uint64_t value = 0;
+    Napi::Value chunkSize = options.Get("chunkSize");
+    if (!chunkSize.IsUndefined()) {
+        if (!ReadUnsignedValue(chunkSize, value) || value == 0) {
+            error = "Invalid chunk size";
+            return false;
+        }
+        request.options.chunkSize = value;
+    }
+
+    Napi::Value overlap = options.Get("overlap");
+    if (!overlap.IsUndefined()) {
+        if (!ReadUnsignedValue(overlap, value)) {
+            error = "Invalid overlap";
+            return false;
+        }
+        request.options.overlap = value;
+    }
+
+    Napi::Value threads = options.Get("threads");
+    if (!threads.IsUndefined()) {
+        if (!ReadUnsignedValue(threads, value) || value > 256) {
+            error = "Invalid thread count";
+            return false;
+        }
+        request.options.threads = static_cast<size_t>(value);
+    }
+
+    Napi::Value alignment = options.Get("alignment");
+    if (!alignment.IsUndefined()) {
+        if (!ReadUnsignedValue(alignment, value) || value == 0 || value > 1024 * 1024) {
+            error = "Invalid alignment";
+            return false;
+        }
+        request.alignment = static_cast<uint32_t>(value);
+    }
+
+    Napi::Value freeSpaceOnly = options.Get("freeSpaceOnly");
+    if (freeSpaceOnly.IsBoolean()) {
+        request.freeSpaceOnly = freeSpaceOnly.As<Napi::Boolean>();
+    }
+
+    Napi::Value bifragment = options.Get("bifragment");
+    if (bifragment.IsBoolean()) {
+        request.bifragment = bifragment.As<Napi::Boolean>();
+    }
+
+    Napi::Value fileRecords = options.Get("fileRecords");
+    if (fileRecords.IsBoolean()) {
+        request.fileRecords = fileRecords.As<Napi::Boolean>();
+    }
+
+    Napi::Value usnRecords = options.Get("usnRecords");
+    if (usnRecords.IsBoolean()) {
+        request.usnRecords = usnRecords.As<Napi::Boolean>();
+    }
+
+    Napi::Value maxGap = options.Get("maxGap");
+    if (!maxGap.IsUndefined()) {
+        if (!ReadUnsignedValue(maxGap, value) || value == 0) {
+            error = "Invalid maximum gap";
+            return false;
+        }
+        request.maxGap = value;
+    }
+
+    Napi::Value ranges = options.Get("ranges");
+    if (ranges.IsArray()) {
+        Napi::Array array = ranges.As<Napi::Array>();
+        for (uint32_t i = 0; i < array.Length(); ++i) {
+            Napi::Value entry = array.Get(i);
+            if (!entry.IsObject()) {
+                error = "Range entry must be an object";
+                return false;
+            }
+            Napi::Object obj = entry.As<Napi::Object>();
+            usnscanner::ByteRange range{};
+            if (!ReadUnsignedValue(obj.Get("offset"), range.offset) || !ReadUnsignedValue(obj.Get("length"), range.length)) {
+                error = "Range entries need numeric offset and length";
+                return false;
+            }
+            request.ranges.push_back(range);
+        }
+    }
+
+    const auto &builtins = usnscanner::BuiltinCarveSignatures();
+    Napi::Value types = options.Get("types");
+    if (types.IsArray()) {
+        Napi::Array array = types.As<Napi::Array>();
+        for (uint32_t i = 0; i < array.Length(); ++i) {
+            Napi::Value entry = array.Get(i);
+            if (!entry.IsString()) {
+                error = "Carve types must be strings";
+                return false;
+            }
+            std::string type = entry.As<Napi::String>();
+            auto it = std::find_if(builtins.begin(), builtins.end(), [&](const usnscanner::CarveSignature &signature) {
+                return signature.type == type || signature.extension == type;
+            });
+            if (it == builtins.end()) {
+                error = "Unknown carve type: " + type;
+                return false;
+            }
+            request.signatures.push_back(*it);
+        }
+    } else {
+        request.signatures = builtins;
+    }
+
+    return true;
+}
+
+Napi::Value Carve(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    CarveRequest request;
+    std::string parseError;
+    if (!ParseCarveOptions(info[1].As<Napi::Object>(), request, parseError)) {
+        Napi::TypeError::New(env, parseError).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string source = info[0].As<Napi::String>();
+    Napi::Function callback = info[2].As<Napi::Function>();
+
+    auto *worker = new CarveWorker(source, std::move(request), callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class IndexSlackWorker : public Napi::AsyncWorker {
+  public:
+    IndexSlackWorker(const std::string &source, const usnscanner::IndexSlackOptions &options, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), source_(source), options_(options), stats_{} {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+
+        usnscanner::IndexSlackScanner scanner(reader, options_);
+        if (!scanner.Run(error)) {
+            SetError(error);
+            return;
+        }
+
+        char letter = 0;
+        std::string prefix;
+        if (usnscanner::IsDriveLetterSource(source_, letter)) {
+            prefix.push_back(static_cast<char>(::toupper(static_cast<unsigned char>(letter))));
+            prefix.push_back(':');
+        }
+
+        for (const auto &hit : scanner.Hits()) {
+            Entry entry;
+            entry.hit = hit;
+            entry.directoryPath = prefix + scanner.DirectoryPath(hit.directory);
+            if (entry.directoryPath.empty() || entry.directoryPath.back() == ':') {
+                entry.directoryPath.push_back('\\');
+            }
+            entries_.push_back(std::move(entry));
+        }
+        stats_ = scanner.Stats();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array entries = Napi::Array::New(env, entries_.size());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            const auto &hit = entries_[i].hit;
+            const auto &name = hit.fileName;
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("name", Napi::String::New(env, name.name));
+            obj.Set("directoryPath", Napi::String::New(env, entries_[i].directoryPath));
+            obj.Set("directoryRecord", Napi::String::New(env, std::to_string(hit.directory)));
+            obj.Set("fileReferenceNumber", Napi::String::New(env, std::to_string(hit.fileRef)));
+            obj.Set("recordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(hit.fileRef))));
+            obj.Set("sequence", Napi::Number::New(env, usnscanner::ReferenceSequence(hit.fileRef)));
+            obj.Set("slotReused", Napi::Boolean::New(env, hit.slotReused));
+            obj.Set("parentReferenceNumber", Napi::String::New(env, std::to_string(name.parentReference)));
+            obj.Set("nameSpace", Napi::Number::New(env, name.nameSpace));
+            obj.Set("isDirectory", Napi::Boolean::New(env, (name.attributes & 0x10000000) != 0));
+            obj.Set("created", Napi::Number::New(env, usnscanner::FileTimeToUnixMs(name.created)));
+            obj.Set("modified", Napi::Number::New(env, usnscanner::FileTimeToUnixMs(name.modified)));
+            obj.Set("mftModified", Napi::Number::New(env, usnscanner::FileTimeToUnixMs(name.mftModified)));
+            obj.Set("accessed", Napi::Number::New(env, usnscanner::FileTimeToUnixMs(name.accessed)));
+            obj.Set("dataSize", Napi::String::New(env, std::to_string(name.dataSize)));
+            obj.Set("allocatedSize", Napi::String::New(env, std::to_string(name.allocatedSize)));
+            obj.Set("slack", Napi::Boolean::New(env, hit.slack));
+            obj.Set("offset", Napi::String::New(env, std::to_string(hit.offset)));
+            entries.Set(i, obj);
+        }
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("records", Napi::Number::New(env, static_cast<double>(stats_.records)));
+        stats.Set("directories", Napi::Number::New(env, static_cast<double>(stats_.directories)));
+        stats.Set("blocks", Napi::Number::New(env, static_cast<double>(stats_.blocks)));
+        stats.Set("tornBlocks", Napi::Number::New(env, static_cast<double>(stats_.tornBlocks)));
+        stats.Set("liveEntries", Napi::Number::New(env, static_cast<double>(stats_.liveEntries)));
+        stats.Set("slackEntries", Napi::Number::New(env, static_cast<double>(stats_.slackEntries)));
+        stats.Set("stillLive", Napi::Number::New(env, static_cast<double>(stats_.stillLive)));
+        stats.Set("sweepMs", Napi::Number::New(env, stats_.sweepMs));
+        stats.Set("indexMs", Napi::Number::New(env, stats_.indexMs));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("entries", entries);
+        result.Set("stats", stats);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    struct Entry {
+        usnscanner::IndexEntryHit hit;
+        std::string directoryPath;
+    };
+
+    std::string source_;
+    usnscanner::IndexSlackOptions options_;
+    std::vector<Entry> entries_;
+    usnscanner::IndexSlackStats stats_;
+};
+
+Napi::Value ScanIndexSlack(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+    usnscanner::IndexSlackOptions slackOptions{ 0, false };
+    uint64_t value = 0;
+    Napi::Value threads = options.Get("threads");
+    if (!threads.IsUndefined()) {
+        if (!ReadUnsignedValue(threads, value) || value > 256) {
+            Napi::TypeError::New(env, "Invalid thread count").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        slackOptions.threads = static_cast<size_t>(value);
+    }
+    Napi::Value includeLive = options.Get("includeLive");
+    if (includeLive.IsBoolean()) {
+        slackOptions.includeLive = includeLive.As<Napi::Boolean>();
+    }
+
+    std::string source = info[0].As<Napi::String>();
+    Napi::Function callback = info[2].As<Napi::Function>();
+
+    auto *worker = new IndexSlackWorker(source, slackOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class LogFileWorker : public Napi::AsyncWorker {
+  public:
+    LogFileWorker(const std::string &source, bool includeLive, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), source_(source), includeLive_(includeLive), clusterSize_(0), stats_{} {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+
+        usnscanner::MftReader mft(reader);
+        if (!mft.Open(error)) {
+            SetError(error);
+            return;
+        }
+        clusterSize_ = mft.Geometry().clusterSize;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> log;
+        if (!usnscanner::ReadLogFile(reader, mft, log, error)) {
+            SetError(error);
+            return;
+        }
+        double readMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        usnscanner::LogFileParser parser(clusterSize_, mft.RecordSize());
+        parser.Stats().readMs = readMs;
+        if (!parser.Parse(log, error)) {
+            SetError(error);
+            return;
+        }
+
+        for (const auto &record : parser.Records()) {
+            if (record.deallocated || includeLive_) {
+                records_.push_back(record);
+            }
+        }
+        stats_ = parser.Stats();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array records = Napi::Array::New(env, records_.size());
+        for (size_t i = 0; i < records_.size(); ++i) {
+            const auto &record = records_[i];
+            const auto &name = record.fileName;
+            uint64_t created = record.hasStandardInformation ? record.standardInformation.created : name.created;
+            uint64_t modified = record.hasStandardInformation ? record.standardInformation.modified : name.modified;
+            uint64_t mftModified = record.hasStandardInformation ? record.standardInformation.mftModified : name.mftModified;
+            uint64_t accessed = record.hasStandardInformation ? record.standardInformation.accessed : name.accessed;
+
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("recordNumber", Napi::String::New(env, std::to_string(record.recordNumber)));
+            obj.Set("sequence", Napi::Number::New(env, record.sequence));
+            obj.Set("fileReference", Napi::String::New(env, std::to_string(usnscanner::MakeFileReference(record.recordNumber, record.sequence))));
+            obj.Set("parentReference", Napi::String::New(env, std::to_string(name.parentReference)));
+            obj.Set("lsn", Napi::String::New(env, std::to_string(record.lsn)));
+            obj.Set("name", Napi::String::New(env, name.name));
+            obj.Set("nameSpace", Napi::Number::New(env, name.nameSpace));
+            obj.Set("deallocated", Napi::Boolean::New(env, record.deallocated));
+            obj.Set("isDirectory", Napi::Boolean::New(env, record.isDirectory));
+            obj.Set("created", FileTimeValue(env, created));
+            obj.Set("modified", FileTimeValue(env, modified));
+            obj.Set("mftModified", FileTimeValue(env, mftModified));
+            obj.Set("accessed", FileTimeValue(env, accessed));
+            obj.Set("dataSize", Napi::String::New(env, std::to_string(record.hasData ? record.dataSize : name.dataSize)));
+            obj.Set("resident", Napi::Boolean::New(env, record.resident));
+            obj.Set("compressionUnit", Napi::Number::New(env, record.compressionUnit));
+            obj.Set("runs", RunsToArray(env, record.runs));
+            if (record.resident && !record.residentData.empty()) {
+                obj.Set("residentDataBase64", Napi::String::New(env, Base64Encode(record.residentData.data(), record.residentData.size())));
+            }
+            records.Set(i, obj);
+        }
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("logSize", Napi::Number::New(env, static_cast<double>(stats_.logSize)));
+        stats.Set("pageSize", Napi::Number::New(env, stats_.pageSize));
+        stats.Set("pages", Napi::Number::New(env, static_cast<double>(stats_.pages)));
+        stats.Set("tornPages", Napi::Number::New(env, static_cast<double>(stats_.tornPages)));
+        stats.Set("logRecords", Napi::Number::New(env, static_cast<double>(stats_.logRecords)));
+        stats.Set("recordImages", Napi::Number::New(env, static_cast<double>(stats_.recordImages)));
+        stats.Set("residentUpdates", Napi::Number::New(env, static_cast<double>(stats_.residentUpdates)));
+        stats.Set("deallocations", Napi::Number::New(env, static_cast<double>(stats_.deallocations)));
+        stats.Set("readMs", Napi::Number::New(env, stats_.readMs));
+        stats.Set("parseMs", Napi::Number::New(env, stats_.parseMs));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("records", records);
+        result.Set("clusterSize", Napi::Number::New(env, static_cast<double>(clusterSize_)));
+        result.Set("stats", stats);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::string source_;
+    bool includeLive_;
+    uint64_t clusterSize_;
+    std::vector<usnscanner::LogFileRecord> records_;
+    usnscanner::LogFileStats stats_;
+};
+
+Napi::Value ParseLogFile(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool includeLive = false;
+    Napi::Value live = info[1].As<Napi::Object>().Get("includeLive");
+    if (live.IsBoolean()) {
+        includeLive = live.As<Napi::Boolean>();
+    }
+
+    std::string source = info[0].As<Napi::String>();
+    Napi::Function callback = info[2].As<Napi::Function>();
+
+    auto *worker = new LogFileWorker(source, includeLive, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class WofDecompressWorker : public Napi::AsyncWorker {
+  public:
+    WofDecompressWorker(std::vector<uint8_t> stream, uint32_t algorithm, uint64_t size, uint64_t length, size_t threads, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), stream_(std::move(stream)), algorithm_(algorithm), size_(size), length_(length), threads_(threads), stats_{} {}
+
+    void Execute() override {
+        output_.assign(static_cast<size_t>(length_), 0);
+        std::string error;
+        if (!usnscanner::WofDecompress(stream_.data(), stream_.size(), algorithm_, size_, length_, output_.data(), threads_, stats_, error)) {
+            SetError(error);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("data", Napi::Buffer<uint8_t>::Copy(env, output_.data(), output_.size()));
+        result.Set("chunks", Napi::Number::New(env, static_cast<double>(stats_.chunks)));
+        result.Set("storedChunks", Napi::Number::New(env, static_cast<double>(stats_.storedChunks)));
+        result.Set("corruptChunks", Napi::Number::New(env, static_cast<double>(stats_.corruptChunks)));
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::vector<uint8_t> stream_;
+    uint32_t algorithm_;
+    uint64_t size_;
+    uint64_t length_;
+    size_t threads_;
+    std::vector<uint8_t> output_;
+    usnscanner::WofStats stats_;
+};
+
+Napi::Value DecompressWof(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected stream, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsBuffer()) {
+        Napi::TypeError::New(env, "Stream must be a Buffer").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+    uint64_t algorithm = 0;
+    if (!ReadUnsignedValue(options.Get("algorithm"), algorithm) || usnscanner::WofChunkSize(static_cast<uint32_t>(algorithm)) == 0) {
+        Napi::TypeError::New(env, "Invalid WOF compression format").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    uint64_t size = 0;
+    if (!ReadUnsignedValue(options.Get("size"), size) || size > (1ULL << 48)) {
+        Napi::TypeError::New(env, "Invalid uncompressed size").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    // Larger files are read a prefix at a time.
+    uint64_t length = size;
+    Napi::Value lengthValue = options.Get("length");
+    if (!lengthValue.IsUndefined() && !ReadUnsignedValue(lengthValue, length)) {
+        Napi::TypeError::New(env, "Invalid output length").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    length = std::min(length, size);
+    if (length > 1024ULL * 1024 * 1024) {
+        Napi::TypeError::New(env, "Output length exceeds 1 GiB").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    uint64_t threads = 0;
+    Napi::Value threadsValue = options.Get("threads");
+    if (!threadsValue.IsUndefined() && (!ReadUnsignedValue(threadsValue, threads) || threads > 256)) {
+        Napi::TypeError::New(env, "Invalid thread count").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+    std::vector<uint8_t> stream(buffer.Data(), buffer.Data() + buffer.Length());
+    Napi::Function callback = info[2].As<Napi::Function>();
+
+    auto *worker = new WofDecompressWorker(std::move(stream), static_cast<uint32_t>(algorithm), size, length, static_cast<size_t>(threads), callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+// Synchronous: one unit is at most 16 MB and decodes in about a millisecond.
+Napi::Value DecodeCompressionUnit(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+        Napi::TypeError::New(env, "Expected stored clusters and unit size").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsBuffer()) {
+        Napi::TypeError::New(env, "Stored clusters must be a Buffer").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint64_t unitSize = 0;
+    if (!ReadUnsignedValue(info[1], unitSize) || unitSize == 0 || unitSize > 16 * 1024 * 1024) {
+        Napi::TypeError::New(env, "Invalid compression unit size").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Buffer<uint8_t> stored = info[0].As<Napi::Buffer<uint8_t>>();
+    Napi::Buffer<uint8_t> unit = Napi::Buffer<uint8_t>::New(env, static_cast<size_t>(unitSize));
+    bool ok = usnscanner::DecodeCompressionUnit(stored.Data(), stored.Length(), unit.Data(), unit.Length());
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("data", unit);
+    result.Set("corrupt", Napi::Boolean::New(env, !ok));
+    return result;
+}
+
+class ResidentExportWorker : public Napi::AsyncWorker {
+  public:
+    ResidentExportWorker(const std::string &source, const usnscanner::ResidentExportOptions &options, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), source_(source), options_(options), stats_{} {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+
+        usnscanner::ResidentExporter exporter(reader, options_);
+        if (!exporter.Run(error)) {
+            SetError(error);
+            return;
+        }
+        entries_ = exporter.Entries();
+        stats_ = exporter.Stats();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array entries = Napi::Array::New(env, entries_.size());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            const auto &entry = entries_[i];
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("recordNumber", Napi::String::New(env, std::to_string(entry.recordNumber)));
+            obj.Set("sequence", Napi::Number::New(env, entry.sequence));
+            obj.Set("inUse", Napi::Boolean::New(env, entry.inUse));
+            obj.Set("parentReference", Napi::String::New(env, std::to_string(entry.parentReference)));
+            obj.Set("name", Napi::String::New(env, entry.name));
+            obj.Set("outputName", Napi::String::New(env, entry.outputName));
+            obj.Set("size", Napi::Number::New(env, static_cast<double>(entry.size)));
+            obj.Set("modified", FileTimeValue(env, entry.modified));
+            entries.Set(i, obj);
+        }
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("records", Napi::Number::New(env, static_cast<double>(stats_.records)));
+        stats.Set("candidates", Napi::Number::New(env, static_cast<double>(stats_.candidates)));
+        stats.Set("files", Napi::Number::New(env, static_cast<double>(stats_.files)));
+        stats.Set("bytes", Napi::Number::New(env, static_cast<double>(stats_.bytes)));
+        stats.Set("failed", Napi::Number::New(env, static_cast<double>(stats_.failed)));
+        stats.Set("sweepMs", Napi::Number::New(env, stats_.sweepMs));
+        stats.Set("writeMs", Napi::Number::New(env, stats_.writeMs));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("entries", entries);
+        result.Set("stats", stats);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::string source_;
+    usnscanner::ResidentExportOptions options_;
+    std::vector<usnscanner::ResidentExportEntry> entries_;
+    usnscanner::ResidentExportStats stats_;
+};
+
+Napi::Value ExtractResident(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+    usnscanner::ResidentExportOptions exportOptions{};
+    Napi::Value outputDir = options.Get("outputDir");
+    Napi::Value archive = options.Get("archive");
+    if (outputDir.IsString()) {
+        exportOptions.outputDirectory = outputDir.As<Napi::String>();
+    }
+    if (archive.IsString()) {
+        exportOptions.archivePath = archive.As<Napi::String>();
+    }
+    if (exportOptions.outputDirectory.empty() == exportOptions.archivePath.empty()) {
+        Napi::TypeError::New(env, "Exactly one of outputDir or archive is required").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Value live = options.Get("includeLive");
+    if (live.IsBoolean()) {
+        exportOptions.includeLive = live.As<Napi::Boolean>();
+    }
+    Napi::Value maxSize = options.Get("maxSize");
+    if (!maxSize.IsUndefined() && !ReadUnsignedValue(maxSize, exportOptions.maxSize)) {
+        Napi::TypeError::New(env, "Invalid maximum size").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string source = info[0].As<Napi::String>();
+    Napi::Function callback = info[2].As<Napi::Function>();
+
+    auto *worker = new ResidentExportWorker(source, exportOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+const char *TreeNodeKindName(usnscanner::TreeNodeKind kind) {
+    switch (kind) {
+        case usnscanner::TreeNodeKind::Root: return "root";
+        case usnscanner::TreeNodeKind::Live: return "live";
+        case usnscanner::TreeNodeKind::OrphanRoot: return "orphanRoot";
+        case usnscanner::TreeNodeKind::Orphan: return "orphan";
+        case usnscanner::TreeNodeKind::Volume: return "volume";
+        default: return "deleted";
+    }
+}
+
+Napi::Object TreeNodeValue(const Napi::Env &env, const usnscanner::DeletedTree &tree, uint32_t id) {
+    const usnscanner::TreeNode &node = tree.Node(id);
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("id", Napi::Number::New(env, id));
+    obj.Set("name", Napi::String::New(env, tree.Name(id)));
+    obj.Set("kind", Napi::String::New(env, TreeNodeKindName(node.kind)));
+    obj.Set("childCount", Napi::Number::New(env, node.childCount));
+    obj.Set("fileCount", Napi::Number::New(env, static_cast<double>(node.fileCount)));
+    obj.Set("totalSize", Napi::Number::New(env, static_cast<double>(node.totalSize)));
+    if (node.kind != usnscanner::TreeNodeKind::Deleted) {
+        obj.Set("isDirectory", Napi::Boolean::New(env, true));
+        if (node.kind == usnscanner::TreeNodeKind::Volume) {
+            obj.Set("volume", Napi::Number::New(env, static_cast<double>(node.reference)));
+        } else if (node.reference != 0) {
+            obj.Set("reference", Napi::String::New(env, std::to_string(node.reference)));
+        }
+        return obj;
+    }
+
+    const usnscanner::DeletedEntry &entry = tree.Entries()[node.item];
+    obj.Set("isDirectory", Napi::Boolean::New(env, entry.isDirectory));
+    obj.Set("recordNumber", Napi::String::New(env, std::to_string(entry.recordNumber)));
+    obj.Set("sequence", Napi::Number::New(env, entry.sequence));
+    obj.Set("fileReference", Napi::String::New(env, std::to_string(node.reference)));
+    obj.Set("parentReference", Napi::String::New(env, std::to_string(entry.parentReference)));
+    if (entry.links != usnscanner::kNoNameLink) {
+        std::vector<std::string> linkPaths = tree.LinkPaths(id);
+        Napi::Array links = Napi::Array::New(env, linkPaths.size());
+        for (size_t i = 0; i < linkPaths.size(); ++i) {
+            links.Set(static_cast<uint32_t>(i), Napi::String::New(env, linkPaths[i]));
+        }
+        obj.Set("linkPaths", links);
+    }
+    obj.Set("size", Napi::Number::New(env, static_cast<double>(entry.size)));
+    obj.Set("allocatedSize", Napi::Number::New(env, static_cast<double>(entry.allocatedSize)));
+    obj.Set("fragments", Napi::Number::New(env, entry.fragments));
+    obj.Set("resident", Napi::Boolean::New(env, entry.resident));
+    obj.Set("created", FileTimeValue(env, entry.created));
+    obj.Set("modified", FileTimeValue(env, entry.modified));
+    obj.Set("mftModified", FileTimeValue(env, entry.mftModified));
+    obj.Set("accessed", FileTimeValue(env, entry.accessed));
+    return obj;
+}
+
+class DeletedTreeWorker : public Napi::AsyncWorker {
+  public:
+    DeletedTreeWorker(const std::string &source, const std::string &journal, const std::string &flightKey, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), source_(source), journal_(journal), flightKey_(flightKey) {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+
+        auto scan = std::make_shared<usnscanner::StoredScan>();
+        scan->source = source_;
+        if (!scan->tree.Build(reader, error)) {
+            SetError(error);
+            return;
+        }
+        if (!journal_.empty() && !usnscanner::AttachJournal(*scan, journal_, error)) {
+            SetError(error);
+            return;
+        }
+        scan_ = std::move(scan);
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        // Every caller sharing the scan gets its own objects and its own id,
+        // to release on its own.
+        DeliverScanFlight(env, flightKey_, Callback(), false, [this](Napi::Env env) -> Napi::Value {
+            const usnscanner::DeletedTree &tree = scan_->tree;
+            const usnscanner::DeletedTreeStats &treeStats = tree.Stats();
+            Napi::Object stats = Napi::Object::New(env);
+            stats.Set("records", Napi::Number::New(env, static_cast<double>(treeStats.records)));
+            stats.Set("deleted", Napi::Number::New(env, static_cast<double>(treeStats.deleted)));
+            stats.Set("directories", Napi::Number::New(env, static_cast<double>(treeStats.directories)));
+            stats.Set("liveAnchors", Napi::Number::New(env, static_cast<double>(treeStats.liveAnchors)));
+            stats.Set("orphanGroups", Napi::Number::New(env, static_cast<double>(treeStats.orphanGroups)));
+            stats.Set("cyclesBroken", Napi::Number::New(env, static_cast<double>(treeStats.cyclesBroken)));
+            stats.Set("nodes", Napi::Number::New(env, static_cast<double>(tree.NodeCount())));
+            stats.Set("sweepMs", Napi::Number::New(env, treeStats.sweepMs));
+            stats.Set("buildMs", Napi::Number::New(env, treeStats.buildMs));
+            stats.Set("journal", Napi::Boolean::New(env, !scan_->reasons.empty()));
+
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("root", TreeNodeValue(env, tree, 0));
+            result.Set("stats", stats);
+            result.Set("scanId", Napi::Number::New(env, usnscanner::StoreScan(scan_)));
+            return result;
+        });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Napi::Value error = e.Value();
+        DeliverScanFlight(env, flightKey_, Callback(), true, [error](Napi::Env) { return error; });
+    }
+
+  private:
+    std::string source_;
+    std::string journal_;
+    std::string flightKey_;
+    std::shared_ptr<const usnscanner::StoredScan> scan_;
+};
+
+Napi::Value ScanDeletedTree(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // journal: true reads the source volume's own change journal; a string
+    // names a copy of $J that belongs to the image being scanned.
+    std::string source = info[0].As<Napi::String>();
+    std::string journal;
+    char letter = 0;
+    Napi::Value journalValue = info[1].As<Napi::Object>().Get("journal");
+    if (journalValue.IsString()) {
+        journal = journalValue.As<Napi::String>();
+    } else if (journalValue.IsBoolean()) {
+        if (journalValue.As<Napi::Boolean>() && !usnscanner::IsDriveLetterSource(source, letter)) {
+            Napi::TypeError::New(env, "journal: true needs a drive letter source; pass the path of a $J copy instead").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (journalValue.As<Napi::Boolean>()) {
+            journal = source;
+        }
+    } else if (!journalValue.IsUndefined()) {
+        Napi::TypeError::New(env, "journal must be a boolean or a path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Function callback = info[2].As<Napi::Function>();
+    std::string flightKey = "tree|" + FlightSource(source) + "|" + (journal == source ? FlightSource(journal) : journal);
+    if (JoinScanFlight(flightKey, callback)) {
+        return env.Undefined();
+    }
+
+    auto *worker = new DeletedTreeWorker(source, journal, flightKey, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+const char *VolumeScanStateName(usnscanner::VolumeScanState state) {
+    switch (state) {
+        case usnscanner::VolumeScanState::Queued: return "queued";
+        case usnscanner::VolumeScanState::Scanning: return "scanning";
+        case usnscanner::VolumeScanState::Journal: return "journal";
+        case usnscanner::VolumeScanState::Done: return "done";
+        default: return "failed";
+    }
+}
+
+Napi::Array VolumeStatusArray(const Napi::Env &env, const usnscanner::VolumeScanStatus *volumes, size_t count) {
+    Napi::Array result = Napi::Array::New(env, count);
+    for (size_t i = 0; i < count; ++i) {
+        const usnscanner::VolumeScanStatus &volume = volumes[i];
+        Napi::Array devices = Napi::Array::New(env, volume.devices.size());
+        for (size_t d = 0; d < volume.devices.size(); ++d) {
+            devices.Set(static_cast<uint32_t>(d), Napi::String::New(env, volume.devices[d]));
+        }
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("volume", Napi::String::New(env, volume.source));
+        obj.Set("devices", devices);
+        obj.Set("group", Napi::Number::New(env, volume.group));
+        obj.Set("state", Napi::String::New(env, VolumeScanStateName(volume.state)));
+        obj.Set("recordsDone", Napi::Number::New(env, static_cast<double>(volume.recordsDone)));
+        obj.Set("recordCount", Napi::Number::New(env, static_cast<double>(volume.recordCount)));
+        obj.Set("deleted", Napi::Number::New(env, static_cast<double>(volume.deleted)));
+        obj.Set("waitMs", Napi::Number::New(env, volume.waitMs));
+        obj.Set("scanMs", Napi::Number::New(env, volume.scanMs));
+        if (!volume.error.empty()) {
+            obj.Set("error", Napi::String::New(env, volume.error));
+        }
+        result.Set(static_cast<uint32_t>(i), obj);
+    }
+    return result;
+}
+
+// Each progress report carries every volume's status, so keeping only the
+// latest one when JS falls behind loses nothing.
+class MultiVolumeScanWorker : public Napi::AsyncProgressWorker<usnscanner::VolumeScanStatus> {
+  public:
+    MultiVolumeScanWorker(
+        std::vector<usnscanner::VolumeScanRequest> requests,
+        const std::string &flightKey,
+        const Napi::Function &onProgress,
+        const Napi::Function &callback)
+        : Napi::AsyncProgressWorker<usnscanner::VolumeScanStatus>(callback),
+          requests_(std::move(requests)),
+          flightKey_(flightKey) {
+        if (!onProgress.IsEmpty()) {
+            onProgress_ = Napi::Persistent(onProgress);
+        }
+    }
+
+    void Execute(const ExecutionProgress &progress) override {
+        auto scan = std::make_shared<usnscanner::StoredScan>();
+        std::string error;
+        bool ok = usnscanner::ScanVolumes(requests_, [&](const std::vector<usnscanner::VolumeScanStatus> &volumes) {
+            progress.Send(volumes.data(), volumes.size());
+        }, *scan, volumes_, error);
+        if (!ok) {
+            SetError(error);
+            return;
+        }
+        scan_ = std::move(scan);
+    }
+
+    // Requests that joined this scan hear its progress too.
+    void OnProgress(const usnscanner::VolumeScanStatus *data, size_t count) override {
+        if (count == 0) {
+            return;
+        }
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        if (!onProgress_.IsEmpty()) {
+            onProgress_.Call({ VolumeStatusArray(env, data, count) });
+        }
+        auto flight = scanFlights.find(flightKey_);
+        if (flightKey_.empty() || flight == scanFlights.end()) {
+            return;
+        }
+        for (const auto &onProgress : flight->second.progress) {
+            if (env.IsExceptionPending()) {
+                return;
+            }
+            onProgress.Call({ VolumeStatusArray(env, data, count) });
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        DeliverScanFlight(env, flightKey_, Callback(), false, [this](Napi::Env env) -> Napi::Value {
+            const usnscanner::DeletedTree &tree = scan_->tree;
+            const usnscanner::DeletedTreeStats &treeStats = tree.Stats();
+            Napi::Object stats = Napi::Object::New(env);
+            stats.Set("records", Napi::Number::New(env, static_cast<double>(treeStats.records)));
+            stats.Set("deleted", Napi::Number::New(env, static_cast<double>(treeStats.deleted)));
+            stats.Set("directories", Napi::Number::New(env, static_cast<double>(treeStats.directories)));
+            stats.Set("nodes", Napi::Number::New(env, static_cast<double>(tree.NodeCount())));
+            stats.Set("journal", Napi::Boolean::New(env, !scan_->reasons.empty()));
+
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("root", TreeNodeValue(env, tree, 0));
+            result.Set("volumes", VolumeStatusArray(env, volumes_.data(), volumes_.size()));
+            result.Set("stats", stats);
+            result.Set("scanId", Napi::Number::New(env, usnscanner::StoreScan(scan_)));
+            return result;
+        });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Napi::Value error = e.Value();
+        DeliverScanFlight(env, flightKey_, Callback(), true, [error](Napi::Env) { return error; });
+    }
+
+  private:
+    std::vector<usnscanner::VolumeScanRequest> requests_;
+    std::string flightKey_;
+    Napi::FunctionReference onProgress_;
+    std::vector<usnscanner::VolumeScanStatus> volumes_;
+    std::shared_ptr<const usnscanner::StoredScan> scan_;
+};
+
+Napi::Value ScanAll(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected volumes, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsArray() || info[0].As<Napi::Array>().Length() == 0) {
+        Napi::TypeError::New(env, "Volumes must be a non-empty array of drive letters or image paths").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+    // journal: true reads each drive letter's own change journal; images are
+    // scanned without one.
+    bool journal = false;
+    Napi::Value journalValue = options.Get("journal");
+    if (journalValue.IsBoolean()) {
+        journal = journalValue.As<Napi::Boolean>();
+    } else if (!journalValue.IsUndefined()) {
+        Napi::TypeError::New(env, "journal must be a boolean").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Value onProgress = options.Get("onProgress");
+    if (!onProgress.IsUndefined() && !onProgress.IsFunction()) {
+        Napi::TypeError::New(env, "onProgress must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array volumes = info[0].As<Napi::Array>();
+    std::vector<usnscanner::VolumeScanRequest> requests;
+    // The same volumes in the same order, since the order shapes the result.
+    std::string flightKey = journal ? "all+journal" : "all";
+    for (uint32_t i = 0; i < volumes.Length(); ++i) {
+        Napi::Value volume = volumes.Get(i);
+        if (!volume.IsString()) {
+            Napi::TypeError::New(env, "Volumes must be a non-empty array of drive letters or image paths").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        usnscanner::VolumeScanRequest request;
+        request.source = volume.As<Napi::String>();
+        flightKey += "|" + FlightSource(request.source);
+        char letter = 0;
+        if (journal && usnscanner::IsDriveLetterSource(request.source, letter)) {
+            request.journal = request.source;
+        }
+        requests.push_back(std::move(request));
+    }
+
+    Napi::Function callback = info[2].As<Napi::Function>();
+    Napi::Function progressCallback = onProgress.IsFunction() ? onProgress.As<Napi::Function>() : Napi::Function();
+    if (JoinScanFlight(flightKey, callback, progressCallback)) {
+        return env.Undefined();
+    }
+    auto *worker = new MultiVolumeScanWorker(std::move(requests), flightKey, progressCallback, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+bool ReadScanId(const Napi::Value &value, uint32_t &scanId) {
+    uint64_t id = 0;
+    if (!ReadUnsignedValue(value, id) || id == 0 || id > UINT32_MAX) {
+        return false;
+    }
+    scanId = static_cast<uint32_t>(id);
+    return true;
+}
+
+// Synchronous: a page of children is a few hundred objects at most.
+Napi::Value ExpandTree(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+        Napi::TypeError::New(env, "Expected scan id and node id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t scanId = 0;
+    if (!ReadScanId(info[0], scanId)) {
+        Napi::TypeError::New(env, "Invalid scan id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::shared_ptr<const usnscanner::StoredScan> scan = usnscanner::FindScan(scanId);
+    if (!scan) {
+        Napi::Error::New(env, "Unknown scan id " + std::to_string(scanId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const usnscanner::DeletedTree &tree = scan->tree;
+    uint64_t nodeId = 0;
+    if (!ReadUnsignedValue(info[1], nodeId) || nodeId >= tree.NodeCount()) {
+        Napi::TypeError::New(env, "Invalid node id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint64_t offset = 0;
+    uint64_t limit = 1000;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object options = info[2].As<Napi::Object>();
+        Napi::Value offsetValue = options.Get("offset");
+        Napi::Value limitValue = options.Get("limit");
+        if ((!offsetValue.IsUndefined() && !ReadUnsignedValue(offsetValue, offset)) ||
+            (!limitValue.IsUndefined() && (!ReadUnsignedValue(limitValue, limit) || limit == 0))) {
+            Napi::TypeError::New(env, "Invalid page options").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    const uint32_t id = static_cast<uint32_t>(nodeId);
+    const usnscanner::TreeNode &node = tree.Node(id);
+    const uint64_t first = std::min<uint64_t>(offset, node.childCount);
+    const uint64_t last = std::min<uint64_t>(node.childCount, first + limit);
+    const uint32_t *children = tree.Children(id);
+
+    Napi::Array page = Napi::Array::New(env, static_cast<size_t>(last - first));
+    for (uint64_t i = first; i < last; ++i) {
+        page.Set(static_cast<uint32_t>(i - first), TreeNodeValue(env, tree, children[i]));
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("node", TreeNodeValue(env, tree, id));
+    result.Set("path", Napi::String::New(env, tree.Path(id)));
+    result.Set("offset", Napi::Number::New(env, static_cast<double>(first)));
+    result.Set("total", Napi::Number::New(env, node.childCount));
+    result.Set("children", page);
+    return result;
+}
+
+Napi::Value ReleaseScan(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    uint32_t scanId = 0;
+    if (info.Length() < 1 || !ReadScanId(info[0], scanId)) {
+        Napi::TypeError::New(env, "Invalid scan id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return Napi::Boolean::New(env, usnscanner::ReleaseScan(scanId));
+}
+
+const char *AggregateKeyName(usnscanner::AggregateKey key) {
+    switch (key) {
+        case usnscanner::AggregateKey::Reason: return "reason";
+        case usnscanner::AggregateKey::Extension: return "extension";
+        case usnscanner::AggregateKey::Directory: return "directory";
+        case usnscanner::AggregateKey::Day: return "day";
+    }
+    return "";
+}
+
+bool ParseAggregateKey(const Napi::Value &value, usnscanner::AggregateKey &key) {
+    if (!value.IsString()) {
+        return false;
+    }
+    std::string name = value.As<Napi::String>();
+    const usnscanner::AggregateKey keys[] = {
+        usnscanner::AggregateKey::Reason,
+        usnscanner::AggregateKey::Extension,
+        usnscanner::AggregateKey::Directory,
+        usnscanner::AggregateKey::Day,
+    };
+    for (auto candidate : keys) {
+        if (name == AggregateKeyName(candidate)) {
+            key = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+class AggregateWorker : public Napi::AsyncWorker {
+  public:
+    AggregateWorker(
+        std::shared_ptr<const usnscanner::StoredScan> scan,
+        std::vector<usnscanner::AggregateKey> keys,
+        const usnscanner::AggregateOptions &options,
+        const Napi::Function &callback)
+        : Napi::AsyncWorker(callback),
+          scan_(std::move(scan)),
+          keys_(std::move(keys)),
+          options_(options),
+          summary_{} {}
+
+    void Execute() override {
+        summary_ = usnscanner::Aggregate(*scan_, keys_, options_);
+    }
+
+    // Tables are columnar (keys, counts, bytes) so a dashboard gets a
+    // handful of arrays rather than an object per row.
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Object tables = Napi::Object::New(env);
+        for (const auto &table : summary_.tables) {
+            Napi::Array keys = Napi::Array::New(env, table.rows.size());
+            Napi::Array counts = Napi::Array::New(env, table.rows.size());
+            Napi::Array bytes = Napi::Array::New(env, table.rows.size());
+            for (size_t i = 0; i < table.rows.size(); ++i) {
+                keys.Set(i, Napi::String::New(env, table.rows[i].key));
+                counts.Set(i, Napi::Number::New(env, static_cast<double>(table.rows[i].count)));
+                bytes.Set(i, Napi::Number::New(env, static_cast<double>(table.rows[i].bytes)));
+            }
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("keys", keys);
+            obj.Set("counts", counts);
+            obj.Set("bytes", bytes);
+            obj.Set("otherKeys", Napi::Number::New(env, static_cast<double>(table.otherKeys)));
+            obj.Set("otherCount", Napi::Number::New(env, static_cast<double>(table.otherCount)));
+            obj.Set("otherBytes", Napi::Number::New(env, static_cast<double>(table.otherBytes)));
+            tables.Set(AggregateKeyName(table.key), obj);
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("files", Napi::Number::New(env, static_cast<double>(summary_.files)));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(summary_.bytes)));
+        result.Set("withoutJournal", Napi::Number::New(env, static_cast<double>(summary_.withoutJournal)));
+        result.Set("tables", tables);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::shared_ptr<const usnscanner::StoredScan> scan_;
+    std::vector<usnscanner::AggregateKey> keys_;
+    usnscanner::AggregateOptions options_;
+    usnscanner::AggregateSummary summary_;
+};
+
+Napi::Value Aggregate(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 4) {
+        Napi::TypeError::New(env, "Expected scan id, group keys, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t scanId = 0;
+    if (!ReadScanId(info[0], scanId)) {
+        Napi::TypeError::New(env, "Invalid scan id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::shared_ptr<const usnscanner::StoredScan> scan = usnscanner::FindScan(scanId);
+    if (!scan) {
+        Napi::Error::New(env, "Unknown scan id " + std::to_string(scanId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // groupBy is one key or an array of keys; each gets its own table.
+    std::vector<usnscanner::AggregateKey> keys;
+    usnscanner::AggregateKey key;
+    if (info[1].IsArray()) {
+        Napi::Array names = info[1].As<Napi::Array>();
+        for (uint32_t i = 0; i < names.Length(); ++i) {
+            if (!ParseAggregateKey(names.Get(i), key)) {
+                Napi::TypeError::New(env, "groupBy keys must be 'reason', 'extension', 'directory' or 'day'").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                keys.push_back(key);
+            }
+        }
+    } else if (ParseAggregateKey(info[1], key)) {
+        keys.push_back(key);
+    }
+    if (keys.empty()) {
+        Napi::TypeError::New(env, "groupBy keys must be 'reason', 'extension', 'directory' or 'day'").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[3].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[2].As<Napi::Object>();
+    usnscanner::AggregateOptions aggregateOptions{ 0, 20, 0 };
+    uint64_t value = 0;
+    Napi::Value nodeId = options.Get("nodeId");
+    if (!nodeId.IsUndefined()) {
+        if (!ReadUnsignedValue(nodeId, value) || value >= scan->tree.NodeCount()) {
+            Napi::TypeError::New(env, "Invalid node id").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        aggregateOptions.nodeId = static_cast<uint32_t>(value);
+    }
+    Napi::Value top = options.Get("top");
+    if (!top.IsUndefined()) {
+        if (!ReadUnsignedValue(top, value) || value == 0 || value > 100000) {
+            Napi::TypeError::New(env, "top must be a number between 1 and 100000").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        aggregateOptions.top = static_cast<size_t>(value);
+    }
+    Napi::Value utcOffset = options.Get("utcOffsetMinutes");
+    if (!utcOffset.IsUndefined()) {
+        double minutes = utcOffset.IsNumber() ? utcOffset.As<Napi::Number>().DoubleValue() : 1e9;
+        if (minutes < -1440 || minutes > 1440) {
+            Napi::TypeError::New(env, "utcOffsetMinutes must be a number between -1440 and 1440").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        aggregateOptions.utcOffsetMinutes = static_cast<int32_t>(minutes);
+    }
+
+    Napi::Function callback = info[3].As<Napi::Function>();
+    auto *worker = new AggregateWorker(std::move(scan), std::move(keys), aggregateOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class ExportWorker : public Napi::AsyncWorker {
+  public:
+    ExportWorker(std::shared_ptr<const usnscanner::StoredScan> scan, const usnscanner::ExportOptions &options, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), scan_(std::move(scan)), options_(options), stats_{} {}
+
+    void Execute() override {
+        std::string error;
+        if (!usnscanner::ExportScan(*scan_, options_, stats_, error)) {
+            SetError(error);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("rows", Napi::Number::New(env, static_cast<double>(stats_.rows)));
+        stats.Set("bytes", Napi::Number::New(env, static_cast<double>(stats_.bytes)));
+        stats.Set("fileBytes", Napi::Number::New(env, static_cast<double>(stats_.fileBytes)));
+        stats.Set("writeMs", Napi::Number::New(env, stats_.writeMs));
+        Callback().Call({ env.Null(), stats });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::shared_ptr<const usnscanner::StoredScan> scan_;
+    usnscanner::ExportOptions options_;
+    usnscanner::ExportStats stats_;
+};
+
+Napi::Value ExportResults(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5) {
+        Napi::TypeError::New(env, "Expected scan id, format, path, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t scanId = 0;
+    if (!ReadScanId(info[0], scanId)) {
+        Napi::TypeError::New(env, "Invalid scan id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::shared_ptr<const usnscanner::StoredScan> scan = usnscanner::FindScan(scanId);
+    if (!scan) {
+        Napi::Error::New(env, "Unknown scan id " + std::to_string(scanId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    usnscanner::ExportOptions exportOptions{};
+    std::string format = info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : std::string();
+    if (format == "csv") {
+        exportOptions.format = usnscanner::ExportFormat::Csv;
+    } else if (format == "jsonl") {
+        exportOptions.format = usnscanner::ExportFormat::JsonLines;
+    } else {
+        Napi::TypeError::New(env, "format must be 'csv' or 'jsonl'").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsString() || info[2].As<Napi::String>().Utf8Value().empty()) {
+        Napi::TypeError::New(env, "Path must be a file path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    exportOptions.path = info[2].As<Napi::String>();
+
+    if (!info[3].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[4].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // gzip defaults to on for a ".gz" path.
+    Napi::Object options = info[3].As<Napi::Object>();
+    const std::string &path = exportOptions.path;
+    exportOptions.gzip = path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+    Napi::Value gzip = options.Get("gzip");
+    if (gzip.IsBoolean()) {
+        exportOptions.gzip = gzip.As<Napi::Boolean>();
+    } else if (!gzip.IsUndefined()) {
+        Napi::TypeError::New(env, "gzip must be a boolean").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    uint64_t value = 0;
+    Napi::Value nodeId = options.Get("nodeId");
+    if (!nodeId.IsUndefined()) {
+        if (!ReadUnsignedValue(nodeId, value) || value >= scan->tree.NodeCount()) {
+            Napi::TypeError::New(env, "Invalid node id").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        exportOptions.nodeId = static_cast<uint32_t>(value);
+    }
+
+    Napi::Function callback = info[4].As<Napi::Function>();
+    auto *worker = new ExportWorker(std::move(scan), exportOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+// Progress goes through AsyncProgressWorker, which keeps only the latest
+// report when JS falls behind, so a large restore never queues callbacks.
+class TreeRecoveryWorker : public Napi::AsyncProgressWorker<usnscanner::TreeRecoveryProgress> {
+  public:
+    TreeRecoveryWorker(
+        std::shared_ptr<const usnscanner::StoredScan> scan,
+        uint32_t nodeId,
+        const usnscanner::TreeRecoveryOptions &options,
+        const Napi::Function &onProgress,
+        const Napi::Function &callback)
+        : Napi::AsyncProgressWorker<usnscanner::TreeRecoveryProgress>(callback),
+          scan_(std::move(scan)),
+          nodeId_(nodeId),
+          options_(options),
+          stats_{} {
+        if (!onProgress.IsEmpty()) {
+            onProgress_ = Napi::Persistent(onProgress);
+        }
+    }
+
+    void Execute(const ExecutionProgress &progress) override {
+        std::string source;
+        if (!usnscanner::NodeSource(*scan_, nodeId_, source)) {
+            SetError("The node spans several volumes; recover each volume's node instead");
+            return;
+        }
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source, error)) {
+            SetError(error);
+            return;
+        }
+
+        usnscanner::TreeRecovery recovery(reader, scan_->tree, options_);
+        bool ok = recovery.Run(nodeId_, [&](const usnscanner::TreeRecoveryProgress &current) {
+            progress.Send(&current, 1);
+        }, error);
+        if (!ok) {
+            SetError(error);
+            return;
+        }
+        failures_ = recovery.Failures();
+        stats_ = recovery.Stats();
+    }
+
+    void OnProgress(const usnscanner::TreeRecoveryProgress *data, size_t count) override {
+        if (onProgress_.IsEmpty() || count == 0) {
+            return;
+        }
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        const usnscanner::TreeRecoveryProgress &current = data[count - 1];
+        Napi::Object value = Napi::Object::New(env);
+        value.Set("files", Napi::Number::New(env, static_cast<double>(current.files)));
+        value.Set("filesDone", Napi::Number::New(env, static_cast<double>(current.filesDone)));
+        value.Set("bytes", Napi::Number::New(env, static_cast<double>(current.bytes)));
+        value.Set("bytesDone", Napi::Number::New(env, static_cast<double>(current.bytesDone)));
+        onProgress_.Call({ value });
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array failures = Napi::Array::New(env, failures_.size());
+        for (size_t i = 0; i < failures_.size(); ++i) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("path", Napi::String::New(env, failures_[i].path));
+            obj.Set("reason", Napi::String::New(env, failures_[i].reason));
+            failures.Set(i, obj);
+        }
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("directories", Napi::Number::New(env, static_cast<double>(stats_.directories)));
+        stats.Set("files", Napi::Number::New(env, static_cast<double>(stats_.files)));
+        stats.Set("residentFiles", Napi::Number::New(env, static_cast<double>(stats_.residentFiles)));
+        stats.Set("compressedFiles", Napi::Number::New(env, static_cast<double>(stats_.compressedFiles)));
+        stats.Set("skippedReused", Napi::Number::New(env, static_cast<double>(stats_.skippedReused)));
+        stats.Set("failed", Napi::Number::New(env, static_cast<double>(stats_.failed)));
+        stats.Set("bytes", Napi::Number::New(env, static_cast<double>(stats_.bytes)));
+        stats.Set("reads", Napi::Number::New(env, static_cast<double>(stats_.reads)));
+        stats.Set("recordMs", Napi::Number::New(env, stats_.recordMs));
+        stats.Set("copyMs", Napi::Number::New(env, stats_.copyMs));
+        stats.Set("io", IoProfileValue(env, stats_.profile));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("failures", failures);
+        result.Set("stats", stats);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::shared_ptr<const usnscanner::StoredScan> scan_;
+    uint32_t nodeId_;
+    usnscanner::TreeRecoveryOptions options_;
+    Napi::FunctionReference onProgress_;
+    std::vector<usnscanner::TreeRecoveryFailure> failures_;
+    usnscanner::TreeRecoveryStats stats_;
+};
+
+Napi::Value RecoverTree(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5) {
+        Napi::TypeError::New(env, "Expected scan id, node id, output directory, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t scanId = 0;
+    if (!ReadScanId(info[0], scanId)) {
+        Napi::TypeError::New(env, "Invalid scan id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::shared_ptr<const usnscanner::StoredScan> scan = usnscanner::FindScan(scanId);
+    if (!scan) {
+        Napi::Error::New(env, "Unknown scan id " + std::to_string(scanId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint64_t nodeId = 0;
+    if (!ReadUnsignedValue(info[1], nodeId) || nodeId >= scan->tree.NodeCount()) {
+        Napi::TypeError::New(env, "Invalid node id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsString()) {
+        Napi::TypeError::New(env, "Output directory must be a string").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[3].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[4].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    usnscanner::TreeRecoveryOptions options{};
+    options.outputDirectory = info[2].As<Napi::String>();
+    Napi::Object optionsObject = info[3].As<Napi::Object>();
+    Napi::Value streams = optionsObject.Get("streams");
+    uint64_t streamCount = 0;
+    if (!streams.IsUndefined() && (!ReadUnsignedValue(streams, streamCount) || streamCount > 64)) {
+        Napi::TypeError::New(env, "streams must be a number between 0 and 64").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    options.streams = static_cast<size_t>(streamCount);
+
+    if (!ReadIoProfileMode(optionsObject.Get("device"), options.device)) {
+        Napi::TypeError::New(env, "device must be 'auto', 'rotational', 'ssd' or 'probe'").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Value onProgress = optionsObject.Get("onProgress");
+    if (!onProgress.IsUndefined() && !onProgress.IsFunction()) {
+        Napi::TypeError::New(env, "onProgress must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Function callback = info[4].As<Napi::Function>();
+    auto *worker = new TreeRecoveryWorker(
+        std::move(scan),
+        static_cast<uint32_t>(nodeId),
+        options,
+        onProgress.IsFunction() ? onProgress.As<Napi::Function>() : Napi::Function(),
+        callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class IoProbeWorker : public Napi::AsyncWorker {
+  public:
+    IoProbeWorker(const std::string &source, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback),
+          source_(source),
+          detected_(usnscanner::DeviceClass::Unknown),
+          probe_{},
+          profile_{} {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+        // What the OS says is reported next to what was measured, so the two
+        // can be compared; neither failing stops the probe.
+        std::string ignored;
+        reader.PhysicalDevices(devices_, ignored);
+        usnscanner::DetectDeviceClass(reader, detected_, ignored);
+        if (!usnscanner::ProbeIoProfile(reader, probe_, profile_, error)) {
+            SetError(error);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Napi::Array devices = Napi::Array::New(env, devices_.size());
+        for (uint32_t i = 0; i < devices_.size(); ++i) {
+            devices.Set(i, Napi::String::New(env, devices_[i]));
+        }
+
+        Napi::Array depths = Napi::Array::New(env, probe_.depths.size());
+        for (uint32_t i = 0; i < probe_.depths.size(); ++i) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("depth", Napi::Number::New(env, static_cast<double>(probe_.depths[i].depth)));
+            obj.Set("mbPerSecond", Napi::Number::New(env, probe_.depths[i].megabytesPerSecond));
+            depths.Set(i, obj);
+        }
+
+        Napi::Object probe = Napi::Object::New(env);
+        probe.Set("randomReadMs", Napi::Number::New(env, probe_.randomReadMs));
+        probe.Set("sequentialMbPerSecond", Napi::Number::New(env, probe_.sequentialMegabytesPerSecond));
+        probe.Set("depths", depths);
+        probe.Set("elapsedMs", Napi::Number::New(env, probe_.elapsedMs));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("source", Napi::String::New(env, source_));
+        result.Set("devices", devices);
+        result.Set("detected", Napi::String::New(env, usnscanner::DeviceClassName(detected_)));
+        result.Set("probe", probe);
+        result.Set("profile", IoProfileValue(env, profile_));
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::string source_;
+    std::vector<std::string> devices_;
+    usnscanner::DeviceClass detected_;
+    usnscanner::IoProbe probe_;
+    usnscanner::IoProfile profile_;
+};
+
+Napi::Value ProbeIo(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+        Napi::TypeError::New(env, "Expected source and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto *worker = new IoProbeWorker(info[0].As<Napi::String>(), info[1].As<Napi::Function>());
+    worker->Queue();
+    return env.Undefined();
+}
+
+const uint64_t kRootDirectory = 5;
+
+class DeletionAnalyticsWorker : public Napi::AsyncWorker {
+  public:
+    DeletionAnalyticsWorker(
+        const std::string &source,
+        const std::string &volume,
+        const usnscanner::DeletionAnalyticsOptions &options,
+        const Napi::Function &callback)
+        : Napi::AsyncWorker(callback),
+          source_(source),
+          volume_(volume),
+          analytics_(options),
+          elapsedMs_(0) {}
+
+    void Execute() override {
+        auto start = std::chrono::steady_clock::now();
+        usnscanner::UsnJournalReader journal;
+        std::string error;
+        if (!journal.Open(source_, usnscanner::kUsnReasonFileDelete, true, error)) {
+            SetError(error);
+            return;
+        }
+
+        std::vector<usnscanner::CarvedUsnRecord> records;
+        while (true) {
+            if (!journal.Next(records, error)) {
+                SetError(error);
+                return;
+            }
+            if (records.empty()) {
+                break;
+            }
+            for (const auto &record : records) {
+                analytics_.Add(record.timestamp, record.parentRef, record.name);
+            }
+        }
+        analytics_.Finish();
+
+        if (!volume_.empty()) {
+            ResolveDirectories();
+        }
+        elapsedMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        const auto &minuteList = analytics_.Minutes();
+        Napi::Array minutes = Napi::Array::New(env, minuteList.size());
+        for (size_t i = 0; i < minuteList.size(); ++i) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("timeMs", Napi::Number::New(env, static_cast<double>(minuteList[i].minute) * 60000.0));
+            obj.Set("count", Napi::Number::New(env, minuteList[i].count));
+            minutes.Set(i, obj);
+        }
+
+        const auto &burstList = analytics_.Bursts();
+        Napi::Array bursts = Napi::Array::New(env, burstList.size());
+        for (size_t i = 0; i < burstList.size(); ++i) {
+            const auto &burst = burstList[i];
+            Napi::Array directories = Napi::Array::New(env, burst.directories.size());
+            for (size_t d = 0; d < burst.directories.size(); ++d) {
+                const auto &directory = burst.directories[d];
+                Napi::Object obj = Napi::Object::New(env);
+                obj.Set("parentReference", Napi::String::New(env, std::to_string(directory.parentReference)));
+                obj.Set("recordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(directory.parentReference))));
+                auto path = paths_.find(directory.parentReference);
+                if (path != paths_.end()) {
+                    obj.Set("path", Napi::String::New(env, path->second));
+                }
+                obj.Set("count", Napi::Number::New(env, static_cast<double>(directory.count)));
+                obj.Set("error", Napi::Number::New(env, static_cast<double>(directory.error)));
+                directories.Set(d, obj);
+            }
+
+            Napi::Array extensions = Napi::Array::New(env, burst.extensions.size());
+            for (size_t e = 0; e < burst.extensions.size(); ++e) {
+                Napi::Object obj = Napi::Object::New(env);
+                obj.Set("extension", Napi::String::New(env, burst.extensions[e].extension));
+                obj.Set("count", Napi::Number::New(env, static_cast<double>(burst.extensions[e].count)));
+                obj.Set("error", Napi::Number::New(env, static_cast<double>(burst.extensions[e].error)));
+                extensions.Set(e, obj);
+            }
+
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("startMs", Napi::Number::New(env, static_cast<double>(burst.firstMinute) * 60000.0));
+            obj.Set("endMs", Napi::Number::New(env, static_cast<double>(burst.lastMinute + 1) * 60000.0));
+            obj.Set("deletions", Napi::Number::New(env, static_cast<double>(burst.deletions)));
+            obj.Set("peakMs", Napi::Number::New(env, static_cast<double>(burst.peakMinute) * 60000.0));
+            obj.Set("peakPerMinute", Napi::Number::New(env, burst.peakRate));
+            obj.Set("baselinePerMinute", Napi::Number::New(env, burst.baseline));
+            obj.Set("topDirectories", directories);
+            obj.Set("topExtensions", extensions);
+            bursts.Set(i, obj);
+        }
+
+        const usnscanner::DeletionAnalyticsStats &analyticsStats = analytics_.Stats();
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("deletions", Napi::Number::New(env, static_cast<double>(analyticsStats.records)));
+        stats.Set("outOfOrder", Napi::Number::New(env, static_cast<double>(analyticsStats.outOfOrder)));
+        stats.Set("first", FileTimeValue(env, analyticsStats.firstTimestamp));
+        stats.Set("last", FileTimeValue(env, analyticsStats.lastTimestamp));
+        stats.Set("elapsedMs", Napi::Number::New(env, elapsedMs_));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("minutes", minutes);
+        result.Set("bursts", bursts);
+        result.Set("stats", stats);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    struct DirectoryName {
+        uint64_t parentRecord;
+        std::string name;
+        bool known;
+    };
+
+    // Only the few directories that top a burst are named, by walking their
+    // $FILE_NAME parents in the MFT. A directory whose slot has been reused
+    // since is left unnamed rather than given the new occupant's path.
+    void ResolveDirectories() {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(volume_, error)) {
+            return;
+        }
+        usnscanner::MftReader mft(reader);
+        if (!mft.Open(error)) {
+            return;
+        }
+
+        std::unordered_map<uint64_t, DirectoryName> names;
+        std::vector<uint8_t> buffer;
+        auto lookup = [&](uint64_t reference) -> const DirectoryName & {
+            uint64_t recordNumber = usnscanner::ReferenceRecordNumber(reference);
+            auto found = names.find(recordNumber);
+            if (found != names.end()) {
+                return found->second;
+            }
+            DirectoryName entry{ 0, std::string(), false };
+            usnscanner::FileRecordDetails details;
+            if (mft.ReadRecord(recordNumber, buffer) &&
+                usnscanner::ParseFileRecord(buffer.data(), static_cast<uint32_t>(buffer.size()), details) &&
+                !usnscanner::SlotReused(reference, details.sequenceNumber, details.inUse)) {
+                std::vector<usnscanner::FileNameInfo> links = usnscanner::ReadLinkNames(details);
+                if (!links.empty()) {
+                    entry = DirectoryName{ links.front().parentReference, links.front().name, true };
+                }
+            }
+            return names.emplace(recordNumber, std::move(entry)).first->second;
+        };
+
+        for (const auto &burst : analytics_.Bursts()) {
+            for (const auto &directory : burst.directories) {
+                if (paths_.count(directory.parentReference) != 0) {
+                    continue;
+                }
+                std::vector<std::string> segments;
+                uint64_t current = directory.parentReference;
+                bool complete = false;
+                for (int guard = 0; guard < 1024; ++guard) {
+                    if (usnscanner::ReferenceRecordNumber(current) == kRootDirectory) {
+                        complete = true;
+                        break;
+                    }
+                    const DirectoryName &entry = lookup(current);
+                    if (!entry.known) {
+                        break;
+                    }
+                    segments.push_back(entry.name);
+                    current = entry.parentRecord;
+                }
+                if (!complete) {
+                    continue;
+                }
+                std::string path;
+                for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+                    path.push_back('\\');
+                    path += *it;
+                }
+                paths_.emplace(directory.parentReference, path.empty() ? "\\" : path);
+            }
+        }
+    }
+
+    std::string source_;
+    std::string volume_;
+    usnscanner::DeletionAnalytics analytics_;
+    std::unordered_map<uint64_t, std::string> paths_;
+    double elapsedMs_;
+};
+
+Napi::Value AnalyzeDeletions(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or journal path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string source = info[0].As<Napi::String>();
+    Napi::Object options = info[1].As<Napi::Object>();
+    usnscanner::DeletionAnalyticsOptions analyticsOptions{ 100, 5.0, 1, 10 };
+    uint64_t value = 0;
+
+    Napi::Value minRate = options.Get("minRate");
+    if (!minRate.IsUndefined()) {
+        if (!ReadUnsignedValue(minRate, value) || value == 0 || value > UINT32_MAX) {
+            Napi::TypeError::New(env, "minRate must be a positive number").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        analyticsOptions.minRate = static_cast<uint32_t>(value);
+    }
+    Napi::Value factor = options.Get("factor");
+    if (!factor.IsUndefined()) {
+        if (!factor.IsNumber() || factor.As<Napi::Number>().DoubleValue() < 1.0) {
+            Napi::TypeError::New(env, "factor must be a number of at least 1").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        analyticsOptions.factor = factor.As<Napi::Number>().DoubleValue();
+    }
+    Napi::Value gapMinutes = options.Get("gapMinutes");
+    if (!gapMinutes.IsUndefined()) {
+        if (!ReadUnsignedValue(gapMinutes, value) || value > 1440) {
+            Napi::TypeError::New(env, "gapMinutes must be a number between 0 and 1440").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        analyticsOptions.maxGapMinutes = static_cast<uint32_t>(value);
+    }
+    Napi::Value top = options.Get("top");
+    if (!top.IsUndefined()) {
+        if (!ReadUnsignedValue(top, value) || value == 0 || value > 1000) {
+            Napi::TypeError::New(env, "top must be a number between 1 and 1000").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        analyticsOptions.top = static_cast<size_t>(value);
+    }
+
+    // Directory names come from the MFT of the journal's volume: the source
+    // itself when it is a drive letter, otherwise an explicit volume or image.
+    std::string volume;
+    char letter = 0;
+    Napi::Value volumeValue = options.Get("volume");
+    if (volumeValue.IsString()) {
+        volume = volumeValue.As<Napi::String>();
+    } else if (!volumeValue.IsUndefined()) {
+        Napi::TypeError::New(env, "volume must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    } else if (usnscanner::IsDriveLetterSource(source, letter)) {
+        volume = source;
+    }
+
+    Napi::Function callback = info[2].As<Napi::Function>();
+    auto *worker = new DeletionAnalyticsWorker(source, volume, analyticsOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class TimelineWorker : public Napi::AsyncWorker {
+  public:
+    TimelineWorker(const std::string &source, const usnscanner::TimelineOptions &options, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), source_(source), options_(options), stats_{} {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+
+        usnscanner::TimelineBuilder builder(reader, options_);
+        if (!builder.Run(error)) {
+            SetError(error);
+            return;
+        }
+        stats_ = builder.Stats();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("records", Napi::Number::New(env, static_cast<double>(stats_.records)));
+        stats.Set("standardInformationEvents", Napi::Number::New(env, static_cast<double>(stats_.standardInformationEvents)));
+        stats.Set("fileNameEvents", Napi::Number::New(env, static_cast<double>(stats_.fileNameEvents)));
+        stats.Set("journalEvents", Napi::Number::New(env, static_cast<double>(stats_.journalEvents)));
+        stats.Set("runs", Napi::Number::New(env, static_cast<double>(stats_.runs)));
+        stats.Set("bytesWritten", Napi::Number::New(env, static_cast<double>(stats_.bytesWritten)));
+        stats.Set("sweepMs", Napi::Number::New(env, stats_.sweepMs));
+        stats.Set("journalMs", Napi::Number::New(env, stats_.journalMs));
+        stats.Set("sortMs", Napi::Number::New(env, stats_.sortMs));
+        stats.Set("writeMs", Napi::Number::New(env, stats_.writeMs));
+        Callback().Call({ env.Null(), stats });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::string source_;
+    usnscanner::TimelineOptions options_;
+    usnscanner::TimelineStats stats_;
+};
+
+Napi::Value BuildTimeline(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string source = info[0].As<Napi::String>();
+    Napi::Object options = info[1].As<Napi::Object>();
+    usnscanner::TimelineOptions timelineOptions{};
+    timelineOptions.format = usnscanner::TimelineFormat::Csv;
+
+    Napi::Value output = options.Get("output");
+    if (!output.IsString() || output.As<Napi::String>().Utf8Value().empty()) {
+        Napi::TypeError::New(env, "output must be a file path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    timelineOptions.outputPath = output.As<Napi::String>();
+
+    Napi::Value format = options.Get("format");
+    if (format.IsString()) {
+        std::string name = format.As<Napi::String>();
+        if (name == "jsonl") {
+            timelineOptions.format = usnscanner::TimelineFormat::JsonLines;
+        } else if (name != "csv") {
+            Napi::TypeError::New(env, "format must be 'csv' or 'jsonl'").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    } else if (!format.IsUndefined()) {
+        Napi::TypeError::New(env, "format must be 'csv' or 'jsonl'").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    char letter = 0;
+    Napi::Value journal = options.Get("journal");
+    if (journal.IsString()) {
+        timelineOptions.journal = journal.As<Napi::String>();
+    } else if (journal.IsBoolean()) {
+        if (journal.As<Napi::Boolean>() && !usnscanner::IsDriveLetterSource(source, letter)) {
+            Napi::TypeError::New(env, "journal: true needs a drive letter source; pass the path of a $J copy instead").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (journal.As<Napi::Boolean>()) {
+            timelineOptions.journal = source;
+        }
+    } else if (!journal.IsUndefined()) {
+        Napi::TypeError::New(env, "journal must be a boolean or a path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Value deletedOnly = options.Get("deletedOnly");
+    if (deletedOnly.IsBoolean()) {
+        timelineOptions.deletedOnly = deletedOnly.As<Napi::Boolean>();
+    }
+
+    uint64_t memoryMb = 0;
+    Napi::Value memory = options.Get("memoryMb");
+    if (!memory.IsUndefined()) {
+        if (!ReadUnsignedValue(memory, memoryMb) || memoryMb == 0 || memoryMb > 65536) {
+            Napi::TypeError::New(env, "memoryMb must be a number between 1 and 65536").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        timelineOptions.memoryBudget = memoryMb << 20;
+    }
+
+    Napi::Function callback = info[2].As<Napi::Function>();
+    auto *worker = new TimelineWorker(source, timelineOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class SnapshotWorker : public Napi::AsyncWorker {
+  public:
+    SnapshotWorker(const std::string &source, const std::string &path, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), source_(source), path_(path), stats_{} {}
+
+    void Execute() override {
+        usnscanner::VolumeReader reader;
+        std::string error;
+        if (!reader.Open(source_, error)) {
+            SetError(error);
+            return;
+        }
+        if (!usnscanner::WriteSnapshot(reader, path_, stats_, error)) {
+            SetError(error);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("records", Napi::Number::New(env, static_cast<double>(stats_.records)));
+        stats.Set("directories", Napi::Number::New(env, static_cast<double>(stats_.directories)));
+        stats.Set("bytes", Napi::Number::New(env, static_cast<double>(stats_.bytes)));
+        stats.Set("sweepMs", Napi::Number::New(env, stats_.sweepMs));
+        Callback().Call({ env.Null(), stats });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::string source_;
+    std::string path_;
+    usnscanner::SnapshotStats stats_;
+};
+
+Napi::Value SaveSnapshot(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, path, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or image path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsString() || info[1].As<Napi::String>().Utf8Value().empty()) {
+        Napi::TypeError::New(env, "Path must be a file path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Function callback = info[2].As<Napi::Function>();
+    auto *worker = new SnapshotWorker(info[0].As<Napi::String>(), info[1].As<Napi::String>(), callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+class SnapshotDiffWorker : public Napi::AsyncWorker {
+  public:
+    SnapshotDiffWorker(const std::string &oldPath, const std::string &newPath, const usnscanner::SnapshotDiffOptions &options, const Napi::Function &callback)
+        : Napi::AsyncWorker(callback), oldPath_(oldPath), newPath_(newPath), options_(options), diff_{} {}
+
+    void Execute() override {
+        std::string error;
+        if (!usnscanner::DiffSnapshots(oldPath_, newPath_, options_, diff_, error)) {
+            SetError(error);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array deleted = Napi::Array::New(env);
+        Napi::Array renamed = Napi::Array::New(env);
+        Napi::Array reused = Napi::Array::New(env);
+        for (const auto &entry : diff_.entries) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("recordNumber", Napi::String::New(env, std::to_string(entry.recordNumber)));
+            obj.Set("isDirectory", Napi::Boolean::New(env, entry.directory));
+            switch (entry.change) {
+                case usnscanner::SnapshotChange::Deleted:
+                    obj.Set("sequence", Napi::Number::New(env, entry.inPrevious ? entry.oldSequence : entry.newSequence));
+                    obj.Set("path", Napi::String::New(env, entry.path));
+                    obj.Set("size", Napi::Number::New(env, static_cast<double>(entry.size)));
+                    obj.Set("modified", FileTimeValue(env, entry.modified));
+                    obj.Set("inPrevious", Napi::Boolean::New(env, entry.inPrevious));
+                    deleted.Set(deleted.Length(), obj);
+                    break;
+                case usnscanner::SnapshotChange::Renamed:
+                    obj.Set("sequence", Napi::Number::New(env, entry.oldSequence));
+                    obj.Set("oldPath", Napi::String::New(env, entry.path));
+                    obj.Set("newPath", Napi::String::New(env, entry.newPath));
+                    renamed.Set(renamed.Length(), obj);
+                    break;
+                case usnscanner::SnapshotChange::Reused:
+                    obj.Set("oldSequence", Napi::Number::New(env, entry.oldSequence));
+                    obj.Set("newSequence", Napi::Number::New(env, entry.newSequence));
+                    obj.Set("oldPath", Napi::String::New(env, entry.path));
+                    obj.Set("newPath", Napi::String::New(env, entry.newPath));
+                    reused.Set(reused.Length(), obj);
+                    break;
+            }
+        }
+
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("oldRecords", Napi::Number::New(env, static_cast<double>(diff_.oldRecords)));
+        stats.Set("newRecords", Napi::Number::New(env, static_cast<double>(diff_.newRecords)));
+        stats.Set("deleted", Napi::Number::New(env, static_cast<double>(diff_.deleted)));
+        stats.Set("renamed", Napi::Number::New(env, static_cast<double>(diff_.renamed)));
+        stats.Set("reused", Napi::Number::New(env, static_cast<double>(diff_.reused)));
+        stats.Set("created", Napi::Number::New(env, static_cast<double>(diff_.created)));
+        stats.Set("mergeMs", Napi::Number::New(env, diff_.mergeMs));
+        stats.Set("resolveMs", Napi::Number::New(env, diff_.resolveMs));
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("oldTakenAt", FileTimeValue(env, diff_.oldTakenAt));
+        result.Set("newTakenAt", FileTimeValue(env, diff_.newTakenAt));
+        result.Set("deleted", deleted);
+        result.Set("renamed", renamed);
+        result.Set("reused", reused);
+        result.Set("stats", stats);
+        Callback().Call({ env.Null(), result });
+    }
+
+    void OnError(const Napi::Error &e) override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Callback().Call({ e.Value(), env.Undefined() });
+    }
+
+  private:
+    std::string oldPath_;
+    std::string newPath_;
+    usnscanner::SnapshotDiffOptions options_;
+    usnscanner::SnapshotDiff diff_;
+};
+
+Napi::Value DiffSnapshots(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 4) {
+        Napi::TypeError::New(env, "Expected old snapshot, new snapshot, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Snapshots must be file paths").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[3].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    usnscanner::SnapshotDiffOptions diffOptions{ 10000 };
+    uint64_t value = 0;
+    Napi::Value limit = info[2].As<Napi::Object>().Get("limit");
+    if (!limit.IsUndefined()) {
+        if (!ReadUnsignedValue(limit, value) || value > 1000000) {
+            Napi::TypeError::New(env, "limit must be a number between 0 and 1000000").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        diffOptions.limit = static_cast<size_t>(value);
+    }
+
+    Napi::Function callback = info[3].As<Napi::Function>();
+    auto *worker = new SnapshotDiffWorker(info[0].As<Napi::String>(), info[1].As<Napi::String>(), diffOptions, callback);
+    worker->Queue();
+    return env.Undefined();
+}
+
+// A running deletion watch. The watcher thread queues batches to JS through
+// onEvents; unwatch() joins the thread first and then clears active, which
+// makes the JS side drop anything still queued, so no events arrive after it.
+struct WatchSession {
+    usnscanner::DeletionWatcher watcher;
+    Napi::ThreadSafeFunction onEvents;
+    std::shared_ptr<bool> active;
+};
+
+struct WatchBatch {
+    std::shared_ptr<bool> active;
+    std::vector<usnscanner::DeletionEvent> events;
+    std::string error;
+};
+
+// Only touched on the JS thread.
+std::unordered_map<uint32_t, std::unique_ptr<WatchSession>> watchSessions;
+uint32_t nextWatchId = 1;
+
+void DeliverWatchBatch(Napi::Env env, Napi::Function callback, WatchBatch *batch) {
+    std::unique_ptr<WatchBatch> owned(batch);
+    if (env == nullptr || callback == nullptr || !*owned->active) {
+        return;
+    }
+    Napi::HandleScope scope(env);
+    if (!owned->error.empty()) {
+        callback.Call({ Napi::Error::New(env, owned->error).Value(), env.Undefined() });
+        return;
+    }
+
+    Napi::Array events = Napi::Array::New(env, owned->events.size());
+    for (size_t i = 0; i < owned->events.size(); ++i) {
+        const usnscanner::DeletionEvent &event = owned->events[i];
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("usn", Napi::String::New(env, std::to_string(event.usn)));
+        obj.Set("fileReferenceNumber", Napi::String::New(env, std::to_string(event.fileRef)));
+        obj.Set("recordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(event.fileRef))));
+        obj.Set("sequence", Napi::Number::New(env, usnscanner::ReferenceSequence(event.fileRef)));
+        obj.Set("parentReferenceNumber", Napi::String::New(env, std::to_string(event.parentRef)));
+        obj.Set("parentRecordNumber", Napi::String::New(env, std::to_string(usnscanner::ReferenceRecordNumber(event.parentRef))));
+        obj.Set("name", Napi::String::New(env, event.name));
+        obj.Set("isDirectory", Napi::Boolean::New(env, (event.attributes & usnscanner::kFileAttributeDirectory) != 0));
+        obj.Set("timestampMs", Napi::Number::New(env, usnscanner::FileTimeToUnixMs(event.timestamp)));
+        obj.Set("reason", Napi::Number::New(env, static_cast<double>(event.reason)));
+        events.Set(i, obj);
+    }
+    callback.Call({ env.Null(), events });
+}
+
+void StopWatch(WatchSession &session) {
+    session.watcher.Stop();
+    *session.active = false;
+    session.onEvents.Release();
+}
+
+Napi::Value Watch(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        Napi::TypeError::New(env, "Expected source, options, and callback").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Source must be a drive letter or journal path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[1].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Callback must be a function").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+    usnscanner::DeletionWatchOptions watchOptions{ 250, 100, 4096, false };
+    uint64_t value = 0;
+
+    Napi::Value pollMs = options.Get("pollMs");
+    if (!pollMs.IsUndefined()) {
+        if (!ReadUnsignedValue(pollMs, value) || value < 10 || value > 60000) {
+            Napi::TypeError::New(env, "pollMs must be a number between 10 and 60000").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        watchOptions.pollMs = static_cast<uint32_t>(value);
+    }
+    Napi::Value batchMs = options.Get("batchMs");
+    if (!batchMs.IsUndefined()) {
+        if (!ReadUnsignedValue(batchMs, value) || value > 60000) {
+            Napi::TypeError::New(env, "batchMs must be a number between 0 and 60000").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        watchOptions.batchMs = static_cast<uint32_t>(value);
+    }
+    Napi::Value maxBatch = options.Get("maxBatch");
+    if (!maxBatch.IsUndefined()) {
+        if (!ReadUnsignedValue(maxBatch, value) || value == 0 || value > 1000000) {
+            Napi::TypeError::New(env, "maxBatch must be a number between 1 and 1000000").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        watchOptions.maxBatch = static_cast<size_t>(value);
+    }
+    Napi::Value fromStart = options.Get("fromStart");
+    if (!fromStart.IsUndefined()) {
+        if (!fromStart.IsBoolean()) {
+            Napi::TypeError::New(env, "fromStart must be a boolean").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        watchOptions.fromStart = fromStart.As<Napi::Boolean>().Value();
+    }
+
+    auto session = std::make_unique<WatchSession>();
+    session->active = std::make_shared<bool>(true);
+    session->onEvents = Napi::ThreadSafeFunction::New(env, info[2].As<Napi::Function>(), "usnscanner.watch", 0, 1);
+
+    WatchSession *target = session.get();
+    auto queue = [target](WatchBatch *batch) {
+        if (target->onEvents.NonBlockingCall(batch, DeliverWatchBatch) != napi_ok) {
+            delete batch;
+        }
+    };
+    std::string error;
+    bool started = session->watcher.Start(
+        info[0].As<Napi::String>(),
+        watchOptions,
+        [target, queue](std::vector<usnscanner::DeletionEvent> events) {
+            queue(new WatchBatch{ target->active, std::move(events), std::string() });
+        },
+        [target, queue](const std::string &message) {
+            queue(new WatchBatch{ target->active, {}, message });
+        },
+        error);
+    if (!started) {
+        session->onEvents.Release();
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t watchId = nextWatchId++;
+    watchSessions.emplace(watchId, std::move(session));
+    return Napi::Number::New(env, watchId);
+}
+
+Napi::Value Unwatch(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    uint32_t watchId = 0;
+    if (info.Length() < 1 || !ReadScanId(info[0], watchId)) {
+        Napi::TypeError::New(env, "Invalid watch id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    auto found = watchSessions.find(watchId);
+    if (found == watchSessions.end()) {
+        return env.Null();
+    }
+
+    StopWatch(*found->second);
+    const usnscanner::DeletionWatchStats &stats = found->second->watcher.Stats();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("records", Napi::Number::New(env, static_cast<double>(stats.records)));
+    result.Set("events", Napi::Number::New(env, static_cast<double>(stats.events)));
+    result.Set("coalesced", Napi::Number::New(env, static_cast<double>(stats.coalesced)));
+    result.Set("batches", Napi::Number::New(env, static_cast<double>(stats.batches)));
+    result.Set("polls", Napi::Number::New(env, static_cast<double>(stats.polls)));
+    watchSessions.erase(found);
+    return result;
+}
+
+// The limits in force and what has gone through them since the addon loaded.
+Napi::Object IoThrottleValue(const Napi::Env &env) {
+    const usnscanner::IoLimits limits = usnscanner::GetIoLimits();
+    const usnscanner::IoThrottleStats stats = usnscanner::GetIoThrottleStats();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("bytesPerSecond", Napi::Number::New(env, static_cast<double>(limits.bytesPerSecond)));
+    result.Set("iops", Napi::Number::New(env, static_cast<double>(limits.operationsPerSecond)));
+    result.Set("background", Napi::Boolean::New(env, limits.background));
+    result.Set("operations", Napi::Number::New(env, static_cast<double>(stats.operations)));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+    result.Set("throttled", Napi::Number::New(env, static_cast<double>(stats.throttled)));
+    result.Set("waitMs", Napi::Number::New(env, stats.waitMs));
+    return result;
+}
+
+// Replaces the process-wide limits; fields left out are lifted.
+Napi::Value SetIoLimits(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Limits must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+
+    usnscanner::IoLimits limits{};
+    Napi::Value bytesPerSecond = options.Get("bytesPerSecond");
+    if (!bytesPerSecond.IsUndefined() && !ReadUnsignedValue(bytesPerSecond, limits.bytesPerSecond)) {
+        Napi::TypeError::New(env, "bytesPerSecond must be a non-negative number").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Value iops = options.Get("iops");
+    uint64_t operations = 0;
+    if (!iops.IsUndefined() && (!ReadUnsignedValue(iops, operations) || operations > UINT32_MAX)) {
+        Napi::TypeError::New(env, "iops must be a non-negative number").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    limits.operationsPerSecond = static_cast<uint32_t>(operations);
+
+    Napi::Value background = options.Get("background");
+    if (!background.IsUndefined() && !background.IsBoolean()) {
+        Napi::TypeError::New(env, "background must be a boolean").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    limits.background = background.IsBoolean() && background.As<Napi::Boolean>().Value();
+
+    usnscanner::SetIoLimits(limits);
+    return IoThrottleValue(env);
+}
+
+Napi::Value IoThrottleStats(const Napi::CallbackInfo &info) {
+    return IoThrottleValue(info.Env());
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+#ifdef _WIN32
+    exports.Set("scan", Napi::Function::New(env, ScanUsn));
+    exports.Set("getFileRecord", Napi::Function::New(env, GetFileRecord));
+    exports.Set("recoverDataRuns", Napi::Function::New(env, RecoverDataRuns));
+#endif
+    exports.Set("carve", Napi::Function::New(env, Carve));
+    exports.Set("scanIndexSlack", Napi::Function::New(env, ScanIndexSlack));
+    exports.Set("parseLogFile", Napi::Function::New(env, ParseLogFile));
+    exports.Set("decompressWof", Napi::Function::New(env, DecompressWof));
+    exports.Set("decodeCompressionUnit", Napi::Function::New(env, DecodeCompressionUnit));
+    exports.Set("extractResident", Napi::Function::New(env, ExtractResident));
+    exports.Set("scanDeletedTree", Napi::Function::New(env, ScanDeletedTree));
+    exports.Set("scanDedupStats", Napi::Function::New(env, ScanDedupStats));
+    exports.Set("scanAll", Napi::Function::New(env, ScanAll));
+    exports.Set("expandTree", Napi::Function::New(env, ExpandTree));
+    exports.Set("releaseScan", Napi::Function::New(env, ReleaseScan));
+    exports.Set("aggregate", Napi::Function::New(env, Aggregate));
+    exports.Set("exportResults", Napi::Function::New(env, ExportResults));
+    exports.Set("recoverTree", Napi::Function::New(env, RecoverTree));
+    exports.Set("probeIo", Napi::Function::New(env, ProbeIo));
+    exports.Set("analyzeDeletions", Napi::Function::New(env, AnalyzeDeletions));
+    exports.Set("buildTimeline", Napi::Function::New(env, BuildTimeline));
+    exports.Set("saveSnapshot", Napi::Function::New(env, SaveSnapshot));
+    exports.Set("diffSnapshots", Napi::Function::New(env, DiffSnapshots));
+    exports.Set("watch", Napi::Function::New(env, Watch));
+    exports.Set("unwatch", Napi::Function::New(env, Unwatch));
+    exports.Set("setIoLimits", Napi::Function::New(env, SetIoLimits));
+    exports.Set("ioThrottleStats", Napi::Function::New(env, IoThrottleStats));
+    env.AddCleanupHook([]() {
+        for (auto &entry : watchSessions) {
+            StopWatch(*entry.second);
+        }
+        watchSessions.clear();
+    });
     return exports;
 }
 
@@ -0,0 +1,393 @@
+#include "carver.h"
+#include "format_walkers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+namespace usnscanner {
+
+namespace {
+
+const uint64_t kDefaultChunkSize = 8ull * 1024 * 1024;
+const size_t kFooterReadBlock = 1024 * 1024;
+// Complete hits at or above this confidence are trusted enough to skip the
+// aligned positions they cover (embedded thumbnails, stored zip members).
+const uint8_t kSkipConfidence = 90;
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const uint8_t *FindBytes(const uint8_t *data, size_t size, const std::vector<uint8_t> &needle) {
+    if (needle.empty() || size < needle.size()) {
+        return nullptr;
+    }
+
+    const uint8_t *cursor = data;
+    const uint8_t *last = data + (size - needle.size());
+    while (cursor <= last) {
+        const void *hit = std::memchr(cursor, needle[0], static_cast<size_t>(last - cursor) + 1);
+        if (!hit) {
+            return nullptr;
+        }
+        cursor = static_cast<const uint8_t *>(hit);
+        if (std::memcmp(cursor, needle.data(), needle.size()) == 0) {
+            return cursor;
+        }
+        ++cursor;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+std::vector<CarveChunk> PlanCarveChunks(const std::vector<ByteRange> &ranges, uint64_t chunkSize, uint64_t overlap) {
+    std::vector<CarveChunk> chunks;
+    if (chunkSize == 0) {
+        chunkSize = kDefaultChunkSize;
+    }
+
+    std::vector<ByteRange> sorted(ranges);
+    std::sort(sorted.begin(), sorted.end(), [](const ByteRange &a, const ByteRange &b) {
+        return a.offset < b.offset;
+    });
+
+    for (const auto &range : sorted) {
+        uint64_t end = range.offset + range.length;
+        for (uint64_t offset = range.offset; offset < end; offset += chunkSize) {
+            uint64_t length = std::min(chunkSize, end - offset);
+            uint64_t readLength = std::min(length + overlap, end - offset);
+            chunks.push_back({ offset, length, readLength });
+        }
+    }
+
+    return chunks;
+}
+
+CarveEngine::CarveEngine(VolumeReader &reader, const CarveOptions &options)
+    : reader_(reader),
+      options_(options),
+      bytesScanned_(0),
+      elapsedMs_(0) {}
+
+bool CarveEngine::Run(const std::vector<ByteRange> &ranges, std::string &error) {
+    auto started = std::chrono::steady_clock::now();
+
+    uint64_t overlap = options_.overlap;
+    for (auto *scanner : scanners_) {
+        overlap = std::max<uint64_t>(overlap, scanner->RequiredOverlap());
+    }
+
+    uint64_t chunkSize = options_.chunkSize == 0 ? kDefaultChunkSize : options_.chunkSize;
+    // Keep chunk boundaries sector aligned so the reader never has to bounce.
+    const uint64_t sector = std::max<uint32_t>(reader_.SectorSize(), 1);
+    chunkSize = std::max(sector, chunkSize - (chunkSize % sector));
+    if (overlap % sector != 0) {
+        overlap += sector - (overlap % sector);
+    }
+
+    std::vector<ByteRange> clipped;
+    clipped.reserve(ranges.size());
+    for (const auto &range : ranges) {
+        if (range.offset >= reader_.Size() || range.length == 0) {
+            continue;
+        }
+        clipped.push_back({ range.offset, std::min(range.length, reader_.Size() - range.offset) });
+    }
+
+    std::vector<CarveChunk> chunks = PlanCarveChunks(clipped, chunkSize, overlap);
+
+    WorkStealingPool pool(options_.threads == 0 ? DefaultWorkerCount() : options_.threads);
+    const size_t workers = pool.ThreadCount();
+    stats_.assign(workers, CarveThreadStats{ 0, 0, 0, 0, 0, 0 });
+    unreadable_.clear();
+    std::mutex unreadableMutex;
+
+    for (auto *scanner : scanners_) {
+        scanner->Begin(workers);
+    }
+
+    std::vector<std::vector<uint8_t>> buffers(workers);
+
+    try {
+        pool.Run(chunks.size(), [&](size_t task, size_t worker) {
+            const CarveChunk &chunk = chunks[task];
+            auto &buffer = buffers[worker];
+            if (buffer.size() < chunk.readLength) {
+                buffer.resize(static_cast<size_t>(chunkSize + overlap));
+            }
+
+            CarveThreadStats &stats = stats_[worker];
+            auto readStart = std::chrono::steady_clock::now();
+            long long read = reader_.ReadAt(chunk.offset, buffer.data(), static_cast<size_t>(chunk.readLength));
+            stats.readMs += MillisecondsSince(readStart);
+
+            if (read <= 0) {
+                stats.readErrors++;
+                std::lock_guard<std::mutex> lock(unreadableMutex);
+                unreadable_.push_back({ chunk.offset, chunk.length });
+                return;
+            }
+
+            ChunkView view{};
+            view.reader = &reader_;
+            view.offset = chunk.offset;
+            view.data = buffer.data();
+            view.size = static_cast<size_t>(read);
+            view.owned = static_cast<size_t>(std::min<uint64_t>(chunk.length, static_cast<uint64_t>(read)));
+
+            auto scanStart = std::chrono::steady_clock::now();
+            for (auto *scanner : scanners_) {
+                scanner->Scan(view, worker);
+            }
+            stats.scanMs += MillisecondsSince(scanStart);
+            stats.bytesRead += static_cast<uint64_t>(read);
+            stats.chunks++;
+        });
+    } catch (const std::exception &ex) {
+        error = std::string("Carving failed: ") + ex.what();
+        return false;
+    }
+
+    const auto &counters = pool.Counters();
+    bytesScanned_ = 0;
+    for (size_t w = 0; w < workers; ++w) {
+        stats_[w].stolen = counters[w].stolen;
+        bytesScanned_ += stats_[w].bytesRead;
+    }
+
+    for (auto *scanner : scanners_) {
+        scanner->End();
+    }
+
+    std::sort(unreadable_.begin(), unreadable_.end(), [](const ByteRange &a, const ByteRange &b) {
+        return a.offset < b.offset;
+    });
+
+    elapsedMs_ = MillisecondsSince(started);
+    return true;
+}
+
+const std::vector<CarveSignature> &BuiltinCarveSignatures() {
+    static const std::vector<CarveSignature> signatures = {
+        { "jpeg", "jpg", { 0xFF, 0xD8, 0xFF }, { 0xFF, 0xD9 }, 0, 20ull * 1024 * 1024, WalkJpeg },
+        { "png", "png", { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A }, { 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82 }, 0, 50ull * 1024 * 1024, WalkPng },
+        { "gif", "gif", { 'G', 'I', 'F', '8' }, { 0x00, 0x3B }, 0, 20ull * 1024 * 1024, nullptr },
+        { "pdf", "pdf", { '%', 'P', 'D', 'F', '-' }, { '%', '%', 'E', 'O', 'F' }, 0, 200ull * 1024 * 1024, WalkPdf },
+        { "zip", "zip", { 'P', 'K', 0x03, 0x04 }, { 'P', 'K', 0x05, 0x06 }, 18, 500ull * 1024 * 1024, WalkZip },
+    };
+    return signatures;
+}
+
+SignatureScanner::SignatureScanner(std::vector<CarveSignature> signatures, uint32_t alignment)
+    : signatures_(std::move(signatures)),
+      alignment_(alignment == 0 ? 1 : alignment) {
+    if (signatures_.size() > 32) {
+        signatures_.resize(32);
+    }
+
+    std::memset(firstByteMask_, 0, sizeof(firstByteMask_));
+    for (size_t i = 0; i < signatures_.size(); ++i) {
+        if (signatures_[i].header.empty()) {
+            continue;
+        }
+        uint8_t first = signatures_[i].header[0];
+        if (firstByteMask_[first] == 0) {
+            firstBytes_.push_back(first);
+        }
+        firstByteMask_[first] |= 1u << i;
+    }
+}
+
+size_t SignatureScanner::RequiredOverlap() const {
+    size_t longest = 0;
+    for (const auto &signature : signatures_) {
+        longest = std::max(longest, std::max(signature.header.size(), signature.footer.size()));
+    }
+    return longest;
+}
+
+void SignatureScanner::Begin(size_t workers) {
+    workerHits_.assign(workers, std::vector<CarveHit>());
+    workerRejected_.assign(workers, 0);
+    hits_.clear();
+}
+
+void SignatureScanner::Scan(const ChunkView &view, size_t worker) {
+    auto &out = workerHits_[worker];
+
+    if (alignment_ > 1) {
+        // Files start on cluster (or at least sector) boundaries, so only the
+        // aligned positions need a header probe.
+        size_t first = static_cast<size_t>((alignment_ - (view.offset % alignment_)) % alignment_);
+        for (size_t position = first; position < view.owned; position += alignment_) {
+            uint32_t candidates = firstByteMask_[view.data[position]];
+            if (candidates == 0) {
+                continue;
+            }
+            size_t end = MatchAt(view, position, candidates, worker);
+            if (end > position + alignment_) {
+                position += ((end - position - 1) / alignment_) * alignment_;
+            }
+        }
+        return;
+    }
+
+    const size_t hitsBefore = out.size();
+    for (uint8_t first : firstBytes_) {
+        const uint8_t *cursor = view.data;
+        const uint8_t *end = view.data + view.owned;
+        while (cursor < end) {
+            const void *hit = std::memchr(cursor, first, static_cast<size_t>(end - cursor));
+            if (!hit) {
+                break;
+            }
+            size_t position = static_cast<size_t>(static_cast<const uint8_t *>(hit) - view.data);
+            MatchAt(view, position, firstByteMask_[first], worker);
+            cursor = static_cast<const uint8_t *>(hit) + 1;
+        }
+    }
+
+    // One memchr pass per first byte leaves this chunk's hits grouped by byte;
+    // restore offset order so End() only has to merge sorted runs.
+    std::sort(out.begin() + static_cast<std::ptrdiff_t>(hitsBefore), out.end(), [](const CarveHit &a, const CarveHit &b) {
+        return a.offset < b.offset;
+    });
+}
+
+size_t SignatureScanner::MatchAt(const ChunkView &view, size_t position, uint32_t candidates, size_t worker) {
+    auto &out = workerHits_[worker];
+    size_t trustedEnd = 0;
+
+    while (candidates != 0) {
+        uint32_t index = 0;
+        while ((candidates & (1u << index)) == 0) {
+            ++index;
+        }
+        candidates &= ~(1u << index);
+
+        const CarveSignature &signature = signatures_[index];
+        if (position + signature.header.size() > view.size) {
+            continue;
+        }
+        if (std::memcmp(view.data + position, signature.header.data(), signature.header.size()) != 0) {
+            continue;
+        }
+
+        if (signature.walker) {
+            CarveByteSource source(view, position);
+            FormatVerdict verdict{};
+            uint64_t limit = std::min(signature.maxLength, source.Size());
+            if (!signature.walker(source, limit, verdict) || verdict.length == 0) {
+                workerRejected_[worker]++;
+                continue;
+            }
+            out.push_back({ view.offset + position, verdict.length, index, verdict.confidence, verdict.complete, verdict.extension, 0, 0 });
+            if (verdict.complete && verdict.confidence >= kSkipConfidence) {
+                trustedEnd = static_cast<size_t>(std::max<uint64_t>(trustedEnd, position + verdict.length));
+            }
+            continue;
+        }
+
+        bool found = false;
+        uint64_t length = FindFooter(view, position, signature, found);
+        out.push_back({ view.offset + position, length, index, static_cast<uint8_t>(found ? 40 : 10), found, nullptr, 0, 0 });
+    }
+
+    return trustedEnd;
+}
+
+uint64_t SignatureScanner::FindFooter(const ChunkView &view, size_t position, const CarveSignature &signature, bool &found) {
+    found = false;
+    const uint64_t start = view.offset + position;
+    const uint64_t sourceEnd = view.reader ? view.reader->Size() : view.offset + view.size;
+    const uint64_t limit = std::min(signature.maxLength, sourceEnd - start);
+    if (signature.footer.empty()) {
+        return limit;
+    }
+
+    const size_t searchFrom = position + signature.header.size();
+    const size_t inBuffer = static_cast<size_t>(std::min<uint64_t>(view.size - position, limit));
+    if (searchFrom < position + inBuffer) {
+        const uint8_t *hit = FindBytes(view.data + searchFrom, position + inBuffer - searchFrom, signature.footer);
+        if (hit) {
+            found = true;
+            uint64_t length = static_cast<uint64_t>(hit - (view.data + position)) + signature.footer.size() + signature.footerTrailer;
+            return std::min(length, limit);
+        }
+    }
+
+    if (!view.reader || inBuffer >= limit) {
+        return limit;
+    }
+
+    // The file runs past the chunk buffer: keep streaming from the reader,
+    // re-reading footer-1 bytes so a footer split between blocks is found.
+    thread_local std::vector<uint8_t> block;
+    block.resize(kFooterReadBlock);
+    const uint64_t keep = signature.footer.size() - 1;
+    uint64_t scanned = inBuffer > keep ? inBuffer - keep : 0;
+
+    while (scanned < limit) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(block.size(), limit - scanned));
+        long long read = view.reader->ReadAt(start + scanned, block.data(), want);
+        if (read <= 0) {
+            break;
+        }
+
+        const uint8_t *hit = FindBytes(block.data(), static_cast<size_t>(read), signature.footer);
+        if (hit) {
+            found = true;
+            uint64_t length = scanned + static_cast<uint64_t>(hit - block.data()) + signature.footer.size() + signature.footerTrailer;
+            return std::min(length, limit);
+        }
+
+        if (static_cast<size_t>(read) < want) {
+            break;
+        }
+        scanned += static_cast<uint64_t>(read) > keep ? static_cast<uint64_t>(read) - keep : static_cast<uint64_t>(read);
+    }
+
+    return limit;
+}
+
+void SignatureScanner::End() {
+    size_t total = 0;
+    for (const auto &local : workerHits_) {
+        total += local.size();
+    }
+
+    hits_.clear();
+    hits_.reserve(total);
+    for (const auto &local : workerHits_) {
+        hits_.insert(hits_.end(), local.begin(), local.end());
+    }
+
+    // Work stealing makes the per-worker order arbitrary; sorting on
+    // (offset, signature) gives the same output for any thread count.
+    std::sort(hits_.begin(), hits_.end(), [](const CarveHit &a, const CarveHit &b) {
+        if (a.offset != b.offset) {
+            return a.offset < b.offset;
+        }
+        return a.signature < b.signature;
+    });
+    hits_.erase(std::unique(hits_.begin(), hits_.end(), [](const CarveHit &a, const CarveHit &b) {
+        return a.offset == b.offset && a.signature == b.signature;
+    }), hits_.end());
+}
+
+uint64_t SignatureScanner::WorkerHits(size_t worker) const {
+    return worker < workerHits_.size() ? workerHits_[worker].size() : 0;
+}
+
+uint64_t SignatureScanner::Rejected() const {
+    uint64_t total = 0;
+    for (uint64_t rejected : workerRejected_) {
+        total += rejected;
+    }
+    return total;
+}
+
+} // namespace usnscanner
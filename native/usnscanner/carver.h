@@ -0,0 +1,153 @@
+#pragma once
+
+#include "volume_reader.h"
+#include "work_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// A unit of carving work. The chunk owns [offset, offset + length); the buffer
+// handed to scanners extends readLength bytes so patterns that straddle the
+// boundary into the next chunk are still visible in full.
+struct CarveChunk {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t readLength;
+};
+
+std::vector<CarveChunk> PlanCarveChunks(const std::vector<ByteRange> &ranges, uint64_t chunkSize, uint64_t overlap);
+
+struct ChunkView {
+    VolumeReader *reader;
+    uint64_t offset;
+    const uint8_t *data;
+    size_t size;
+    // A scanner reports a hit from this chunk only if the hit starts below
+    // owned; the tail past it belongs to the next chunk and is read-ahead only.
+    size_t owned;
+};
+
+// Plug-in run by CarveEngine over every chunk buffer. Scan is called
+// concurrently from several workers, so implementations keep per-worker
+// state and merge it in End().
+class ChunkScanner {
+  public:
+    virtual ~ChunkScanner() = default;
+    virtual size_t RequiredOverlap() const { return 0; }
+    virtual void Begin(size_t workers) = 0;
+    virtual void Scan(const ChunkView &view, size_t worker) = 0;
+    virtual void End() = 0;
+};
+
+struct CarveOptions {
+    uint64_t chunkSize;
+    uint64_t overlap;
+    size_t threads;
+};
+
+struct CarveThreadStats {
+    uint64_t bytesRead;
+    uint64_t chunks;
+    uint64_t stolen;
+    uint64_t readErrors;
+    double readMs;
+    double scanMs;
+};
+
+class CarveEngine {
+  public:
+    CarveEngine(VolumeReader &reader, const CarveOptions &options);
+
+    void AddScanner(ChunkScanner *scanner) { scanners_.push_back(scanner); }
+    bool Run(const std::vector<ByteRange> &ranges, std::string &error);
+
+    const std::vector<CarveThreadStats> &ThreadStats() const { return stats_; }
+    const std::vector<ByteRange> &UnreadableRanges() const { return unreadable_; }
+    uint64_t BytesScanned() const { return bytesScanned_; }
+    double ElapsedMs() const { return elapsedMs_; }
+
+  private:
+    VolumeReader &reader_;
+    CarveOptions options_;
+    std::vector<ChunkScanner *> scanners_;
+    std::vector<CarveThreadStats> stats_;
+    std::vector<ByteRange> unreadable_;
+    uint64_t bytesScanned_;
+    double elapsedMs_;
+};
+
+class CarveByteSource;
+struct FormatVerdict;
+
+// Structure walker that validates a candidate and measures its exact length
+// (see format_walkers.h). Returns false for false positives.
+using FormatWalker = bool (*)(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict);
+
+struct CarveSignature {
+    std::string type;
+    std::string extension;
+    std::vector<uint8_t> header;
+    std::vector<uint8_t> footer;
+    // Bytes that follow the footer and still belong to the file (e.g. the rest
+    // of a ZIP end-of-central-directory record).
+    uint32_t footerTrailer;
+    uint64_t maxLength;
+    // When set, replaces footer search with a format-aware walk.
+    FormatWalker walker;
+};
+
+const std::vector<CarveSignature> &BuiltinCarveSignatures();
+
+struct CarveHit {
+    uint64_t offset;
+    uint64_t length;
+    uint32_t signature;
+    // 0-100; structure-validated hits score far above bare header/footer pairs
+    // so they can be ranked next to file system results.
+    uint8_t confidence;
+    bool complete;
+    const char *extension;
+    // Set by bifragment carving: the first fragment is fragmentLength bytes,
+    // the rest of the file starts `gap` bytes after it. 0 when contiguous.
+    uint64_t fragmentLength;
+    uint64_t gap;
+};
+
+// Header-triggered carver. Headers are matched at every `alignment` bytes (1
+// for byte-granular carving). Signatures with a walker are validated and sized
+// structurally; the rest fall back to footer search, in the chunk buffer first
+// and continued through the reader when the file runs past it.
+class SignatureScanner : public ChunkScanner {
+  public:
+    SignatureScanner(std::vector<CarveSignature> signatures, uint32_t alignment);
+
+    size_t RequiredOverlap() const override;
+    void Begin(size_t workers) override;
+    void Scan(const ChunkView &view, size_t worker) override;
+    void End() override;
+
+    const std::vector<CarveSignature> &Signatures() const { return signatures_; }
+    const std::vector<CarveHit> &Hits() const { return hits_; }
+    uint64_t WorkerHits(size_t worker) const;
+    uint64_t Rejected() const;
+
+  private:
+    // Returns the end (relative to the chunk) of the longest complete,
+    // high-confidence hit at this position, or 0.
+    size_t MatchAt(const ChunkView &view, size_t position, uint32_t candidates, size_t worker);
+    uint64_t FindFooter(const ChunkView &view, size_t position, const CarveSignature &signature, bool &found);
+
+    std::vector<CarveSignature> signatures_;
+    uint32_t alignment_;
+    uint32_t firstByteMask_[256];
+    std::vector<uint8_t> firstBytes_;
+    std::vector<std::vector<CarveHit>> workerHits_;
+    std::vector<uint64_t> workerRejected_;
+    std::vector<CarveHit> hits_;
+};
+
+} // namespace usnscanner
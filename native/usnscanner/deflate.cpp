@@ -0,0 +1,192 @@
+#include "deflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const unsigned kHashBits = 15;
+const size_t kMinMatch = 4;
+const size_t kMaxMatch = 258;
+const size_t kWindowSize = 32768;
+const unsigned kEndOfBlock = 256;
+
+const uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const uint16_t kDistanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const uint8_t kDistanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+uint32_t ReverseBits(uint32_t code, unsigned length) {
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+}
+
+// The fixed literal/length and distance codes (RFC 1951 3.2.6), bit-reversed
+// because DEFLATE packs Huffman codes MSB first into an LSB-first stream.
+struct FixedCodes {
+    uint16_t literal[288];
+    uint8_t literalLength[288];
+    uint8_t distance[30];
+    // Length 3..258 to its length code (0..28).
+    uint8_t lengthCode[kMaxMatch + 1];
+    // Distance - 1 to its code: below 256 directly, else by (distance - 1) >> 7.
+    uint8_t nearDistanceCode[256];
+    uint8_t farDistanceCode[256];
+
+    FixedCodes() {
+        for (unsigned symbol = 0; symbol < 288; ++symbol) {
+            uint32_t code;
+            unsigned length;
+            if (symbol < 144) {
+                code = 0x30 + symbol;
+                length = 8;
+            } else if (symbol < 256) {
+                code = 0x190 + (symbol - 144);
+                length = 9;
+            } else if (symbol < 280) {
+                code = symbol - 256;
+                length = 7;
+            } else {
+                code = 0xC0 + (symbol - 280);
+                length = 8;
+            }
+            literal[symbol] = static_cast<uint16_t>(ReverseBits(code, length));
+            literalLength[symbol] = static_cast<uint8_t>(length);
+        }
+        for (unsigned code = 0; code < 30; ++code) {
+            distance[code] = static_cast<uint8_t>(ReverseBits(code, 5));
+            uint32_t end = kDistanceBase[code] + (1u << kDistanceExtra[code]);
+            for (uint32_t value = kDistanceBase[code]; value < end; ++value) {
+                if (value <= 256) {
+                    nearDistanceCode[value - 1] = static_cast<uint8_t>(code);
+                } else {
+                    farDistanceCode[(value - 1) >> 7] = static_cast<uint8_t>(code);
+                }
+            }
+        }
+        for (unsigned code = 0; code < 29; ++code) {
+            uint32_t end = std::min<uint32_t>(kLengthBase[code] + (1u << kLengthExtra[code]), kMaxMatch + 1);
+            for (uint32_t value = kLengthBase[code]; value < end; ++value) {
+                lengthCode[value] = static_cast<uint8_t>(code);
+            }
+        }
+    }
+};
+
+const FixedCodes &Codes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+uint32_t Load32(const uint8_t *data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t Hash(uint32_t value) {
+    return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+} // namespace
+
+DeflateEncoder::DeflateEncoder() : bitBuffer_(0), bitCount_(0), table_(size_t(1) << kHashBits) {}
+
+void DeflateEncoder::PutBits(uint32_t bits, unsigned count, std::string &out) {
+    bitBuffer_ |= static_cast<uint64_t>(bits) << bitCount_;
+    bitCount_ += count;
+    if (bitCount_ >= 32) {
+        char bytes[4] = {
+            static_cast<char>(bitBuffer_),
+            static_cast<char>(bitBuffer_ >> 8),
+            static_cast<char>(bitBuffer_ >> 16),
+            static_cast<char>(bitBuffer_ >> 24),
+        };
+        out.append(bytes, sizeof(bytes));
+        bitBuffer_ >>= 32;
+        bitCount_ -= 32;
+    }
+}
+
+void DeflateEncoder::PutLiteral(uint8_t value, std::string &out) {
+    const FixedCodes &codes = Codes();
+    PutBits(codes.literal[value], codes.literalLength[value], out);
+}
+
+void DeflateEncoder::PutMatch(size_t length, size_t distance, std::string &out) {
+    const FixedCodes &codes = Codes();
+    unsigned lengthCode = codes.lengthCode[length];
+    unsigned symbol = 257 + lengthCode;
+    PutBits(codes.literal[symbol], codes.literalLength[symbol], out);
+    PutBits(static_cast<uint32_t>(length - kLengthBase[lengthCode]), kLengthExtra[lengthCode], out);
+
+    unsigned distanceCode = distance <= 256 ? codes.nearDistanceCode[distance - 1] : codes.farDistanceCode[(distance - 1) >> 7];
+    PutBits(codes.distance[distanceCode], 5, out);
+    PutBits(static_cast<uint32_t>(distance - kDistanceBase[distanceCode]), kDistanceExtra[distanceCode], out);
+}
+
+void DeflateEncoder::Compress(const uint8_t *data, size_t size, std::string &out) {
+    if (size == 0) {
+        return;
+    }
+    const FixedCodes &codes = Codes();
+    // Not final, fixed codes.
+    PutBits(2, 3, out);
+    std::fill(table_.begin(), table_.end(), 0);
+
+    size_t position = 0;
+    while (position + kMinMatch <= size) {
+        uint32_t value = Load32(data + position);
+        uint32_t &slot = table_[Hash(value)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(position + 1);
+        if (candidate != 0 && position + 1 - candidate <= kWindowSize && Load32(data + candidate - 1) == value) {
+            size_t from = candidate - 1;
+            size_t limit = std::min(kMaxMatch, size - position);
+            size_t length = kMinMatch;
+            while (length < limit && data[from + length] == data[position + length]) {
+                ++length;
+            }
+            PutMatch(length, position - from, out);
+            position += length;
+            continue;
+        }
+        PutBits(codes.literal[data[position]], codes.literalLength[data[position]], out);
+        ++position;
+    }
+    for (; position < size; ++position) {
+        PutLiteral(data[position], out);
+    }
+    PutBits(codes.literal[kEndOfBlock], codes.literalLength[kEndOfBlock], out);
+}
+
+void DeflateEncoder::Finish(std::string &out) {
+    const FixedCodes &codes = Codes();
+    // Final, fixed codes, no symbols.
+    PutBits(3, 3, out);
+    PutBits(codes.literal[kEndOfBlock], codes.literalLength[kEndOfBlock], out);
+    while (bitCount_ > 0) {
+        out.push_back(static_cast<char>(bitBuffer_));
+        bitBuffer_ >>= 8;
+        bitCount_ = bitCount_ > 8 ? bitCount_ - 8 : 0;
+    }
+}
+
+} // namespace usnscanner
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// Raw DEFLATE (RFC 1951) encoder tuned for speed over ratio: fixed Huffman
+// codes, and an LZ77 search that probes one hash slot per position with no
+// chains and no lazy matching. Row-oriented text still shrinks several times
+// while compression keeps up with a disk. Each Compress() call is one block
+// whose matches stay inside the call, so no history is carried between them.
+class DeflateEncoder {
+  public:
+    DeflateEncoder();
+
+    // Appends a block holding `data` (under 4 GB) to `out`.
+    void Compress(const uint8_t *data, size_t size, std::string &out);
+    // Appends the final (empty) block and pads the stream to a whole byte.
+    void Finish(std::string &out);
+
+  private:
+    void PutBits(uint32_t bits, unsigned count, std::string &out);
+    void PutLiteral(uint8_t value, std::string &out);
+    void PutMatch(size_t length, size_t distance, std::string &out);
+
+    uint64_t bitBuffer_;
+    unsigned bitCount_;
+    // Position + 1 of the last occurrence of each 4-byte hash; 0 = none.
+    std::vector<uint32_t> table_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,485 @@
+#include "deleted_tree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const uint16_t kRecordInUse = 0x0001;
+const uint16_t kRecordIsDirectory = 0x0002;
+const uint64_t kRootDirectory = 5;
+const uint32_t kNoNode = 0xFFFFFFFF;
+const uint64_t kProgressRecords = 65536;
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ASCII case folding is enough for display order.
+bool NameLess(const std::string &a, const std::string &b) {
+    size_t length = std::min(a.size(), b.size());
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char x = static_cast<unsigned char>(a[i]);
+        unsigned char y = static_cast<unsigned char>(b[i]);
+        if (x >= 'A' && x <= 'Z') {
+            x = static_cast<unsigned char>(x + 32);
+        }
+        if (y >= 'A' && y <= 'Z') {
+            y = static_cast<unsigned char>(y + 32);
+        }
+        if (x != y) {
+            return x < y;
+        }
+    }
+    return a.size() < b.size();
+}
+
+} // namespace
+
+bool CollectDeletedRecords(VolumeReader &reader, DeletedRecordSet &records, DeletedTreeStats &stats, std::string &error) {
+    return CollectDeletedRecords(reader, records, stats, SweepProgress(), error);
+}
+
+bool CollectDeletedRecords(
+    VolumeReader &reader,
+    DeletedRecordSet &records,
+    DeletedTreeStats &stats,
+    const SweepProgress &progress,
+    std::string &error) {
+    MftReader mft(reader);
+    if (!mft.Open(error)) {
+        return false;
+    }
+    records.entries.clear();
+    records.links.clear();
+    records.liveDirectories.clear();
+    records.sequences.assign(static_cast<size_t>(mft.RecordCount()), 0);
+    records.flags.assign(static_cast<size_t>(mft.RecordCount()), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    FileRecordDetails details{};
+    bool swept = mft.Sweep([&](uint64_t recordNumber, const uint8_t *record, uint32_t size) {
+        const FileRecordHeader *header = reinterpret_cast<const FileRecordHeader *>(record);
+        records.sequences[recordNumber] = header->SequenceNumber;
+        records.flags[recordNumber] = static_cast<uint8_t>(header->Flags & 0xFF);
+        if (++stats.records % kProgressRecords == 0 && progress) {
+            progress(stats.records, mft.RecordCount());
+        }
+
+        // Live files never enter the tree; live directories only lend names.
+        const bool inUse = (header->Flags & kRecordInUse) != 0;
+        if (header->BaseFileRecord != 0 || (inUse && (header->Flags & kRecordIsDirectory) == 0) ||
+            !ParseFileRecord(record, size, details)) {
+            return;
+        }
+
+        std::vector<FileNameInfo> names = ReadLinkNames(details);
+        if (names.empty()) {
+            return;
+        }
+        FileNameInfo &name = names.front();
+        bool hasStandardInformation = false;
+        StandardInformation standardInformation{};
+        for (const auto &attribute : details.attributes) {
+            if (attribute.type == kAttributeStandardInformation && !attribute.nonResident) {
+                hasStandardInformation = ParseStandardInformation(attribute.residentData, standardInformation);
+            }
+        }
+        if (inUse) {
+            records.liveDirectories[recordNumber] = { ReferenceRecordNumber(name.parentReference), std::move(name.name) };
+            return;
+        }
+
+        DataStreamSummary data = SummarizeData(details);
+        DeletedEntry entry{};
+        entry.recordNumber = recordNumber;
+        entry.sequence = header->SequenceNumber;
+        entry.parentReference = name.parentReference;
+        entry.links = kNoNameLink;
+        for (size_t i = 1; i < names.size(); ++i) {
+            AddNameLink(records.links, entry.links, names[i].parentReference, names[i].name);
+        }
+        entry.isDirectory = details.isDirectory;
+        entry.resident = data.resident;
+        entry.size = data.present ? data.dataSize : name.dataSize;
+        entry.allocatedSize = data.present ? data.allocatedSize : name.allocatedSize;
+        entry.fragments = data.fragments;
+        entry.created = hasStandardInformation ? standardInformation.created : name.created;
+        entry.modified = hasStandardInformation ? standardInformation.modified : name.modified;
+        entry.mftModified = hasStandardInformation ? standardInformation.mftModified : name.mftModified;
+        entry.accessed = hasStandardInformation ? standardInformation.accessed : name.accessed;
+        entry.name = std::move(name.name);
+        records.entries.push_back(std::move(entry));
+    }, error);
+    stats.sweepMs = MillisecondsSince(start);
+    if (swept && progress) {
+        progress(stats.records, mft.RecordCount());
+    }
+    return swept;
+}
+
+DeletedTree::DeletedTree() : orphanRoot_(0), stats_{} {}
+
+bool DeletedTree::Build(VolumeReader &reader, std::string &error) {
+    return Build(reader, SweepProgress(), error);
+}
+
+bool DeletedTree::Build(VolumeReader &reader, const SweepProgress &progress, std::string &error) {
+    stats_ = DeletedTreeStats{};
+    DeletedRecordSet records;
+    if (!CollectDeletedRecords(reader, records, stats_, progress, error)) {
+        return false;
+    }
+    Build(std::move(records));
+    return true;
+}
+
+void DeletedTree::Build(DeletedRecordSet records) {
+    auto start = std::chrono::steady_clock::now();
+    entries_ = std::move(records.entries);
+    links_ = std::move(records.links);
+    linkPaths_.clear();
+    nodes_.clear();
+    children_.clear();
+    labels_.clear();
+    anchors_.clear();
+    orphanGroups_.clear();
+    stats_.deleted = entries_.size();
+    stats_.directories = 0;
+    stats_.liveAnchors = 0;
+    stats_.orphanGroups = 0;
+    stats_.cyclesBroken = 0;
+
+    nodes_.reserve(entries_.size() + 1);
+    AddNode(TreeNodeKind::Root, 0, std::string(), 0);
+    orphanRoot_ = 0;
+
+    std::unordered_map<uint64_t, uint32_t> deletedByRecord;
+    deletedByRecord.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const DeletedEntry &entry = entries_[i];
+        uint32_t id = static_cast<uint32_t>(i + 1);
+        nodes_.push_back({ TreeNodeKind::Deleted, 0, 0, 0, static_cast<uint32_t>(i), 0, 0, MakeFileReference(entry.recordNumber, entry.sequence) });
+        if (entry.isDirectory) {
+            deletedByRecord.emplace(entry.recordNumber, id);
+            ++stats_.directories;
+        }
+    }
+
+    // Parent resolution. A deleted parent matches when the reference's
+    // sequence number is the one its record had before being freed; a live
+    // parent must still carry it exactly.
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const uint64_t parentReference = entries_[i].parentReference;
+        const uint64_t parentRecord = ReferenceRecordNumber(parentReference);
+        uint32_t parent = kNoNode;
+        if (parentRecord != entries_[i].recordNumber) {
+            auto it = deletedByRecord.find(parentRecord);
+            if (it != deletedByRecord.end() && !SlotReused(parentReference, entries_[it->second - 1].sequence, false)) {
+                parent = it->second;
+            } else if (parentRecord < records.flags.size() &&
+                       (records.flags[parentRecord] & (kRecordInUse | kRecordIsDirectory)) == (kRecordInUse | kRecordIsDirectory) &&
+                       !SlotReused(parentReference, records.sequences[parentRecord], true)) {
+                parent = LiveAnchor(parentRecord, records);
+            }
+        }
+        if (parent == kNoNode) {
+            parent = OrphanGroup(parentReference);
+        }
+        nodes_[i + 1].parent = parent;
+    }
+
+    // Stale records can name each other as parents. Walk every chain once;
+    // meeting a node already on the current chain closes a cycle, which is
+    // cut by moving the last node into an orphan group.
+    const uint32_t deletedEnd = static_cast<uint32_t>(entries_.size() + 1);
+    std::vector<uint8_t> state(deletedEnd, 0);
+    std::vector<uint32_t> chain;
+    for (uint32_t id = 1; id < deletedEnd; ++id) {
+        if (state[id] != 0) {
+            continue;
+        }
+        chain.clear();
+        uint32_t node = id;
+        while (node != 0 && node < deletedEnd && state[node] == 0) {
+            state[node] = 1;
+            chain.push_back(node);
+            node = nodes_[node].parent;
+        }
+        if (node != 0 && node < deletedEnd && state[node] == 1) {
+            uint32_t last = chain.back();
+            nodes_[last].parent = OrphanGroup(entries_[last - 1].parentReference);
+            ++stats_.cyclesBroken;
+        }
+        for (uint32_t visited : chain) {
+            state[visited] = 2;
+        }
+    }
+
+    // Children as one flat array (CSR), sorted directories first.
+    const size_t count = nodes_.size();
+    for (size_t id = 1; id < count; ++id) {
+        ++nodes_[nodes_[id].parent].childCount;
+    }
+    uint32_t offset = 0;
+    for (auto &node : nodes_) {
+        node.firstChild = offset;
+        offset += node.childCount;
+        node.childCount = 0;
+    }
+    children_.assign(offset, 0);
+    for (size_t id = 1; id < count; ++id) {
+        TreeNode &parent = nodes_[nodes_[id].parent];
+        children_[parent.firstChild + parent.childCount++] = static_cast<uint32_t>(id);
+    }
+    auto isFolder = [this](uint32_t id) {
+        return nodes_[id].kind != TreeNodeKind::Deleted || entries_[nodes_[id].item].isDirectory;
+    };
+    for (const auto &node : nodes_) {
+        uint32_t *first = children_.data() + node.firstChild;
+        std::sort(first, first + node.childCount, [&](uint32_t a, uint32_t b) {
+            bool folderA = isFolder(a);
+            bool folderB = isFolder(b);
+            if (folderA != folderB) {
+                return folderA;
+            }
+            return NameLess(Name(a), Name(b));
+        });
+    }
+
+    // Further hard links only name places; resolve each the way a primary
+    // name would be, without adding nodes for them.
+    linkPaths_.reserve(links_.size());
+    for (const auto &link : links_) {
+        const uint64_t parentRecord = ReferenceRecordNumber(link.parentReference);
+        std::string path;
+        auto it = deletedByRecord.find(parentRecord);
+        if (it != deletedByRecord.end() && !SlotReused(link.parentReference, entries_[it->second - 1].sequence, false)) {
+            path = Path(it->second);
+        } else if (parentRecord < records.flags.size() &&
+                   (records.flags[parentRecord] & (kRecordInUse | kRecordIsDirectory)) == (kRecordInUse | kRecordIsDirectory) &&
+                   !SlotReused(link.parentReference, records.sequences[parentRecord], true)) {
+            path = LivePath(parentRecord, records);
+        } else {
+            path = "$Orphan\\$Orphan_" + std::to_string(parentRecord);
+        }
+        if (path.back() != '\\') {
+            path.push_back('\\');
+        }
+        linkPaths_.push_back(path + link.name);
+    }
+
+    // Subtree totals, children before parents (reverse breadth-first order).
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    order.push_back(0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        const TreeNode &node = nodes_[order[i]];
+        order.insert(order.end(), children_.begin() + node.firstChild, children_.begin() + node.firstChild + node.childCount);
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        TreeNode &node = nodes_[*it];
+        if (node.kind == TreeNodeKind::Deleted && !entries_[node.item].isDirectory) {
+            node.fileCount += 1;
+            node.totalSize += entries_[node.item].size;
+        }
+        if (*it != 0) {
+            nodes_[node.parent].fileCount += node.fileCount;
+            nodes_[node.parent].totalSize += node.totalSize;
+        }
+    }
+    stats_.buildMs = MillisecondsSince(start);
+}
+
+void DeletedTree::Merge(std::vector<DeletedTree> volumes, const std::vector<std::string> &labels) {
+    auto start = std::chrono::steady_clock::now();
+    entries_.clear();
+    links_.clear();
+    linkPaths_.clear();
+    nodes_.clear();
+    children_.clear();
+    labels_.clear();
+    anchors_.clear();
+    orphanGroups_.clear();
+    orphanRoot_ = 0;
+    stats_ = DeletedTreeStats{};
+
+    // Layout: the root, every volume's entries, one node per volume, then
+    // every volume's other nodes. The root's children come first in
+    // children_, followed by each volume's child lists.
+    const uint32_t volumeCount = static_cast<uint32_t>(volumes.size());
+    size_t totalEntries = 0;
+    size_t totalNodes = 1 + volumeCount;
+    size_t totalChildren = volumeCount;
+    for (const DeletedTree &volume : volumes) {
+        totalEntries += volume.entries_.size();
+        totalNodes += volume.nodes_.size() - 1;
+        totalChildren += volume.children_.size();
+    }
+    const uint32_t firstVolumeNode = static_cast<uint32_t>(1 + totalEntries);
+    entries_.reserve(totalEntries);
+    nodes_.resize(totalNodes);
+    children_.reserve(totalChildren);
+
+    nodes_[0] = { TreeNodeKind::Root, 0, 0, volumeCount, 0, 0, 0, 0 };
+    labels_.emplace_back();
+    for (uint32_t v = 0; v < volumeCount; ++v) {
+        children_.push_back(firstVolumeNode + v);
+    }
+
+    uint32_t otherBase = firstVolumeNode + volumeCount;
+    for (uint32_t v = 0; v < volumeCount; ++v) {
+        DeletedTree &volume = volumes[v];
+        const std::string label = v < labels.size() ? labels[v] : std::string();
+        const uint32_t entryBase = static_cast<uint32_t>(entries_.size());
+        const uint32_t labelBase = static_cast<uint32_t>(labels_.size());
+        const uint32_t linkBase = static_cast<uint32_t>(links_.size());
+        const uint32_t childBase = static_cast<uint32_t>(children_.size());
+        const uint32_t volumeNode = firstVolumeNode + v;
+        const uint32_t volumeEntries = static_cast<uint32_t>(volume.entries_.size());
+        auto remap = [&](uint32_t id) {
+            if (id == 0) {
+                return volumeNode;
+            }
+            return id <= volumeEntries ? entryBase + id : otherBase + (id - volumeEntries - 1);
+        };
+
+        for (DeletedEntry &entry : volume.entries_) {
+            if (entry.links != kNoNameLink) {
+                entry.links += linkBase;
+            }
+            entries_.push_back(std::move(entry));
+        }
+        for (NameLink &link : volume.links_) {
+            if (link.next != kNoNameLink) {
+                link.next += linkBase;
+            }
+            links_.push_back(std::move(link));
+        }
+        for (const std::string &path : volume.linkPaths_) {
+            linkPaths_.push_back(path.empty() || path.front() != '\\' ? label + "\\" + path : label + path);
+        }
+        for (std::string &name : volume.labels_) {
+            labels_.push_back(std::move(name));
+        }
+        for (uint32_t child : volume.children_) {
+            children_.push_back(remap(child));
+        }
+
+        const TreeNode &root = volume.nodes_[0];
+        nodes_[volumeNode] = { TreeNodeKind::Volume, 0, childBase + root.firstChild, root.childCount,
+                               static_cast<uint32_t>(labels_.size()), root.fileCount, root.totalSize, v };
+        labels_.push_back(label);
+        for (uint32_t id = 1; id < volume.nodes_.size(); ++id) {
+            TreeNode node = volume.nodes_[id];
+            node.parent = remap(node.parent);
+            node.firstChild += childBase;
+            node.item += node.kind == TreeNodeKind::Deleted ? entryBase : labelBase;
+            nodes_[remap(id)] = node;
+        }
+        otherBase += static_cast<uint32_t>(volume.nodes_.size() - 1 - volumeEntries);
+
+        nodes_[0].fileCount += root.fileCount;
+        nodes_[0].totalSize += root.totalSize;
+        const DeletedTreeStats &stats = volume.stats_;
+        stats_.records += stats.records;
+        stats_.deleted += stats.deleted;
+        stats_.directories += stats.directories;
+        stats_.liveAnchors += stats.liveAnchors;
+        stats_.orphanGroups += stats.orphanGroups;
+        stats_.cyclesBroken += stats.cyclesBroken;
+        stats_.sweepMs += stats.sweepMs;
+        stats_.buildMs += stats.buildMs;
+        volume = DeletedTree();
+    }
+    stats_.buildMs += MillisecondsSince(start);
+}
+
+const std::string &DeletedTree::Name(uint32_t id) const {
+    const TreeNode &node = nodes_[id];
+    return node.kind == TreeNodeKind::Deleted ? entries_[node.item].name : labels_[node.item];
+}
+
+std::string DeletedTree::Path(uint32_t id) const {
+    std::vector<uint32_t> segments;
+    for (uint32_t node = id; node != 0 && segments.size() < 4096; node = nodes_[node].parent) {
+        segments.push_back(node);
+    }
+    std::string path;
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        const std::string &name = Name(*it);
+        if (!path.empty() && path.back() != '\\' && (name.empty() || name.front() != '\\')) {
+            path.push_back('\\');
+        }
+        path += name;
+    }
+    return path;
+}
+
+std::vector<std::string> DeletedTree::LinkPaths(uint32_t id) const {
+    std::vector<std::string> paths;
+    const TreeNode &node = nodes_[id];
+    if (node.kind != TreeNodeKind::Deleted) {
+        return paths;
+    }
+    for (uint32_t link = entries_[node.item].links; link != kNoNameLink && paths.size() < links_.size(); link = links_[link].next) {
+        paths.push_back(linkPaths_[link]);
+    }
+    return paths;
+}
+
+uint32_t DeletedTree::AddNode(TreeNodeKind kind, uint32_t parent, std::string label, uint64_t reference) {
+    uint32_t id = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back({ kind, parent, 0, 0, static_cast<uint32_t>(labels_.size()), 0, 0, reference });
+    labels_.push_back(std::move(label));
+    return id;
+}
+
+uint32_t DeletedTree::LiveAnchor(uint64_t recordNumber, const DeletedRecordSet &records) {
+    auto it = anchors_.find(recordNumber);
+    if (it != anchors_.end()) {
+        return it->second;
+    }
+    uint32_t id = AddNode(TreeNodeKind::Live, 0, LivePath(recordNumber, records), MakeFileReference(recordNumber, records.sequences[recordNumber]));
+    anchors_.emplace(recordNumber, id);
+    ++stats_.liveAnchors;
+    return id;
+}
+
+uint32_t DeletedTree::OrphanGroup(uint64_t parentReference) {
+    if (orphanRoot_ == 0) {
+        orphanRoot_ = AddNode(TreeNodeKind::OrphanRoot, 0, "$Orphan", 0);
+    }
+    auto it = orphanGroups_.find(parentReference);
+    if (it != orphanGroups_.end()) {
+        return it->second;
+    }
+    uint32_t id = AddNode(TreeNodeKind::Orphan, orphanRoot_, "$Orphan_" + std::to_string(ReferenceRecordNumber(parentReference)), parentReference);
+    orphanGroups_.emplace(parentReference, id);
+    ++stats_.orphanGroups;
+    return id;
+}
+
+std::string DeletedTree::LivePath(uint64_t recordNumber, const DeletedRecordSet &records) const {
+    std::vector<const std::string *> segments;
+    uint64_t current = recordNumber;
+    for (int guard = 0; guard < 1024 && current != kRootDirectory; ++guard) {
+        auto it = records.liveDirectories.find(current);
+        if (it == records.liveDirectories.end()) {
+            break;
+        }
+        segments.push_back(&it->second.name);
+        current = it->second.parentRecord;
+    }
+    std::string path;
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        path.push_back('\\');
+        path += **it;
+    }
+    return path.empty() ? "\\" : path;
+}
+
+} // namespace usnscanner
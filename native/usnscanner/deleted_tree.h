@@ -0,0 +1,164 @@
+#pragma once
+
+#include "mft_reader.h"
+#include "ntfs_record.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace usnscanner {
+
+// A freed MFT record that still carries a name. Timestamps are FILETIME
+// ticks from $STANDARD_INFORMATION, or $FILE_NAME when that is missing.
+struct DeletedEntry {
+    uint64_t recordNumber;
+    // Sequence number of the freed record (already bumped by the deletion).
+    uint16_t sequence;
+    // Primary name (Win32 preferred) and where it lived.
+    uint64_t parentReference;
+    std::string name;
+    // First further hard link in the set's (later the tree's) links, or
+    // kNoNameLink.
+    uint32_t links;
+    bool isDirectory;
+    bool resident;
+    uint64_t size;
+    uint64_t allocatedSize;
+    uint32_t fragments;
+    uint64_t created;
+    uint64_t modified;
+    uint64_t mftModified;
+    uint64_t accessed;
+};
+
+// Everything one MFT sweep learns that the tree needs: the deleted entries,
+// per-record sequence numbers and flags to validate parent references, and
+// the names of live directories to label the places deletions hang off.
+struct DeletedRecordSet {
+    std::vector<DeletedEntry> entries;
+    std::vector<NameLink> links;
+    std::vector<uint16_t> sequences;
+    std::vector<uint8_t> flags;
+    struct LiveDirectory {
+        uint64_t parentRecord;
+        std::string name;
+    };
+    std::unordered_map<uint64_t, LiveDirectory> liveDirectories;
+};
+
+// Reports how far the MFT sweep has got, every few tens of thousands of
+// records and once at the end.
+using SweepProgress = std::function<void(uint64_t recordsDone, uint64_t recordCount)>;
+
+struct DeletedTreeStats {
+    uint64_t records;
+    uint64_t deleted;
+    uint64_t directories;
+    uint64_t liveAnchors;
+    uint64_t orphanGroups;
+    uint64_t cyclesBroken;
+    double sweepMs;
+    double buildMs;
+};
+
+enum class TreeNodeKind : uint8_t {
+    Root,
+    // Live directory that directly contains deleted entries; labelled with
+    // its full path.
+    Live,
+    // "$Orphan" and its groups, one per missing parent reference.
+    OrphanRoot,
+    Orphan,
+    // Top of one volume's tree in a merged multi-volume tree; labelled with
+    // the volume's source.
+    Volume,
+    Deleted
+};
+
+struct TreeNode {
+    TreeNodeKind kind;
+    uint32_t parent;
+    // Children are children_[firstChild, firstChild + childCount), sorted
+    // directories first, then by name.
+    uint32_t firstChild;
+    uint32_t childCount;
+    // Deleted: index into Entries(). Others: index of the label.
+    uint32_t item;
+    // Deleted files in the subtree and their total size.
+    uint64_t fileCount;
+    uint64_t totalSize;
+    // Live/Orphan: reference of the directory the node stands for. Volume:
+    // the volume's position in the merge.
+    uint64_t reference;
+};
+
+// Graph of deleted files and directories rebuilt from parent references.
+// Entry i is node i + 1 and node 0 is the root. A deleted entry hangs under
+// the deleted directory its parent reference names (checked against the
+// sequence number), else under a node for the live parent, else under
+// "$Orphan" in a group for the missing parent, so deleted trees whose top
+// directory is gone stay together. A file with several hard links appears
+// once, under its primary name; LinkPaths() reports where the others lived.
+// Reference cycles from stale records are broken into orphan groups. Nodes
+// are stored flat so callers can expand any level on demand without
+// materialising the rest.
+class DeletedTree {
+  public:
+    DeletedTree();
+
+    bool Build(VolumeReader &reader, std::string &error);
+    bool Build(VolumeReader &reader, const SweepProgress &progress, std::string &error);
+    void Build(DeletedRecordSet records);
+    // Replaces the tree with the given volumes' trees, each under a Volume
+    // node labelled with its source, in the order given. Node ids, entries
+    // and links are renumbered, keeping entry i as node i + 1; stats are
+    // summed.
+    void Merge(std::vector<DeletedTree> volumes, const std::vector<std::string> &labels);
+
+    const std::vector<DeletedEntry> &Entries() const { return entries_; }
+    size_t NodeCount() const { return nodes_.size(); }
+    const TreeNode &Node(uint32_t id) const { return nodes_[id]; }
+    const uint32_t *Children(uint32_t id) const { return children_.data() + nodes_[id].firstChild; }
+    const std::string &Name(uint32_t id) const;
+    // Backslash-separated path from the root, e.g. "\Users\me\proj\a.txt" or
+    // "$Orphan\$Orphan_1234\src\a.c".
+    std::string Path(uint32_t id) const;
+    // Paths of a deleted node's further hard links, resolved like its own;
+    // empty for single-name files.
+    std::vector<std::string> LinkPaths(uint32_t id) const;
+    const DeletedTreeStats &Stats() const { return stats_; }
+
+  private:
+    uint32_t AddNode(TreeNodeKind kind, uint32_t parent, std::string label, uint64_t reference);
+    uint32_t LiveAnchor(uint64_t recordNumber, const DeletedRecordSet &records);
+    uint32_t OrphanGroup(uint64_t parentReference);
+    std::string LivePath(uint64_t recordNumber, const DeletedRecordSet &records) const;
+
+    std::vector<DeletedEntry> entries_;
+    std::vector<NameLink> links_;
+    // Resolved path of links_[i].
+    std::vector<std::string> linkPaths_;
+    std::vector<TreeNode> nodes_;
+    std::vector<uint32_t> children_;
+    std::vector<std::string> labels_;
+    std::unordered_map<uint64_t, uint32_t> anchors_;
+    std::unordered_map<uint64_t, uint32_t> orphanGroups_;
+    uint32_t orphanRoot_;
+    DeletedTreeStats stats_;
+};
+
+// Sweeps the MFT once and collects every freed, named base record.
+bool CollectDeletedRecords(VolumeReader &reader, DeletedRecordSet &records, DeletedTreeStats &stats, std::string &error);
+bool CollectDeletedRecords(
+    VolumeReader &reader,
+    DeletedRecordSet &records,
+    DeletedTreeStats &stats,
+    const SweepProgress &progress,
+    std::string &error);
+
+} // namespace usnscanner
@@ -0,0 +1,205 @@
+#include "deletion_analytics.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace usnscanner {
+
+namespace {
+
+const int64_t kFileTimeTicksPerSecond = 10000000;
+const int64_t kUnixEpochSeconds = 11644473600LL;
+// Weight of each quiet minute in the baseline; about the last 20 minutes
+// dominate it.
+const double kBaselineWeight = 0.05;
+const size_t kMaxExtensionLength = 16;
+const size_t kMinCounters = 32;
+
+int64_t UnixMinute(uint64_t fileTime) {
+    int64_t seconds = static_cast<int64_t>(fileTime / kFileTimeTicksPerSecond) - kUnixEpochSeconds;
+    return seconds >= 0 ? seconds / 60 : (seconds - 59) / 60;
+}
+
+} // namespace
+
+template <typename Key>
+void TopCounter<Key>::Add(const Key &key, uint64_t count) {
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+        entries_[found->second].count += count;
+        return;
+    }
+    if (entries_.size() < capacity_) {
+        index_.emplace(key, entries_.size());
+        entries_.push_back({ key, count, 0 });
+        return;
+    }
+
+    size_t smallest = 0;
+    for (size_t i = 1; i < entries_.size(); ++i) {
+        if (entries_[i].count < entries_[smallest].count) {
+            smallest = i;
+        }
+    }
+    Entry &entry = entries_[smallest];
+    index_.erase(entry.key);
+    entry.error = entry.count;
+    entry.count += count;
+    entry.key = key;
+    index_.emplace(key, smallest);
+}
+
+template <typename Key>
+void TopCounter<Key>::Merge(const TopCounter &other) {
+    for (const auto &entry : other.entries_) {
+        Add(entry.key, entry.count);
+        entries_[index_[entry.key]].error += entry.error;
+    }
+}
+
+template <typename Key>
+void TopCounter<Key>::Clear() {
+    entries_.clear();
+    index_.clear();
+}
+
+template <typename Key>
+std::vector<typename TopCounter<Key>::Entry> TopCounter<Key>::Top(size_t n) const {
+    std::vector<Entry> top = entries_;
+    std::sort(top.begin(), top.end(), [](const Entry &a, const Entry &b) {
+        return a.count > b.count;
+    });
+    if (top.size() > n) {
+        top.resize(n);
+    }
+    return top;
+}
+
+template class TopCounter<uint64_t>;
+template class TopCounter<std::string>;
+
+std::string DeletionExtension(const std::string &name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos || dot + 1 == name.size() || name.size() - dot - 1 > kMaxExtensionLength) {
+        return std::string();
+    }
+    std::string extension = name.substr(dot + 1);
+    for (auto &ch : extension) {
+        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    }
+    return extension;
+}
+
+DeletionAnalytics::DeletionAnalytics(const DeletionAnalyticsOptions &options)
+    : options_(options),
+      stats_{},
+      baseline_(0),
+      burstOpen_(false),
+      minuteOpen_(false),
+      lastHotMinute_(0),
+      burst_{},
+      minuteDirectories_(std::max(kMinCounters, options.top * 4)),
+      minuteExtensions_(std::max(kMinCounters, options.top * 4)),
+      burstDirectories_(std::max(kMinCounters, options.top * 4)),
+      burstExtensions_(std::max(kMinCounters, options.top * 4)) {}
+
+void DeletionAnalytics::Add(uint64_t timestamp, uint64_t parentReference, const std::string &name) {
+    if (stats_.records == 0 || timestamp < stats_.firstTimestamp) {
+        stats_.firstTimestamp = timestamp;
+    }
+    stats_.lastTimestamp = std::max(stats_.lastTimestamp, timestamp);
+    ++stats_.records;
+
+    int64_t minute = UnixMinute(timestamp);
+    if (!minutes_.empty() && minute < minutes_.back().minute) {
+        // Journal order and timestamp order disagree around clock changes;
+        // the late record still counts towards its own minute.
+        ++stats_.outOfOrder;
+        auto it = std::lower_bound(minutes_.begin(), minutes_.end(), minute, [](const DeletionMinute &entry, int64_t value) {
+            return entry.minute < value;
+        });
+        if (it != minutes_.end() && it->minute == minute) {
+            ++it->count;
+        } else {
+            minutes_.insert(it, DeletionMinute{ minute, 1 });
+        }
+        return;
+    }
+
+    if (minutes_.empty() || minute > minutes_.back().minute) {
+        if (!minutes_.empty()) {
+            int64_t quiet = minute - minutes_.back().minute - 1;
+            if (minuteOpen_) {
+                CloseMinute();
+            }
+            if (quiet > 0) {
+                baseline_ *= std::pow(1.0 - kBaselineWeight, static_cast<double>(std::min<int64_t>(quiet, 100000)));
+            }
+        }
+        minutes_.push_back(DeletionMinute{ minute, 0 });
+        minuteOpen_ = true;
+    }
+
+    ++minutes_.back().count;
+    minuteDirectories_.Add(parentReference, 1);
+    minuteExtensions_.Add(DeletionExtension(name), 1);
+}
+
+void DeletionAnalytics::Finish() {
+    if (minuteOpen_) {
+        CloseMinute();
+    }
+    if (burstOpen_) {
+        CloseBurst();
+    }
+}
+
+void DeletionAnalytics::CloseMinute() {
+    const DeletionMinute &current = minutes_.back();
+    minuteOpen_ = false;
+
+    if (burstOpen_ && current.minute - lastHotMinute_ - 1 > static_cast<int64_t>(options_.maxGapMinutes)) {
+        CloseBurst();
+    }
+
+    double threshold = std::max(static_cast<double>(options_.minRate), options_.factor * baseline_);
+    if (current.count >= threshold) {
+        if (!burstOpen_) {
+            burst_ = DeletionBurst{};
+            burst_.firstMinute = current.minute;
+            burst_.baseline = baseline_;
+            burstOpen_ = true;
+        }
+        burst_.lastMinute = current.minute;
+        burst_.deletions += current.count;
+        if (current.count > burst_.peakRate) {
+            burst_.peakRate = current.count;
+            burst_.peakMinute = current.minute;
+        }
+        burstDirectories_.Merge(minuteDirectories_);
+        burstExtensions_.Merge(minuteExtensions_);
+        lastHotMinute_ = current.minute;
+    } else {
+        baseline_ += kBaselineWeight * (static_cast<double>(current.count) - baseline_);
+    }
+
+    minuteDirectories_.Clear();
+    minuteExtensions_.Clear();
+}
+
+void DeletionAnalytics::CloseBurst() {
+    for (const auto &entry : burstDirectories_.Top(options_.top)) {
+        burst_.directories.push_back(DirectoryCount{ entry.key, entry.count, entry.error });
+    }
+    for (const auto &entry : burstExtensions_.Top(options_.top)) {
+        burst_.extensions.push_back(ExtensionCount{ entry.key, entry.count, entry.error });
+    }
+    bursts_.push_back(std::move(burst_));
+    burst_ = DeletionBurst{};
+    burstDirectories_.Clear();
+    burstExtensions_.Clear();
+    burstOpen_ = false;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace usnscanner {
+
+struct DeletionAnalyticsOptions {
+    // A minute is part of a burst when it has at least minRate deletions and
+    // at least factor times the running baseline rate.
+    uint32_t minRate;
+    double factor;
+    // Quiet minutes tolerated inside one burst.
+    uint32_t maxGapMinutes;
+    // Directories and extensions reported per burst.
+    size_t top;
+};
+
+struct DeletionMinute {
+    // Minutes since the Unix epoch.
+    int64_t minute;
+    uint32_t count;
+};
+
+// Heavy hitters are approximate: count may overstate the true figure by at
+// most error.
+struct DirectoryCount {
+    uint64_t parentReference;
+    uint64_t count;
+    uint64_t error;
+};
+
+struct ExtensionCount {
+    std::string extension;
+    uint64_t count;
+    uint64_t error;
+};
+
+struct DeletionBurst {
+    int64_t firstMinute;
+    int64_t lastMinute;
+    uint64_t deletions;
+    int64_t peakMinute;
+    uint32_t peakRate;
+    // Deletions per minute expected before the burst started.
+    double baseline;
+    std::vector<DirectoryCount> directories;
+    std::vector<ExtensionCount> extensions;
+};
+
+struct DeletionAnalyticsStats {
+    uint64_t records;
+    // Records older than the minute being counted; they only reach the
+    // per-minute series.
+    uint64_t outOfOrder;
+    uint64_t firstTimestamp;
+    uint64_t lastTimestamp;
+};
+
+// Space-Saving summary: at most capacity counters, and a key that is not
+// tracked replaces the smallest one and inherits its count as error. Any
+// key with more than total/capacity occurrences is guaranteed to be kept.
+template <typename Key>
+class TopCounter {
+  public:
+    explicit TopCounter(size_t capacity) : capacity_(capacity) {}
+
+    void Add(const Key &key, uint64_t count);
+    void Merge(const TopCounter &other);
+    void Clear();
+    bool Empty() const { return entries_.empty(); }
+
+    struct Entry {
+        Key key;
+        uint64_t count;
+        uint64_t error;
+    };
+    // The n largest counters, largest first.
+    std::vector<Entry> Top(size_t n) const;
+
+  private:
+    size_t capacity_;
+    std::vector<Entry> entries_;
+    std::unordered_map<Key, size_t> index_;
+};
+
+// One pass over deletion records in journal order. Memory is one entry per
+// minute that saw a deletion plus fixed-size summaries for the minute being
+// counted and the open burst, so journals of any length summarize without
+// keeping their records.
+//
+// Each finished minute is compared with an exponentially weighted baseline
+// of the quiet minutes before it (empty minutes included), so a steady
+// background of deletions does not count as a burst but a sudden jump does.
+// Burst minutes are left out of the baseline.
+class DeletionAnalytics {
+  public:
+    explicit DeletionAnalytics(const DeletionAnalyticsOptions &options);
+
+    // timestamp is a FILETIME.
+    void Add(uint64_t timestamp, uint64_t parentReference, const std::string &name);
+    void Finish();
+
+    const std::vector<DeletionMinute> &Minutes() const { return minutes_; }
+    const std::vector<DeletionBurst> &Bursts() const { return bursts_; }
+    const DeletionAnalyticsStats &Stats() const { return stats_; }
+
+  private:
+    void CloseMinute();
+    void CloseBurst();
+
+    DeletionAnalyticsOptions options_;
+    std::vector<DeletionMinute> minutes_;
+    std::vector<DeletionBurst> bursts_;
+    DeletionAnalyticsStats stats_;
+    double baseline_;
+    bool burstOpen_;
+    // The last minute's counts have not been evaluated yet.
+    bool minuteOpen_;
+    int64_t lastHotMinute_;
+    DeletionBurst burst_;
+    TopCounter<uint64_t> minuteDirectories_;
+    TopCounter<std::string> minuteExtensions_;
+    TopCounter<uint64_t> burstDirectories_;
+    TopCounter<std::string> burstExtensions_;
+};
+
+// Lower-cased extension without the dot; empty when there is none or it is
+// implausibly long.
+std::string DeletionExtension(const std::string &name);
+
+} // namespace usnscanner
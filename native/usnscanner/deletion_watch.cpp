@@ -0,0 +1,120 @@
+#include "deletion_watch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
+namespace usnscanner {
+
+DeletionWatcher::DeletionWatcher() : options_{}, stats_{}, stopping_(false) {}
+
+DeletionWatcher::~DeletionWatcher() {
+    Stop();
+}
+
+bool DeletionWatcher::Start(
+    const std::string &source,
+    const DeletionWatchOptions &options,
+    BatchHandler onBatch,
+    ErrorHandler onError,
+    std::string &error) {
+    if (thread_.joinable()) {
+        error = "The watch is already running";
+        return false;
+    }
+    // Every record rather than only the one written at close: a deletion
+    // shows up as soon as the journal has it, and the batch merges the
+    // close record that follows.
+    if (!journal_.Open(source, kUsnReasonFileDelete, false, error)) {
+        return false;
+    }
+    if (!options.fromStart && !journal_.SeekToEnd(error)) {
+        return false;
+    }
+
+    options_ = options;
+    options_.maxBatch = std::max<size_t>(options_.maxBatch, 1);
+    onBatch_ = std::move(onBatch);
+    onError_ = std::move(onError);
+    stats_ = DeletionWatchStats{};
+    stopping_ = false;
+    thread_ = std::thread(&DeletionWatcher::Run, this);
+    return true;
+}
+
+void DeletionWatcher::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void DeletionWatcher::Run() {
+    using Clock = std::chrono::steady_clock;
+    const auto batchWindow = std::chrono::milliseconds(options_.batchMs);
+    const auto pollInterval = std::chrono::milliseconds(options_.pollMs);
+
+    std::vector<CarvedUsnRecord> records;
+    std::vector<DeletionEvent> pending;
+    // File reference -> its slot in pending.
+    std::unordered_map<uint64_t, size_t> slots;
+    Clock::time_point batchStart;
+    std::string error;
+
+    while (!stopping_) {
+        if (!journal_.Next(records, error)) {
+            onError_(error);
+            return;
+        }
+        ++stats_.polls;
+        stats_.records += records.size();
+
+        for (CarvedUsnRecord &record : records) {
+            auto slot = slots.find(record.fileRef);
+            if (slot != slots.end()) {
+                DeletionEvent &event = pending[slot->second];
+                event.reason |= record.reason;
+                event.usn = record.usn;
+                event.timestamp = record.timestamp;
+                event.parentRef = record.parentRef;
+                event.name = std::move(record.name);
+                ++stats_.coalesced;
+                continue;
+            }
+            if (pending.empty()) {
+                batchStart = Clock::now();
+            }
+            slots.emplace(record.fileRef, pending.size());
+            pending.push_back({ record.fileRef, record.parentRef, record.usn, record.timestamp,
+                                record.reason, record.attributes, std::move(record.name) });
+        }
+
+        const auto now = Clock::now();
+        if (!pending.empty() && (pending.size() >= options_.maxBatch || now - batchStart >= batchWindow)) {
+            stats_.events += pending.size();
+            ++stats_.batches;
+            onBatch_(std::move(pending));
+            pending.clear();
+            slots.clear();
+        }
+
+        // Still reading a backlog: go straight back for more.
+        if (!records.empty()) {
+            continue;
+        }
+
+        auto wait = std::chrono::duration_cast<Clock::duration>(pollInterval);
+        if (!pending.empty()) {
+            wait = std::min(wait, batchStart + batchWindow - now);
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, wait, [this] { return stopping_.load(); });
+    }
+}
+
+} // namespace usnscanner
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "usn_journal.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace usnscanner {
+
+struct DeletionEvent {
+    uint64_t fileRef;
+    uint64_t parentRef;
+    // Of the last journal record seen for the file.
+    uint64_t usn;
+    uint64_t timestamp;
+    // Every reason recorded for the file within the batch.
+    uint32_t reason;
+    uint32_t attributes;
+    std::string name;
+};
+
+struct DeletionWatchOptions {
+    // Sleep between journal reads once everything written has been read.
+    uint32_t pollMs;
+    // How long the first event of a batch waits for more to join it.
+    uint32_t batchMs;
+    // A batch this large goes out without waiting.
+    size_t maxBatch;
+    // Replay the deletions already in the journal instead of starting at its
+    // end.
+    bool fromStart;
+};
+
+struct DeletionWatchStats {
+    uint64_t records;
+    uint64_t events;
+    // Records folded into an event already waiting in the batch.
+    uint64_t coalesced;
+    uint64_t batches;
+    uint64_t polls;
+};
+
+// Follows a change journal, live (drive letter) or a copy of $J that may
+// still be growing, from a cursor of its own and reports deletions in
+// batches. Records for a file reference already waiting in the batch are
+// merged into its event, so a deletion logged once as FILE_DELETE and again
+// at close is reported once. The journal is polled: a read that finds
+// nothing new costs one ioctl or one fstat, and the thread sleeps on a
+// condition variable in between, so Stop() never waits out the interval.
+class DeletionWatcher {
+  public:
+    // Handlers run on the watch thread. After an error the thread ends.
+    using BatchHandler = std::function<void(std::vector<DeletionEvent> batch)>;
+    using ErrorHandler = std::function<void(const std::string &error)>;
+
+    DeletionWatcher();
+    ~DeletionWatcher();
+
+    DeletionWatcher(const DeletionWatcher &) = delete;
+    DeletionWatcher &operator=(const DeletionWatcher &) = delete;
+
+    bool Start(
+        const std::string &source,
+        const DeletionWatchOptions &options,
+        BatchHandler onBatch,
+        ErrorHandler onError,
+        std::string &error);
+    // Wakes and joins the watch thread. Events still waiting for their batch
+    // to fill are dropped; no handler runs after Stop() returns.
+    void Stop();
+
+    // Only stable once Stop() has returned.
+    const DeletionWatchStats &Stats() const { return stats_; }
+
+  private:
+    void Run();
+
+    UsnJournalReader journal_;
+    DeletionWatchOptions options_;
+    BatchHandler onBatch_;
+    ErrorHandler onError_;
+    DeletionWatchStats stats_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> stopping_;
+    std::thread thread_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,291 @@
+#include "export_writer.h"
+#include "format_walkers.h"
+
+#include <cstdio>
+#include <filesystem>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define USNSCANNER_SSE2 1
+#endif
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kFlushSize = 1 << 20;
+const uint64_t kFileTimeTicksPerSecond = 10000000;
+const int64_t kUnixEpochSeconds = 11644473600LL;
+
+// RFC 1952 member header: deflate, no flags, no mtime, unknown OS.
+const char kGzipHeader[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+
+#ifdef USNSCANNER_SSE2
+size_t LowestBit(int mask) {
+    size_t index = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+}
+#endif
+
+// Position of the first comma, quote, CR or LF at or after `position`, or
+// `size`. Sixteen bytes are classified per step, so the common field with
+// nothing to quote costs a few compares.
+size_t FindCsvSpecial(const char *data, size_t position, size_t size) {
+#ifdef USNSCANNER_SSE2
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; position + 16 <= size; position += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + position));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, quote)),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, lf)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return position + LowestBit(mask);
+        }
+    }
+#endif
+    for (; position < size; ++position) {
+        char ch = data[position];
+        if (ch == ',' || ch == '"' || ch == '\r' || ch == '\n') {
+            return position;
+        }
+    }
+    return size;
+}
+
+// Position of the first quote, backslash or control character at or after
+// `position`, or `size`.
+size_t FindJsonSpecial(const char *data, size_t position, size_t size) {
+#ifdef USNSCANNER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; position + 16 <= size; position += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + position));
+        // Unsigned byte <= 0x1F: the max with 0x1F leaves it at 0x1F.
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(bytes, control), control));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return position + LowestBit(mask);
+        }
+    }
+#endif
+    for (; position < size; ++position) {
+        unsigned char byte = static_cast<unsigned char>(data[position]);
+        if (byte == '"' || byte == '\\' || byte < 0x20) {
+            return position;
+        }
+    }
+    return size;
+}
+
+void PutDigits(char *out, int width, uint32_t value) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+void PutLe32(std::string &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>(value >> shift));
+    }
+}
+
+} // namespace
+
+ExportWriter::ExportWriter() : written_(0), fileBytes_(0), crc_(0) {
+    buffer_.reserve(kFlushSize + 4096);
+}
+
+bool ExportWriter::Open(const std::string &path, bool gzip, std::string &error) {
+    out_.open(std::filesystem::u8path(path), std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        error = "Cannot create " + path;
+        return false;
+    }
+    buffer_.clear();
+    written_ = 0;
+    fileBytes_ = 0;
+    crc_ = 0;
+    deflate_.reset();
+    if (gzip) {
+        deflate_.reset(new DeflateEncoder());
+        compressed_.assign(kGzipHeader, sizeof(kGzipHeader));
+        Write(compressed_);
+    }
+    return true;
+}
+
+bool ExportWriter::Close(std::string &error) {
+    Flush();
+    if (deflate_) {
+        compressed_.clear();
+        deflate_->Finish(compressed_);
+        PutLe32(compressed_, crc_);
+        PutLe32(compressed_, static_cast<uint32_t>(written_));
+        Write(compressed_);
+        deflate_.reset();
+    }
+    out_.close();
+    if (!out_) {
+        error = "Writing the export failed";
+        return false;
+    }
+    return true;
+}
+
+void ExportWriter::Write(const std::string &data) {
+    out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+    fileBytes_ += data.size();
+}
+
+void ExportWriter::Flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+    if (deflate_) {
+        const uint8_t *text = reinterpret_cast<const uint8_t *>(buffer_.data());
+        crc_ = Crc32(text, buffer_.size(), crc_);
+        compressed_.clear();
+        deflate_->Compress(text, buffer_.size(), compressed_);
+        Write(compressed_);
+    } else {
+        Write(buffer_);
+    }
+    written_ += buffer_.size();
+    buffer_.clear();
+}
+
+void ExportWriter::Append(const char *data, size_t length) {
+    buffer_.append(data, length);
+    if (buffer_.size() >= kFlushSize) {
+        Flush();
+    }
+}
+
+void ExportWriter::Append(char ch) {
+    buffer_.push_back(ch);
+    if (buffer_.size() >= kFlushSize) {
+        Flush();
+    }
+}
+
+void ExportWriter::AppendUnsigned(uint64_t value) {
+    char digits[20];
+    size_t length = 0;
+    do {
+        digits[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length > 0) {
+        buffer_.push_back(digits[--length]);
+    }
+    if (buffer_.size() >= kFlushSize) {
+        Flush();
+    }
+}
+
+void ExportWriter::AppendCsvField(const std::string &value) {
+    if (FindCsvSpecial(value.data(), 0, value.size()) == value.size()) {
+        Append(value);
+        return;
+    }
+    // Inside the quotes only quotes need attention.
+    buffer_.push_back('"');
+    size_t start = 0;
+    for (size_t quote = value.find('"'); quote != std::string::npos; quote = value.find('"', start)) {
+        buffer_.append(value, start, quote + 1 - start);
+        buffer_.push_back('"');
+        start = quote + 1;
+    }
+    buffer_.append(value, start, std::string::npos);
+    Append('"');
+}
+
+void ExportWriter::AppendJsonString(const std::string &value) {
+    static const char kHex[] = "0123456789abcdef";
+    const char *data = value.data();
+    const size_t size = value.size();
+    buffer_.push_back('"');
+    for (size_t start = 0;;) {
+        size_t special = FindJsonSpecial(data, start, size);
+        buffer_.append(data + start, special - start);
+        if (special == size) {
+            break;
+        }
+        char ch = data[special];
+        unsigned char byte = static_cast<unsigned char>(ch);
+        switch (ch) {
+            case '"': buffer_.append("\\\""); break;
+            case '\\': buffer_.append("\\\\"); break;
+            case '\n': buffer_.append("\\n"); break;
+            case '\r': buffer_.append("\\r"); break;
+            case '\t': buffer_.append("\\t"); break;
+            default:
+                buffer_.append("\\u00");
+                buffer_.push_back(kHex[byte >> 4]);
+                buffer_.push_back(kHex[byte & 0xF]);
+                break;
+        }
+        start = special + 1;
+    }
+    Append('"');
+}
+
+void ExportWriter::AppendFileTime(uint64_t fileTime) {
+    int64_t seconds = static_cast<int64_t>(fileTime / kFileTimeTicksPerSecond) - kUnixEpochSeconds;
+    uint32_t fraction = static_cast<uint32_t>(fileTime % kFileTimeTicksPerSecond);
+    int64_t days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    int64_t secondOfDay = seconds - days * 86400;
+
+    // Days since 1970-01-01 to a civil date (proleptic Gregorian).
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    if (year >= 0 && year <= 9999) {
+        // Fixed width, so the digits go straight into place.
+        char text[] = "0000-00-00T00:00:00.0000000Z";
+        PutDigits(text, 4, static_cast<uint32_t>(year));
+        PutDigits(text + 5, 2, static_cast<uint32_t>(month));
+        PutDigits(text + 8, 2, static_cast<uint32_t>(day));
+        PutDigits(text + 11, 2, static_cast<uint32_t>(secondOfDay / 3600));
+        PutDigits(text + 14, 2, static_cast<uint32_t>(secondOfDay / 60 % 60));
+        PutDigits(text + 17, 2, static_cast<uint32_t>(secondOfDay % 60));
+        PutDigits(text + 20, 7, fraction);
+        Append(text, sizeof(text) - 1);
+        return;
+    }
+
+    char text[40];
+    int length = std::snprintf(
+        text,
+        sizeof(text),
+        "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld.%07uZ",
+        static_cast<long long>(year),
+        static_cast<long long>(month),
+        static_cast<long long>(day),
+        static_cast<long long>(secondOfDay / 3600),
+        static_cast<long long>(secondOfDay / 60 % 60),
+        static_cast<long long>(secondOfDay % 60),
+        fraction);
+    Append(text, static_cast<size_t>(length));
+}
+
+} // namespace usnscanner
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "deflate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace usnscanner {
+
+// Buffered text output for CSV and JSON Lines exports. Rows are formatted
+// straight into one large buffer that goes to disk in big sequential
+// writes, so memory stays constant however many rows are written. With gzip
+// each full buffer is deflated on its way out.
+class ExportWriter {
+  public:
+    ExportWriter();
+
+    ExportWriter(const ExportWriter &) = delete;
+    ExportWriter &operator=(const ExportWriter &) = delete;
+
+    bool Open(const std::string &path, bool gzip, std::string &error);
+    // Flushes and closes; false when any write failed.
+    bool Close(std::string &error);
+
+    void Append(const char *data, size_t length);
+    void Append(const char *text) { Append(text, std::strlen(text)); }
+    void Append(const std::string &text) { Append(text.data(), text.size()); }
+    void Append(char ch);
+    void AppendUnsigned(uint64_t value);
+    // Quoted only when it holds a comma, quote or line break; quotes are
+    // doubled (RFC 4180).
+    void AppendCsvField(const std::string &value);
+    // A JSON string literal, quotes included.
+    void AppendJsonString(const std::string &value);
+    // ISO 8601 in UTC with 100 ns digits, e.g. 2023-11-14T22:13:20.1234567Z.
+    void AppendFileTime(uint64_t fileTime);
+
+    // Text produced so far, before any compression.
+    uint64_t BytesWritten() const { return written_ + buffer_.size(); }
+    // Size of the file on disk once closed.
+    uint64_t FileBytes() const { return fileBytes_; }
+
+  private:
+    void Flush();
+    void Write(const std::string &data);
+
+    std::ofstream out_;
+    std::string buffer_;
+    uint64_t written_;
+    uint64_t fileBytes_;
+    std::unique_ptr<DeflateEncoder> deflate_;
+    std::string compressed_;
+    uint32_t crc_;
+};
+
+} // namespace usnscanner
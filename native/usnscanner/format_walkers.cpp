@@ -0,0 +1,1281 @@
+#include "format_walkers.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kWindowSize = 256 * 1024;
+const uint64_t kWindowAlignment = 4096;
+const size_t kScanBlock = 64 * 1024;
+// PDFs carry objects at least every few MB; a longer gap ends a truncated one.
+const uint64_t kPdfSegment = 8ull * 1024 * 1024;
+// How far before a JPEG decoding error the data may already have been foreign.
+const uint64_t kJpegLookback = 32 * 1024;
+// Consecutive zero bytes that end JPEG entropy-coded data.
+const uint32_t kJpegZeroRun = 32;
+
+uint16_t ReadBe16(const uint8_t *p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t ReadBe32(const uint8_t *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint16_t ReadLe16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t ReadLe32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+struct Crc32Tables {
+    uint32_t table[8][256];
+
+    Crc32Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32Tables &CrcTables() {
+    static const Crc32Tables tables;
+    return tables;
+}
+
+uint32_t Crc32Range(CarveByteSource &source, uint64_t offset, uint64_t length, bool &ok) {
+    uint32_t crc = 0;
+    ok = true;
+    while (length > 0) {
+        size_t step = static_cast<size_t>(std::min<uint64_t>(length, kScanBlock));
+        const uint8_t *p = source.Data(offset, step);
+        if (!p) {
+            ok = false;
+            return 0;
+        }
+        crc = Crc32(p, step, crc);
+        offset += step;
+        length -= step;
+    }
+    return crc;
+}
+
+bool IsJpegSofMarker(uint8_t marker) {
+    return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+bool IsKnownJpegSegment(uint8_t marker) {
+    return IsJpegSofMarker(marker) || marker == 0xC4 || marker == 0xCC || marker == 0xDA || marker == 0xDB ||
+           marker == 0xDC || marker == 0xDD || marker == 0xDE || marker == 0xDF ||
+           (marker >= 0xE0 && marker <= 0xEF) || marker == 0xFE;
+}
+
+// Huffman table in the canonical form of ITU T.81 F.2.2.3, plus a 9-bit
+// lookahead that resolves most codes in one step.
+struct JpegHuffmanTable {
+    bool defined;
+    uint16_t fast[1 << 9];
+    int32_t maxCode[18];
+    int32_t valueOffset[17];
+    uint8_t values[256];
+};
+
+bool BuildJpegHuffmanTable(const uint8_t *counts, const uint8_t *values, size_t total, JpegHuffmanTable &table) {
+    std::memset(&table, 0, sizeof(table));
+    std::memcpy(table.values, values, total);
+
+    int32_t code = 0;
+    size_t index = 0;
+    for (int length = 1; length <= 16; ++length) {
+        table.valueOffset[length] = static_cast<int32_t>(index) - code;
+        for (uint8_t i = 0; i < counts[length - 1]; ++i, ++index, ++code) {
+            if (length <= 9) {
+                int shift = 9 - length;
+                for (int fill = 0; fill < (1 << shift); ++fill) {
+                    table.fast[(code << shift) | fill] = static_cast<uint16_t>((length << 8) | values[index]);
+                }
+            }
+        }
+        // Codes of one length must fit in it; all-ones is reserved.
+        if (counts[length - 1] != 0 && code >= (1 << length)) {
+            return false;
+        }
+        table.maxCode[length] = counts[length - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+    table.maxCode[17] = 0x7FFFFFFF;
+    table.defined = true;
+    return true;
+}
+
+struct JpegComponent {
+    uint8_t id;
+    uint8_t h;
+    uint8_t v;
+};
+
+struct JpegFrame {
+    bool huffmanSequential;
+    uint8_t precision;
+    uint16_t width;
+    uint16_t height;
+    uint8_t hMax;
+    uint8_t vMax;
+    std::vector<JpegComponent> components;
+};
+
+struct JpegScanComponent {
+    size_t component;
+    uint8_t dcTable;
+    uint8_t acTable;
+};
+
+// Decodes the entropy-coded segment of a sequential Huffman scan without
+// reconstructing pixels. Real image data decodes to exactly the MCU count the
+// frame header promises; foreign data fails within a few hundred bytes on an
+// undefined code, a coefficient index past 63, or a misplaced marker.
+class JpegScanDecoder {
+  public:
+    JpegScanDecoder(CarveByteSource &source, uint64_t offset, uint64_t limit)
+        : source_(source),
+          limit_(std::min(limit, source.Size())),
+          scanStart_(offset),
+          position_(offset),
+          bits_(0),
+          count_(0),
+          stopped_(false),
+          zeroRun_(0),
+          block_(nullptr),
+          blockStart_(0),
+          blockLength_(0),
+          checkpoint_(offset),
+          mcu_(0),
+          expectedRst_(0) {}
+
+    // Continues from a state recorded by an earlier walk over the same scan.
+    bool Resume(const WalkCheckpoint &checkpoint) {
+        if (checkpoint.state[0] != scanStart_) {
+            return false;
+        }
+        position_ = checkpoint.state[1];
+        bits_ = checkpoint.state[2];
+        count_ = static_cast<int>(checkpoint.state[3] & 0xFF);
+        stopped_ = (checkpoint.state[3] >> 8) != 0;
+        mcu_ = checkpoint.state[4];
+        expectedRst_ = static_cast<uint8_t>(checkpoint.state[5]);
+        checkpoint_ = checkpoint.state[6];
+        return true;
+    }
+
+    // On success `end` is the offset of the marker that follows the scan; on
+    // failure `errorAt` is where decoding went wrong.
+    bool Decode(const JpegFrame &frame, const std::vector<JpegScanComponent> &scan, const JpegHuffmanTable *dc,
+                const JpegHuffmanTable *ac, uint16_t restartInterval, uint64_t &end, uint64_t &errorAt) {
+        uint64_t mcus = 0;
+        std::vector<uint32_t> blocks;
+        if (scan.size() == 1) {
+            const JpegComponent &c = frame.components[scan[0].component];
+            uint64_t w = (static_cast<uint64_t>(frame.width) * c.h + frame.hMax - 1) / frame.hMax;
+            uint64_t h = (static_cast<uint64_t>(frame.height) * c.v + frame.vMax - 1) / frame.vMax;
+            mcus = ((w + 7) / 8) * ((h + 7) / 8);
+            blocks.push_back(1);
+        } else {
+            mcus = ((frame.width + 8u * frame.hMax - 1) / (8u * frame.hMax)) *
+                   static_cast<uint64_t>((frame.height + 8u * frame.vMax - 1) / (8u * frame.vMax));
+            for (const JpegScanComponent &s : scan) {
+                blocks.push_back(static_cast<uint32_t>(frame.components[s.component].h) * frame.components[s.component].v);
+            }
+        }
+
+        const int dcLimit = frame.precision == 12 ? 15 : 11;
+        const int acLimit = frame.precision == 12 ? 14 : 10;
+
+        // States taken at MCU starts become checkpoints for the boundaries
+        // after them, as long as no byte past the boundary was loaded yet.
+        uint64_t boundary = source_.NextCheckpoint(position_);
+        WalkCheckpoint last{};
+        bool haveLast = false;
+
+        for (; mcu_ < mcus; ++mcu_) {
+            if (boundary != UINT64_MAX) {
+                while (position_ > boundary) {
+                    if (haveLast) {
+                        last.boundary = boundary;
+                        source_.AddCheckpoint(last);
+                    }
+                    boundary = source_.NextCheckpoint(boundary);
+                }
+                last = WalkCheckpoint{ 0, { scanStart_, position_, bits_, static_cast<uint64_t>(count_) | (stopped_ ? 0x100u : 0u),
+                                            mcu_, expectedRst_, checkpoint_ } };
+                haveLast = true;
+            }
+
+            if (restartInterval != 0 && mcu_ != 0 && mcu_ % restartInterval == 0) {
+                if (!Restart(expectedRst_)) {
+                    errorAt = ErrorOffset();
+                    return false;
+                }
+                expectedRst_ = static_cast<uint8_t>((expectedRst_ + 1) & 7);
+            }
+            for (size_t i = 0; i < scan.size(); ++i) {
+                for (uint32_t b = 0; b < blocks[i]; ++b) {
+                    if (!DecodeBlock(dc[scan[i].dcTable], ac[scan[i].acTable], dcLimit, acLimit)) {
+                        errorAt = ErrorOffset();
+                        return false;
+                    }
+                }
+            }
+        }
+
+        // Only the final byte's padding bits may remain before the marker.
+        Refill();
+        if (!stopped_ || count_ >= 8) {
+            errorAt = ErrorOffset();
+            return false;
+        }
+        end = position_;
+        return true;
+    }
+
+    // Last offset known to start cleanly decodable data (scan start or the
+    // most recent restart marker).
+    uint64_t Checkpoint() const { return checkpoint_; }
+
+  private:
+    bool Byte(uint64_t at, uint8_t &value) {
+        if (at < blockStart_ || at >= blockStart_ + blockLength_) {
+            if (at >= limit_) {
+                return false;
+            }
+            size_t step = static_cast<size_t>(std::min<uint64_t>(limit_ - at, kScanBlock));
+            block_ = source_.Data(at, step);
+            if (!block_) {
+                blockLength_ = 0;
+                return false;
+            }
+            blockStart_ = at;
+            blockLength_ = step;
+        }
+        value = block_[at - blockStart_];
+        return true;
+    }
+
+    void Refill() {
+        while (count_ <= 56 && !stopped_) {
+            uint8_t b = 0;
+            if (!Byte(position_, b)) {
+                stopped_ = true;
+                break;
+            }
+            // Zero runs decode as valid codes with common tables, but an
+            // encoder never produces this many; it is fill or slack.
+            zeroRun_ = b == 0 ? zeroRun_ + 1 : 0;
+            if (zeroRun_ >= kJpegZeroRun) {
+                stopped_ = true;
+                break;
+            }
+            if (b == 0xFF) {
+                uint8_t next = 0;
+                if (!Byte(position_ + 1, next)) {
+                    stopped_ = true;
+                    break;
+                }
+                if (next == 0xFF) {
+                    ++position_;
+                    continue;
+                }
+                if (next != 0x00) {
+                    stopped_ = true;
+                    break;
+                }
+                position_ += 2;
+            } else {
+                ++position_;
+            }
+            bits_ |= static_cast<uint64_t>(b) << (56 - count_);
+            count_ += 8;
+        }
+    }
+
+    bool Take(int n, uint32_t &value) {
+        if (count_ < n) {
+            Refill();
+            if (count_ < n) {
+                return false;
+            }
+        }
+        value = n == 0 ? 0 : static_cast<uint32_t>(bits_ >> (64 - n));
+        bits_ <<= n;
+        count_ -= n;
+        return true;
+    }
+
+    bool Symbol(const JpegHuffmanTable &table, int &symbol) {
+        if (count_ < 16) {
+            Refill();
+        }
+        uint32_t look = static_cast<uint32_t>(bits_ >> 48);
+        uint16_t fast = table.fast[look >> 7];
+        int length = fast >> 8;
+        if (length != 0) {
+            symbol = fast & 0xFF;
+        } else {
+            for (length = 10; length <= 16; ++length) {
+                int32_t code = static_cast<int32_t>(look >> (16 - length));
+                if (code <= table.maxCode[length]) {
+                    int32_t index = table.valueOffset[length] + code;
+                    if (index < 0 || index > 255) {
+                        return false;
+                    }
+                    symbol = table.values[index];
+                    break;
+                }
+            }
+            if (length > 16) {
+                return false;
+            }
+        }
+        if (length > count_) {
+            return false;
+        }
+        bits_ <<= length;
+        count_ -= length;
+        return true;
+    }
+
+    bool DecodeBlock(const JpegHuffmanTable &dc, const JpegHuffmanTable &ac, int dcLimit, int acLimit) {
+        int symbol = 0;
+        uint32_t ignored = 0;
+        if (!Symbol(dc, symbol) || symbol > dcLimit || !Take(symbol, ignored)) {
+            return false;
+        }
+        for (int k = 1; k < 64;) {
+            if (!Symbol(ac, symbol)) {
+                return false;
+            }
+            int run = symbol >> 4;
+            int size = symbol & 15;
+            if (size == 0) {
+                if (run != 15) {
+                    return true;
+                }
+                k += 16;
+                if (k > 64) {
+                    return false;
+                }
+                continue;
+            }
+            k += run;
+            if (k > 63 || size > acLimit || !Take(size, ignored)) {
+                return false;
+            }
+            ++k;
+        }
+        return true;
+    }
+
+    bool Restart(uint8_t expected) {
+        Refill();
+        if (!stopped_ || count_ >= 8) {
+            return false;
+        }
+        uint8_t marker[2] = { 0, 0 };
+        if (!Byte(position_, marker[0]) || !Byte(position_ + 1, marker[1]) || marker[1] != 0xD0 + expected) {
+            return false;
+        }
+        position_ += 2;
+        checkpoint_ = position_;
+        bits_ = 0;
+        count_ = 0;
+        stopped_ = false;
+        return true;
+    }
+
+    uint64_t ErrorOffset() const {
+        uint64_t pending = static_cast<uint64_t>(count_ / 8);
+        return position_ > pending ? position_ - pending : position_;
+    }
+
+    CarveByteSource &source_;
+    uint64_t limit_;
+    uint64_t scanStart_;
+    uint64_t position_;
+    uint64_t bits_;
+    int count_;
+    bool stopped_;
+    uint32_t zeroRun_;
+    const uint8_t *block_;
+    uint64_t blockStart_;
+    size_t blockLength_;
+    uint64_t checkpoint_;
+    uint64_t mcu_;
+    uint8_t expectedRst_;
+};
+
+bool IsPdfWhitespace(uint8_t c) {
+    return c == ' ' || c == '\r' || c == '\n' || c == '\t' || c == '\f' || c == 0;
+}
+
+} // namespace
+
+uint32_t Crc32(const uint8_t *data, size_t length, uint32_t crc) {
+    const auto &t = CrcTables().table;
+    crc = ~crc;
+
+    // Slicing-by-8: one table lookup per input byte, no per-bit branches.
+    while (length >= 8) {
+        uint32_t lo = ReadLe32(data) ^ crc;
+        uint32_t hi = ReadLe32(data + 4);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+CarveByteSource::CarveByteSource(const ChunkView &view, size_t position)
+    : view_(view),
+      position_(position),
+      base_(view.offset + position),
+      size_(0),
+      physicalSize_(0),
+      split_(0),
+      gap_(0),
+      checkpoints_(nullptr),
+      checkpointInterval_(0),
+      windowStart_(0),
+      windowLength_(0) {
+    uint64_t sourceEnd = view.reader ? view.reader->Size() : view.offset + view.size;
+    physicalSize_ = sourceEnd > base_ ? sourceEnd - base_ : 0;
+    size_ = physicalSize_;
+}
+
+void CarveByteSource::SetFragmentGap(uint64_t split, uint64_t gap) {
+    split_ = split;
+    gap_ = gap;
+    size_ = physicalSize_ > gap ? physicalSize_ - gap : 0;
+}
+
+void CarveByteSource::SetCheckpoints(std::vector<WalkCheckpoint> *checkpoints, uint64_t interval) {
+    checkpoints_ = checkpoints;
+    checkpointInterval_ = interval;
+}
+
+uint64_t CarveByteSource::NextCheckpoint(uint64_t offset) const {
+    if (!checkpoints_ || checkpointInterval_ == 0 || gap_ != 0) {
+        return UINT64_MAX;
+    }
+    uint64_t absolute = base_ + offset;
+    return absolute - (absolute % checkpointInterval_) + checkpointInterval_ - base_;
+}
+
+void CarveByteSource::AddCheckpoint(const WalkCheckpoint &checkpoint) {
+    if (checkpoints_ && gap_ == 0) {
+        checkpoints_->push_back(checkpoint);
+    }
+}
+
+const WalkCheckpoint *CarveByteSource::ResumePoint() const {
+    if (!checkpoints_ || gap_ == 0) {
+        return nullptr;
+    }
+    auto it = std::lower_bound(checkpoints_->begin(), checkpoints_->end(), split_,
+                               [](const WalkCheckpoint &checkpoint, uint64_t value) { return checkpoint.boundary < value; });
+    return it != checkpoints_->end() && it->boundary == split_ ? &*it : nullptr;
+}
+
+const uint8_t *CarveByteSource::Data(uint64_t offset, size_t length) {
+    if (offset + length > size_ || offset + length < offset) {
+        return nullptr;
+    }
+
+    if (gap_ == 0 || offset + length <= split_) {
+        return Fetch(offset, length);
+    }
+    if (offset >= split_) {
+        return Fetch(offset + gap_, length);
+    }
+
+    // The request straddles the fragment boundary; stitch both halves.
+    size_t head = static_cast<size_t>(split_ - offset);
+    if (stitch_.size() < length) {
+        stitch_.resize(length);
+    }
+    const uint8_t *first = Fetch(offset, head);
+    if (!first) {
+        return nullptr;
+    }
+    std::memcpy(stitch_.data(), first, head);
+    const uint8_t *second = Fetch(split_ + gap_, length - head);
+    if (!second) {
+        return nullptr;
+    }
+    std::memcpy(stitch_.data() + head, second, length - head);
+    return stitch_.data();
+}
+
+const uint8_t *CarveByteSource::Fetch(uint64_t offset, size_t length) {
+    if (offset + length > physicalSize_) {
+        return nullptr;
+    }
+
+    if (position_ + offset + length <= view_.size) {
+        return view_.data + position_ + offset;
+    }
+
+    if (windowLength_ != 0 && offset >= windowStart_ && offset + length <= windowStart_ + windowLength_) {
+        return window_.data() + (offset - windowStart_);
+    }
+
+    if (!view_.reader) {
+        return nullptr;
+    }
+
+    uint64_t absolute = base_ + offset;
+    uint64_t alignedStart = absolute - (absolute % kWindowAlignment);
+    size_t want = std::max(kWindowSize, static_cast<size_t>(absolute - alignedStart) + length);
+    if (window_.size() < want) {
+        window_.resize(want);
+    }
+
+    long long read = view_.reader->ReadAt(alignedStart, window_.data(), want);
+    if (read <= 0 || alignedStart + static_cast<uint64_t>(read) < absolute + length) {
+        windowLength_ = 0;
+        return nullptr;
+    }
+
+    // Windows may start before the candidate when it is not 4K aligned; keep
+    // offsets relative to the candidate and skip the leading bytes.
+    uint64_t lead = absolute - alignedStart;
+    if (lead != 0) {
+        std::memmove(window_.data(), window_.data() + lead, static_cast<size_t>(read - static_cast<long long>(lead)));
+    }
+    windowStart_ = offset;
+    windowLength_ = static_cast<size_t>(static_cast<uint64_t>(read) - lead);
+    return window_.data();
+}
+
+uint64_t CarveByteSource::Find(uint64_t from, uint64_t to, const uint8_t *needle, size_t needleLength) {
+    to = std::min(to, size_);
+    if (needleLength == 0 || from >= to || to - from < needleLength) {
+        return to;
+    }
+
+    while (from + needleLength <= to) {
+        size_t step = static_cast<size_t>(std::min<uint64_t>(to - from, kScanBlock));
+        if (step < needleLength) {
+            break;
+        }
+        const uint8_t *p = Data(from, step);
+        if (!p) {
+            break;
+        }
+
+        const uint8_t *cursor = p;
+        const uint8_t *last = p + (step - needleLength);
+        while (cursor <= last) {
+            const void *hit = std::memchr(cursor, needle[0], static_cast<size_t>(last - cursor) + 1);
+            if (!hit) {
+                break;
+            }
+            cursor = static_cast<const uint8_t *>(hit);
+            if (std::memcmp(cursor, needle, needleLength) == 0) {
+                return from + static_cast<uint64_t>(cursor - p);
+            }
+            ++cursor;
+        }
+
+        if (from + step >= to) {
+            break;
+        }
+        from += step - (needleLength - 1);
+    }
+
+    return to;
+}
+
+bool WalkJpeg(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict) {
+    verdict = FormatVerdict{ 0, 0, false, nullptr, 0, 0 };
+
+    const uint8_t *p = source.Data(0, 4);
+    if (!p || p[0] != 0xFF || p[1] != 0xD8 || p[2] != 0xFF) {
+        return false;
+    }
+
+    JpegHuffmanTable dcTables[4] = {};
+    JpegHuffmanTable acTables[4] = {};
+    JpegFrame frame{ false, 0, 0, 0, 1, 1, {} };
+    uint16_t restartInterval = 0;
+    uint32_t scans = 0;
+    bool seenSof = false;
+    bool seenSos = false;
+    bool seenTables = false;
+    bool allDecoded = true;
+    uint64_t offset = 2;
+    uint64_t validEnd = 2;
+    uint64_t suspectFrom = 0;
+    uint64_t failedAt = 0;
+
+    while (offset + 2 <= limit) {
+        p = source.Data(offset, 2);
+        if (!p || p[0] != 0xFF) {
+            failedAt = offset + 2;
+            break;
+        }
+
+        uint8_t marker = p[1];
+        if (marker == 0xFF) {
+            ++offset;
+            continue;
+        }
+        if (marker == 0xD9) {
+            // An image missing its frame or scan ends up like a truncated
+            // one: a low-confidence hit, or none without a frame.
+            if (!seenSof) {
+                return false;
+            }
+            verdict.length = offset + 2;
+            verdict.complete = seenSos;
+            verdict.confidence = !seenSos ? 10 : allDecoded ? 98 : seenTables ? 95 : 80;
+            return true;
+        }
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+            offset += 2;
+            continue;
+        }
+        if (!IsKnownJpegSegment(marker)) {
+            failedAt = offset + 2;
+            break;
+        }
+
+        p = source.Data(offset + 2, 2);
+        if (!p) {
+            break;
+        }
+        uint16_t segmentLength = ReadBe16(p);
+        if (segmentLength < 2) {
+            failedAt = offset + 4;
+            break;
+        }
+        const uint8_t *segment = source.Data(offset + 4, segmentLength - 2u);
+        if (!segment) {
+            break;
+        }
+        const size_t payload = segmentLength - 2u;
+
+        bool valid = true;
+        std::vector<JpegScanComponent> scan;
+        if (IsJpegSofMarker(marker)) {
+            uint8_t count = payload >= 6 ? segment[5] : 0;
+            uint16_t width = payload >= 6 ? ReadBe16(segment + 3) : 0;
+            valid = payload >= 6 && (segment[0] == 8 || segment[0] == 12 || segment[0] == 16) && width != 0 &&
+                    count != 0 && count <= 4 && payload >= 6u + 3u * count;
+            if (valid) {
+                frame = JpegFrame{ marker == 0xC0 || marker == 0xC1, segment[0], width, ReadBe16(segment + 1), 1, 1, {} };
+                for (uint8_t i = 0; i < count && valid; ++i) {
+                    const uint8_t *c = segment + 6 + 3 * i;
+                    uint8_t h = c[1] >> 4;
+                    uint8_t v = c[1] & 15;
+                    valid = h >= 1 && h <= 4 && v >= 1 && v <= 4;
+                    frame.components.push_back(JpegComponent{ c[0], h, v });
+                    frame.hMax = std::max(frame.hMax, h);
+                    frame.vMax = std::max(frame.vMax, v);
+                }
+                // Height 0 defers to a DNL marker; leave such frames to the
+                // marker-level check.
+                frame.huffmanSequential = frame.huffmanSequential && frame.height != 0 && frame.precision != 16;
+                seenSof = valid;
+            }
+        } else if (marker == 0xC4) {
+            seenTables = true;
+            size_t at = 0;
+            while (valid && at < payload) {
+                uint8_t classId = segment[at];
+                if (at + 17 > payload || (classId >> 4) > 1 || (classId & 15) > 3) {
+                    valid = false;
+                    break;
+                }
+                size_t total = 0;
+                for (int i = 0; i < 16; ++i) {
+                    total += segment[at + 1 + i];
+                }
+                if (total > 256 || at + 17 + total > payload) {
+                    valid = false;
+                    break;
+                }
+                JpegHuffmanTable &table = (classId >> 4) ? acTables[classId & 15] : dcTables[classId & 15];
+                valid = BuildJpegHuffmanTable(segment + at + 1, segment + at + 17, total, table);
+                at += 17 + total;
+            }
+        } else if (marker == 0xDB) {
+            seenTables = true;
+        } else if (marker == 0xDD) {
+            valid = payload >= 2;
+            restartInterval = valid ? ReadBe16(segment) : 0;
+        } else if (marker == 0xDA) {
+            uint8_t count = payload >= 1 ? segment[0] : 0;
+            valid = seenSof && count >= 1 && count <= 4 && payload >= 1u + 2u * count + 3u;
+            for (uint8_t i = 0; valid && i < count; ++i) {
+                const uint8_t *c = segment + 1 + 2 * i;
+                size_t index = 0;
+                while (index < frame.components.size() && frame.components[index].id != c[0]) {
+                    ++index;
+                }
+                valid = index < frame.components.size();
+                scan.push_back(JpegScanComponent{ index, static_cast<uint8_t>(c[1] >> 4), static_cast<uint8_t>(c[1] & 15) });
+            }
+        }
+        if (!valid) {
+            failedAt = offset + 2 + segmentLength;
+            break;
+        }
+
+        offset += 2 + static_cast<uint64_t>(segmentLength);
+        validEnd = offset;
+
+        if (marker != 0xDA) {
+            continue;
+        }
+        seenSos = true;
+
+        bool decodable = frame.huffmanSequential;
+        for (const JpegScanComponent &c : scan) {
+            decodable = decodable && c.dcTable < 4 && c.acTable < 4 && dcTables[c.dcTable].defined &&
+                        acTables[c.acTable].defined;
+        }
+        if (decodable) {
+            JpegScanDecoder decoder(source, offset, limit);
+            const WalkCheckpoint *resume = scans == 0 ? source.ResumePoint() : nullptr;
+            if (resume) {
+                decoder.Resume(*resume);
+            }
+            ++scans;
+            uint64_t end = 0;
+            uint64_t errorAt = 0;
+            if (!decoder.Decode(frame, scan, dcTables, acTables, restartInterval, end, errorAt)) {
+                // Huffman codes resynchronise, so foreign data is usually
+                // caught within a few KB of the break but not immediately.
+                validEnd = errorAt;
+                suspectFrom = std::max(decoder.Checkpoint(), errorAt > kJpegLookback ? errorAt - kJpegLookback : 0);
+                failedAt = errorAt;
+                break;
+            }
+            offset = end;
+            validEnd = offset;
+            continue;
+        }
+        allDecoded = false;
+
+        // Progressive and arithmetic scans are only checked at marker level:
+        // FF00 stuffing and RSTn may appear before the next real marker.
+        // Anything else means the data stopped being JPEG here (typically a
+        // fragmentation point).
+        bool markerFound = false;
+        bool corrupt = false;
+        uint8_t expectedRst = 0;
+        uint64_t lastRst = offset;
+        while (offset < limit && !markerFound && !corrupt) {
+            size_t step = static_cast<size_t>(std::min<uint64_t>(limit - offset, kScanBlock));
+            const uint8_t *block = source.Data(offset, step);
+            if (!block) {
+                break;
+            }
+
+            const uint8_t *cursor = block;
+            const uint8_t *end = block + step;
+            while (cursor < end) {
+                const void *hit = std::memchr(cursor, 0xFF, static_cast<size_t>(end - cursor));
+                if (!hit) {
+                    cursor = end;
+                    break;
+                }
+                cursor = static_cast<const uint8_t *>(hit);
+                if (cursor + 1 >= end) {
+                    break;
+                }
+
+                uint8_t next = cursor[1];
+                if (next == 0x00 || next == 0xFF) {
+                    cursor += 1 + (next == 0x00);
+                    continue;
+                }
+                if (next >= 0xD0 && next <= 0xD7) {
+                    if (next - 0xD0 != expectedRst) {
+                        corrupt = true;
+                        break;
+                    }
+                    expectedRst = static_cast<uint8_t>((expectedRst + 1) & 7);
+                    cursor += 2;
+                    lastRst = offset + static_cast<uint64_t>(cursor - block);
+                    continue;
+                }
+                if (next == 0xD9 || IsKnownJpegSegment(next)) {
+                    markerFound = true;
+                    break;
+                }
+                corrupt = true;
+                break;
+            }
+
+            uint64_t consumed = static_cast<uint64_t>(cursor - block);
+            offset += consumed;
+            if (!markerFound && !corrupt) {
+                validEnd = offset;
+                if (consumed == 0) {
+                    break;
+                }
+            }
+        }
+
+        validEnd = offset;
+        if (corrupt) {
+            suspectFrom = std::max(lastRst, offset > kJpegLookback ? offset - kJpegLookback : 0);
+            failedAt = offset + 2;
+        }
+        if (!markerFound) {
+            break;
+        }
+    }
+
+    if (!seenSof) {
+        return false;
+    }
+
+    verdict.length = std::min(validEnd, limit);
+    verdict.complete = false;
+    verdict.confidence = seenSos ? 35 : 10;
+    if (failedAt != 0) {
+        verdict.suspectFrom = std::min(suspectFrom != 0 ? suspectFrom : verdict.length, verdict.length);
+        verdict.failedAt = std::max(failedAt, verdict.length);
+    }
+    return true;
+}
+
+bool WalkPng(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict) {
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    verdict = FormatVerdict{ 0, 0, false, nullptr, 0, 0 };
+
+    const uint8_t *p = source.Data(0, 8 + 8 + 13 + 4);
+    if (!p || std::memcmp(p, kSignature, 8) != 0) {
+        return false;
+    }
+
+    // IHDR must come first and be internally consistent; this alone rejects
+    // nearly every accidental signature match.
+    const uint8_t *ihdr = p + 8;
+    if (ReadBe32(ihdr) != 13 || std::memcmp(ihdr + 4, "IHDR", 4) != 0) {
+        return false;
+    }
+    uint32_t width = ReadBe32(ihdr + 8);
+    uint32_t height = ReadBe32(ihdr + 12);
+    uint8_t bitDepth = ihdr[16];
+    uint8_t colorType = ihdr[17];
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF ||
+        (bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16) ||
+        (colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6) ||
+        ihdr[18] != 0 || ihdr[19] != 0 || ihdr[20] > 1) {
+        return false;
+    }
+    if (Crc32(ihdr + 4, 17) != ReadBe32(ihdr + 21)) {
+        return false;
+    }
+
+    uint64_t offset = 8 + 25;
+    bool seenData = false;
+
+    while (offset + 12 <= limit) {
+        p = source.Data(offset, 8);
+        if (!p) {
+            break;
+        }
+        uint32_t length = ReadBe32(p);
+        uint8_t type[4];
+        std::memcpy(type, p + 4, 4);
+
+        bool typeValid = true;
+        for (uint8_t c : type) {
+            typeValid = typeValid && ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
+        }
+        if (!typeValid || length > 0x7FFFFFFFu || offset + 12 + length > limit) {
+            verdict.suspectFrom = offset;
+            verdict.failedAt = offset + 8;
+            break;
+        }
+
+        bool ok = false;
+        uint32_t crc = Crc32Range(source, offset + 4, 4 + static_cast<uint64_t>(length), ok);
+        const uint8_t *stored = ok ? source.Data(offset + 8 + length, 4) : nullptr;
+        if (!stored || ReadBe32(stored) != crc) {
+            if (stored) {
+                verdict.suspectFrom = offset;
+                verdict.failedAt = offset + 12 + length;
+            }
+            break;
+        }
+
+        offset += 12 + static_cast<uint64_t>(length);
+        if (std::memcmp(type, "IDAT", 4) == 0) {
+            seenData = true;
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            verdict.length = offset;
+            verdict.complete = seenData;
+            verdict.confidence = seenData ? 98 : 30;
+            return true;
+        }
+    }
+
+    verdict.length = offset;
+    verdict.confidence = seenData ? 40 : 15;
+    return true;
+}
+
+bool WalkPdf(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict) {
+    static const uint8_t kEof[] = { '%', '%', 'E', 'O', 'F' };
+    static const uint8_t kStartXref[] = { 's', 't', 'a', 'r', 't', 'x', 'r', 'e', 'f' };
+    static const uint8_t kEndObj[] = { 'e', 'n', 'd', 'o', 'b', 'j' };
+    static const uint8_t kObj[] = { 'o', 'b', 'j' };
+    verdict = FormatVerdict{ 0, 0, false, nullptr, 0, 0 };
+
+    const uint8_t *p = source.Data(0, 9);
+    if (!p || std::memcmp(p, "%PDF-", 5) != 0 || p[5] < '1' || p[5] > '2' || p[6] != '.' || p[7] < '0' || p[7] > '9' ||
+        (p[8] != '\r' && p[8] != '\n' && p[8] != ' ')) {
+        return false;
+    }
+
+    // A real header is followed within a few hundred bytes by the first
+    // object; a stray "%PDF-" in random data is not.
+    uint64_t probe = std::min<uint64_t>(1024, limit);
+    if (source.Find(9, probe, kObj, sizeof(kObj)) >= probe) {
+        return false;
+    }
+
+    uint64_t lastValidEnd = 0;
+    uint64_t lastObjectEnd = 0;
+    uint64_t segmentStart = 9;
+    bool done = false;
+
+    while (!done && segmentStart < limit) {
+        uint64_t segmentEnd = std::min(limit, segmentStart + kPdfSegment);
+
+        bool sawObject = false;
+        for (uint64_t at = segmentStart;;) {
+            uint64_t hit = source.Find(at, segmentEnd, kEndObj, sizeof(kEndObj));
+            if (hit >= segmentEnd) {
+                break;
+            }
+            lastObjectEnd = hit + sizeof(kEndObj);
+            sawObject = true;
+            at = lastObjectEnd;
+        }
+
+        bool sawEof = false;
+        uint64_t searchFrom = segmentStart;
+        while (searchFrom < segmentEnd) {
+            uint64_t eof = source.Find(searchFrom, segmentEnd, kEof, sizeof(kEof));
+            if (eof >= segmentEnd) {
+                break;
+            }
+            searchFrom = eof + sizeof(kEof);
+            sawEof = true;
+
+            // The trailer before %%EOF names the byte offset of the xref table
+            // (or xref stream object). An %%EOF whose startxref does not point
+            // at one is embedded content or a linearization stub.
+            uint64_t marker = eof > 1024 ? eof - 1024 : 0;
+            uint64_t found = eof;
+            while (true) {
+                uint64_t next = source.Find(marker, eof, kStartXref, sizeof(kStartXref));
+                if (next >= eof) {
+                    break;
+                }
+                found = next;
+                marker = next + 1;
+            }
+            if (found >= eof) {
+                continue;
+            }
+
+            const size_t tail = static_cast<size_t>(eof - found - sizeof(kStartXref));
+            const uint8_t *text = source.Data(found + sizeof(kStartXref), tail);
+            if (!text) {
+                continue;
+            }
+            size_t i = 0;
+            while (i < tail && IsPdfWhitespace(text[i])) {
+                ++i;
+            }
+            uint64_t xrefOffset = 0;
+            size_t digits = 0;
+            while (i < tail && text[i] >= '0' && text[i] <= '9' && digits < 15) {
+                xrefOffset = xrefOffset * 10 + static_cast<uint64_t>(text[i] - '0');
+                ++i;
+                ++digits;
+            }
+            if (digits == 0 || xrefOffset == 0 || xrefOffset >= eof) {
+                continue;
+            }
+
+            const uint8_t *xref = source.Data(xrefOffset, 16);
+            if (!xref) {
+                continue;
+            }
+            bool xrefValid = std::memcmp(xref, "xref", 4) == 0;
+            if (!xrefValid && xref[0] >= '0' && xref[0] <= '9') {
+                size_t j = 0;
+                while (j < 16 && xref[j] >= '0' && xref[j] <= '9') {
+                    ++j;
+                }
+                xrefValid = j < 16 && IsPdfWhitespace(xref[j]);
+            }
+            if (!xrefValid) {
+                continue;
+            }
+
+            uint64_t end = eof + sizeof(kEof);
+            const uint8_t *eol = source.Data(end, 2);
+            if (eol) {
+                if (eol[0] == '\r' && eol[1] == '\n') {
+                    end += 2;
+                } else if (eol[0] == '\r' || eol[0] == '\n') {
+                    end += 1;
+                }
+            }
+            lastValidEnd = std::min(end, limit);
+
+            // Incremental updates append objects and another trailer after the
+            // first %%EOF; keep going only when the next bytes look like that.
+            size_t peekLength = static_cast<size_t>(std::min<uint64_t>(256, source.Size() > end ? source.Size() - end : 0));
+            const uint8_t *after = peekLength ? source.Data(end, peekLength) : nullptr;
+            size_t k = 0;
+            while (after && k < peekLength && IsPdfWhitespace(after[k]) && after[k] != 0) {
+                ++k;
+            }
+            bool continues = after && k < peekLength &&
+                             ((after[k] >= '1' && after[k] <= '9') ||
+                              (k + 4 <= peekLength && std::memcmp(after + k, "xref", 4) == 0));
+            if (!continues) {
+                done = true;
+                break;
+            }
+            searchFrom = std::max(searchFrom, end);
+        }
+
+        // Stretches with neither objects nor trailers mean the data stopped
+        // being this PDF (overwritten or fragmented).
+        if (!sawObject && !sawEof) {
+            break;
+        }
+        if (segmentEnd >= limit) {
+            break;
+        }
+        segmentStart = segmentEnd - (sizeof(kStartXref) - 1);
+    }
+
+    if (lastValidEnd != 0) {
+        verdict.length = lastValidEnd;
+        verdict.complete = true;
+        verdict.confidence = 90;
+        return true;
+    }
+
+    verdict.length = std::max<uint64_t>(lastObjectEnd, 9);
+    verdict.confidence = lastObjectEnd != 0 ? 25 : 10;
+    return true;
+}
+
+bool WalkZip(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict) {
+    verdict = FormatVerdict{ 0, 0, false, nullptr, 0, 0 };
+
+    uint64_t offset = 0;
+    uint64_t entryData = 0;
+    uint32_t localEntries = 0;
+    bool sawContentTypes = false;
+    const char *extension = nullptr;
+
+    // Local file headers, each followed by its data.
+    while (offset + 30 <= limit) {
+        const uint8_t *p = source.Data(offset, 30);
+        if (!p || ReadLe32(p) != 0x04034B50) {
+            // Either the central directory starts here or the previous entry's
+            // data ran into foreign clusters.
+            if (p && ReadLe32(p) != 0x02014B50 && localEntries != 0) {
+                verdict.suspectFrom = entryData;
+                verdict.failedAt = offset + 4;
+            }
+            break;
+        }
+
+        uint16_t flags = ReadLe16(p + 6);
+        uint16_t method = ReadLe16(p + 8);
+        uint32_t crc = ReadLe32(p + 14);
+        uint32_t compressedSize = ReadLe32(p + 18);
+        uint16_t nameLength = ReadLe16(p + 26);
+        uint16_t extraLength = ReadLe16(p + 28);
+        if (nameLength == 0 || nameLength > 1024 || (method > 20 && method != 93 && method != 95 && method != 98 && method != 99)) {
+            if (localEntries == 0) {
+                return false;
+            }
+            break;
+        }
+
+        const uint8_t *name = source.Data(offset + 30, nameLength);
+        if (!name) {
+            break;
+        }
+        if (localEntries == 0) {
+            if (nameLength == 19 && std::memcmp(name, "[Content_Types].xml", 19) == 0) {
+                sawContentTypes = true;
+            } else if (nameLength == 8 && std::memcmp(name, "mimetype", 8) == 0) {
+                const uint8_t *mime = method == 0 ? source.Data(offset + 30 + nameLength + extraLength, 46) : nullptr;
+                if (mime && std::memcmp(mime, "application/vnd.oasis.opendocument.", 35) == 0) {
+                    if (std::memcmp(mime + 35, "text", 4) == 0) {
+                        extension = "odt";
+                    } else if (std::memcmp(mime + 35, "spreadsheet", 11) == 0) {
+                        extension = "ods";
+                    } else if (std::memcmp(mime + 35, "presentation", 11) == 0) {
+                        extension = "odp";
+                    }
+                } else if (mime && std::memcmp(mime, "application/epub+zip", 20) == 0) {
+                    extension = "epub";
+                }
+            }
+        }
+        if (sawContentTypes && !extension) {
+            if (nameLength > 5 && std::memcmp(name, "word/", 5) == 0) {
+                extension = "docx";
+            } else if (nameLength > 3 && std::memcmp(name, "xl/", 3) == 0) {
+                extension = "xlsx";
+            } else if (nameLength > 4 && std::memcmp(name, "ppt/", 4) == 0) {
+                extension = "pptx";
+            }
+        }
+
+        uint64_t dataStart = offset + 30 + nameLength + extraLength;
+        entryData = dataStart;
+        if ((flags & 0x0008) != 0 || compressedSize == 0xFFFFFFFFu) {
+            // Sizes live in a trailing data descriptor; resync on the next
+            // header signature instead.
+            static const uint8_t kPk[] = { 'P', 'K' };
+            uint64_t cursor = dataStart;
+            uint64_t next = limit;
+            while (cursor < limit) {
+                uint64_t hit = source.Find(cursor, limit, kPk, sizeof(kPk));
+                if (hit + 4 > limit) {
+                    break;
+                }
+                const uint8_t *sig = source.Data(hit, 4);
+                if (sig && ((sig[2] == 0x03 && sig[3] == 0x04) || (sig[2] == 0x01 && sig[3] == 0x02))) {
+                    next = hit;
+                    break;
+                }
+                if (sig && sig[2] == 0x07 && sig[3] == 0x08) {
+                    // Descriptor is 16 bytes, or 24 with ZIP64 sizes.
+                    const uint8_t *after = source.Data(hit + 16, 4);
+                    next = (after && after[0] == 'P' && after[1] == 'K') ? hit + 16 : hit + 24;
+                    break;
+                }
+                cursor = hit + 1;
+            }
+            if (next >= limit) {
+                break;
+            }
+            offset = next;
+        } else {
+            if (method == 0 && compressedSize <= 16u * 1024 * 1024) {
+                bool ok = false;
+                uint32_t actual = Crc32Range(source, dataStart, compressedSize, ok);
+                if (!ok || actual != crc) {
+                    if (ok) {
+                        verdict.suspectFrom = dataStart;
+                        verdict.failedAt = dataStart + compressedSize;
+                    }
+                    break;
+                }
+            }
+            offset = dataStart + compressedSize;
+        }
+        ++localEntries;
+    }
+
+    if (localEntries == 0) {
+        return false;
+    }
+
+    // Central directory, then the end-of-central-directory record that must
+    // point back at it.
+    const uint64_t centralStart = offset;
+    uint32_t centralEntries = 0;
+    while (offset + 46 <= limit) {
+        const uint8_t *p = source.Data(offset, 46);
+        if (!p || ReadLe32(p) != 0x02014B50) {
+            break;
+        }
+        offset += 46 + static_cast<uint64_t>(ReadLe16(p + 28)) + ReadLe16(p + 30) + ReadLe16(p + 32);
+        ++centralEntries;
+    }
+
+    const uint8_t *p = source.Data(offset, 4);
+    if (p && ReadLe32(p) == 0x06064B50) {
+        const uint8_t *zip64 = source.Data(offset, 12);
+        if (zip64) {
+            uint64_t recordSize = static_cast<uint64_t>(ReadLe32(zip64 + 4)) | (static_cast<uint64_t>(ReadLe32(zip64 + 8)) << 32);
+            offset += 12 + recordSize;
+        }
+        p = source.Data(offset, 4);
+        if (p && ReadLe32(p) == 0x07064B50) {
+            offset += 20;
+        }
+    }
+
+    p = source.Data(offset, 22);
+    if (centralEntries > 0 && p && ReadLe32(p) == 0x06054B50) {
+        uint16_t totalEntries = ReadLe16(p + 10);
+        uint32_t directorySize = ReadLe32(p + 12);
+        uint32_t directoryOffset = ReadLe32(p + 16);
+        uint16_t commentLength = ReadLe16(p + 20);
+
+        bool consistent = (directoryOffset == 0xFFFFFFFFu || directoryOffset == centralStart) &&
+                          (totalEntries == 0xFFFF || totalEntries == centralEntries) &&
+                          (directorySize == 0xFFFFFFFFu || directoryOffset == 0xFFFFFFFFu || centralStart + directorySize <= offset);
+        uint64_t end = offset + 22 + commentLength;
+        if (end <= limit) {
+            verdict.length = end;
+            verdict.complete = true;
+            verdict.confidence = consistent ? 97 : 60;
+            verdict.extension = extension;
+            return true;
+        }
+    }
+
+    verdict.length = std::min(offset, limit);
+    verdict.confidence = localEntries > 1 ? 30 : 15;
+    verdict.extension = extension;
+    if (verdict.failedAt == 0 && centralEntries > 0) {
+        verdict.suspectFrom = centralStart;
+        verdict.failedAt = offset + 4;
+    }
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "carver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace usnscanner {
+
+// Opaque validator state a walker can resume from. During a contiguous walk a
+// walker records one per checkpoint boundary it crosses; once a fragment gap
+// is set it restarts from the state recorded at the split instead of
+// validating the whole header fragment again.
+struct WalkCheckpoint {
+    uint64_t boundary;
+    uint64_t state[7];
+};
+
+// Random access over a candidate file that starts at a position inside a
+// chunk. Bytes inside the chunk buffer are returned in place; anything past
+// it is fetched through the reader in aligned windows, so walkers never copy
+// the part of the file that was already read for the chunk.
+class CarveByteSource {
+  public:
+    CarveByteSource(const ChunkView &view, size_t position);
+
+    uint64_t Base() const { return base_; }
+    // Bytes from the candidate start to the end of the source.
+    uint64_t Size() const { return size_; }
+
+    // Pointer to `length` bytes at `offset` (relative to the candidate start),
+    // or nullptr if they are past the end or unreadable. The pointer is only
+    // valid until the next call.
+    const uint8_t *Data(uint64_t offset, size_t length);
+
+    // Finds the first occurrence of `needle` in [from, to); returns `to` when
+    // absent.
+    uint64_t Find(uint64_t from, uint64_t to, const uint8_t *needle, size_t needleLength);
+
+    // Treats the candidate as two fragments: offsets at or past `split` are
+    // read `gap` bytes further on. A gap of 0 restores the contiguous view.
+    void SetFragmentGap(uint64_t split, uint64_t gap);
+
+    // Checkpoints are recorded into `checkpoints` at every absolute multiple
+    // of `interval` (cluster boundaries) while no gap is set.
+    void SetCheckpoints(std::vector<WalkCheckpoint> *checkpoints, uint64_t interval);
+    // First checkpoint boundary after `offset`, or UINT64_MAX when not
+    // recording.
+    uint64_t NextCheckpoint(uint64_t offset) const;
+    void AddCheckpoint(const WalkCheckpoint &checkpoint);
+    // State recorded at the current split, if any.
+    const WalkCheckpoint *ResumePoint() const;
+
+  private:
+    const uint8_t *Fetch(uint64_t offset, size_t length);
+
+    const ChunkView &view_;
+    size_t position_;
+    uint64_t base_;
+    uint64_t size_;
+    uint64_t physicalSize_;
+    uint64_t split_;
+    uint64_t gap_;
+    std::vector<uint8_t> stitch_;
+    std::vector<WalkCheckpoint> *checkpoints_;
+    uint64_t checkpointInterval_;
+    std::vector<uint8_t> window_;
+    uint64_t windowStart_;
+    size_t windowLength_;
+};
+
+struct FormatVerdict {
+    // Exact length when complete, otherwise the structurally valid prefix.
+    uint64_t length;
+    uint8_t confidence;
+    bool complete;
+    // Refined extension (docx for an OOXML zip, ...); nullptr keeps the
+    // signature's default.
+    const char *extension;
+    // Truncated results only: the walk noticed foreign data at failedAt, and
+    // the break that caused it lies somewhere in [suspectFrom, failedAt].
+    // Both stay 0 when the walker cannot localise the break.
+    uint64_t suspectFrom;
+    uint64_t failedAt;
+};
+
+// Walkers return false when the candidate is a false positive and should be
+// dropped; otherwise they fill `verdict`.
+bool WalkJpeg(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict);
+bool WalkPng(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict);
+bool WalkPdf(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict);
+bool WalkZip(CarveByteSource &source, uint64_t limit, FormatVerdict &verdict);
+
+uint32_t Crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+} // namespace usnscanner
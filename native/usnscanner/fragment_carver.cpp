@@ -0,0 +1,394 @@
+#include "fragment_carver.h"
+#include "format_walkers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+// Split points tried per second-fragment candidate, newest first.
+const size_t kMaxSplits = 64;
+// The header fragment is held in memory while gaps are tried.
+const uint64_t kMaxPrefix = 64ull * 1024 * 1024;
+// 64 class bytes per page; 64K pages cover 4M clusters for a few MB.
+const size_t kCachePages = 64 * 1024;
+// Verdicts at or above this were validated end to end (Huffman-decoded JPEG,
+// CRC-checked PNG, consistent ZIP directory), so a repair built on one is
+// trustworthy; weaker verdicts only prove the pieces line up.
+const uint8_t kValidatedConfidence = 97;
+// Quarter-bit entropy floors for clusters that may continue a file.
+const uint8_t kJpegEntropyFloor = 24;
+const uint8_t kCompressedEntropyFloor = 20;
+
+enum class FragmentKind {
+    Unsupported,
+    Jpeg,
+    Compressed
+};
+
+FragmentKind KindOf(const CarveSignature &signature) {
+    if (!signature.walker) {
+        return FragmentKind::Unsupported;
+    }
+    if (signature.type == "jpeg") {
+        return FragmentKind::Jpeg;
+    }
+    if (signature.type == "png" || signature.type == "zip") {
+        return FragmentKind::Compressed;
+    }
+    return FragmentKind::Unsupported;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint8_t ClassifyCluster(const uint8_t *data, size_t size) {
+    uint32_t counts[256] = {};
+    for (size_t i = 0; i < size; ++i) {
+        ++counts[data[i]];
+    }
+    double entropy = 0;
+    for (uint32_t count : counts) {
+        if (count != 0) {
+            double p = static_cast<double>(count) / static_cast<double>(size);
+            entropy -= p * std::log2(p);
+        }
+    }
+    uint8_t classes = static_cast<uint8_t>(std::min(62.0, entropy * 4));
+
+    bool clean = true;
+    bool end = false;
+    const uint8_t *cursor = data;
+    const uint8_t *last = data + size;
+    while (cursor < last) {
+        const void *hit = std::memchr(cursor, 0xFF, static_cast<size_t>(last - cursor));
+        if (!hit) {
+            break;
+        }
+        cursor = static_cast<const uint8_t *>(hit);
+        if (cursor + 1 >= last) {
+            break;
+        }
+        uint8_t next = cursor[1];
+        if (next == 0xD9) {
+            end = true;
+            break;
+        }
+        if (next != 0x00 && next != 0xFF && (next < 0xD0 || next > 0xD7)) {
+            clean = false;
+            break;
+        }
+        cursor += next == 0xFF ? 1 : 2;
+    }
+
+    if (clean) {
+        classes |= kClusterJpegClean;
+    }
+    if (end) {
+        classes |= kClusterJpegEnd;
+    }
+    return classes;
+}
+
+// Whether [offset, offset + length) lies inside one of the sorted ranges.
+bool InRanges(const std::vector<ByteRange> &ranges, uint64_t offset, uint64_t length) {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), offset, [](uint64_t value, const ByteRange &range) {
+        return value < range.offset;
+    });
+    if (it == ranges.begin()) {
+        return false;
+    }
+    --it;
+    return offset >= it->offset && offset + length <= it->offset + it->length;
+}
+
+} // namespace
+
+ClusterClassCache::ClusterClassCache(VolumeReader &reader, uint32_t clusterSize, size_t maxPages)
+    : reader_(reader),
+      clusterSize_(clusterSize),
+      maxPagesPerShard_(std::max<size_t>(1, maxPages / kShards)),
+      hits_(0),
+      misses_(0) {}
+
+uint8_t ClusterClassCache::Get(uint64_t cluster) {
+    const uint64_t page = cluster / kPageClusters;
+    const size_t slot = static_cast<size_t>(cluster % kPageClusters);
+    Shard &shard = shards_[page % kShards];
+
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.pages.find(page);
+        if (it != shard.pages.end()) {
+            ++hits_;
+            return it->second[slot];
+        }
+    }
+
+    ++misses_;
+    std::array<uint8_t, kPageClusters> classes;
+    Classify(page, classes);
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    if (shard.pages.size() >= maxPagesPerShard_) {
+        shard.pages.clear();
+    }
+    shard.pages.emplace(page, classes);
+    return classes[slot];
+}
+
+void ClusterClassCache::Classify(uint64_t page, std::array<uint8_t, kPageClusters> &classes) {
+    thread_local std::vector<uint8_t> buffer;
+    const uint64_t start = page * kPageClusters * clusterSize_;
+    const size_t want = kPageClusters * clusterSize_;
+    buffer.resize(want);
+
+    long long read = -1;
+    if (start < reader_.Size()) {
+        read = reader_.ReadAt(start, buffer.data(), static_cast<size_t>(std::min<uint64_t>(want, reader_.Size() - start)));
+    }
+
+    for (size_t i = 0; i < kPageClusters; ++i) {
+        uint64_t end = static_cast<uint64_t>(i + 1) * clusterSize_;
+        classes[i] = read > 0 && static_cast<uint64_t>(read) >= end
+                         ? ClassifyCluster(buffer.data() + i * clusterSize_, clusterSize_)
+                         : kUnreadableCluster;
+    }
+}
+
+BifragmentCarver::BifragmentCarver(VolumeReader &reader, const std::vector<CarveSignature> &signatures, const BifragmentOptions &options)
+    : reader_(reader),
+      signatures_(signatures),
+      options_(options),
+      cache_(reader, options.clusterSize, kCachePages),
+      stats_{ 0, 0, 0, 0, 0, 0, 0 } {
+    if (options_.maxGap == 0) {
+        options_.maxGap = 32ull * 1024 * 1024;
+    }
+    if (options_.maxTests == 0) {
+        options_.maxTests = 512;
+    }
+}
+
+void BifragmentCarver::Run(std::vector<CarveHit> &hits, const std::vector<ByteRange> &ranges) {
+    auto started = std::chrono::steady_clock::now();
+    stats_ = BifragmentStats{ 0, 0, 0, 0, 0, 0, 0 };
+
+    std::vector<ByteRange> sorted = ranges;
+    std::sort(sorted.begin(), sorted.end(), [](const ByteRange &a, const ByteRange &b) {
+        return a.offset < b.offset;
+    });
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < hits.size(); ++i) {
+        if (!hits[i].complete && KindOf(signatures_[hits[i].signature]) != FragmentKind::Unsupported) {
+            pending.push_back(i);
+        }
+    }
+    stats_.candidates = pending.size();
+
+    if (!pending.empty() && options_.clusterSize != 0) {
+        WorkStealingPool pool(options_.threads != 0 ? options_.threads : DefaultWorkerCount());
+        std::vector<Counters> counters(pool.ThreadCount(), Counters{ 0, 0, 0 });
+        pool.Run(pending.size(), [&](size_t task, size_t worker) {
+            Repair(hits[pending[task]], sorted, counters[worker]);
+        });
+        for (const Counters &c : counters) {
+            stats_.tests += c.tests;
+            stats_.pruned += c.pruned;
+            stats_.repaired += c.repaired;
+        }
+    }
+
+    stats_.cacheHits = cache_.Hits();
+    stats_.cacheMisses = cache_.Misses();
+    stats_.elapsedMs = MillisecondsSince(started);
+}
+
+bool BifragmentCarver::Repair(CarveHit &hit, const std::vector<ByteRange> &ranges, Counters &counters) {
+    const CarveSignature &signature = signatures_[hit.signature];
+    const FragmentKind kind = KindOf(signature);
+    const uint64_t cluster = options_.clusterSize;
+    const uint64_t base = hit.offset;
+    const uint64_t limit = signature.maxLength;
+
+    // Walk once more without a gap to learn where the data stopped validating,
+    // keeping the walker's state at every cluster boundary so candidate gaps
+    // resume from the split instead of re-validating the header fragment.
+    std::vector<WalkCheckpoint> checkpoints;
+    ChunkView probeView{ &reader_, base, nullptr, 0, 0 };
+    CarveByteSource probe(probeView, 0);
+    probe.SetCheckpoints(&checkpoints, cluster);
+    FormatVerdict verdict{};
+    if (!signature.walker(probe, limit, verdict) || verdict.complete || verdict.failedAt == 0) {
+        return false;
+    }
+
+    // The break is an absolute cluster boundary somewhere in the suspect range.
+    uint64_t highest = base + verdict.failedAt - 1;
+    highest -= highest % cluster;
+    uint64_t lowest = base + verdict.suspectFrom;
+    lowest -= lowest % cluster;
+    if (lowest <= base) {
+        lowest = base + cluster - (base % cluster);
+    }
+    if (highest < lowest || highest - base > kMaxPrefix) {
+        return false;
+    }
+
+    std::vector<uint8_t> prefix(static_cast<size_t>(highest - base));
+    long long read = reader_.ReadAt(base, prefix.data(), prefix.size());
+    if (read < 0 || static_cast<uint64_t>(read) != prefix.size()) {
+        return false;
+    }
+
+    // Second-fragment starts: free clusters after the lowest split whose class
+    // fits the format. Starts that follow an unfit cluster (where a foreign
+    // file or fill ends) are tried first.
+    std::vector<uint64_t> preferred;
+    std::vector<uint64_t> others;
+    const uint64_t first = lowest + cluster;
+    const uint64_t last = std::min(highest + options_.maxGap, reader_.Size());
+    const size_t maxCandidates = options_.maxTests;
+
+    auto fits = [&](uint8_t classes) {
+        uint8_t entropy = classes & kClusterEntropyMask;
+        if (entropy == kUnreadableCluster) {
+            return false;
+        }
+        if (kind == FragmentKind::Jpeg) {
+            return (classes & kClusterJpegClean) != 0 && (entropy >= kJpegEntropyFloor || (classes & kClusterJpegEnd) != 0);
+        }
+        return entropy >= kCompressedEntropyFloor;
+    };
+
+    // A JPEG tail is a run of clean clusters ending in one that holds EOI;
+    // starts inside a run that never reaches EOI are dropped.
+    std::vector<uint64_t> run;
+    bool previousFits = false;
+    auto flushRun = [&](bool terminated) {
+        if (terminated && !run.empty()) {
+            preferred.push_back(run.front());
+            others.insert(others.end(), run.begin() + 1, run.end());
+        } else {
+            counters.pruned += run.size();
+        }
+        run.clear();
+    };
+
+    for (uint64_t at = first; at < last || (!run.empty() && at < base + limit); at += cluster) {
+        if (preferred.size() + others.size() >= maxCandidates) {
+            break;
+        }
+        if (!InRanges(ranges, at, cluster)) {
+            flushRun(false);
+            previousFits = false;
+            if (at >= last) {
+                break;
+            }
+            ++counters.pruned;
+            continue;
+        }
+
+        uint8_t classes = cache_.Get(at / cluster);
+        bool ok = fits(classes);
+        if (kind == FragmentKind::Jpeg) {
+            if (!ok) {
+                flushRun(false);
+                if (at >= last) {
+                    break;
+                }
+                ++counters.pruned;
+                continue;
+            }
+            if (at < last) {
+                run.push_back(at);
+            }
+            if ((classes & kClusterJpegEnd) != 0) {
+                flushRun(true);
+            }
+            continue;
+        }
+
+        if (!ok) {
+            ++counters.pruned;
+        } else if (!previousFits) {
+            preferred.push_back(at);
+        } else {
+            others.push_back(at);
+        }
+        previousFits = ok;
+    }
+    flushRun(false);
+
+    preferred.insert(preferred.end(), others.begin(), others.end());
+
+    // Where the data turns from fitting to unfit clusters (text, fill) the
+    // split is almost certainly there, wherever it falls in the suspect
+    // range; after those, the boundaries closest to the failure.
+    std::vector<uint64_t> splits;
+    for (uint64_t at = lowest; at <= highest && splits.size() < kMaxSplits; at += cluster) {
+        if (at - cluster > base && !fits(cache_.Get(at / cluster)) && fits(cache_.Get(at / cluster - 1))) {
+            splits.push_back(at);
+        }
+    }
+    const size_t transitions = splits.size();
+    for (uint64_t at = highest; at >= lowest && splits.size() < transitions + kMaxSplits; at -= cluster) {
+        if (std::find(splits.begin(), splits.begin() + static_cast<std::ptrdiff_t>(transitions), at) ==
+            splits.begin() + static_cast<std::ptrdiff_t>(transitions)) {
+            splits.push_back(at);
+        }
+    }
+
+    ChunkView view{ &reader_, base, prefix.data(), prefix.size(), prefix.size() };
+    CarveByteSource source(view, 0);
+    source.SetCheckpoints(&checkpoints, cluster);
+    uint32_t tests = 0;
+
+    for (uint64_t start : preferred) {
+        for (uint64_t split : splits) {
+            if (start < split + cluster) {
+                continue;
+            }
+            if (tests >= options_.maxTests) {
+                counters.tests += tests;
+                return false;
+            }
+            ++tests;
+
+            const uint64_t logicalSplit = split - base;
+            const uint64_t gap = start - split;
+            source.SetFragmentGap(logicalSplit, gap);
+            FormatVerdict candidate{};
+            if (!signature.walker(source, limit, candidate) || !candidate.complete || candidate.length <= logicalSplit) {
+                continue;
+            }
+            if (!InRanges(ranges, start, candidate.length - logicalSplit)) {
+                continue;
+            }
+
+            hit.length = candidate.length;
+            hit.complete = true;
+            hit.confidence = candidate.confidence >= kValidatedConfidence ? static_cast<uint8_t>(candidate.confidence - 8)
+                                                                         : static_cast<uint8_t>(candidate.confidence / 2);
+            if (candidate.extension) {
+                hit.extension = candidate.extension;
+            }
+            hit.fragmentLength = logicalSplit;
+            hit.gap = gap;
+            counters.tests += tests;
+            ++counters.repaired;
+            return true;
+        }
+    }
+
+    counters.tests += tests;
+    return false;
+}
+
+} // namespace usnscanner
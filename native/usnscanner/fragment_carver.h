@@ -0,0 +1,108 @@
+#pragma once
+
+#include "carver.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace usnscanner {
+
+// Class byte kept per cluster: low six bits hold the byte entropy in quarter
+// bits (kUnreadableCluster when the read failed), the top bits describe JPEG
+// entropy-coded data.
+const uint8_t kClusterEntropyMask = 0x3F;
+const uint8_t kUnreadableCluster = 0x3F;
+// Every 0xFF byte is followed by stuffing, fill, RSTn or EOI.
+const uint8_t kClusterJpegClean = 0x40;
+// Contains an EOI marker (bytes after it are not checked).
+const uint8_t kClusterJpegEnd = 0x80;
+
+// Entropy and format validity per cluster, computed once and shared by every
+// gap search that crosses the cluster. Clusters are classified in pages so one
+// read covers many neighbours.
+class ClusterClassCache {
+  public:
+    ClusterClassCache(VolumeReader &reader, uint32_t clusterSize, size_t maxPages);
+
+    uint8_t Get(uint64_t cluster);
+
+    uint64_t Hits() const { return hits_.load(); }
+    uint64_t Misses() const { return misses_.load(); }
+
+  private:
+    static const size_t kPageClusters = 64;
+    static const size_t kShards = 16;
+
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<uint64_t, std::array<uint8_t, kPageClusters>> pages;
+    };
+
+    void Classify(uint64_t page, std::array<uint8_t, kPageClusters> &classes);
+
+    VolumeReader &reader_;
+    uint32_t clusterSize_;
+    size_t maxPagesPerShard_;
+    std::array<Shard, kShards> shards_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+};
+
+struct BifragmentOptions {
+    // Fragments start on multiples of this (the volume cluster size).
+    uint32_t clusterSize;
+    // Largest hole searched between the two fragments.
+    uint64_t maxGap;
+    // Walker runs allowed per truncated hit.
+    uint32_t maxTests;
+    size_t threads;
+};
+
+struct BifragmentStats {
+    uint64_t candidates;
+    uint64_t repaired;
+    uint64_t tests;
+    uint64_t pruned;
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    double elapsedMs;
+};
+
+// Bifragment gap carving: a truncated hit whose walker located the point
+// where the data stopped validating is retried as header fragment + hole +
+// footer fragment. Split points come from the walker's suspect range and
+// second-fragment starts from free clusters whose cached class fits the
+// format, so only a handful of (split, gap) pairs reach the walker.
+class BifragmentCarver {
+  public:
+    BifragmentCarver(VolumeReader &reader, const std::vector<CarveSignature> &signatures, const BifragmentOptions &options);
+
+    // Repairs hits in place; `ranges` are the areas the second fragment may
+    // live in (the free space that was carved).
+    void Run(std::vector<CarveHit> &hits, const std::vector<ByteRange> &ranges);
+
+    const BifragmentStats &Stats() const { return stats_; }
+
+  private:
+    struct Counters {
+        uint64_t tests;
+        uint64_t pruned;
+        uint64_t repaired;
+    };
+
+    bool Repair(CarveHit &hit, const std::vector<ByteRange> &ranges, Counters &counters);
+
+    VolumeReader &reader_;
+    const std::vector<CarveSignature> &signatures_;
+    BifragmentOptions options_;
+    ClusterClassCache cache_;
+    BifragmentStats stats_;
+};
+
+} // namespace usnscanner
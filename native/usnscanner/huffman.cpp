@@ -0,0 +1,80 @@
+#include "huffman.h"
+
+#include <algorithm>
+
+namespace usnscanner {
+
+bool HuffmanDecoder::Build(const uint8_t *lengths, size_t count, unsigned maxLength) {
+    if (maxLength == 0 || maxLength > kMaxLength || count > 0xFFFF) {
+        return false;
+    }
+    maxLength_ = maxLength;
+    tableBits_ = std::min(kTableBits, maxLength);
+
+    std::fill(std::begin(counts_), std::end(counts_), 0);
+    for (size_t symbol = 0; symbol < count; ++symbol) {
+        if (lengths[symbol] > maxLength) {
+            return false;
+        }
+        ++counts_[lengths[symbol]];
+    }
+    counts_[0] = 0;
+
+    // Kraft sum in units of 2^-maxLength; more than 1 cannot be decoded.
+    uint32_t used = 0;
+    for (unsigned length = 1; length <= maxLength; ++length) {
+        used += static_cast<uint32_t>(counts_[length]) << (maxLength - length);
+    }
+    if (used > (1u << maxLength)) {
+        return false;
+    }
+
+    uint32_t code = 0;
+    uint16_t offset = 0;
+    for (unsigned length = 1; length <= maxLength; ++length) {
+        code = (code + counts_[length - 1]) << 1;
+        firstCode_[length] = code;
+        offsets_[length] = offset;
+        offset = static_cast<uint16_t>(offset + counts_[length]);
+    }
+
+    sorted_.assign(offset, 0);
+    std::vector<uint16_t> next(offsets_, offsets_ + maxLength + 1);
+    for (size_t symbol = 0; symbol < count; ++symbol) {
+        if (lengths[symbol] != 0) {
+            sorted_[next[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+        }
+    }
+
+    table_.assign(static_cast<size_t>(1) << tableBits_, 0);
+    for (unsigned length = 1; length <= tableBits_; ++length) {
+        for (uint16_t i = 0; i < counts_[length]; ++i) {
+            uint32_t symbolCode = firstCode_[length] + i;
+            uint16_t symbol = sorted_[offsets_[length] + i];
+            size_t first = static_cast<size_t>(symbolCode) << (tableBits_ - length);
+            size_t span = static_cast<size_t>(1) << (tableBits_ - length);
+            std::fill(table_.begin() + first, table_.begin() + first + span, static_cast<uint16_t>((symbol << 5) | length));
+        }
+    }
+    return true;
+}
+
+int HuffmanDecoder::Decode(uint32_t peek, unsigned &length) const {
+    uint16_t entry = table_[peek >> (maxLength_ - tableBits_)];
+    if (entry != 0) {
+        length = entry & 0x1F;
+        return entry >> 5;
+    }
+
+    for (unsigned bits = tableBits_ + 1; bits <= maxLength_; ++bits) {
+        uint32_t code = peek >> (maxLength_ - bits);
+        uint32_t index = code - firstCode_[bits];
+        if (code >= firstCode_[bits] && index < counts_[bits]) {
+            length = bits;
+            return sorted_[offsets_[bits] + index];
+        }
+    }
+    return -1;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace usnscanner {
+
+// Canonical Huffman decoder for the MSB-first codes used by XPRESS and LZX:
+// codes are assigned in order of length, then symbol value. Codes up to
+// kTableBits long resolve with one table lookup; longer ones fall back to a
+// per-length canonical search.
+class HuffmanDecoder {
+  public:
+    // Builds the code from per-symbol lengths (0 = unused). Rejects
+    // over-subscribed lengths; incomplete and empty codes are accepted and
+    // only fail when an unassigned code is decoded.
+    bool Build(const uint8_t *lengths, size_t count, unsigned maxLength);
+
+    // Decodes one symbol from `peek`, the next MaxLength() bits of the
+    // stream right-aligned. Returns -1 when no code matches.
+    int Decode(uint32_t peek, unsigned &length) const;
+
+    unsigned MaxLength() const { return maxLength_; }
+
+  private:
+    static constexpr unsigned kTableBits = 10;
+    static constexpr unsigned kMaxLength = 16;
+
+    unsigned maxLength_ = 0;
+    unsigned tableBits_ = 0;
+    // (symbol << 5) | length for codes of at most tableBits_ bits; 0 otherwise.
+    std::vector<uint16_t> table_;
+    uint32_t firstCode_[kMaxLength + 1] = {};
+    uint16_t counts_[kMaxLength + 1] = {};
+    uint16_t offsets_[kMaxLength + 1] = {};
+    std::vector<uint16_t> sorted_;
+};
+
+} // namespace usnscanner
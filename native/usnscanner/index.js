@@ -17,9 +17,9 @@ function loadBinding() {
 
 const binding = loadBinding();
 
-function scan(driveLetter) {
+function scan(driveLetter, options = {}) {
   return new Promise((resolve, reject) => {
-    binding.scan(driveLetter, (err, result) => {
+    binding.scan(driveLetter, options, (err, result) => {
       if (err) {
         reject(err);
       } else {
@@ -41,7 +41,7 @@ function getFileRecord(driveLetter, fileReference) {
   });
 }
 
-function recoverDataRuns(driveLetter, runs, clusterSize, fileSize, outputPath) {
+function recoverDataRuns(driveLetter, runs, clusterSize, fileSize, outputPath, options = {}) {
   return new Promise((resolve, reject) => {
     binding.recoverDataRuns(
       driveLetter,
@@ -49,19 +49,276 @@ function recoverDataRuns(driveLetter, runs, clusterSize, fileSize, outputPath) {
       String(clusterSize),
       String(fileSize),
       outputPath,
-      (err) => {
+      options,
+      (err, result) => {
         if (err) {
           reject(err);
         } else {
-          resolve();
+          resolve(result);
         }
       }
     );
   });
 }
 
+function carve(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.carve(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function scanIndexSlack(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.scanIndexSlack(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function parseLogFile(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.parseLogFile(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function decompressWof(stream, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.decompressWof(stream, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+// Expands one NTFS compression unit (unitSize bytes) from the clusters
+// allocated to it. Returns { data, corrupt }.
+function decodeCompressionUnit(stored, unitSize) {
+  return binding.decodeCompressionUnit(stored, unitSize);
+}
+
+function extractResident(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.extractResident(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function scanDeletedTree(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.scanDeletedTree(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function scanAll(volumes, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.scanAll(volumes, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function expandTree(scanId, nodeId, options = {}) {
+  return binding.expandTree(scanId, nodeId, options);
+}
+
+// Identical scan(), scanDeletedTree() and scanAll() calls made while one is
+// running share its enumeration; these are the counters for that.
+function scanDedupStats() {
+  return binding.scanDedupStats();
+}
+
+// Caps the bandwidth and operation rate of every native read in the process
+// (0 or absent lifts a cap) and optionally drops it to background priority.
+// Returns the limits in force with the counters of ioThrottleStats().
+function setIoLimits(limits = {}) {
+  return binding.setIoLimits(limits);
+}
+
+function ioThrottleStats() {
+  return binding.ioThrottleStats();
+}
+
+function releaseScan(scanId) {
+  return binding.releaseScan(scanId);
+}
+
+function aggregate(scanId, groupBy, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.aggregate(scanId, groupBy, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function exportResults(scanId, format, path, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.exportResults(scanId, format, path, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function recoverTree(scanId, nodeId, outputDir, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.recoverTree(scanId, nodeId, outputDir, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+// Times a drive or image and returns the read profile it measured, next to
+// the device class the OS reports.
+function probeIo(source) {
+  return new Promise((resolve, reject) => {
+    binding.probeIo(source, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function analyzeDeletions(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.analyzeDeletions(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function buildTimeline(source, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.buildTimeline(source, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function saveSnapshot(source, path) {
+  return new Promise((resolve, reject) => {
+    binding.saveSnapshot(source, path, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+function diffSnapshots(oldPath, newPath, options = {}) {
+  return new Promise((resolve, reject) => {
+    binding.diffSnapshots(oldPath, newPath, options, (err, result) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+// Follows the change journal of a drive or a (growing) $J copy and calls
+// onEvents with each batch of new deletions. stop() ends the watch and
+// returns its counters; after an error the watch stops itself.
+function watch(source, options = {}) {
+  const { onEvents, onError, ...watchOptions } = options;
+  const id = binding.watch(source, watchOptions, (err, events) => {
+    if (err) {
+      binding.unwatch(id);
+      if (onError) {
+        onError(err);
+      }
+    } else if (onEvents) {
+      onEvents(events);
+    }
+  });
+  return {
+    id,
+    stop: () => binding.unwatch(id),
+  };
+}
+
 module.exports = {
   scan,
+  scanDedupStats,
   getFileRecord,
   recoverDataRuns,
+  carve,
+  scanIndexSlack,
+  parseLogFile,
+  decompressWof,
+  decodeCompressionUnit,
+  extractResident,
+  scanDeletedTree,
+  scanAll,
+  expandTree,
+  releaseScan,
+  aggregate,
+  exportResults,
+  recoverTree,
+  probeIo,
+  analyzeDeletions,
+  buildTimeline,
+  saveSnapshot,
+  diffSnapshots,
+  watch,
+  setIoLimits,
+  ioThrottleStats,
 };
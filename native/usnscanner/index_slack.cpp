@@ -0,0 +1,356 @@
+#include "index_slack.h"
+#include "work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+namespace usnscanner {
+
+namespace {
+
+const uint32_t kIndexMagic = 0x58444E49; // 'INDX'
+const uint32_t kAttributeIndexRoot = 0x90;
+const uint32_t kAttributeIndexAllocation = 0xA0;
+const uint64_t kRootDirectory = 5;
+const uint8_t kRecordInUse = 0x01;
+const uint8_t kRecordIsDirectory = 0x02;
+const uint16_t kEntryLast = 0x0002;
+// Fixed part of a $FILE_NAME key before the name itself.
+const size_t kFileNameHeader = 66;
+const size_t kEntryHeader = 16;
+const size_t kIndexReadBlock = 1024 * 1024;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t Align8(size_t value) {
+    return (value + 7) & ~static_cast<size_t>(7);
+}
+
+bool PlausibleTime(uint64_t value, uint64_t notAfter) {
+    return value >= kFileTimeFloor && value <= notAfter;
+}
+
+bool PlausibleName(const uint8_t *name, size_t characters) {
+    for (size_t i = 0; i < characters; ++i) {
+        uint16_t unit = Load<uint16_t>(name + i * 2);
+        if (unit < 0x20 || unit == '/' || unit == '\\') {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+IndexSlackScanner::IndexSlackScanner(VolumeReader &reader, const IndexSlackOptions &options)
+    : reader_(reader), options_(options), clusterSize_(0), stats_{} {}
+
+bool IndexSlackScanner::Run(std::string &error) {
+    stats_ = IndexSlackStats{};
+    hits_.clear();
+    directoryNames_.clear();
+
+    MftReader mft(reader_);
+    if (!mft.Open(error)) {
+        return false;
+    }
+    clusterSize_ = mft.Geometry().clusterSize;
+    sequences_.assign(static_cast<size_t>(mft.RecordCount()), 0);
+    flags_.assign(static_cast<size_t>(mft.RecordCount()), 0);
+
+    // Pass 1: index geometry and allocation runs per directory. Large
+    // directories keep $INDEX_ALLOCATION in extension records, so pieces are
+    // gathered under the base record number.
+    auto sweepStart = std::chrono::steady_clock::now();
+    std::map<uint64_t, Directory> directories;
+    FileRecordDetails details{};
+    bool swept = mft.Sweep([&](uint64_t recordNumber, const uint8_t *record, uint32_t size) {
+        const FileRecordHeader *header = reinterpret_cast<const FileRecordHeader *>(record);
+        sequences_[recordNumber] = header->SequenceNumber;
+        flags_[recordNumber] = static_cast<uint8_t>(header->Flags & 0xFF);
+        ++stats_.records;
+        if ((header->Flags & kRecordInUse) == 0 || !ParseFileRecord(record, size, details)) {
+            return;
+        }
+
+        uint64_t owner = ReferenceRecordNumber(details.baseReference);
+        if (owner == 0) {
+            owner = recordNumber;
+        }
+
+        for (const auto &attribute : details.attributes) {
+            if (attribute.type == kAttributeFileName && !attribute.nonResident && owner == recordNumber && details.isDirectory) {
+                FileNameInfo name{};
+                if (!ParseFileName(attribute.residentData, name)) {
+                    continue;
+                }
+                int rank = NamespaceRank(name.nameSpace);
+                auto it = directoryNames_.find(recordNumber);
+                if (it == directoryNames_.end() || rank < it->second.rank) {
+                    directoryNames_[recordNumber] = { ReferenceRecordNumber(name.parentReference), name.name, rank };
+                }
+            } else if (attribute.name == "$I30" && attribute.type == kAttributeIndexRoot && attribute.residentData.size() >= 16) {
+                Directory &directory = directories[owner];
+                directory.record = owner;
+                directory.blockSize = Load<uint32_t>(attribute.residentData.data() + 8);
+            } else if (attribute.name == "$I30" && attribute.type == kAttributeIndexAllocation && attribute.nonResident) {
+                Directory &directory = directories[owner];
+                directory.record = owner;
+                directory.runs.insert(directory.runs.end(), attribute.runs.begin(), attribute.runs.end());
+            }
+        }
+    }, error);
+    if (!swept) {
+        return false;
+    }
+    stats_.sweepMs = MillisecondsSince(sweepStart);
+
+    std::vector<Directory> work;
+    work.reserve(directories.size());
+    for (auto &entry : directories) {
+        Directory &directory = entry.second;
+        uint8_t flags = directory.record < flags_.size() ? flags_[directory.record] : 0;
+        if ((flags & kRecordIsDirectory) == 0 || directory.runs.empty() ||
+            directory.blockSize < 512 || directory.blockSize > 65536 || (directory.blockSize & (directory.blockSize - 1)) != 0) {
+            continue;
+        }
+        directory.sequence = sequences_[directory.record];
+        std::sort(directory.runs.begin(), directory.runs.end(), [](const DataRunSegment &a, const DataRunSegment &b) {
+            return a.vcnStart < b.vcnStart;
+        });
+        work.push_back(std::move(directory));
+    }
+    stats_.directories = work.size();
+
+    // Directories in on-disk order so the pool's ascending blocks read forward.
+    auto firstLcn = [](const Directory &directory) {
+        for (const auto &run : directory.runs) {
+            if (!run.sparse) {
+                return run.lcn;
+            }
+        }
+        return static_cast<long long>(0);
+    };
+    std::sort(work.begin(), work.end(), [&](const Directory &a, const Directory &b) {
+        return firstLcn(a) < firstLcn(b);
+    });
+
+    // Pass 2: INDX buffers, parallel across directories.
+    auto indexStart = std::chrono::steady_clock::now();
+    WorkStealingPool pool(options_.threads != 0 ? options_.threads : DefaultWorkerCount(8));
+    std::vector<std::vector<IndexEntryHit>> workerHits(pool.ThreadCount());
+    std::vector<IndexSlackStats> workerStats(pool.ThreadCount(), IndexSlackStats{});
+    std::vector<std::vector<uint8_t>> buffers(pool.ThreadCount());
+
+    pool.Run(work.size(), [&](size_t task, size_t worker) {
+        const Directory &directory = work[task];
+        std::vector<uint8_t> &pending = buffers[worker];
+        pending.clear();
+        uint64_t pendingOffset = 0;
+
+        // Blocks are consecutive in VCN order and may straddle runs when
+        // clusters are smaller than an index block.
+        for (const auto &run : directory.runs) {
+            if (run.sparse || run.lcn < 0 || run.length <= 0) {
+                pending.clear();
+                continue;
+            }
+            uint64_t start = static_cast<uint64_t>(run.lcn) * clusterSize_;
+            uint64_t length = static_cast<uint64_t>(run.length) * clusterSize_;
+            for (uint64_t done = 0; done < length;) {
+                size_t want = static_cast<size_t>(std::min<uint64_t>(length - done, kIndexReadBlock));
+                size_t base = pending.size();
+                if (base == 0) {
+                    pendingOffset = start + done;
+                }
+                pending.resize(base + want);
+                long long read = reader_.ReadAt(start + done, pending.data() + base, want);
+                if (read != static_cast<long long>(want)) {
+                    pending.clear();
+                    break;
+                }
+                done += want;
+
+                size_t blocks = pending.size() / directory.blockSize;
+                for (size_t i = 0; i < blocks; ++i) {
+                    ParseBlock(directory, pending.data() + i * directory.blockSize, pendingOffset + i * directory.blockSize,
+                               workerHits[worker], workerStats[worker]);
+                }
+                size_t used = blocks * directory.blockSize;
+                pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(used));
+                pendingOffset += used;
+            }
+        }
+    });
+
+    for (size_t i = 0; i < workerHits.size(); ++i) {
+        hits_.insert(hits_.end(), workerHits[i].begin(), workerHits[i].end());
+        stats_.blocks += workerStats[i].blocks;
+        stats_.tornBlocks += workerStats[i].tornBlocks;
+        stats_.liveEntries += workerStats[i].liveEntries;
+        stats_.stillLive += workerStats[i].stillLive;
+    }
+
+    // The same removed key often survives in several blocks after splits and
+    // merges; one copy per (directory, file, name) is enough.
+    auto key = [](const IndexEntryHit &hit) {
+        return std::tie(hit.directory, hit.slack, hit.fileRef, hit.fileName.name);
+    };
+    std::sort(hits_.begin(), hits_.end(), [&](const IndexEntryHit &a, const IndexEntryHit &b) {
+        if (key(a) != key(b)) {
+            return key(a) < key(b);
+        }
+        return a.offset < b.offset;
+    });
+    hits_.erase(std::unique(hits_.begin(), hits_.end(), [&](const IndexEntryHit &a, const IndexEntryHit &b) {
+        return key(a) == key(b);
+    }), hits_.end());
+    stats_.slackEntries = static_cast<uint64_t>(std::count_if(hits_.begin(), hits_.end(), [](const IndexEntryHit &hit) {
+        return hit.slack;
+    }));
+    stats_.indexMs = MillisecondsSince(indexStart);
+    return true;
+}
+
+void IndexSlackScanner::ParseBlock(const Directory &directory, uint8_t *block, uint64_t offset, std::vector<IndexEntryHit> &out, IndexSlackStats &stats) const {
+    const uint32_t size = directory.blockSize;
+    if (Load<uint32_t>(block) != kIndexMagic) {
+        return;
+    }
+    ++stats.blocks;
+
+    uint16_t usaCount = Load<uint16_t>(block + 6);
+    uint32_t stride = usaCount > 1 ? size / (usaCount - 1u) : 0;
+    if (stride < 256 || stride * (usaCount - 1u) != size || !ApplyFixups(block, size, stride)) {
+        ++stats.tornBlocks;
+        return;
+    }
+
+    // INDEX_HEADER at 0x18; its offsets are relative to itself.
+    const size_t headerStart = 0x18;
+    size_t entries = headerStart + Load<uint32_t>(block + 0x18);
+    size_t inUse = std::min<size_t>(headerStart + Load<uint32_t>(block + 0x1C), size);
+    size_t allocated = std::min<size_t>(headerStart + Load<uint32_t>(block + 0x20), size);
+    if (entries >= inUse || inUse > allocated) {
+        return;
+    }
+
+    std::vector<uint8_t> value;
+    for (size_t position = entries; position + kEntryHeader <= inUse;) {
+        uint16_t entryLength = Load<uint16_t>(block + position + 8);
+        uint16_t keyLength = Load<uint16_t>(block + position + 10);
+        uint16_t flags = Load<uint16_t>(block + position + 12);
+        if (entryLength < kEntryHeader || position + entryLength > inUse || (flags & kEntryLast) != 0) {
+            break;
+        }
+        if (keyLength >= kFileNameHeader && kEntryHeader + keyLength <= entryLength) {
+            ++stats.liveEntries;
+            if (options_.includeLive) {
+                IndexEntryHit hit{};
+                value.assign(block + position + kEntryHeader, block + position + kEntryHeader + keyLength);
+                if (ParseFileName(value, hit.fileName)) {
+                    hit.directory = directory.record;
+                    hit.fileRef = Load<uint64_t>(block + position);
+                    hit.slack = false;
+                    hit.offset = offset + position + kEntryHeader;
+                    out.push_back(std::move(hit));
+                }
+            }
+        }
+        position += entryLength;
+    }
+
+    // Slack: keys left behind when entries were removed or shifted. Only keys
+    // whose parent reference is this directory are believed.
+    const uint64_t parent = directory.record | (static_cast<uint64_t>(directory.sequence) << 48);
+    const uint64_t notAfter = CurrentFileTime() + kFileTimeTicksPerDay;
+    for (size_t position = Align8(inUse); position + kFileNameHeader <= allocated;) {
+        if (Load<uint64_t>(block + position) != parent) {
+            position += 8;
+            continue;
+        }
+
+        size_t characters = block[position + 64];
+        uint8_t nameSpace = block[position + 65];
+        size_t keyLength = kFileNameHeader + characters * 2;
+        if (characters == 0 || nameSpace > 3 || position + keyLength > allocated ||
+            !PlausibleName(block + position + kFileNameHeader, characters)) {
+            position += 8;
+            continue;
+        }
+
+        IndexEntryHit hit{};
+        value.assign(block + position, block + position + keyLength);
+        if (!ParseFileName(value, hit.fileName) ||
+            !PlausibleTime(hit.fileName.created, notAfter) || !PlausibleTime(hit.fileName.mftModified, notAfter)) {
+            position += 8;
+            continue;
+        }
+
+        // The entry header (file reference) is trusted only when its lengths
+        // still describe this key.
+        if (position >= kEntryHeader) {
+            uint16_t entryLength = Load<uint16_t>(block + position - 8);
+            uint16_t storedKeyLength = Load<uint16_t>(block + position - 6);
+            size_t expected = Align8(kEntryHeader + keyLength);
+            uint64_t reference = Load<uint64_t>(block + position - kEntryHeader);
+            if (storedKeyLength == keyLength && (entryLength == expected || entryLength == expected + 8) &&
+                ReferenceSequence(reference) != 0 && ReferenceRecordNumber(reference) < flags_.size()) {
+                hit.fileRef = reference;
+            }
+        }
+
+        uint64_t fileRecord = ReferenceRecordNumber(hit.fileRef);
+        bool known = hit.fileRef != 0 && fileRecord < flags_.size();
+        bool inUse = known && (flags_[fileRecord] & kRecordInUse) != 0;
+        if (inUse && sequences_[fileRecord] == ReferenceSequence(hit.fileRef)) {
+            ++stats.stillLive;
+        } else {
+            hit.slotReused = known && SlotReused(hit.fileRef, sequences_[fileRecord], inUse);
+            hit.directory = directory.record;
+            hit.slack = true;
+            hit.offset = offset + position;
+            out.push_back(std::move(hit));
+        }
+        position += Align8(keyLength);
+    }
+}
+
+std::string IndexSlackScanner::DirectoryPath(uint64_t directory) const {
+    std::vector<const std::string *> segments;
+    uint64_t current = directory;
+    bool rooted = false;
+    for (int guard = 0; guard < 1024; ++guard) {
+        if (current == kRootDirectory) {
+            rooted = true;
+            break;
+        }
+        auto it = directoryNames_.find(current);
+        if (it == directoryNames_.end() || it->second.parent == current) {
+            break;
+        }
+        segments.push_back(&it->second.name);
+        current = it->second.parent;
+    }
+
+    std::string path = rooted ? std::string() : std::string("\\$Orphan");
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        path.push_back('\\');
+        path += **it;
+    }
+    return path;
+}
+
+} // namespace usnscanner
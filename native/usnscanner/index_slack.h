@@ -0,0 +1,94 @@
+#pragma once
+
+#include "mft_reader.h"
+#include "ntfs_record.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace usnscanner {
+
+// One $FILE_NAME key found in a directory's $I30 index.
+struct IndexEntryHit {
+    // Directory record number (no sequence).
+    uint64_t directory;
+    // 0 when the entry header in front of a slack key was overwritten.
+    uint64_t fileRef;
+    FileNameInfo fileName;
+    // Found past the index's in-use length, i.e. a removed entry.
+    bool slack;
+    // The file's MFT slot has since been given to another file.
+    bool slotReused;
+    // Volume byte offset of the key.
+    uint64_t offset;
+};
+
+struct IndexSlackOptions {
+    size_t threads;
+    // Also return the live entries of every index.
+    bool includeLive;
+};
+
+struct IndexSlackStats {
+    uint64_t records;
+    uint64_t directories;
+    uint64_t blocks;
+    uint64_t tornBlocks;
+    uint64_t liveEntries;
+    uint64_t slackEntries;
+    // Slack keys whose file still exists under the same reference (the entry
+    // only moved when the B+ tree was rebalanced).
+    uint64_t stillLive;
+    double sweepMs;
+    double indexMs;
+};
+
+// Bulk $I30 reader: one MFT sweep collects every directory's index geometry
+// and $INDEX_ALLOCATION runs, then INDX buffers are read and parsed in
+// parallel across directories. Slack keys are accepted only when their parent
+// reference names the directory being parsed.
+class IndexSlackScanner {
+  public:
+    IndexSlackScanner(VolumeReader &reader, const IndexSlackOptions &options);
+
+    bool Run(std::string &error);
+
+    const std::vector<IndexEntryHit> &Hits() const { return hits_; }
+    const IndexSlackStats &Stats() const { return stats_; }
+
+    // Path of a directory below the root ("" for the root itself, "\\a\\b"
+    // otherwise), from the names collected during the sweep.
+    std::string DirectoryPath(uint64_t directory) const;
+
+  private:
+    struct Directory {
+        uint64_t record;
+        uint16_t sequence;
+        uint32_t blockSize;
+        std::vector<DataRunSegment> runs;
+    };
+
+    struct Name {
+        uint64_t parent;
+        std::string name;
+        int rank;
+    };
+
+    void ParseBlock(const Directory &directory, uint8_t *block, uint64_t offset, std::vector<IndexEntryHit> &out, IndexSlackStats &stats) const;
+
+    VolumeReader &reader_;
+    IndexSlackOptions options_;
+    uint32_t clusterSize_;
+    // Per MFT record: sequence number and header flags (in use, directory).
+    std::vector<uint16_t> sequences_;
+    std::vector<uint8_t> flags_;
+    std::unordered_map<uint64_t, Name> directoryNames_;
+    std::vector<IndexEntryHit> hits_;
+    IndexSlackStats stats_;
+};
+
+} // namespace usnscanner
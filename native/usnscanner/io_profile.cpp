@@ -0,0 +1,271 @@
+#include "io_profile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fstream>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace usnscanner {
+
+namespace {
+
+const uint64_t kMiB = 1024 * 1024;
+// A random read this slow means a head moved.
+const double kRotationalLatencyMs = 2.0;
+const size_t kLatencyReads = 48;
+const size_t kSequentialReads = 32;
+const uint64_t kProbeReadSize = 1 * kMiB;
+const uint64_t kDepthReadSize = 256 * 1024;
+// Each depth is measured for this long, so a fast device is not judged by a
+// handful of reads.
+const auto kDepthWindow = std::chrono::milliseconds(100);
+const size_t kMaxProbeDepth = 32;
+// A deeper queue has to buy this much more throughput to be worth it.
+const double kDepthGain = 1.1;
+const uint64_t kMinProbeSource = 64 * kMiB;
+const auto kProbeBudget = std::chrono::milliseconds(1500);
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Random offset, 4 KiB aligned, with room for length bytes after it.
+uint64_t RandomOffset(std::mt19937_64 &random, uint64_t size, uint64_t length) {
+    const uint64_t slots = (size - length) / 4096;
+    return std::uniform_int_distribution<uint64_t>(0, slots)(random) * 4096;
+}
+
+std::string ProbeReadError(unsigned long code) {
+    return "Probe read failed with error " + std::to_string(code);
+}
+
+} // namespace
+
+IoProfile DefaultIoProfile(DeviceClass deviceClass) {
+    switch (deviceClass) {
+        case DeviceClass::Rotational:
+            return { deviceClass, IoProfileBasis::Default, 8 * kMiB, 1 * kMiB, 1 };
+        case DeviceClass::SolidState:
+            return { deviceClass, IoProfileBasis::Default, 1 * kMiB, 32 * 1024, 16 };
+        default:
+            return { DeviceClass::Unknown, IoProfileBasis::Default, 4 * kMiB, 64 * 1024, 4 };
+    }
+}
+
+#ifdef _WIN32
+bool DetectDeviceClass(VolumeReader &reader, DeviceClass &deviceClass, std::string &error) {
+    deviceClass = DeviceClass::Unknown;
+    // The storage stack answers for the disk under a volume; an image file
+    // has no such disk of its own.
+    if (!reader.IsVolume()) {
+        return true;
+    }
+    STORAGE_PROPERTY_QUERY query{};
+    query.PropertyId = StorageDeviceSeekPenaltyProperty;
+    query.QueryType = PropertyStandardQuery;
+    DEVICE_SEEK_PENALTY_DESCRIPTOR penalty{};
+    unsigned long returned = 0;
+    if (!reader.Ioctl(IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query), &penalty, sizeof(penalty), returned)) {
+        // Volumes spanning several disks do not answer.
+        if (VolumeReader::LastError() == ERROR_INVALID_FUNCTION || VolumeReader::LastError() == ERROR_NOT_SUPPORTED) {
+            return true;
+        }
+        error = "IOCTL_STORAGE_QUERY_PROPERTY failed with error " + std::to_string(VolumeReader::LastError());
+        return false;
+    }
+    if (returned >= sizeof(penalty)) {
+        deviceClass = penalty.IncursSeekPenalty ? DeviceClass::Rotational : DeviceClass::SolidState;
+    }
+    return true;
+}
+#else
+bool DetectDeviceClass(VolumeReader &reader, DeviceClass &deviceClass, std::string &error) {
+    deviceClass = DeviceClass::Unknown;
+    std::vector<std::string> devices;
+    if (!reader.PhysicalDevices(devices, error)) {
+        return false;
+    }
+    for (const std::string &device : devices) {
+        std::ifstream flag("/sys/block/" + device + "/queue/rotational");
+        int rotational = -1;
+        if (!(flag >> rotational)) {
+            continue;
+        }
+        if (rotational == 1) {
+            deviceClass = DeviceClass::Rotational;
+            return true;
+        }
+        deviceClass = DeviceClass::SolidState;
+    }
+    return true;
+}
+#endif
+
+bool ProbeIoProfile(VolumeReader &reader, IoProbe &probe, IoProfile &profile, std::string &error) {
+    probe = IoProbe{};
+    const uint64_t size = reader.Size();
+    if (size < kMinProbeSource) {
+        error = "The source is too small to probe";
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::mt19937_64 random(static_cast<uint64_t>(start.time_since_epoch().count()));
+    std::vector<uint8_t> buffer(static_cast<size_t>(kProbeReadSize));
+
+    // Latency of the smallest read the device takes, each at a fresh spot.
+    const size_t sector = std::max<size_t>(reader.SectorSize(), 4096);
+    std::vector<double> latencies;
+    for (size_t i = 0; i < kLatencyReads; ++i) {
+        const auto readStart = std::chrono::steady_clock::now();
+        if (reader.ReadAt(RandomOffset(random, size, sector), buffer.data(), sector) < 0) {
+            error = ProbeReadError(VolumeReader::LastError());
+            return false;
+        }
+        latencies.push_back(MillisecondsSince(readStart));
+    }
+    std::nth_element(latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end());
+    probe.randomReadMs = latencies[latencies.size() / 2];
+
+    const uint64_t sequentialStart = RandomOffset(random, size, kSequentialReads * kProbeReadSize);
+    const auto sequentialClock = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kSequentialReads; ++i) {
+        if (reader.ReadAt(sequentialStart + i * kProbeReadSize, buffer.data(), buffer.size()) < 0) {
+            error = ProbeReadError(VolumeReader::LastError());
+            return false;
+        }
+    }
+    const double sequentialMs = std::max(MillisecondsSince(sequentialClock), 0.001);
+    probe.sequentialMegabytesPerSecond = static_cast<double>(kSequentialReads * kProbeReadSize) / kMiB / (sequentialMs / 1000);
+
+    const DeviceClass deviceClass = probe.randomReadMs >= kRotationalLatencyMs ? DeviceClass::Rotational : DeviceClass::SolidState;
+    profile = DefaultIoProfile(deviceClass);
+    profile.basis = IoProfileBasis::Probe;
+
+    // Reading through a gap is worth it while it costs less than the random
+    // read it saves.
+    const double gapBytes = probe.randomReadMs / 1000 * probe.sequentialMegabytesPerSecond * kMiB;
+    profile.gatherGap = std::min<uint64_t>(std::max<uint64_t>(static_cast<uint64_t>(gapBytes), 16 * 1024), profile.readSize / 4) / 4096 * 4096;
+
+    // A disk that seeks only gets slower with more streams; anything else
+    // gets the depth past which doubling stops paying.
+    if (deviceClass == DeviceClass::SolidState) {
+        double best = 0;
+        size_t bestDepth = 1;
+        for (size_t depth = 1; depth <= kMaxProbeDepth && std::chrono::steady_clock::now() - start < kProbeBudget; depth *= 2) {
+            // LastError() belongs to the stream that failed.
+            std::atomic<bool> failed(false);
+            std::atomic<unsigned long> failure(0);
+            std::atomic<uint64_t> bytes(0);
+            const uint64_t seed = random();
+            const auto depthStart = std::chrono::steady_clock::now();
+            std::vector<std::thread> streams;
+            for (size_t stream = 0; stream < depth; ++stream) {
+                streams.emplace_back([&, stream] {
+                    std::mt19937_64 streamRandom(seed + stream);
+                    std::vector<uint8_t> streamBuffer(static_cast<size_t>(kDepthReadSize));
+                    while (!failed && std::chrono::steady_clock::now() - depthStart < kDepthWindow) {
+                        if (reader.ReadAt(RandomOffset(streamRandom, size, kDepthReadSize), streamBuffer.data(), streamBuffer.size()) < 0) {
+                            failure = VolumeReader::LastError();
+                            failed = true;
+                            return;
+                        }
+                        bytes += kDepthReadSize;
+                    }
+                });
+            }
+            for (std::thread &thread : streams) {
+                thread.join();
+            }
+            if (failed) {
+                error = ProbeReadError(failure);
+                return false;
+            }
+            const double depthMs = std::max(MillisecondsSince(depthStart), 0.001);
+            const double throughput = static_cast<double>(bytes.load()) / kMiB / (depthMs / 1000);
+            probe.depths.push_back({ depth, throughput });
+            if (throughput < best * kDepthGain) {
+                break;
+            }
+            best = throughput;
+            bestDepth = depth;
+        }
+        profile.queueDepth = bestDepth;
+    }
+
+    probe.elapsedMs = MillisecondsSince(start);
+    return true;
+}
+
+IoProfile SelectIoProfile(VolumeReader &reader, IoProfileMode mode) {
+    IoProfile profile{};
+    std::string error;
+    switch (mode) {
+        case IoProfileMode::Rotational:
+            profile = DefaultIoProfile(DeviceClass::Rotational);
+            profile.basis = IoProfileBasis::Override;
+            return profile;
+        case IoProfileMode::SolidState:
+            profile = DefaultIoProfile(DeviceClass::SolidState);
+            profile.basis = IoProfileBasis::Override;
+            return profile;
+        case IoProfileMode::Probe: {
+            IoProbe probe;
+            if (ProbeIoProfile(reader, probe, profile, error)) {
+                return profile;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    DeviceClass deviceClass = DeviceClass::Unknown;
+    if (DetectDeviceClass(reader, deviceClass, error) && deviceClass != DeviceClass::Unknown) {
+        profile = DefaultIoProfile(deviceClass);
+        profile.basis = IoProfileBasis::Detected;
+        return profile;
+    }
+    return DefaultIoProfile(DeviceClass::Unknown);
+}
+
+const char *DeviceClassName(DeviceClass deviceClass) {
+    switch (deviceClass) {
+        case DeviceClass::Rotational: return "rotational";
+        case DeviceClass::SolidState: return "ssd";
+        default: return "unknown";
+    }
+}
+
+const char *IoProfileBasisName(IoProfileBasis basis) {
+    switch (basis) {
+        case IoProfileBasis::Detected: return "detected";
+        case IoProfileBasis::Override: return "override";
+        case IoProfileBasis::Probe: return "probe";
+        default: return "default";
+    }
+}
+
+bool ParseIoProfileMode(const std::string &text, IoProfileMode &mode) {
+    if (text == "auto") {
+        mode = IoProfileMode::Detect;
+    } else if (text == "rotational") {
+        mode = IoProfileMode::Rotational;
+    } else if (text == "ssd") {
+        mode = IoProfileMode::SolidState;
+    } else if (text == "probe") {
+        mode = IoProfileMode::Probe;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+enum class DeviceClass : uint8_t {
+    Unknown,
+    Rotational,
+    SolidState
+};
+
+// How a profile was arrived at.
+enum class IoProfileBasis : uint8_t {
+    Default,
+    Detected,
+    Override,
+    Probe
+};
+
+// How reads against one device are shaped.
+struct IoProfile {
+    DeviceClass deviceClass;
+    IoProfileBasis basis;
+    // Largest single read, and how far apart two extents may be and still
+    // share one (the gap is read through and discarded).
+    uint64_t readSize;
+    uint64_t gatherGap;
+    // Reads kept in flight at once. Reads are synchronous, so this is also
+    // the number of reading threads.
+    size_t queueDepth;
+};
+
+// What the caller asks for: the device class from the OS, a class named
+// outright (the only way to classify an image on a disk the OS will not
+// describe), or a measurement.
+enum class IoProfileMode : uint8_t {
+    Detect,
+    Rotational,
+    SolidState,
+    Probe
+};
+
+struct IoProbeDepth {
+    size_t depth;
+    double megabytesPerSecond;
+};
+
+struct IoProbe {
+    // Median latency of single-sector-sized reads at random offsets.
+    double randomReadMs;
+    // One stream of whole read-size reads from a random start.
+    double sequentialMegabytesPerSecond;
+    // Random read-size reads at doubling queue depths, until the gain stalls.
+    std::vector<IoProbeDepth> depths;
+    double elapsedMs;
+};
+
+// Rotational disks get long reads, a wide gather gap and one stream, so the
+// head sweeps the disk once; solid-state devices get moderate reads and a
+// deep queue. Unknown keeps the middle ground used before profiles existed.
+IoProfile DefaultIoProfile(DeviceClass deviceClass);
+
+// Asks the OS whether the disks under the source seek: the rotational flag
+// of every backing disk in /sys/block on Linux, the seek penalty of a live
+// volume on Windows. A source on any rotational disk is rotational. Unknown
+// (with a true return) when no disk says either way.
+bool DetectDeviceClass(VolumeReader &reader, DeviceClass &deviceClass, std::string &error);
+
+// Times the source for about a second and builds a profile from what it
+// measured: rotational when a random read costs milliseconds, a gather gap of
+// as many bytes as the device streams in the time of one random read, and the
+// queue depth past which throughput stops growing. Reads hit whatever cache
+// sits in front of the device, so a cached image profiles as fast as its
+// cache, and count against the I/O limits, so probe before setting any.
+bool ProbeIoProfile(VolumeReader &reader, IoProbe &probe, IoProfile &profile, std::string &error);
+
+// Resolves a mode to a profile. Never fails: a failed detection or probe
+// falls back to the next weaker answer, down to the Unknown default.
+IoProfile SelectIoProfile(VolumeReader &reader, IoProfileMode mode);
+
+const char *DeviceClassName(DeviceClass deviceClass);
+const char *IoProfileBasisName(IoProfileBasis basis);
+// Accepts "auto", "rotational", "ssd" and "probe".
+bool ParseIoProfileMode(const std::string &text, IoProfileMode &mode);
+
+} // namespace usnscanner
@@ -0,0 +1,189 @@
+#include "io_throttle.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace usnscanner {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Seconds of rate a bucket holds: enough to absorb a burst of small reads,
+// short enough that the device never sees a long stretch at full speed.
+const double kBucketSeconds = 0.1;
+
+#ifndef _WIN32
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassShift = 13;
+const int kIoprioClassBestEffort = 2;
+// The lowest best-effort level rather than the idle class: a file server
+// disk is rarely idle, and idle-class I/O would starve rather than slow.
+const int kBackgroundPriority = (kIoprioClassBestEffort << kIoprioClassShift) | 7;
+#endif
+
+struct Bucket {
+    double rate;
+    double capacity;
+    double tokens;
+
+    void Configure(double perSecond) {
+        rate = perSecond;
+        capacity = std::max(perSecond * kBucketSeconds, 1.0);
+        tokens = capacity;
+    }
+
+    // Seconds until `amount` can be taken; 0 when it can be taken now.
+    double Wait(double amount) const {
+        if (rate == 0) {
+            return 0;
+        }
+        const double needed = std::min(amount, capacity);
+        return tokens >= needed ? 0 : (needed - tokens) / rate;
+    }
+};
+
+struct Throttle {
+    std::mutex mutex;
+    std::condition_variable changed;
+    IoLimits limits{};
+    Bucket bytes{};
+    Bucket operations{};
+    Clock::time_point refilled;
+    // Read without the lock so unthrottled I/O never takes it.
+    std::atomic<bool> limited{ false };
+    std::atomic<bool> background{ false };
+
+    std::atomic<uint64_t> operationCount{ 0 };
+    std::atomic<uint64_t> byteCount{ 0 };
+    std::atomic<uint64_t> throttledCount{ 0 };
+    std::atomic<uint64_t> waitNanoseconds{ 0 };
+
+    void Refill(Clock::time_point now) {
+        const double seconds = std::chrono::duration<double>(now - refilled).count();
+        refilled = now;
+        for (Bucket *bucket : { &bytes, &operations }) {
+            bucket->tokens = std::min(bucket->capacity, bucket->tokens + bucket->rate * seconds);
+        }
+    }
+};
+
+Throttle &GetThrottle() {
+    static Throttle throttle;
+    return throttle;
+}
+
+// Set while the thread runs inside a scope that lowered its priority.
+thread_local bool threadLowered = false;
+
+void Acquire(Throttle &throttle, uint64_t amount) {
+    const auto start = Clock::now();
+    bool waited = false;
+    std::unique_lock<std::mutex> lock(throttle.mutex);
+    while (throttle.limited) {
+        const auto now = Clock::now();
+        throttle.Refill(now);
+        const double wait = std::max(throttle.bytes.Wait(static_cast<double>(amount)), throttle.operations.Wait(1));
+        if (wait == 0) {
+            if (throttle.bytes.rate != 0) {
+                throttle.bytes.tokens -= static_cast<double>(amount);
+            }
+            if (throttle.operations.rate != 0) {
+                throttle.operations.tokens -= 1;
+            }
+            break;
+        }
+        waited = true;
+        throttle.changed.wait_until(lock, now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait)));
+    }
+    lock.unlock();
+
+    if (waited) {
+        ++throttle.throttledCount;
+        throttle.waitNanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+}
+
+} // namespace
+
+void SetIoLimits(const IoLimits &limits) {
+    Throttle &throttle = GetThrottle();
+    {
+        std::lock_guard<std::mutex> lock(throttle.mutex);
+        throttle.limits = limits;
+        throttle.bytes.Configure(static_cast<double>(limits.bytesPerSecond));
+        throttle.operations.Configure(static_cast<double>(limits.operationsPerSecond));
+        throttle.refilled = Clock::now();
+        throttle.limited = limits.bytesPerSecond != 0 || limits.operationsPerSecond != 0;
+        throttle.background = limits.background;
+    }
+    throttle.changed.notify_all();
+}
+
+IoLimits GetIoLimits() {
+    Throttle &throttle = GetThrottle();
+    std::lock_guard<std::mutex> lock(throttle.mutex);
+    return throttle.limits;
+}
+
+IoThrottleStats GetIoThrottleStats() {
+    Throttle &throttle = GetThrottle();
+    IoThrottleStats stats{};
+    stats.operations = throttle.operationCount;
+    stats.bytes = throttle.byteCount;
+    stats.throttled = throttle.throttledCount;
+    stats.waitMs = static_cast<double>(throttle.waitNanoseconds.load()) / 1e6;
+    return stats;
+}
+
+IoThrottleScope::IoThrottleScope(uint64_t bytes) : lowered_(false), previousPriority_(0) {
+    Throttle &throttle = GetThrottle();
+    ++throttle.operationCount;
+    throttle.byteCount += bytes;
+    if (throttle.limited) {
+        Acquire(throttle, bytes);
+    }
+    if (!throttle.background || threadLowered) {
+        return;
+    }
+
+#ifdef _WIN32
+    lowered_ = ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0;
+#else
+    const long previous = ::syscall(SYS_ioprio_get, kIoprioWhoProcess, 0);
+    if (previous >= 0 && ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kBackgroundPriority) == 0) {
+        previousPriority_ = static_cast<int>(previous);
+        lowered_ = true;
+    }
+#endif
+    threadLowered = lowered_;
+}
+
+IoThrottleScope::~IoThrottleScope() {
+    if (!lowered_) {
+        return;
+    }
+#ifdef _WIN32
+    const DWORD error = ::GetLastError();
+    ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+    ::SetLastError(error);
+#else
+    const int error = errno;
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, previousPriority_);
+    errno = error;
+#endif
+    threadLowered = false;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace usnscanner {
+
+struct IoLimits {
+    // 0 leaves a dimension unlimited.
+    uint64_t bytesPerSecond;
+    uint32_t operationsPerSecond;
+    // Issue device I/O at the lowest best-effort priority.
+    bool background;
+};
+
+struct IoThrottleStats {
+    uint64_t operations;
+    uint64_t bytes;
+    // Operations that had to wait for the limits, and how long they waited.
+    uint64_t throttled;
+    double waitMs;
+};
+
+// Limits shared by every reader in the process: one token bucket for bytes
+// and one for operations, each holding a tenth of a second of its rate.
+// Operations wait for tokens instead of failing, so scans and recoveries
+// slow down rather than error out; an operation larger than the bucket
+// waits for a full one and leaves it in debt. New limits take effect at
+// once, including for operations already waiting.
+void SetIoLimits(const IoLimits &limits);
+IoLimits GetIoLimits();
+IoThrottleStats GetIoThrottleStats();
+
+// Brackets one device operation: construction waits until the limits allow
+// `bytes` more, and in background mode the calling thread's I/O priority is
+// lowered until destruction (ioprio_set on Linux, background thread mode on
+// Windows). The priority is restored on the same thread, so pool threads
+// shared with other work are left as they were. The OS error of the
+// operation survives the destructor.
+class IoThrottleScope {
+  public:
+    explicit IoThrottleScope(uint64_t bytes);
+    ~IoThrottleScope();
+
+    IoThrottleScope(const IoThrottleScope &) = delete;
+    IoThrottleScope &operator=(const IoThrottleScope &) = delete;
+
+  private:
+    bool lowered_;
+    int previousPriority_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,385 @@
+#include "logfile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+namespace usnscanner {
+
+namespace {
+
+const uint32_t kRestartMagic = 0x52545352; // 'RSTR'
+const uint32_t kCheckDiskMagic = 0x444B4843; // 'CHKD'
+const uint32_t kRecordPageMagic = 0x44524352; // 'RCRD'
+const uint32_t kLogSectorSize = 512;
+const uint64_t kLogFileRecordNumber = 2;
+const uint32_t kClientRecord = 1;
+const uint32_t kClientRestart = 2;
+// Client data larger than this is not an NTFS transaction record.
+const uint32_t kMaxClientData = 1024 * 1024;
+const size_t kNtfsLogHeader = 0x20;
+
+// NTFS log operation codes this parser replays.
+const uint16_t kInitializeFileRecordSegment = 0x02;
+const uint16_t kDeallocateFileRecordSegment = 0x03;
+const uint16_t kUpdateResidentValue = 0x07;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t Align8(size_t value) {
+    return (value + 7) & ~static_cast<size_t>(7);
+}
+
+bool IsPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// The parts of one NTFS log record this parser needs; redo/undo payloads
+// point into the arena.
+struct LogOperation {
+    uint64_t lsn;
+    uint16_t redoOperation;
+    uint16_t undoOperation;
+    uint64_t targetVcn;
+    uint16_t clusterBlockOffset;
+    uint16_t recordOffset;
+    uint16_t attributeOffset;
+    size_t redo;
+    uint32_t redoLength;
+    size_t undo;
+    uint32_t undoLength;
+};
+
+struct RecordState {
+    std::vector<uint8_t> image;
+    uint64_t lsn;
+    bool deallocated;
+};
+
+} // namespace
+
+LogFileParser::LogFileParser(uint32_t clusterSize, uint32_t recordSize)
+    : clusterSize_(clusterSize), recordSize_(recordSize), stats_{} {}
+
+bool LogFileParser::Parse(std::vector<uint8_t> &log, std::string &error) {
+    auto start = std::chrono::steady_clock::now();
+    double readMs = stats_.readMs;
+    stats_ = LogFileStats{};
+    stats_.readMs = readMs;
+    stats_.logSize = log.size();
+    records_.clear();
+
+    // Either restart page may be the current one; both carry the geometry.
+    uint32_t systemPageSize = 0;
+    uint32_t logPageSize = 0;
+    uint32_t recordHeaderLength = 0;
+    uint32_t pageDataOffset = 0;
+    for (uint32_t candidate = 0; candidate < 2 && logPageSize == 0; ++candidate) {
+        size_t offset = candidate == 0 ? 0 : systemPageSize;
+        if (candidate == 1 && systemPageSize == 0) {
+            offset = 4096;
+        }
+        if (offset + 0x30 > log.size()) {
+            break;
+        }
+        uint8_t *page = log.data() + offset;
+        uint32_t magic = Load<uint32_t>(page);
+        uint32_t pageSize = Load<uint32_t>(page + 0x10);
+        if ((magic != kRestartMagic && magic != kCheckDiskMagic) || !IsPowerOfTwo(pageSize) || pageSize < 512 ||
+            offset + pageSize > log.size()) {
+            continue;
+        }
+        systemPageSize = pageSize;
+        if (!ApplyFixups(page, pageSize, kLogSectorSize)) {
+            continue;
+        }
+        uint32_t areaOffset = Load<uint16_t>(page + 0x18);
+        if (areaOffset + 0x30 > pageSize) {
+            continue;
+        }
+        const uint8_t *area = page + areaOffset;
+        uint32_t candidatePageSize = Load<uint32_t>(page + 0x14);
+        if (!IsPowerOfTwo(candidatePageSize) || candidatePageSize < 512 || candidatePageSize > 65536) {
+            continue;
+        }
+        logPageSize = candidatePageSize;
+        recordHeaderLength = Load<uint16_t>(area + 0x24);
+        pageDataOffset = Load<uint16_t>(area + 0x26);
+    }
+    if (logPageSize == 0) {
+        error = "No valid $LogFile restart page";
+        return false;
+    }
+    if (recordHeaderLength < 0x30 || pageDataOffset < 0x28 || pageDataOffset >= logPageSize) {
+        error = "Unsupported $LogFile restart area";
+        return false;
+    }
+    stats_.pageSize = logPageSize;
+
+    // Pass 1: collect the operations of interest. Pages are visited in file
+    // order; a record that does not fit its page continues at the data area
+    // of the next one.
+    std::vector<uint8_t> arena;
+    std::vector<LogOperation> operations;
+    std::vector<uint8_t> carry;
+    size_t carryTotal = 0;
+
+    auto emit = [&](const uint8_t *record, size_t length) {
+        ++stats_.logRecords;
+        uint32_t recordType = Load<uint32_t>(record + 0x20);
+        if (recordType != kClientRecord || length < recordHeaderLength + kNtfsLogHeader) {
+            return;
+        }
+        const uint8_t *client = record + recordHeaderLength;
+        size_t clientLength = length - recordHeaderLength;
+
+        LogOperation operation{};
+        operation.lsn = Load<uint64_t>(record);
+        operation.redoOperation = Load<uint16_t>(client);
+        operation.undoOperation = Load<uint16_t>(client + 2);
+        bool wanted = operation.redoOperation == kInitializeFileRecordSegment ||
+                      operation.redoOperation == kDeallocateFileRecordSegment ||
+                      operation.redoOperation == kUpdateResidentValue;
+        if (!wanted) {
+            return;
+        }
+
+        uint16_t redoOffset = Load<uint16_t>(client + 4);
+        uint16_t redoLength = Load<uint16_t>(client + 6);
+        uint16_t undoOffset = Load<uint16_t>(client + 8);
+        uint16_t undoLength = Load<uint16_t>(client + 10);
+        if ((redoLength != 0 && redoOffset + static_cast<size_t>(redoLength) > clientLength) ||
+            (undoLength != 0 && undoOffset + static_cast<size_t>(undoLength) > clientLength)) {
+            return;
+        }
+        operation.recordOffset = Load<uint16_t>(client + 0x10);
+        operation.attributeOffset = Load<uint16_t>(client + 0x12);
+        operation.clusterBlockOffset = Load<uint16_t>(client + 0x14);
+        operation.targetVcn = Load<uint64_t>(client + 0x18);
+
+        operation.redo = arena.size();
+        operation.redoLength = redoLength;
+        arena.insert(arena.end(), client + redoOffset, client + redoOffset + redoLength);
+        operation.undo = arena.size();
+        operation.undoLength = 0;
+        if (operation.redoOperation == kDeallocateFileRecordSegment && operation.undoOperation == kInitializeFileRecordSegment) {
+            // Only the pre-deletion image is worth keeping from undo data.
+            operation.undoLength = undoLength;
+            arena.insert(arena.end(), client + undoOffset, client + undoOffset + undoLength);
+        }
+        operations.push_back(operation);
+    };
+
+    for (size_t offset = 2 * static_cast<size_t>(systemPageSize); offset + logPageSize <= log.size(); offset += logPageSize) {
+        uint8_t *page = log.data() + offset;
+        if (Load<uint32_t>(page) != kRecordPageMagic) {
+            carry.clear();
+            continue;
+        }
+        ++stats_.pages;
+        if (!ApplyFixups(page, logPageSize, kLogSectorSize)) {
+            ++stats_.tornPages;
+            carry.clear();
+            continue;
+        }
+
+        size_t position = pageDataOffset;
+        size_t limit = Load<uint16_t>(page + 0x18);
+        if (limit <= pageDataOffset || limit > logPageSize) {
+            limit = logPageSize;
+        }
+
+        if (!carry.empty()) {
+            size_t take = std::min(carryTotal - carry.size(), static_cast<size_t>(logPageSize) - position);
+            carry.insert(carry.end(), page + position, page + position + take);
+            position += take;
+            if (carry.size() < carryTotal) {
+                continue;
+            }
+            emit(carry.data(), carry.size());
+            carry.clear();
+            position = Align8(position);
+        }
+
+        while (position + recordHeaderLength <= logPageSize && position < limit) {
+            const uint8_t *record = page + position;
+            uint64_t lsn = Load<uint64_t>(record);
+            uint32_t clientLength = Load<uint32_t>(record + 0x18);
+            uint32_t recordType = Load<uint32_t>(record + 0x20);
+            if (lsn == 0 || clientLength > kMaxClientData || (recordType != kClientRecord && recordType != kClientRestart)) {
+                break;
+            }
+
+            size_t total = recordHeaderLength + clientLength;
+            if (position + total > logPageSize) {
+                carry.assign(record, static_cast<const uint8_t *>(page + logPageSize));
+                carryTotal = total;
+                break;
+            }
+            emit(record, total);
+            position += Align8(total);
+        }
+    }
+
+    // Pass 2: replay in LSN order. Tail copies and page rewrites log the same
+    // record more than once.
+    std::sort(operations.begin(), operations.end(), [](const LogOperation &a, const LogOperation &b) {
+        return a.lsn < b.lsn;
+    });
+    operations.erase(std::unique(operations.begin(), operations.end(), [](const LogOperation &a, const LogOperation &b) {
+        return a.lsn == b.lsn;
+    }), operations.end());
+
+    auto recordNumberOf = [&](const LogOperation &operation) {
+        return (operation.targetVcn * clusterSize_ + static_cast<uint64_t>(operation.clusterBlockOffset) * kLogSectorSize) / recordSize_;
+    };
+    auto imageRecordNumber = [&](const uint8_t *image, uint32_t length, uint64_t fallback) {
+        if (length >= sizeof(FileRecordHeader) && Load<uint32_t>(image) == kFileRecordMagic) {
+            const FileRecordHeader *header = reinterpret_cast<const FileRecordHeader *>(image);
+            // NTFS 3.1 records carry their own number past the fixup array.
+            if (header->UpdateSequenceOffset >= 0x30) {
+                return static_cast<uint64_t>(header->MftRecordNumber);
+            }
+        }
+        return fallback;
+    };
+
+    std::unordered_map<uint64_t, RecordState> states;
+    for (const auto &operation : operations) {
+        uint64_t recordNumber = recordNumberOf(operation);
+        if (operation.redoOperation == kInitializeFileRecordSegment && operation.redoLength >= sizeof(FileRecordHeader)) {
+            const uint8_t *image = arena.data() + operation.redo;
+            RecordState &state = states[imageRecordNumber(image, operation.redoLength, recordNumber)];
+            state.image.assign(image, image + std::min<uint32_t>(operation.redoLength, recordSize_));
+            state.image.resize(recordSize_, 0);
+            state.lsn = operation.lsn;
+            state.deallocated = false;
+            ++stats_.recordImages;
+        } else if (operation.redoOperation == kDeallocateFileRecordSegment) {
+            ++stats_.deallocations;
+            if (operation.undoLength >= sizeof(FileRecordHeader)) {
+                const uint8_t *image = arena.data() + operation.undo;
+                recordNumber = imageRecordNumber(image, operation.undoLength, recordNumber);
+                RecordState &state = states[recordNumber];
+                state.image.assign(image, image + std::min<uint32_t>(operation.undoLength, recordSize_));
+                state.image.resize(recordSize_, 0);
+                ++stats_.recordImages;
+            }
+            auto it = states.find(recordNumber);
+            if (it != states.end()) {
+                it->second.lsn = operation.lsn;
+                it->second.deallocated = true;
+            }
+        } else if (operation.redoOperation == kUpdateResidentValue) {
+            auto it = states.find(recordNumber);
+            if (it == states.end()) {
+                continue;
+            }
+            std::vector<uint8_t> &image = it->second.image;
+            size_t attribute = operation.recordOffset;
+            size_t target = attribute + operation.attributeOffset;
+            // Only patch resident attributes of the image the update targets.
+            if (attribute + 0x18 > image.size() || image[attribute + 8] != 0 || target + operation.redoLength > image.size()) {
+                continue;
+            }
+            std::memcpy(image.data() + target, arena.data() + operation.redo, operation.redoLength);
+            it->second.lsn = operation.lsn;
+            ++stats_.residentUpdates;
+        }
+    }
+
+    FileRecordDetails details{};
+    for (auto &entry : states) {
+        RecordState &state = entry.second;
+        if (!ParseFileRecord(state.image.data(), recordSize_, details) || ReferenceRecordNumber(details.baseReference) != 0) {
+            continue;
+        }
+
+        const FileRecordHeader *header = reinterpret_cast<const FileRecordHeader *>(state.image.data());
+        LogFileRecord record{};
+        record.recordNumber = entry.first;
+        record.sequence = header->SequenceNumber;
+        record.lsn = state.lsn;
+        record.deallocated = state.deallocated;
+        record.isDirectory = details.isDirectory;
+
+        bool named = false;
+        for (const auto &attribute : details.attributes) {
+            if (attribute.type == kAttributeFileName && !attribute.nonResident) {
+                FileNameInfo name{};
+                if (ParseFileName(attribute.residentData, name) &&
+                    (!named || NamespaceRank(name.nameSpace) < NamespaceRank(record.fileName.nameSpace))) {
+                    record.fileName = std::move(name);
+                    named = true;
+                }
+            } else if (attribute.type == kAttributeStandardInformation && !attribute.nonResident) {
+                record.hasStandardInformation = ParseStandardInformation(attribute.residentData, record.standardInformation);
+            } else if (attribute.type == kAttributeData && attribute.name.empty() && !record.hasData) {
+                record.hasData = true;
+                record.resident = !attribute.nonResident;
+                record.dataSize = attribute.dataSize;
+                record.compressionUnit = attribute.compressionUnit;
+                record.residentData = attribute.residentData;
+                record.runs = attribute.runs;
+            }
+        }
+        if (named) {
+            records_.push_back(std::move(record));
+        }
+    }
+
+    std::sort(records_.begin(), records_.end(), [](const LogFileRecord &a, const LogFileRecord &b) {
+        return a.recordNumber < b.recordNumber;
+    });
+    stats_.parseMs = MillisecondsSince(start);
+    return true;
+}
+
+bool ReadLogFile(VolumeReader &reader, MftReader &mft, std::vector<uint8_t> &log, std::string &error) {
+    std::vector<uint8_t> record;
+    FileRecordDetails details{};
+    if (!mft.ReadRecord(kLogFileRecordNumber, record) || !ParseFileRecord(record.data(), mft.RecordSize(), details)) {
+        error = "Unable to read $LogFile record";
+        return false;
+    }
+
+    const AttributeInfo *data = nullptr;
+    for (const auto &attribute : details.attributes) {
+        if (attribute.type == kAttributeData && attribute.name.empty() && attribute.nonResident) {
+            data = &attribute;
+            break;
+        }
+    }
+    if (!data || data->dataSize == 0 || data->dataSize > 4ULL * 1024 * 1024 * 1024) {
+        error = "$LogFile has no usable data stream";
+        return false;
+    }
+
+    const uint64_t clusterSize = mft.Geometry().clusterSize;
+    log.assign(static_cast<size_t>(data->dataSize), 0);
+    for (const auto &run : data->runs) {
+        uint64_t begin = static_cast<uint64_t>(run.vcnStart) * clusterSize;
+        if (run.sparse || begin >= log.size()) {
+            continue;
+        }
+        size_t want = static_cast<size_t>(std::min<uint64_t>(log.size() - begin, static_cast<uint64_t>(run.length) * clusterSize));
+        long long read = reader.ReadAt(static_cast<uint64_t>(run.lcn) * clusterSize, log.data() + begin, want);
+        if (read != static_cast<long long>(want)) {
+            error = "$LogFile read failed with error " + std::to_string(VolumeReader::LastError());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace usnscanner
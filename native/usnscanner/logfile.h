@@ -0,0 +1,72 @@
+#pragma once
+
+#include "mft_reader.h"
+#include "ntfs_record.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// Latest state of one MFT record as reconstructed from $LogFile: the record
+// image logged by InitializeFileRecordSegment (redo for new records, undo for
+// deallocated ones) with later resident value updates replayed on top.
+struct LogFileRecord {
+    uint64_t recordNumber;
+    uint16_t sequence;
+    // LSN of the newest operation applied to the image.
+    uint64_t lsn;
+    // The log holds a DeallocateFileRecordSegment newer than the image.
+    bool deallocated;
+    bool isDirectory;
+    FileNameInfo fileName;
+    bool hasStandardInformation;
+    StandardInformation standardInformation;
+    bool hasData;
+    bool resident;
+    uint64_t dataSize;
+    uint8_t compressionUnit;
+    std::vector<uint8_t> residentData;
+    std::vector<DataRunSegment> runs;
+};
+
+struct LogFileStats {
+    uint64_t logSize;
+    uint32_t pageSize;
+    uint64_t pages;
+    uint64_t tornPages;
+    uint64_t logRecords;
+    uint64_t recordImages;
+    uint64_t residentUpdates;
+    uint64_t deallocations;
+    double readMs;
+    double parseMs;
+};
+
+// Parses an in-memory copy of $LogFile. Restart pages give the page and
+// record-header geometry; RCRD pages are fixed up, log records (including the
+// ones that continue across pages) are collected, ordered by LSN and
+// replayed against the MFT record images they carry.
+class LogFileParser {
+  public:
+    LogFileParser(uint32_t clusterSize, uint32_t recordSize);
+
+    bool Parse(std::vector<uint8_t> &log, std::string &error);
+
+    const std::vector<LogFileRecord> &Records() const { return records_; }
+    LogFileStats &Stats() { return stats_; }
+
+  private:
+    uint32_t clusterSize_;
+    uint32_t recordSize_;
+    std::vector<LogFileRecord> records_;
+    LogFileStats stats_;
+};
+
+// Reads $LogFile (MFT record 2) in full.
+bool ReadLogFile(VolumeReader &reader, MftReader &mft, std::vector<uint8_t> &log, std::string &error);
+
+} // namespace usnscanner
@@ -0,0 +1,208 @@
+#include "lznt1.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kChunkSize = 4096;
+const uint16_t kChunkCompressed = 0x8000;
+const uint16_t kChunkSizeMask = 0x0FFF;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// A back-reference token splits into offset and length bits depending on how
+// far into the 4 KB chunk the decoder is: 4 offset bits for the first 16
+// bytes, one more each time the position doubles. Indexed by position - 1.
+struct TokenTable {
+    uint8_t shift[kChunkSize];
+
+    TokenTable() {
+        for (size_t position = 1; position <= kChunkSize; ++position) {
+            uint8_t bits = 12;
+            for (size_t p = position - 1; p >= 0x10; p >>= 1) {
+                --bits;
+            }
+            shift[position - 1] = bits;
+        }
+    }
+};
+
+const TokenTable kTokens;
+
+// Decodes one compressed chunk into [out, outEnd). Returns the end of the
+// decoded data or nullptr when a token points outside the chunk.
+uint8_t *DecodeChunk(const uint8_t *in, const uint8_t *inEnd, uint8_t *out, uint8_t *outEnd) {
+    uint8_t *const chunkStart = out;
+    if (static_cast<size_t>(outEnd - out) > kChunkSize) {
+        outEnd = out + kChunkSize;
+    }
+
+    while (in < inEnd && out < outEnd) {
+        uint8_t flags = *in++;
+
+        // Eight literals in a row: copy them as one word.
+        if (flags == 0 && inEnd - in >= 8 && outEnd - out >= 8) {
+            std::memcpy(out, in, 8);
+            in += 8;
+            out += 8;
+            continue;
+        }
+
+        for (int bit = 0; bit < 8 && in < inEnd && out < outEnd; ++bit, flags >>= 1) {
+            if ((flags & 1) == 0) {
+                *out++ = *in++;
+                continue;
+            }
+
+            if (inEnd - in < 2) {
+                return nullptr;
+            }
+            uint16_t token = Load<uint16_t>(in);
+            in += 2;
+
+            size_t position = static_cast<size_t>(out - chunkStart);
+            if (position == 0) {
+                return nullptr;
+            }
+            uint8_t shift = kTokens.shift[position - 1];
+            size_t offset = static_cast<size_t>(token >> shift) + 1;
+            size_t length = static_cast<size_t>(token & ((1u << shift) - 1)) + 3;
+            if (offset > position) {
+                return nullptr;
+            }
+            length = std::min(length, static_cast<size_t>(outEnd - out));
+
+            const uint8_t *source = out - offset;
+            if (offset >= 8 && static_cast<size_t>(outEnd - out) >= ((length + 7) & ~static_cast<size_t>(7))) {
+                // Source trails the destination by at least a word, so word
+                // copies never read bytes this match has not produced yet.
+                for (size_t i = 0; i < length; i += 8) {
+                    std::memcpy(out + i, source + i, 8);
+                }
+                out += length;
+            } else {
+                for (size_t i = 0; i < length; ++i) {
+                    out[i] = source[i];
+                }
+                out += length;
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+bool Lznt1Decompress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputSize, size_t &produced) {
+    const uint8_t *in = input;
+    const uint8_t *const inEnd = input + inputSize;
+    uint8_t *out = output;
+    uint8_t *const outEnd = output + outputSize;
+    produced = 0;
+
+    while (inEnd - in >= 2 && out < outEnd) {
+        uint16_t header = Load<uint16_t>(in);
+        if (header == 0) {
+            break;
+        }
+        in += 2;
+
+        size_t chunkLength = static_cast<size_t>(header & kChunkSizeMask) + 1;
+        if (chunkLength > static_cast<size_t>(inEnd - in)) {
+            return false;
+        }
+
+        uint8_t *const chunkStart = out;
+        if ((header & kChunkCompressed) == 0) {
+            size_t copy = std::min(chunkLength, static_cast<size_t>(outEnd - out));
+            std::memcpy(out, in, copy);
+            out += copy;
+        } else {
+            uint8_t *end = DecodeChunk(in, in + chunkLength, out, outEnd);
+            if (!end) {
+                return false;
+            }
+            out = end;
+        }
+        in += chunkLength;
+
+        // Every chunk but the last covers a full 4 KB of output; a short one
+        // is padded with zeros, as RtlDecompressBuffer does, so the next
+        // chunk starts on its boundary.
+        if (inEnd - in >= 2 && Load<uint16_t>(in) != 0) {
+            uint8_t *boundary = chunkStart + std::min(kChunkSize, static_cast<size_t>(outEnd - chunkStart));
+            std::memset(out, 0, static_cast<size_t>(boundary - out));
+            out = boundary;
+        }
+        produced = static_cast<size_t>(out - output);
+    }
+    produced = static_cast<size_t>(out - output);
+    return true;
+}
+
+bool DecodeCompressionUnit(const uint8_t *stored, size_t storedSize, uint8_t *unit, size_t unitSize) {
+    if (storedSize == 0) {
+        std::memset(unit, 0, unitSize);
+        return true;
+    }
+    if (storedSize >= unitSize) {
+        std::memcpy(unit, stored, unitSize);
+        return true;
+    }
+
+    size_t produced = 0;
+    bool ok = Lznt1Decompress(stored, storedSize, unit, unitSize, produced);
+    std::memset(unit + produced, 0, unitSize - produced);
+    return ok;
+}
+
+uint64_t MapCompressionUnit(
+    const std::vector<DataRunSegment> &runs,
+    uint64_t clusterSize,
+    uint64_t firstVcn,
+    uint64_t clusters,
+    std::vector<ByteRange> &extents) {
+    extents.clear();
+    const uint64_t lastVcn = firstVcn + clusters;
+    uint64_t allocated = 0;
+    uint64_t vcn = 0;
+    for (const auto &run : runs) {
+        if (run.length <= 0) {
+            continue;
+        }
+        uint64_t runStart = vcn;
+        uint64_t runEnd = vcn + static_cast<uint64_t>(run.length);
+        vcn = runEnd;
+        if (runEnd <= firstVcn) {
+            continue;
+        }
+        if (runStart >= lastVcn) {
+            break;
+        }
+        if (run.sparse || run.lcn <= 0) {
+            continue;
+        }
+
+        uint64_t begin = std::max(runStart, firstVcn);
+        uint64_t end = std::min(runEnd, lastVcn);
+        uint64_t lcn = static_cast<uint64_t>(run.lcn) + (begin - runStart);
+        ByteRange range{ lcn * clusterSize, (end - begin) * clusterSize };
+        if (!extents.empty() && extents.back().offset + extents.back().length == range.offset) {
+            extents.back().length += range.length;
+        } else {
+            extents.push_back(range);
+        }
+        allocated += end - begin;
+    }
+    return allocated;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ntfs_record.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace usnscanner {
+
+// Decompresses an LZNT1 stream (the NTFS compressed-attribute format) into
+// `output`. Every chunk but the last fills 4 KB of output, a short one being
+// padded with zeros. Decoding stops at the zero chunk header that terminates
+// a unit, at the end of the input, or when `output` is full. Returns false on
+// a corrupt chunk; `produced` still counts the bytes decoded before it.
+bool Lznt1Decompress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputSize, size_t &produced);
+
+// Expands one compression unit from the clusters allocated to it. No clusters
+// means a sparse unit (zeros), a fully allocated unit is stored raw, anything
+// in between is LZNT1 data. Bytes past the decoded data are zeroed.
+bool DecodeCompressionUnit(const uint8_t *stored, size_t storedSize, uint8_t *unit, size_t unitSize);
+
+// Volume byte ranges backing VCNs [firstVcn, firstVcn + clusters), in VCN
+// order. Runs are taken as consecutive from VCN 0; sparse runs contribute
+// nothing. Returns the number of allocated clusters found.
+uint64_t MapCompressionUnit(
+    const std::vector<DataRunSegment> &runs,
+    uint64_t clusterSize,
+    uint64_t firstVcn,
+    uint64_t clusters,
+    std::vector<ByteRange> &extents);
+
+} // namespace usnscanner
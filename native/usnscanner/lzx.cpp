@@ -0,0 +1,334 @@
+#include "lzx.h"
+#include "huffman.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const unsigned kBlockVerbatim = 1;
+const unsigned kBlockAligned = 2;
+const unsigned kBlockUncompressed = 3;
+const size_t kDefaultBlockSize = 32768;
+const unsigned kMinWindowOrder = 15;
+const unsigned kMaxWindowOrder = 21;
+const size_t kMaxOffsetSlots = 50;
+const size_t kLiterals = 256;
+const size_t kLengthHeaders = 8;
+const size_t kPrimaryLengths = 7;
+const size_t kLengthSymbols = 249;
+const size_t kPreSymbols = 20;
+const size_t kAlignedSymbols = 8;
+const size_t kMinMatch = 2;
+const size_t kRecentOffsets = 3;
+const uint32_t kOffsetAdjustment = kRecentOffsets - 1;
+const int32_t kE8FileSize = 12000000;
+const unsigned kMaxCodeLength = 16;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+struct SlotTable {
+    uint32_t base[kMaxOffsetSlots + 1];
+    uint8_t extra[kMaxOffsetSlots];
+
+    SlotTable() {
+        base[0] = 0;
+        for (size_t slot = 0; slot < kMaxOffsetSlots; ++slot) {
+            extra[slot] = static_cast<uint8_t>(slot < 4 ? 0 : std::min<size_t>((slot - 2) / 2, 17));
+            base[slot + 1] = base[slot] + (1u << extra[slot]);
+        }
+    }
+};
+
+const SlotTable kSlots;
+
+size_t OffsetSlotCount(unsigned windowOrder) {
+    static const uint8_t kCounts[] = { 30, 32, 34, 36, 38, 42, 50 };
+    return kCounts[windowOrder - kMinWindowOrder];
+}
+
+// 16-bit little-endian words read MSB first. Words are loaded only when a
+// read needs them, so after any read fewer than 16 bits stay buffered, which
+// is what the uncompressed-block alignment rule relies on.
+class BitReader {
+  public:
+    BitReader(const uint8_t *data, size_t size) : data_(data), size_(size), position_(0), buffer_(0), bits_(0) {}
+
+    void Ensure(unsigned count) {
+        while (bits_ < count) {
+            // Past the end reads as zeros: a final short code may peek
+            // beyond the last word.
+            uint32_t word = position_ + 2 <= size_ ? Load<uint16_t>(data_ + position_) : 0;
+            position_ += 2;
+            buffer_ |= static_cast<uint64_t>(word) << (48 - bits_);
+            bits_ += 16;
+        }
+    }
+
+    uint32_t Peek(unsigned count) {
+        Ensure(count);
+        return static_cast<uint32_t>(buffer_ >> (64 - count));
+    }
+
+    void Skip(unsigned count) {
+        buffer_ <<= count;
+        bits_ -= count;
+    }
+
+    uint32_t Read(unsigned count) {
+        if (count == 0) {
+            return 0;
+        }
+        uint32_t value = Peek(count);
+        Skip(count);
+        return value;
+    }
+
+    int Decode(const HuffmanDecoder &decoder) {
+        unsigned length = 0;
+        int symbol = decoder.Decode(Peek(decoder.MaxLength()), length);
+        if (symbol >= 0) {
+            Skip(length);
+        }
+        return symbol;
+    }
+
+    // Drops the partial word; an already aligned stream drops a whole word.
+    void Align() {
+        Ensure(1);
+        buffer_ = 0;
+        bits_ = 0;
+    }
+
+    const uint8_t *Bytes(size_t count) {
+        if (position_ + count > size_) {
+            return nullptr;
+        }
+        const uint8_t *bytes = data_ + position_;
+        position_ += count;
+        return bytes;
+    }
+
+  private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t position_;
+    uint64_t buffer_;
+    unsigned bits_;
+};
+
+// Reads a pretree and uses it to update `lengths` in place; each value is a
+// delta (mod 17) from the previous block's length.
+bool ReadCodeLengths(BitReader &reader, uint8_t *lengths, size_t count) {
+    uint8_t preLengths[kPreSymbols];
+    for (size_t i = 0; i < kPreSymbols; ++i) {
+        preLengths[i] = static_cast<uint8_t>(reader.Read(4));
+    }
+    HuffmanDecoder pretree;
+    if (!pretree.Build(preLengths, kPreSymbols, 15)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count;) {
+        int symbol = reader.Decode(pretree);
+        if (symbol < 0) {
+            return false;
+        }
+        if (symbol == 17 || symbol == 18) {
+            size_t run = symbol == 17 ? 4 + reader.Read(4) : 20 + reader.Read(5);
+            run = std::min(run, count - i);
+            std::memset(lengths + i, 0, run);
+            i += run;
+        } else if (symbol == 19) {
+            size_t run = std::min<size_t>(4 + reader.Read(1), count - i);
+            symbol = reader.Decode(pretree);
+            if (symbol < 0 || symbol > 16) {
+                return false;
+            }
+            uint8_t length = static_cast<uint8_t>((lengths[i] + 17 - symbol) % 17);
+            std::memset(lengths + i, length, run);
+            i += run;
+        } else {
+            lengths[i] = static_cast<uint8_t>((lengths[i] + 17 - symbol) % 17);
+            ++i;
+        }
+    }
+    return true;
+}
+
+void UndoE8Translation(uint8_t *data, size_t size) {
+    if (size <= 10) {
+        return;
+    }
+    uint8_t *tail = data + size - 10;
+    for (uint8_t *p = data; p < tail;) {
+        if (*p != 0xE8) {
+            ++p;
+            continue;
+        }
+        int32_t position = static_cast<int32_t>(p - data);
+        int32_t absolute = Load<int32_t>(p + 1);
+        if (absolute >= 0) {
+            if (absolute < kE8FileSize) {
+                int32_t relative = absolute - position;
+                std::memcpy(p + 1, &relative, sizeof(relative));
+            }
+        } else if (absolute >= -position) {
+            int32_t relative = absolute + kE8FileSize;
+            std::memcpy(p + 1, &relative, sizeof(relative));
+        }
+        p += 5;
+    }
+}
+
+} // namespace
+
+bool LzxDecompress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputSize) {
+    unsigned windowOrder = kMinWindowOrder;
+    while ((static_cast<size_t>(1) << windowOrder) < outputSize) {
+        if (++windowOrder > kMaxWindowOrder) {
+            return false;
+        }
+    }
+    const size_t windowSize = static_cast<size_t>(1) << windowOrder;
+    const size_t offsetSlots = OffsetSlotCount(windowOrder);
+    const size_t mainSymbols = kLiterals + kLengthHeaders * offsetSlots;
+
+    BitReader reader(input, inputSize);
+    uint8_t mainLengths[kLiterals + kLengthHeaders * kMaxOffsetSlots] = {};
+    uint8_t lengthLengths[kLengthSymbols] = {};
+    HuffmanDecoder mainCode;
+    HuffmanDecoder lengthCode;
+    HuffmanDecoder alignedCode;
+    uint32_t recent[kRecentOffsets] = { 1, 1, 1 };
+
+    size_t out = 0;
+    while (out < outputSize) {
+        unsigned blockType = reader.Read(3);
+        size_t blockSize = kDefaultBlockSize;
+        if (reader.Read(1) == 0) {
+            blockSize = reader.Read(16);
+            if (windowSize >= 65536) {
+                blockSize = (blockSize << 8) | reader.Read(8);
+            }
+        }
+        if (blockSize == 0) {
+            return false;
+        }
+        const size_t blockEnd = std::min(outputSize, out + blockSize);
+
+        if (blockType == kBlockUncompressed) {
+            reader.Align();
+            const uint8_t *header = reader.Bytes(12);
+            if (!header) {
+                return false;
+            }
+            for (size_t i = 0; i < kRecentOffsets; ++i) {
+                recent[i] = Load<uint32_t>(header + 4 * i);
+            }
+            const uint8_t *bytes = reader.Bytes(blockSize);
+            if (!bytes) {
+                return false;
+            }
+            std::memcpy(output + out, bytes, blockEnd - out);
+            out = blockEnd;
+            if (blockSize & 1) {
+                reader.Bytes(1);
+            }
+            continue;
+        }
+
+        if (blockType != kBlockVerbatim && blockType != kBlockAligned) {
+            return false;
+        }
+        if (blockType == kBlockAligned) {
+            uint8_t alignedLengths[kAlignedSymbols];
+            for (size_t i = 0; i < kAlignedSymbols; ++i) {
+                alignedLengths[i] = static_cast<uint8_t>(reader.Read(3));
+            }
+            if (!alignedCode.Build(alignedLengths, kAlignedSymbols, 7)) {
+                return false;
+            }
+        }
+        if (!ReadCodeLengths(reader, mainLengths, kLiterals) ||
+            !ReadCodeLengths(reader, mainLengths + kLiterals, mainSymbols - kLiterals) ||
+            !mainCode.Build(mainLengths, mainSymbols, kMaxCodeLength) ||
+            !ReadCodeLengths(reader, lengthLengths, kLengthSymbols) ||
+            !lengthCode.Build(lengthLengths, kLengthSymbols, kMaxCodeLength)) {
+            return false;
+        }
+
+        while (out < blockEnd) {
+            int symbol = reader.Decode(mainCode);
+            if (symbol < 0) {
+                return false;
+            }
+            if (static_cast<size_t>(symbol) < kLiterals) {
+                output[out++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            symbol -= static_cast<int>(kLiterals);
+            size_t matchLength = static_cast<size_t>(symbol) % kLengthHeaders;
+            size_t slot = static_cast<size_t>(symbol) / kLengthHeaders;
+            if (matchLength == kPrimaryLengths) {
+                int extra = reader.Decode(lengthCode);
+                if (extra < 0) {
+                    return false;
+                }
+                matchLength += static_cast<size_t>(extra);
+            }
+            matchLength += kMinMatch;
+
+            uint32_t offset;
+            if (slot < kRecentOffsets) {
+                offset = recent[slot];
+                recent[slot] = recent[0];
+                recent[0] = offset;
+            } else {
+                unsigned extraBits = kSlots.extra[slot];
+                offset = kSlots.base[slot];
+                if (blockType == kBlockAligned && extraBits >= 3) {
+                    offset += reader.Read(extraBits - 3) << 3;
+                    int aligned = reader.Decode(alignedCode);
+                    if (aligned < 0) {
+                        return false;
+                    }
+                    offset += static_cast<uint32_t>(aligned);
+                } else {
+                    offset += reader.Read(extraBits);
+                }
+                offset -= kOffsetAdjustment;
+                recent[2] = recent[1];
+                recent[1] = recent[0];
+                recent[0] = offset;
+            }
+
+            if (offset == 0 || offset > out || matchLength > blockEnd - out) {
+                return false;
+            }
+            const uint8_t *source = output + out - offset;
+            uint8_t *target = output + out;
+            if (offset >= matchLength) {
+                std::memcpy(target, source, matchLength);
+            } else {
+                for (size_t i = 0; i < matchLength; ++i) {
+                    target[i] = source[i];
+                }
+            }
+            out += matchLength;
+        }
+    }
+
+    UndoE8Translation(output, outputSize);
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace usnscanner {
+
+// Decompresses one independently compressed LZX chunk in the WIM/WOF
+// variant: the window is the chunk itself (at most 2 MB), block sizes default
+// to 32 KB, and E8 call translation is undone with the fixed 12000000 file
+// size. Produces exactly `outputSize` bytes; returns false on corrupt input.
+bool LzxDecompress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputSize);
+
+} // namespace usnscanner
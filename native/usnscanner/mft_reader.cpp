@@ -0,0 +1,279 @@
+#include "mft_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const uint32_t kAttributeList = 0x20;
+// Sweep reads are issued in blocks of this size (rounded to whole records).
+const size_t kSweepBlock = 4 * 1024 * 1024;
+// ReadRecords reads through gaps up to this size rather than issuing another
+// request; past a few tens of KB a seek is cheaper than the extra transfer.
+const uint64_t kGatherGap = 64 * 1024;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+const AttributeInfo *FindUnnamedData(const FileRecordDetails &details) {
+    for (const auto &attribute : details.attributes) {
+        if (attribute.type == kAttributeData && attribute.name.empty()) {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+bool FixupFileRecord(uint8_t *record, uint32_t size) {
+    uint32_t magic = Load<uint32_t>(record);
+    uint16_t usaCount = Load<uint16_t>(record + 6);
+    if (magic != kFileRecordMagic || usaCount < 2) {
+        return false;
+    }
+    uint32_t stride = size / (usaCount - 1u);
+    if (stride * (usaCount - 1u) != size || stride < 256) {
+        return false;
+    }
+    return ApplyFixups(record, size, stride);
+}
+
+MftReader::MftReader(VolumeReader &reader) : reader_(reader), geometry_{}, recordCount_(0) {}
+
+bool MftReader::Open(std::string &error) {
+    if (!ReadNtfsGeometry(reader_, geometry_)) {
+        error = "Source is not an NTFS volume";
+        return false;
+    }
+
+    // Bootstrap: record 0 lives at the start of the first MFT extent.
+    std::vector<uint8_t> record(geometry_.recordSize);
+    uint64_t offset = geometry_.mftCluster * geometry_.clusterSize;
+    long long read = reader_.ReadAt(offset, record.data(), record.size());
+    if (read != static_cast<long long>(record.size()) || !FixupFileRecord(record.data(), geometry_.recordSize)) {
+        error = "Unable to read $MFT record";
+        return false;
+    }
+
+    FileRecordDetails details{};
+    const AttributeInfo *data = nullptr;
+    if (!ParseFileRecord(record.data(), geometry_.recordSize, details) || !(data = FindUnnamedData(details)) || !data->nonResident) {
+        error = "Malformed $MFT record";
+        return false;
+    }
+
+    runs_.clear();
+    for (const auto &attribute : details.attributes) {
+        if (attribute.type == kAttributeData && attribute.name.empty()) {
+            runs_.insert(runs_.end(), attribute.runs.begin(), attribute.runs.end());
+        }
+    }
+    recordCount_ = data->dataSize / geometry_.recordSize;
+
+    if (!LoadAttributeListRuns(details, error)) {
+        return false;
+    }
+    std::sort(runs_.begin(), runs_.end(), [](const DataRunSegment &a, const DataRunSegment &b) {
+        return a.vcnStart < b.vcnStart;
+    });
+    return true;
+}
+
+bool MftReader::LoadAttributeListRuns(const FileRecordDetails &base, std::string &error) {
+    const AttributeInfo *list = nullptr;
+    for (const auto &attribute : base.attributes) {
+        if (attribute.type == kAttributeList) {
+            list = &attribute;
+            break;
+        }
+    }
+    if (!list) {
+        return true;
+    }
+
+    std::vector<uint8_t> value = list->residentData;
+    if (list->nonResident) {
+        value.assign(static_cast<size_t>(std::min<uint64_t>(list->dataSize, 16 * 1024 * 1024)), 0);
+        size_t filled = 0;
+        for (const auto &run : list->runs) {
+            if (run.sparse || filled >= value.size()) {
+                continue;
+            }
+            size_t want = static_cast<size_t>(std::min<uint64_t>(value.size() - filled, static_cast<uint64_t>(run.length) * geometry_.clusterSize));
+            if (reader_.ReadAt(static_cast<uint64_t>(run.lcn) * geometry_.clusterSize, value.data() + filled, want) != static_cast<long long>(want)) {
+                error = "Unable to read $MFT attribute list";
+                return false;
+            }
+            filled += want;
+        }
+    }
+
+    // Extension records holding later pieces of $MFT's $DATA; they sit in the
+    // part of the MFT already mapped by record 0.
+    std::vector<uint64_t> extensions;
+    for (size_t position = 0; position + 26 <= value.size();) {
+        uint32_t type = Load<uint32_t>(value.data() + position);
+        uint16_t length = Load<uint16_t>(value.data() + position + 4);
+        uint8_t nameLength = value[position + 6];
+        uint64_t reference = ReferenceRecordNumber(Load<uint64_t>(value.data() + position + 16));
+        if (length == 0) {
+            break;
+        }
+        if (type == kAttributeData && nameLength == 0 && reference != 0) {
+            extensions.push_back(reference);
+        }
+        position += length;
+    }
+
+    std::sort(extensions.begin(), extensions.end());
+    extensions.erase(std::unique(extensions.begin(), extensions.end()), extensions.end());
+
+    std::vector<uint8_t> record;
+    for (uint64_t reference : extensions) {
+        FileRecordDetails details{};
+        if (!ReadRecord(reference, record) || !ParseFileRecord(record.data(), geometry_.recordSize, details)) {
+            error = "Unable to read $MFT extension record " + std::to_string(reference);
+            return false;
+        }
+        for (const auto &attribute : details.attributes) {
+            if (attribute.type == kAttributeData && attribute.name.empty() && attribute.nonResident) {
+                runs_.insert(runs_.end(), attribute.runs.begin(), attribute.runs.end());
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t MftReader::RecordOffset(uint64_t recordNumber) const {
+    uint64_t byte = recordNumber * geometry_.recordSize;
+    for (const auto &run : runs_) {
+        uint64_t start = static_cast<uint64_t>(run.vcnStart) * geometry_.clusterSize;
+        uint64_t length = static_cast<uint64_t>(run.length) * geometry_.clusterSize;
+        if (byte >= start && byte < start + length) {
+            if (run.sparse) {
+                return UINT64_MAX;
+            }
+            return static_cast<uint64_t>(run.lcn) * geometry_.clusterSize + (byte - start);
+        }
+    }
+    return UINT64_MAX;
+}
+
+bool MftReader::ReadRecord(uint64_t recordNumber, std::vector<uint8_t> &record) {
+    uint64_t offset = RecordOffset(recordNumber);
+    if (offset == UINT64_MAX) {
+        return false;
+    }
+    record.resize(geometry_.recordSize);
+    if (reader_.ReadAt(offset, record.data(), record.size()) != static_cast<long long>(record.size())) {
+        return false;
+    }
+    return FixupFileRecord(record.data(), geometry_.recordSize);
+}
+
+bool MftReader::Sweep(const std::function<void(uint64_t recordNumber, const uint8_t *record, uint32_t size)> &visit, std::string &error) {
+    const uint32_t recordSize = geometry_.recordSize;
+    const size_t blockSize = std::max<size_t>(recordSize, (kSweepBlock / recordSize) * recordSize);
+    std::vector<uint8_t> buffer(blockSize);
+
+    for (const auto &run : runs_) {
+        if (run.sparse || run.length <= 0) {
+            continue;
+        }
+
+        uint64_t start = static_cast<uint64_t>(run.vcnStart) * geometry_.clusterSize;
+        uint64_t length = static_cast<uint64_t>(run.length) * geometry_.clusterSize;
+        uint64_t firstRecord = (start + recordSize - 1) / recordSize;
+        uint64_t lastRecord = std::min(recordCount_, (start + length) / recordSize);
+
+        for (uint64_t recordNumber = firstRecord; recordNumber < lastRecord;) {
+            uint64_t count = std::min<uint64_t>(lastRecord - recordNumber, blockSize / recordSize);
+            uint64_t offset = static_cast<uint64_t>(run.lcn) * geometry_.clusterSize + (recordNumber * recordSize - start);
+            size_t want = static_cast<size_t>(count * recordSize);
+            long long read = reader_.ReadAt(offset, buffer.data(), want);
+            if (read < 0) {
+                error = "MFT read failed with error " + std::to_string(VolumeReader::LastError());
+                return false;
+            }
+
+            uint64_t complete = static_cast<uint64_t>(read) / recordSize;
+            for (uint64_t i = 0; i < complete; ++i) {
+                uint8_t *record = buffer.data() + i * recordSize;
+                if (FixupFileRecord(record, recordSize)) {
+                    visit(recordNumber + i, record, recordSize);
+                }
+            }
+            if (complete < count) {
+                break;
+            }
+            recordNumber += count;
+        }
+    }
+    return true;
+}
+
+bool MftReader::ReadRecords(std::vector<uint64_t> recordNumbers, const std::function<void(uint64_t recordNumber, const uint8_t *record, uint32_t size)> &visit, std::string &error) {
+    std::sort(recordNumbers.begin(), recordNumbers.end());
+    recordNumbers.erase(std::unique(recordNumbers.begin(), recordNumbers.end()), recordNumbers.end());
+
+    struct Wanted {
+        uint64_t recordNumber;
+        uint64_t offset;
+    };
+    std::vector<Wanted> wanted;
+    wanted.reserve(recordNumbers.size());
+    for (uint64_t recordNumber : recordNumbers) {
+        if (recordNumber >= recordCount_) {
+            continue;
+        }
+        uint64_t offset = RecordOffset(recordNumber);
+        if (offset != UINT64_MAX) {
+            wanted.push_back({ recordNumber, offset });
+        }
+    }
+
+    const uint32_t recordSize = geometry_.recordSize;
+    std::vector<uint8_t> buffer;
+    for (size_t first = 0; first < wanted.size();) {
+        // Grow the batch while the next record follows on disk within the gap
+        // limit and the span stays within one sweep block.
+        uint64_t start = wanted[first].offset;
+        uint64_t end = start + recordSize;
+        size_t last = first + 1;
+        while (last < wanted.size() && wanted[last].offset >= end &&
+               wanted[last].offset - end <= kGatherGap &&
+               wanted[last].offset + recordSize - start <= kSweepBlock) {
+            end = wanted[last].offset + recordSize;
+            ++last;
+        }
+
+        size_t span = static_cast<size_t>(end - start);
+        buffer.resize(span);
+        long long read = reader_.ReadAt(start, buffer.data(), span);
+        if (read < 0) {
+            error = "MFT read failed with error " + std::to_string(VolumeReader::LastError());
+            return false;
+        }
+        for (size_t i = first; i < last; ++i) {
+            uint64_t position = wanted[i].offset - start;
+            if (position + recordSize > static_cast<uint64_t>(read)) {
+                break;
+            }
+            uint8_t *record = buffer.data() + position;
+            if (FixupFileRecord(record, recordSize)) {
+                visit(wanted[i].recordNumber, record, recordSize);
+            }
+        }
+        first = last;
+    }
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ntfs_record.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// Raw $MFT access through a VolumeReader, for live volumes and images alike.
+// The $MFT run list comes from record 0 (and its attribute list when the MFT
+// is fragmented enough to need one).
+class MftReader {
+  public:
+    explicit MftReader(VolumeReader &reader);
+
+    bool Open(std::string &error);
+
+    const NtfsGeometry &Geometry() const { return geometry_; }
+    uint32_t RecordSize() const { return geometry_.recordSize; }
+    uint64_t RecordCount() const { return recordCount_; }
+    const std::vector<DataRunSegment> &Runs() const { return runs_; }
+
+    // Volume byte offset of a record, or UINT64_MAX when it maps to a hole.
+    uint64_t RecordOffset(uint64_t recordNumber) const;
+
+    // Reads one record and applies its fixups. False for unreadable, torn or
+    // never-initialised records.
+    bool ReadRecord(uint64_t recordNumber, std::vector<uint8_t> &record);
+
+    // Streams the whole MFT in run order with large sequential reads and calls
+    // visit for every record that carries the FILE magic and survives fixups.
+    // Records are fixed up in place in the read buffer.
+    bool Sweep(const std::function<void(uint64_t recordNumber, const uint8_t *record, uint32_t size)> &visit, std::string &error);
+
+    // Reads a set of records with as few requests as possible: record numbers
+    // are sorted and deduplicated, and records that sit close together on disk
+    // are fetched in one read with the gaps read through. visit is called like
+    // Sweep's, in ascending record order; unreadable or torn records are
+    // skipped.
+    bool ReadRecords(std::vector<uint64_t> recordNumbers, const std::function<void(uint64_t recordNumber, const uint8_t *record, uint32_t size)> &visit, std::string &error);
+
+  private:
+    bool LoadAttributeListRuns(const FileRecordDetails &base, std::string &error);
+
+    VolumeReader &reader_;
+    NtfsGeometry geometry_;
+    uint64_t recordCount_;
+    std::vector<DataRunSegment> runs_;
+};
+
+// Fixes up one record in place; the stride comes from the update sequence
+// array size so 512- and 4096-byte sector volumes both work.
+bool FixupFileRecord(uint8_t *record, uint32_t size);
+
+} // namespace usnscanner
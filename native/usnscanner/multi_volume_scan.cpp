@@ -0,0 +1,175 @@
+#include "multi_volume_scan.h"
+#include "scan_aggregate.h"
+#include "volume_reader.h"
+
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+namespace usnscanner {
+
+namespace {
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t FindGroup(std::vector<size_t> &parent, size_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Volumes sharing any disk end up in one group, numbered in request order.
+std::vector<std::vector<size_t>> GroupByDevice(std::vector<VolumeScanStatus> &volumes) {
+    std::vector<size_t> parent(volumes.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    std::unordered_map<std::string, size_t> owners;
+    for (size_t i = 0; i < volumes.size(); ++i) {
+        for (const std::string &device : volumes[i].devices) {
+            auto owner = owners.emplace(device, i);
+            if (!owner.second) {
+                parent[FindGroup(parent, i)] = FindGroup(parent, owner.first->second);
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> groups;
+    std::unordered_map<size_t, uint32_t> numbers;
+    for (size_t i = 0; i < volumes.size(); ++i) {
+        auto number = numbers.emplace(FindGroup(parent, i), static_cast<uint32_t>(groups.size()));
+        if (number.second) {
+            groups.emplace_back();
+        }
+        volumes[i].group = number.first->second;
+        groups[number.first->second].push_back(i);
+    }
+    return groups;
+}
+
+} // namespace
+
+bool ScanVolumes(
+    const std::vector<VolumeScanRequest> &requests,
+    const VolumeScanProgress &progress,
+    StoredScan &scan,
+    std::vector<VolumeScanStatus> &volumes,
+    std::string &error) {
+    if (requests.empty()) {
+        error = "No volumes to scan";
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    // A volume whose disks cannot be told shares none and runs on its own;
+    // one that cannot be opened fails again, and is reported, in its turn.
+    volumes.assign(requests.size(), VolumeScanStatus{});
+    for (size_t i = 0; i < requests.size(); ++i) {
+        volumes[i].source = requests[i].source;
+        VolumeReader reader;
+        std::string ignored;
+        if (reader.Open(requests[i].source, ignored)) {
+            reader.PhysicalDevices(volumes[i].devices, ignored);
+        }
+    }
+    const std::vector<std::vector<size_t>> groups = GroupByDevice(volumes);
+
+    std::mutex mutex;
+    auto report = [&](size_t i, const std::function<void(VolumeScanStatus &)> &update) {
+        std::lock_guard<std::mutex> lock(mutex);
+        update(volumes[i]);
+        if (progress) {
+            progress(volumes);
+        }
+    };
+
+    std::vector<StoredScan> parts(requests.size());
+    std::vector<uint8_t> scanned(requests.size(), 0);
+    auto scanVolume = [&](size_t i) {
+        report(i, [&](VolumeScanStatus &status) {
+            status.state = VolumeScanState::Scanning;
+            status.waitMs = MillisecondsSince(start);
+        });
+        const auto volumeStart = std::chrono::steady_clock::now();
+        StoredScan &part = parts[i];
+        part.source = requests[i].source;
+
+        VolumeReader reader;
+        std::string volumeError;
+        bool ok = reader.Open(part.source, volumeError) &&
+                  part.tree.Build(reader, [&](uint64_t recordsDone, uint64_t recordCount) {
+                      report(i, [&](VolumeScanStatus &status) {
+                          status.recordsDone = recordsDone;
+                          status.recordCount = recordCount;
+                      });
+                  }, volumeError);
+        if (ok && !requests[i].journal.empty()) {
+            report(i, [](VolumeScanStatus &status) { status.state = VolumeScanState::Journal; });
+            ok = AttachJournal(part, requests[i].journal, volumeError);
+        }
+
+        scanned[i] = ok ? 1 : 0;
+        report(i, [&](VolumeScanStatus &status) {
+            status.state = ok ? VolumeScanState::Done : VolumeScanState::Failed;
+            status.deleted = ok ? part.tree.Entries().size() : 0;
+            status.scanMs = MillisecondsSince(volumeStart);
+            status.error = ok ? std::string() : volumeError;
+        });
+    };
+
+    // One thread per group beyond the first, which runs here.
+    std::vector<std::thread> threads;
+    for (size_t g = 1; g < groups.size(); ++g) {
+        threads.emplace_back([&, g] {
+            for (size_t i : groups[g]) {
+                scanVolume(i);
+            }
+        });
+    }
+    for (size_t i : groups[0]) {
+        scanVolume(i);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    // Merge in request order. Journal columns cover every entry or none, so
+    // volumes scanned without one contribute empty values.
+    bool journal = false;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        journal = journal || (scanned[i] && !parts[i].reasons.empty());
+    }
+    scan = StoredScan{};
+    std::vector<DeletedTree> trees;
+    uint32_t firstEntry = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (!scanned[i]) {
+            continue;
+        }
+        StoredScan &part = parts[i];
+        const size_t entries = part.tree.Entries().size();
+        scan.volumeFirstEntry.push_back(firstEntry);
+        scan.volumes.push_back(part.source);
+        firstEntry += static_cast<uint32_t>(entries);
+        if (journal) {
+            part.reasons.resize(entries, 0);
+            part.deletedAt.resize(entries, 0);
+            scan.reasons.insert(scan.reasons.end(), part.reasons.begin(), part.reasons.end());
+            scan.deletedAt.insert(scan.deletedAt.end(), part.deletedAt.begin(), part.deletedAt.end());
+        }
+        trees.push_back(std::move(part.tree));
+    }
+
+    if (trees.empty()) {
+        error = volumes.front().source + ": " + volumes.front().error;
+        return false;
+    }
+    scan.tree.Merge(std::move(trees), scan.volumes);
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "result_store.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+struct VolumeScanRequest {
+    std::string source;
+    // Change journal to attach (drive letter or $J copy); empty for none.
+    std::string journal;
+};
+
+enum class VolumeScanState : uint8_t {
+    Queued,
+    Scanning,
+    Journal,
+    Done,
+    Failed
+};
+
+struct VolumeScanStatus {
+    std::string source;
+    // Physical disks the volume sits on (VolumeReader::PhysicalDevices).
+    std::vector<std::string> devices;
+    // Volumes in one group share a disk and are scanned one after another;
+    // groups run side by side.
+    uint32_t group;
+    VolumeScanState state;
+    uint64_t recordsDone;
+    uint64_t recordCount;
+    uint64_t deleted;
+    // Time spent waiting behind other volumes of the group, then scanning.
+    double waitMs;
+    double scanMs;
+    std::string error;
+};
+
+// Receives the status of every volume whenever one of them moves on. Calls
+// come from the scanning threads, one at a time.
+using VolumeScanProgress = std::function<void(const std::vector<VolumeScanStatus> &volumes)>;
+
+// Scans several volumes and merges their deleted trees into one scan, one
+// Volume node per volume under the root, in request order. Volumes are
+// grouped by the physical disks they live on: each group gets a thread and
+// walks its volumes in turn, so separate disks are read in parallel while a
+// disk holding several volumes is never made to seek between two MFTs. A
+// volume that fails is reported in `volumes` and left out of the merge; the
+// call only fails when no volume could be scanned.
+bool ScanVolumes(
+    const std::vector<VolumeScanRequest> &requests,
+    const VolumeScanProgress &progress,
+    StoredScan &scan,
+    std::vector<VolumeScanStatus> &volumes,
+    std::string &error);
+
+} // namespace usnscanner
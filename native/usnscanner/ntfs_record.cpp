@@ -0,0 +1,432 @@
+#include "ntfs_record.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kResidentHeaderSize = 0x18;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+std::string ExtractAttributeName(const AttributeRecordHeader *header) {
+    if (!header || header->NameLength == 0) {
+        return std::string();
+    }
+    if (static_cast<uint32_t>(header->NameOffset) + header->NameLength * 2u > header->Length) {
+        return std::string();
+    }
+
+    return Utf16ToUtf8(reinterpret_cast<const uint8_t *>(header) + header->NameOffset, header->NameLength);
+}
+
+} // namespace
+
+std::string Utf16ToUtf8(const uint8_t *data, size_t characters) {
+    std::string output;
+    output.reserve(characters);
+
+    for (size_t i = 0; i < characters; ++i) {
+        uint32_t code = Load<uint16_t>(data + i * 2);
+        if (code >= 0xD800 && code <= 0xDBFF && i + 1 < characters) {
+            uint32_t low = Load<uint16_t>(data + (i + 1) * 2);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+        if (code >= 0xD800 && code <= 0xDFFF) {
+            // Unpaired surrogates are legal in NTFS names but not in UTF-8.
+            code = 0xFFFD;
+        }
+
+        if (code < 0x80) {
+            output.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            output.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            output.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            output.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    return output;
+}
+
+std::string AttributeTypeToString(uint32_t type) {
+    switch (type) {
+        case 0x10: return "StandardInformation";
+        case 0x20: return "AttributeList";
+        case 0x30: return "FileName";
+        case 0x40: return "ObjectId";
+        case 0x50: return "SecurityDescriptor";
+        case 0x60: return "VolumeName";
+        case 0x70: return "VolumeInformation";
+        case 0x80: return "Data";
+        case 0x90: return "IndexRoot";
+        case 0xA0: return "IndexAllocation";
+        case 0xB0: return "Bitmap";
+        case 0xC0: return "ReparsePoint";
+        case 0xD0: return "EAInformation";
+        case 0xE0: return "EA";
+        case 0xF0: return "PropertySet";
+        case 0x100: return "LoggedUtilityStream";
+        default: return "Unknown";
+    }
+}
+
+long long ReadSignedValue(const uint8_t *data, int size) {
+    if (size <= 0 || size > 8) {
+        return 0;
+    }
+
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+
+    if (size < 8 && (data[size - 1] & 0x80)) {
+        value |= ~((1ULL << (size * 8)) - 1);
+    }
+
+    return static_cast<long long>(value);
+}
+
+std::vector<DataRunSegment> ParseRunList(const AttributeRecordHeader *header) {
+    std::vector<DataRunSegment> runs;
+    if (!header || header->NonResident == 0 || header->NonResidentData.RunOffset >= header->Length) {
+        return runs;
+    }
+
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(header);
+    const uint8_t *runPtr = base + header->NonResidentData.RunOffset;
+    const uint8_t *end = base + header->Length;
+
+    long long currentVCN = static_cast<long long>(header->NonResidentData.LowestVcn);
+    long long currentLCN = 0;
+
+    while (runPtr < end && *runPtr != 0) {
+        uint8_t headerByte = *runPtr++;
+        int lengthFieldSize = headerByte & 0x0F;
+        int offsetFieldSize = (headerByte >> 4) & 0x0F;
+
+        if (lengthFieldSize <= 0 || lengthFieldSize > 8 || offsetFieldSize > 8 ||
+            runPtr + lengthFieldSize + offsetFieldSize > end) {
+            break;
+        }
+
+        long long runLength = 0;
+        for (int i = 0; i < lengthFieldSize; ++i) {
+            runLength |= static_cast<long long>(runPtr[i]) << (8 * i);
+        }
+        runPtr += lengthFieldSize;
+
+        bool sparse = (offsetFieldSize == 0);
+        long long runOffset = ReadSignedValue(runPtr, offsetFieldSize);
+        runPtr += offsetFieldSize;
+
+        currentLCN += runOffset;
+        runs.push_back({ currentVCN, currentLCN, runLength, sparse });
+        currentVCN += runLength;
+    }
+
+    return runs;
+}
+
+bool ParseFileRecord(const uint8_t *buffer, uint32_t length, FileRecordDetails &details) {
+    if (!buffer || length < sizeof(FileRecordHeader)) {
+        return false;
+    }
+
+    const FileRecordHeader *header = reinterpret_cast<const FileRecordHeader *>(buffer);
+    if (header->Magic != kFileRecordMagic) {
+        return false;
+    }
+
+    details.inUse = (header->Flags & 0x0001) != 0;
+    details.isDirectory = (header->Flags & 0x0002) != 0;
+    details.baseReference = header->BaseFileRecord;
+    details.sequenceNumber = header->SequenceNumber;
+    details.hardLinkCount = header->HardLinkCount;
+    details.flags = header->Flags;
+    details.attributes.clear();
+    details.bytesPerSector = 0;
+    details.sectorsPerCluster = 0;
+    details.clusterSize = 0;
+
+    if (header->BytesInUse != 0 && header->BytesInUse < length) {
+        length = header->BytesInUse;
+    }
+    if (header->FirstAttributeOffset >= length) {
+        return false;
+    }
+
+    const uint8_t *attrPtr = buffer + header->FirstAttributeOffset;
+    const uint8_t *end = buffer + length;
+
+    // Resident headers are shorter than the full (non-resident) struct, so
+    // only the common part is required up front.
+    while (end - attrPtr >= 4) {
+        const AttributeRecordHeader *attr = reinterpret_cast<const AttributeRecordHeader *>(attrPtr);
+        if (attr->Type == kAttributeEnd || static_cast<size_t>(end - attrPtr) < kResidentHeaderSize || attr->Length == 0) {
+            break;
+        }
+        size_t minimum = attr->NonResident ? sizeof(AttributeRecordHeader) : kResidentHeaderSize;
+        if (attr->Length < minimum || attr->Length > static_cast<size_t>(end - attrPtr)) {
+            break;
+        }
+
+        AttributeInfo info{};
+        info.type = attr->Type;
+        info.typeName = AttributeTypeToString(attr->Type);
+        info.nonResident = attr->NonResident != 0;
+        info.name = ExtractAttributeName(attr);
+        info.dataSize = 0;
+        info.allocatedSize = 0;
+
+        if (info.nonResident) {
+            info.dataSize = attr->NonResidentData.DataSize;
+            info.allocatedSize = attr->NonResidentData.AllocatedSize;
+            info.compressionUnit = static_cast<uint8_t>(attr->NonResidentData.CompressionUnit);
+            info.runs = ParseRunList(attr);
+        } else {
+            info.dataSize = attr->Resident.ValueLength;
+            info.allocatedSize = attr->Resident.ValueLength;
+            uint32_t valueOffset = attr->Resident.ValueOffset;
+            uint32_t valueLength = attr->Resident.ValueLength;
+            if (valueLength > 0 && valueOffset <= attr->Length && valueLength <= attr->Length - valueOffset) {
+                const uint8_t *valuePtr = reinterpret_cast<const uint8_t *>(attr) + valueOffset;
+                info.residentData.assign(valuePtr, valuePtr + valueLength);
+            }
+        }
+
+        details.attributes.push_back(std::move(info));
+        attrPtr += attr->Length;
+    }
+
+    return true;
+}
+
+bool ApplyFixups(uint8_t *record, size_t length, uint32_t sectorSize) {
+    if (length < 8 || sectorSize < 8) {
+        return false;
+    }
+
+    uint16_t usaOffset = Load<uint16_t>(record + 4);
+    uint16_t usaCount = Load<uint16_t>(record + 6);
+    if (usaCount < 2 || (usaCount - 1) * static_cast<size_t>(sectorSize) > length ||
+        usaOffset < 8 || usaOffset + usaCount * 2u > length || (usaOffset & 1) != 0) {
+        return false;
+    }
+
+    uint16_t sequence = Load<uint16_t>(record + usaOffset);
+    for (uint16_t i = 1; i < usaCount; ++i) {
+        uint8_t *tail = record + i * static_cast<size_t>(sectorSize) - 2;
+        if (Load<uint16_t>(tail) != sequence) {
+            return false;
+        }
+        std::memcpy(tail, record + usaOffset + i * 2, 2);
+    }
+
+    return true;
+}
+
+bool ParseFileName(const std::vector<uint8_t> &value, FileNameInfo &info) {
+    if (value.size() < 66) {
+        return false;
+    }
+
+    const uint8_t *data = value.data();
+    size_t nameLength = data[64];
+    if (66 + nameLength * 2 > value.size() || nameLength == 0) {
+        return false;
+    }
+
+    info.parentReference = Load<uint64_t>(data);
+    info.created = Load<uint64_t>(data + 8);
+    info.modified = Load<uint64_t>(data + 16);
+    info.mftModified = Load<uint64_t>(data + 24);
+    info.accessed = Load<uint64_t>(data + 32);
+    info.allocatedSize = Load<uint64_t>(data + 40);
+    info.dataSize = Load<uint64_t>(data + 48);
+    info.attributes = Load<uint32_t>(data + 56);
+    info.nameSpace = data[65];
+    info.name = Utf16ToUtf8(data + 66, nameLength);
+    return true;
+}
+
+int NamespaceRank(uint8_t nameSpace) {
+    switch (nameSpace) {
+        case 1: return 0; // Win32
+        case 3: return 0; // Win32 and DOS
+        case 0: return 1; // POSIX
+        default: return 2; // DOS 8.3
+    }
+}
+
+std::vector<FileNameInfo> ReadLinkNames(const FileRecordDetails &details) {
+    std::vector<FileNameInfo> names;
+    for (const auto &attribute : details.attributes) {
+        FileNameInfo name{};
+        if (attribute.type == kAttributeFileName && !attribute.nonResident && ParseFileName(attribute.residentData, name)) {
+            names.push_back(std::move(name));
+        }
+    }
+    // Best names first, so an alias is always checked against the long name.
+    std::stable_sort(names.begin(), names.end(), [](const FileNameInfo &a, const FileNameInfo &b) {
+        return NamespaceRank(a.nameSpace) < NamespaceRank(b.nameSpace);
+    });
+
+    std::vector<FileNameInfo> links;
+    for (auto &name : names) {
+        bool redundant = false;
+        for (const auto &kept : links) {
+            if (kept.parentReference == name.parentReference &&
+                (name.nameSpace == 2 || kept.name == name.name)) {
+                redundant = true;
+                break;
+            }
+        }
+        if (!redundant) {
+            links.push_back(std::move(name));
+        }
+    }
+    return links;
+}
+
+bool AddNameLink(std::vector<NameLink> &links, uint32_t &head, uint64_t parentReference, const std::string &name) {
+    uint32_t *tail = &head;
+    while (*tail != kNoNameLink) {
+        const NameLink &link = links[*tail];
+        if (link.parentReference == parentReference && link.name == name) {
+            return false;
+        }
+        tail = &links[*tail].next;
+    }
+    *tail = static_cast<uint32_t>(links.size());
+    links.push_back({ parentReference, name, kNoNameLink });
+    return true;
+}
+
+bool ParseStandardInformation(const std::vector<uint8_t> &value, StandardInformation &info) {
+    if (value.size() < 36) {
+        return false;
+    }
+
+    const uint8_t *data = value.data();
+    info.created = Load<uint64_t>(data);
+    info.modified = Load<uint64_t>(data + 8);
+    info.mftModified = Load<uint64_t>(data + 16);
+    info.accessed = Load<uint64_t>(data + 24);
+    info.attributes = Load<uint32_t>(data + 32);
+    return true;
+}
+
+DataStreamSummary SummarizeData(const FileRecordDetails &details) {
+    DataStreamSummary summary{};
+    long long nextLcn = -1;
+    for (const auto &attribute : details.attributes) {
+        if (attribute.type != kAttributeData || !attribute.name.empty()) {
+            continue;
+        }
+        // Sizes come from the first piece; later pieces of a long run list
+        // (non-zero lowest VCN) carry zeros there.
+        if (!summary.present) {
+            summary.present = true;
+            summary.resident = !attribute.nonResident;
+            summary.dataSize = attribute.dataSize;
+            summary.allocatedSize = attribute.allocatedSize;
+        }
+        for (const auto &run : attribute.runs) {
+            if (run.sparse || run.length <= 0) {
+                continue;
+            }
+            if (run.lcn != nextLcn) {
+                ++summary.fragments;
+            }
+            nextLcn = run.lcn + run.length;
+        }
+    }
+    return summary;
+}
+
+bool SlotReused(uint64_t reference, uint16_t recordSequence, bool recordInUse) {
+    uint16_t sequence = ReferenceSequence(reference);
+    if (sequence == 0) {
+        return false;
+    }
+    if (recordInUse) {
+        return recordSequence != sequence;
+    }
+    // Freeing the file itself bumps the number once; 0 is skipped on wrap.
+    uint16_t freed = static_cast<uint16_t>(sequence + 1) == 0 ? 1 : static_cast<uint16_t>(sequence + 1);
+    return recordSequence != sequence && recordSequence != freed;
+}
+
+bool ReadNtfsGeometry(VolumeReader &reader, NtfsGeometry &geometry) {
+    uint8_t boot[512];
+    if (reader.ReadAt(0, boot, sizeof(boot)) != static_cast<long long>(sizeof(boot))) {
+        return false;
+    }
+    if (std::memcmp(boot + 3, "NTFS    ", 8) != 0) {
+        return false;
+    }
+
+    uint32_t bytesPerSector = Load<uint16_t>(boot + 0x0B);
+    uint32_t sectorsPerCluster = boot[0x0D];
+    // Values above 0x80 encode 2^(256 - n) sectors (64 KB+ clusters).
+    if (sectorsPerCluster > 0x80) {
+        sectorsPerCluster = 1u << (256 - sectorsPerCluster);
+    }
+    if (bytesPerSector < 256 || bytesPerSector > 4096 || (bytesPerSector & (bytesPerSector - 1)) != 0 ||
+        sectorsPerCluster == 0 || (sectorsPerCluster & (sectorsPerCluster - 1)) != 0) {
+        return false;
+    }
+
+    uint32_t clusterSize = bytesPerSector * sectorsPerCluster;
+    int8_t recordClusters = static_cast<int8_t>(boot[0x40]);
+    uint32_t recordSize = recordClusters < 0 ? (1u << -recordClusters) : clusterSize * static_cast<uint32_t>(recordClusters);
+    if (recordSize < 256 || recordSize > 65536) {
+        return false;
+    }
+
+    geometry.bytesPerSector = bytesPerSector;
+    geometry.clusterSize = clusterSize;
+    geometry.recordSize = recordSize;
+    geometry.mftCluster = Load<uint64_t>(boot + 0x30);
+    geometry.totalSectors = Load<uint64_t>(boot + 0x28);
+    return true;
+}
+
+double FileTimeToUnixMs(uint64_t fileTime) {
+    const long long WINDOWS_EPOCH_OFFSET_MS = 11644473600000LL;
+    const long long HUNDRED_NANOSECONDS_PER_MILLISECOND = 10000LL;
+
+    long long unixMs = static_cast<long long>(fileTime / HUNDRED_NANOSECONDS_PER_MILLISECOND) - WINDOWS_EPOCH_OFFSET_MS;
+    return static_cast<double>(unixMs);
+}
+
+uint64_t CurrentFileTime() {
+    const uint64_t UNIX_EPOCH_TICKS = 116444736000000000ULL;
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto ticks = std::chrono::duration_cast<std::chrono::microseconds>(now).count() * 10;
+    return UNIX_EPOCH_TICKS + static_cast<uint64_t>(ticks);
+}
+
+} // namespace usnscanner
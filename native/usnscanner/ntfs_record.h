@@ -0,0 +1,218 @@
+#pragma once
+
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+#pragma pack(push, 1)
+struct FileRecordHeader {
+    uint32_t Magic; // 'FILE'
+    uint16_t UpdateSequenceOffset;
+    uint16_t UpdateSequenceSize;
+    uint64_t LogFileSequenceNumber;
+    uint16_t SequenceNumber;
+    uint16_t HardLinkCount;
+    uint16_t FirstAttributeOffset;
+    uint16_t Flags;
+    uint32_t BytesInUse;
+    uint32_t BytesAllocated;
+    uint64_t BaseFileRecord;
+    uint16_t NextAttributeId;
+    uint16_t Padding;
+    uint32_t MftRecordNumber;
+};
+
+struct AttributeRecordHeader {
+    uint32_t Type;
+    uint32_t Length;
+    uint8_t NonResident;
+    uint8_t NameLength;
+    uint16_t NameOffset;
+    uint16_t Flags;
+    uint16_t Instance;
+    union {
+        struct {
+            uint32_t ValueLength;
+            uint16_t ValueOffset;
+            uint8_t Flags;
+            uint8_t Reserved;
+        } Resident;
+        struct {
+            uint64_t LowestVcn;
+            uint64_t HighestVcn;
+            uint16_t RunOffset;
+            uint16_t CompressionUnit;
+            uint32_t Padding;
+            uint64_t AllocatedSize;
+            uint64_t DataSize;
+            uint64_t InitializedSize;
+            uint64_t CompressedSize;
+        } NonResidentData;
+    };
+};
+#pragma pack(pop)
+
+const uint32_t kFileRecordMagic = 0x454C4946; // 'FILE'
+const uint32_t kAttributeStandardInformation = 0x10;
+const uint32_t kAttributeFileName = 0x30;
+const uint32_t kAttributeData = 0x80;
+const uint32_t kAttributeReparsePoint = 0xC0;
+const uint32_t kAttributeEnd = 0xFFFFFFFF;
+
+// File references hold the MFT record number in the low 48 bits and the
+// record's sequence number, as of when the reference was taken, in the high
+// 16. The sequence number is bumped whenever a record is freed, so it tells a
+// file apart from a later occupant of the same slot.
+const uint64_t kFileReferenceMask = 0x0000FFFFFFFFFFFFULL;
+
+inline uint64_t ReferenceRecordNumber(uint64_t reference) { return reference & kFileReferenceMask; }
+inline uint16_t ReferenceSequence(uint64_t reference) { return static_cast<uint16_t>(reference >> 48); }
+inline uint64_t MakeFileReference(uint64_t recordNumber, uint16_t sequence) {
+    return (static_cast<uint64_t>(sequence) << 48) | (recordNumber & kFileReferenceMask);
+}
+
+struct DataRunSegment {
+    long long vcnStart;
+    long long lcn;
+    long long length;
+    bool sparse;
+};
+
+struct AttributeInfo {
+    uint32_t type;
+    std::string typeName;
+    bool nonResident;
+    std::string name;
+    uint64_t dataSize;
+    uint64_t allocatedSize;
+    // log2 of clusters per compression unit; 0 when not compressed.
+    uint8_t compressionUnit;
+    std::vector<DataRunSegment> runs;
+    std::vector<uint8_t> residentData;
+};
+
+struct FileRecordDetails {
+    bool inUse;
+    bool isDirectory;
+    uint64_t baseReference;
+    uint16_t sequenceNumber;
+    uint32_t hardLinkCount;
+    uint32_t flags;
+    std::vector<AttributeInfo> attributes;
+    uint32_t bytesPerSector;
+    uint32_t sectorsPerCluster;
+    uint64_t clusterSize;
+};
+
+// Decoded $FILE_NAME value.
+struct FileNameInfo {
+    uint64_t parentReference;
+    uint64_t created;
+    uint64_t modified;
+    uint64_t mftModified;
+    uint64_t accessed;
+    uint64_t allocatedSize;
+    uint64_t dataSize;
+    uint32_t attributes;
+    // 0 POSIX, 1 Win32, 2 DOS, 3 Win32 and DOS.
+    uint8_t nameSpace;
+    std::string name;
+};
+
+// Names of a file beyond its primary one (further hard links). They live in
+// one shared array and are chained per file, so the common single-name file
+// costs only the index of an empty chain.
+struct NameLink {
+    uint64_t parentReference;
+    std::string name;
+    uint32_t next;
+};
+
+const uint32_t kNoNameLink = 0xFFFFFFFF;
+
+// Decoded $STANDARD_INFORMATION timestamps (FILETIME ticks).
+struct StandardInformation {
+    uint64_t created;
+    uint64_t modified;
+    uint64_t mftModified;
+    uint64_t accessed;
+    uint32_t attributes;
+};
+
+// Unnamed $DATA stream as seen from one record. A record whose stream moved
+// to extension records (attribute list) reports present = false.
+struct DataStreamSummary {
+    bool present;
+    bool resident;
+    uint64_t dataSize;
+    uint64_t allocatedSize;
+    // Discontiguous extents of allocated clusters; 0 for resident data.
+    uint32_t fragments;
+};
+
+// Geometry from an NTFS boot sector.
+struct NtfsGeometry {
+    uint32_t bytesPerSector;
+    uint32_t clusterSize;
+    uint32_t recordSize;
+    uint64_t mftCluster;
+    uint64_t totalSectors;
+};
+
+std::string Utf16ToUtf8(const uint8_t *data, size_t characters);
+std::string AttributeTypeToString(uint32_t type);
+long long ReadSignedValue(const uint8_t *data, int size);
+std::vector<DataRunSegment> ParseRunList(const AttributeRecordHeader *header);
+
+// Walks the attribute list of a record whose fixups were already applied.
+// Attribute headers, names and run lists are bounds-checked against `length`
+// so stale or carved records cannot read past the buffer.
+bool ParseFileRecord(const uint8_t *buffer, uint32_t length, FileRecordDetails &details);
+
+// Verifies and replaces the update sequence array entries at the end of every
+// sector of a multi-sector record ("FILE", "INDX", "RSTR", "RCRD"). Returns
+// false when a sector does not carry the expected sequence number, i.e. the
+// record is torn or is not a record at all.
+bool ApplyFixups(uint8_t *record, size_t length, uint32_t sectorSize = 512);
+
+bool ParseFileName(const std::vector<uint8_t> &value, FileNameInfo &info);
+
+// Preference among a record's $FILE_NAME namespaces, lower first: Win32 (or
+// Win32 and DOS), then POSIX, then a DOS 8.3 alias.
+int NamespaceRank(uint8_t nameSpace);
+
+// The resident $FILE_NAME values of a record, one per hard link: a DOS 8.3
+// alias is dropped when a Win32 or POSIX name lives in the same directory,
+// and repeats of a name are dropped. The preferred name (Win32, then POSIX,
+// then DOS) comes first. Empty when the record carries no usable name.
+std::vector<FileNameInfo> ReadLinkNames(const FileRecordDetails &details);
+
+// Adds (parentReference, name) to the chain starting at head unless the chain
+// already holds it. Returns false for a repeat.
+bool AddNameLink(std::vector<NameLink> &links, uint32_t &head, uint64_t parentReference, const std::string &name);
+DataStreamSummary SummarizeData(const FileRecordDetails &details);
+
+// True when the record now in a reference's slot belongs to another file: a
+// live record with a different sequence number, or a free one freed more than
+// once since the reference was taken. The contents are then not the named
+// file's. References without a sequence number (0) never count as reused.
+bool SlotReused(uint64_t reference, uint16_t recordSequence, bool recordInUse);
+bool ParseStandardInformation(const std::vector<uint8_t> &value, StandardInformation &info);
+
+// Reads the boot sector at offset 0; false when the source is not an NTFS
+// volume or volume image.
+bool ReadNtfsGeometry(VolumeReader &reader, NtfsGeometry &geometry);
+
+double FileTimeToUnixMs(uint64_t fileTime);
+uint64_t CurrentFileTime();
+
+// 2000-01-01 in FILETIME ticks; older timestamps in carved metadata are noise.
+const uint64_t kFileTimeFloor = 125911584000000000ULL;
+const uint64_t kFileTimeTicksPerDay = 864000000000ULL;
+
+} // namespace usnscanner
@@ -0,0 +1,261 @@
+#include "record_carver.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <tuple>
+
+namespace usnscanner {
+
+namespace {
+
+const uint32_t kSectorSize = 512;
+const uint16_t kRecordInUse = 0x0001;
+const uint16_t kRecordIsDirectory = 0x0002;
+
+bool PlausibleHeader(const FileRecordHeader &header, uint32_t recordSize) {
+    if (recordSize != 0 ? header.BytesAllocated != recordSize
+                        : header.BytesAllocated != 1024 && header.BytesAllocated != 4096) {
+        return false;
+    }
+    if (header.BytesInUse > header.BytesAllocated || header.BytesInUse < sizeof(FileRecordHeader)) {
+        return false;
+    }
+    // One fixup entry per sector; 4K-sector disks use fewer, larger strides.
+    if (header.UpdateSequenceSize < 2) {
+        return false;
+    }
+    uint32_t stride = header.BytesAllocated / (header.UpdateSequenceSize - 1u);
+    if (stride * (header.UpdateSequenceSize - 1u) != header.BytesAllocated || stride < kSectorSize || (stride & (stride - 1)) != 0) {
+        return false;
+    }
+    if (header.UpdateSequenceOffset < 0x28 || header.UpdateSequenceOffset + header.UpdateSequenceSize * 2u > header.FirstAttributeOffset) {
+        return false;
+    }
+    if ((header.FirstAttributeOffset & 7) != 0 || header.FirstAttributeOffset >= header.BytesInUse) {
+        return false;
+    }
+    return (header.Flags & ~0x000Fu) == 0;
+}
+
+} // namespace
+
+FileRecordScanner::FileRecordScanner(uint32_t recordSize) : recordSize_(recordSize) {}
+
+void FileRecordScanner::Begin(size_t workers) {
+    workers_.assign(workers, WorkerState{});
+    records_.clear();
+}
+
+void FileRecordScanner::Scan(const ChunkView &view, size_t worker) {
+    WorkerState &state = workers_[worker];
+
+    // Records sit on sector boundaries of the volume regardless of cluster
+    // size, so a 4-byte compare per sector is the whole filter.
+    size_t first = static_cast<size_t>((kSectorSize - (view.offset % kSectorSize)) % kSectorSize);
+    for (size_t position = first; position < view.owned && position + 4 <= view.size; position += kSectorSize) {
+        uint32_t magic;
+        std::memcpy(&magic, view.data + position, sizeof(magic));
+        if (magic == kFileRecordMagic) {
+            Inspect(view, position, state);
+        }
+    }
+}
+
+void FileRecordScanner::Inspect(const ChunkView &view, size_t position, WorkerState &state) {
+    if (position + sizeof(FileRecordHeader) > view.size) {
+        return;
+    }
+
+    FileRecordHeader header;
+    std::memcpy(&header, view.data + position, sizeof(header));
+    if (!PlausibleHeader(header, recordSize_)) {
+        return;
+    }
+
+    // Fixups rewrite the sector tails, so work on a copy; records cut by the
+    // end of the buffer are completed through the reader.
+    uint32_t size = header.BytesAllocated;
+    state.scratch.resize(size);
+    if (position + size <= view.size) {
+        std::memcpy(state.scratch.data(), view.data + position, size);
+    } else if (view.reader->ReadAt(view.offset + position, state.scratch.data(), size) != static_cast<long long>(size)) {
+        return;
+    }
+
+    uint32_t stride = size / (header.UpdateSequenceSize - 1u);
+    if (!ApplyFixups(state.scratch.data(), size, stride)) {
+        ++state.torn;
+        return;
+    }
+
+    FileRecordDetails details{};
+    if (!ParseFileRecord(state.scratch.data(), size, details)) {
+        return;
+    }
+    if (details.baseReference != 0) {
+        // Extension records carry overflow attributes but no name; they only
+        // matter once their base record is found.
+        ++state.extensions;
+        return;
+    }
+
+    CarvedFileRecord record{};
+    record.offset = view.offset + position;
+    record.recordSize = size;
+    record.recordNumber = header.MftRecordNumber;
+    record.sequence = header.SequenceNumber;
+    record.logSequence = header.LogFileSequenceNumber;
+    record.inUse = (header.Flags & kRecordInUse) != 0;
+    record.isDirectory = (header.Flags & kRecordIsDirectory) != 0;
+
+    bool named = false;
+    for (const auto &attribute : details.attributes) {
+        if (attribute.type == kAttributeFileName && !attribute.nonResident) {
+            FileNameInfo name{};
+            if (ParseFileName(attribute.residentData, name) &&
+                (!named || NamespaceRank(name.nameSpace) < NamespaceRank(record.fileName.nameSpace))) {
+                record.fileName = std::move(name);
+                named = true;
+            }
+        } else if (attribute.type == kAttributeStandardInformation && !attribute.nonResident) {
+            record.hasStandardInformation = ParseStandardInformation(attribute.residentData, record.standardInformation);
+        } else if (attribute.type == kAttributeData && attribute.name.empty()) {
+            if (!record.hasData) {
+                record.hasData = true;
+                record.resident = !attribute.nonResident;
+                record.dataSize = attribute.dataSize;
+                record.allocatedSize = attribute.allocatedSize;
+                record.compressionUnit = attribute.compressionUnit;
+                record.residentData = attribute.residentData;
+            }
+            if (attribute.nonResident) {
+                record.runs.insert(record.runs.end(), attribute.runs.begin(), attribute.runs.end());
+            }
+        }
+    }
+
+    // A record without a name cannot be presented or placed in a directory;
+    // it is almost always a wiped or half-initialised slot.
+    if (!named) {
+        return;
+    }
+
+    state.records.push_back(std::move(record));
+}
+
+void FileRecordScanner::End() {
+    size_t total = 0;
+    for (const auto &state : workers_) {
+        total += state.records.size();
+    }
+
+    records_.clear();
+    records_.reserve(total);
+    for (auto &state : workers_) {
+        std::move(state.records.begin(), state.records.end(), std::back_inserter(records_));
+        state.records.clear();
+        state.scratch.clear();
+    }
+
+    // The same record often survives in several old MFT copies; keep the
+    // newest copy (highest $LogFile sequence) of each record version.
+    auto key = [](const CarvedFileRecord &record) {
+        return std::tie(record.recordNumber, record.sequence, record.fileName.parentReference, record.fileName.name);
+    };
+    std::sort(records_.begin(), records_.end(), [&](const CarvedFileRecord &a, const CarvedFileRecord &b) {
+        if (key(a) != key(b)) {
+            return key(a) < key(b);
+        }
+        if (a.logSequence != b.logSequence) {
+            return a.logSequence > b.logSequence;
+        }
+        return a.offset < b.offset;
+    });
+    records_.erase(std::unique(records_.begin(), records_.end(), [&](const CarvedFileRecord &a, const CarvedFileRecord &b) {
+        return key(a) == key(b);
+    }), records_.end());
+
+    std::sort(records_.begin(), records_.end(), [](const CarvedFileRecord &a, const CarvedFileRecord &b) {
+        return a.offset < b.offset;
+    });
+}
+
+void FileRecordScanner::Score(const std::vector<ByteRange> &freeRanges, uint64_t clusterSize) {
+    std::vector<ByteRange> sorted(freeRanges);
+    std::sort(sorted.begin(), sorted.end(), [](const ByteRange &a, const ByteRange &b) {
+        return a.offset < b.offset;
+    });
+
+    // Bytes of [offset, offset + length) covered by the free ranges.
+    auto freeBytes = [&](uint64_t offset, uint64_t length) {
+        uint64_t end = offset + length;
+        auto it = std::upper_bound(sorted.begin(), sorted.end(), offset, [](uint64_t value, const ByteRange &range) {
+            return value < range.offset;
+        });
+        if (it != sorted.begin()) {
+            --it;
+        }
+        uint64_t covered = 0;
+        for (; it != sorted.end() && it->offset < end; ++it) {
+            uint64_t from = std::max(offset, it->offset);
+            uint64_t to = std::min(end, it->offset + it->length);
+            if (to > from) {
+                covered += to - from;
+            }
+        }
+        return covered;
+    };
+
+    for (auto &record : records_) {
+        if (!record.hasData) {
+            record.recoveryChance = 0;
+            continue;
+        }
+        if (record.resident) {
+            // The contents travelled with the record itself.
+            record.recoveryChance = record.residentData.size() == record.dataSize ? 95 : 0;
+            continue;
+        }
+
+        uint64_t total = 0;
+        uint64_t available = 0;
+        bool valid = clusterSize != 0;
+        for (const auto &run : record.runs) {
+            if (run.sparse) {
+                continue;
+            }
+            if (run.lcn < 0 || run.length <= 0) {
+                valid = false;
+                break;
+            }
+            uint64_t bytes = static_cast<uint64_t>(run.length) * clusterSize;
+            total += bytes;
+            available += freeBytes(static_cast<uint64_t>(run.lcn) * clusterSize, bytes);
+        }
+
+        if (!valid || total == 0) {
+            record.recoveryChance = 0;
+            continue;
+        }
+        record.recoveryChance = static_cast<uint8_t>((available * 90) / total);
+    }
+}
+
+uint64_t FileRecordScanner::Torn() const {
+    uint64_t total = 0;
+    for (const auto &state : workers_) {
+        total += state.torn;
+    }
+    return total;
+}
+
+uint64_t FileRecordScanner::Extensions() const {
+    uint64_t total = 0;
+    for (const auto &state : workers_) {
+        total += state.extensions;
+    }
+    return total;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "carver.h"
+#include "ntfs_record.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// A FILE record found outside the live MFT (old MFT extents, rewritten or
+// shrunk MFT). Timestamps are FILETIME ticks.
+struct CarvedFileRecord {
+    uint64_t offset;
+    uint32_t recordSize;
+    uint32_t recordNumber;
+    uint16_t sequence;
+    uint64_t logSequence;
+    bool inUse;
+    bool isDirectory;
+    // Best $FILE_NAME: Win32 over POSIX over DOS.
+    FileNameInfo fileName;
+    bool hasStandardInformation;
+    StandardInformation standardInformation;
+    // Unnamed $DATA stream.
+    bool hasData;
+    bool resident;
+    uint64_t dataSize;
+    uint64_t allocatedSize;
+    uint8_t compressionUnit;
+    std::vector<DataRunSegment> runs;
+    std::vector<uint8_t> residentData;
+    // Set by Score(): 0-100 from how much of the run list is still free.
+    uint8_t recoveryChance;
+};
+
+// Finds orphaned MFT records while the carve engine streams the source, so the
+// pass costs no extra reads. Candidates are "FILE" magics on sector
+// boundaries; each is fixed up on a private copy and validated with
+// ParseFileRecord before it is kept.
+class FileRecordScanner : public ChunkScanner {
+  public:
+    // recordSize is the volume's MFT record size when known, or 0 to trust
+    // each record header (1024 or 4096).
+    explicit FileRecordScanner(uint32_t recordSize);
+
+    size_t RequiredOverlap() const override { return 4096; }
+    void Begin(size_t workers) override;
+    void Scan(const ChunkView &view, size_t worker) override;
+    void End() override;
+
+    // Rates each record by the share of its data clusters that lie inside
+    // `freeRanges` (sorted byte ranges); clusters that were reallocated since
+    // the record was orphaned no longer hold its contents.
+    void Score(const std::vector<ByteRange> &freeRanges, uint64_t clusterSize);
+
+    const std::vector<CarvedFileRecord> &Records() const { return records_; }
+    uint64_t Torn() const;
+    uint64_t Extensions() const;
+
+  private:
+    struct WorkerState {
+        std::vector<CarvedFileRecord> records;
+        std::vector<uint8_t> scratch;
+        uint64_t torn;
+        uint64_t extensions;
+    };
+
+    void Inspect(const ChunkView &view, size_t position, WorkerState &state);
+
+    uint32_t recordSize_;
+    std::vector<WorkerState> workers_;
+    std::vector<CarvedFileRecord> records_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,264 @@
+#include "resident_export.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace usnscanner {
+
+namespace {
+
+const uint16_t kRecordInUse = 0x0001;
+const uint16_t kRecordIsDirectory = 0x0002;
+const size_t kTarBlock = 512;
+// ustar names are 100 bytes including the terminator; directory output uses
+// the same limit so both modes produce identical names.
+const size_t kMaxOutputName = 99;
+const size_t kArchiveBuffer = 1 << 20;
+// Numeric ustar fields hold 11 octal digits, so members stop short of 8 GiB.
+const uint64_t kMaxTarOctal = (1ULL << 33) - 1;
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string OutputName(uint64_t recordNumber, const std::string &name) {
+    std::string result = std::to_string(recordNumber);
+    if (name.empty()) {
+        return result;
+    }
+    result.push_back('_');
+    for (char c : name) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        result.push_back(byte < 0x20 || std::strchr("<>:\"/\\|?*", c) ? '_' : c);
+    }
+    if (result.size() > kMaxOutputName) {
+        // Do not cut a UTF-8 sequence in half.
+        size_t length = kMaxOutputName;
+        while (length > 0 && (static_cast<unsigned char>(result[length]) & 0xC0) == 0x80) {
+            --length;
+        }
+        result.resize(length);
+    }
+    // Windows drops trailing dots and spaces.
+    if (result.back() == '.' || result.back() == ' ') {
+        result.back() = '_';
+    }
+    return result;
+}
+
+void PutOctal(char *out, int width, uint64_t value) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + (value & 7));
+        value >>= 3;
+    }
+}
+
+// Streams a POSIX ustar archive: a 512-byte header per member, the data padded
+// to a block, and two zero blocks at the end. No index or checksums over the
+// data are needed, so members are written as they are found.
+class TarWriter {
+  public:
+    TarWriter() : buffer_(kArchiveBuffer) {}
+
+    bool Open(const std::string &path, std::string &error) {
+        out_.rdbuf()->pubsetbuf(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.open(std::filesystem::u8path(path), std::ios::binary | std::ios::trunc);
+        if (!out_) {
+            error = "Cannot create archive " + path;
+            return false;
+        }
+        return true;
+    }
+
+    // Fails without writing anything for a member of 8 GiB or more; check
+    // Failed() to tell that apart from a broken archive.
+    bool Add(const std::string &name, const uint8_t *data, size_t size, uint64_t modifiedUnix) {
+        if (size > kMaxTarOctal) {
+            return false;
+        }
+        char header[kTarBlock] = {};
+        std::memcpy(header, name.data(), std::min(name.size(), kMaxOutputName));
+        std::memcpy(header + 100, "0000644", 7);
+        std::memcpy(header + 108, "0000000", 7);
+        std::memcpy(header + 116, "0000000", 7);
+        PutOctal(header + 124, 11, size);
+        PutOctal(header + 136, 11, std::min(modifiedUnix, kMaxTarOctal));
+        header[156] = '0';
+        std::memcpy(header + 257, "ustar", 6);
+        std::memcpy(header + 263, "00", 2);
+
+        std::memset(header + 148, ' ', 8);
+        unsigned checksum = 0;
+        for (size_t i = 0; i < kTarBlock; ++i) {
+            checksum += static_cast<unsigned char>(header[i]);
+        }
+        PutOctal(header + 148, 6, checksum);
+        header[154] = '\0';
+        header[155] = ' ';
+
+        static const char kPadding[kTarBlock] = {};
+        out_.write(header, kTarBlock);
+        out_.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        out_.write(kPadding, static_cast<std::streamsize>((kTarBlock - size % kTarBlock) % kTarBlock));
+        return static_cast<bool>(out_);
+    }
+
+    bool Failed() const {
+        return !out_;
+    }
+
+    bool Close(std::string &error) {
+        static const char kEnd[2 * kTarBlock] = {};
+        out_.write(kEnd, sizeof(kEnd));
+        out_.close();
+        if (!out_) {
+            error = "Writing the archive failed";
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    std::vector<char> buffer_;
+    std::ofstream out_;
+};
+
+bool WriteFile(const std::filesystem::path &path, const uint8_t *data, size_t size) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+    out.close();
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+ResidentExporter::ResidentExporter(VolumeReader &reader, const ResidentExportOptions &options)
+    : reader_(reader), options_(options), stats_{} {}
+
+bool ResidentExporter::Run(std::string &error) {
+    entries_.clear();
+    stats_ = ResidentExportStats{};
+
+    const bool archive = !options_.archivePath.empty();
+    if (archive == !options_.outputDirectory.empty()) {
+        error = "Exactly one of an output directory or an archive path is required";
+        return false;
+    }
+
+    MftReader mft(reader_);
+    if (!mft.Open(error)) {
+        return false;
+    }
+
+    TarWriter tar;
+    std::filesystem::path directory;
+    if (archive) {
+        if (!tar.Open(options_.archivePath, error)) {
+            return false;
+        }
+    } else {
+        directory = std::filesystem::u8path(options_.outputDirectory);
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            error = "Cannot create output directory: " + ec.message();
+            return false;
+        }
+    }
+
+    bool archiveFailed = false;
+    auto start = std::chrono::steady_clock::now();
+    bool swept = mft.Sweep([&](uint64_t recordNumber, const uint8_t *record, uint32_t size) {
+        ++stats_.records;
+        FileRecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        // Header-only filters keep the parse off the common path: directories,
+        // extension records and, by default, live files never get parsed.
+        if ((header.Flags & kRecordIsDirectory) != 0 || header.BaseFileRecord != 0) {
+            return;
+        }
+        const bool inUse = (header.Flags & kRecordInUse) != 0;
+        if (inUse && !options_.includeLive) {
+            return;
+        }
+
+        FileRecordDetails details{};
+        if (!ParseFileRecord(record, size, details)) {
+            return;
+        }
+
+        const AttributeInfo *data = nullptr;
+        bool hasStandardInformation = false;
+        StandardInformation standardInformation{};
+        for (const auto &attribute : details.attributes) {
+            if (attribute.type == kAttributeData && attribute.name.empty()) {
+                data = &attribute;
+            } else if (attribute.type == kAttributeStandardInformation && !attribute.nonResident) {
+                hasStandardInformation = ParseStandardInformation(attribute.residentData, standardInformation);
+            }
+        }
+        if (!data || data->nonResident) {
+            return;
+        }
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(data->dataSize, data->residentData.size()));
+        if (length == 0 || (options_.maxSize != 0 && length > options_.maxSize)) {
+            return;
+        }
+        ++stats_.candidates;
+
+        // The preferred name comes first.
+        const std::vector<FileNameInfo> links = ReadLinkNames(details);
+        const bool named = !links.empty();
+        const FileNameInfo name = named ? links.front() : FileNameInfo{};
+
+        ResidentExportEntry entry{};
+        entry.recordNumber = recordNumber;
+        entry.sequence = header.SequenceNumber;
+        entry.inUse = inUse;
+        entry.parentReference = named ? name.parentReference : 0;
+        entry.name = named ? name.name : std::string();
+        entry.outputName = OutputName(recordNumber, entry.name);
+        entry.size = length;
+        entry.modified = hasStandardInformation ? standardInformation.modified : name.modified;
+
+        auto writeStart = std::chrono::steady_clock::now();
+        bool written;
+        if (archive) {
+            double modifiedMs = entry.modified != 0 ? FileTimeToUnixMs(entry.modified) : 0;
+            uint64_t modifiedUnix = modifiedMs > 0 ? static_cast<uint64_t>(modifiedMs / 1000) : 0;
+            written = !archiveFailed && tar.Add(entry.outputName, data->residentData.data(), length, modifiedUnix);
+            archiveFailed = tar.Failed();
+        } else {
+            written = WriteFile(directory / std::filesystem::u8path(entry.outputName), data->residentData.data(), length);
+        }
+        stats_.writeMs += MillisecondsSince(writeStart);
+
+        if (!written) {
+            ++stats_.failed;
+            return;
+        }
+        ++stats_.files;
+        stats_.bytes += length;
+        entries_.push_back(std::move(entry));
+    }, error);
+    stats_.sweepMs = MillisecondsSince(start);
+
+    if (archive) {
+        std::string closeError;
+        if (!tar.Close(closeError) && swept) {
+            error = closeError;
+            return false;
+        }
+        if (archiveFailed && swept) {
+            error = "Writing the archive failed";
+            return false;
+        }
+    }
+    return swept;
+}
+
+} // namespace usnscanner
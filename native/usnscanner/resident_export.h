@@ -0,0 +1,67 @@
+#pragma once
+
+#include "mft_reader.h"
+#include "ntfs_record.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+struct ResidentExportOptions {
+    // Exactly one of the two is set: a directory that receives one file per
+    // record, or the path of a ustar archive holding all of them.
+    std::string outputDirectory;
+    std::string archivePath;
+    // Also export records that are still in use.
+    bool includeLive;
+    // Skip payloads larger than this (0 for no limit).
+    uint64_t maxSize;
+};
+
+struct ResidentExportEntry {
+    uint64_t recordNumber;
+    uint16_t sequence;
+    bool inUse;
+    uint64_t parentReference;
+    std::string name;
+    // File name inside the output directory or archive.
+    std::string outputName;
+    uint64_t size;
+    uint64_t modified;
+};
+
+struct ResidentExportStats {
+    uint64_t records;
+    uint64_t candidates;
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t failed;
+    double sweepMs;
+    double writeMs;
+};
+
+// Writes the unnamed resident $DATA of every matching file record while the
+// MFT is swept, so the whole export is one sequential pass over the MFT with
+// no per-file lookups. Output names are "<record>_<name>", which keeps them
+// unique when several deleted files shared a name.
+class ResidentExporter {
+  public:
+    ResidentExporter(VolumeReader &reader, const ResidentExportOptions &options);
+
+    bool Run(std::string &error);
+
+    const std::vector<ResidentExportEntry> &Entries() const { return entries_; }
+    const ResidentExportStats &Stats() const { return stats_; }
+
+  private:
+    VolumeReader &reader_;
+    ResidentExportOptions options_;
+    std::vector<ResidentExportEntry> entries_;
+    ResidentExportStats stats_;
+};
+
+} // namespace usnscanner
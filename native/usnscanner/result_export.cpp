@@ -0,0 +1,188 @@
+#include "result_export.h"
+#include "export_writer.h"
+#include "usn_journal.h"
+
+#include <chrono>
+#include <vector>
+
+namespace usnscanner {
+
+namespace {
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+class RowWriter {
+  public:
+    RowWriter(ExportWriter &out, ExportFormat format, const StoredScan &scan)
+        : out_(out),
+          format_(format),
+          scan_(scan),
+          journal_(scan.reasons.size() == scan.tree.Entries().size() && !scan.reasons.empty()) {}
+
+    void Header() {
+        if (format_ == ExportFormat::Csv) {
+            out_.Append("record,sequence,path,directory,size,allocated,fragments,resident,created,modified,changed,accessed,deleted,reasons,volume\n");
+        }
+    }
+
+    void Write(const DeletedEntry &entry, uint32_t item, const std::string &path) {
+        const uint64_t deletedAt = journal_ ? scan_.deletedAt[item] : 0;
+        reasons_.clear();
+        if (journal_) {
+            AppendUsnReasons(scan_.reasons[item], reasons_);
+        }
+
+        if (format_ == ExportFormat::Csv) {
+            out_.AppendUnsigned(entry.recordNumber);
+            out_.Append(',');
+            out_.AppendUnsigned(entry.sequence);
+            out_.Append(',');
+            out_.AppendCsvField(path);
+            out_.Append(entry.isDirectory ? ",1," : ",0,");
+            out_.AppendUnsigned(entry.size);
+            out_.Append(',');
+            out_.AppendUnsigned(entry.allocatedSize);
+            out_.Append(',');
+            out_.AppendUnsigned(entry.fragments);
+            out_.Append(entry.resident ? ",1," : ",0,");
+            CsvTime(entry.created);
+            out_.Append(',');
+            CsvTime(entry.modified);
+            out_.Append(',');
+            CsvTime(entry.mftModified);
+            out_.Append(',');
+            CsvTime(entry.accessed);
+            out_.Append(',');
+            CsvTime(deletedAt);
+            out_.Append(',');
+            out_.Append(reasons_);
+            out_.Append(',');
+            out_.AppendCsvField(EntrySource(scan_, item));
+            out_.Append('\n');
+            return;
+        }
+
+        out_.Append("{\"record\":");
+        out_.AppendUnsigned(entry.recordNumber);
+        out_.Append(",\"sequence\":");
+        out_.AppendUnsigned(entry.sequence);
+        out_.Append(",\"path\":");
+        out_.AppendJsonString(path);
+        out_.Append(entry.isDirectory ? ",\"directory\":true,\"size\":" : ",\"directory\":false,\"size\":");
+        out_.AppendUnsigned(entry.size);
+        out_.Append(",\"allocated\":");
+        out_.AppendUnsigned(entry.allocatedSize);
+        out_.Append(",\"fragments\":");
+        out_.AppendUnsigned(entry.fragments);
+        out_.Append(entry.resident ? ",\"resident\":true,\"created\":" : ",\"resident\":false,\"created\":");
+        JsonTime(entry.created);
+        out_.Append(",\"modified\":");
+        JsonTime(entry.modified);
+        out_.Append(",\"changed\":");
+        JsonTime(entry.mftModified);
+        out_.Append(",\"accessed\":");
+        JsonTime(entry.accessed);
+        out_.Append(",\"deleted\":");
+        JsonTime(deletedAt);
+        if (journal_) {
+            out_.Append(",\"reasons\":\"");
+            out_.Append(reasons_);
+            out_.Append('"');
+        }
+        out_.Append(",\"volume\":");
+        out_.AppendJsonString(EntrySource(scan_, item));
+        out_.Append("}\n");
+    }
+
+  private:
+    // Unknown times are left empty (CSV) or null (JSON).
+    void CsvTime(uint64_t fileTime) {
+        if (fileTime != 0) {
+            out_.AppendFileTime(fileTime);
+        }
+    }
+
+    void JsonTime(uint64_t fileTime) {
+        if (fileTime == 0) {
+            out_.Append("null");
+            return;
+        }
+        out_.Append('"');
+        out_.AppendFileTime(fileTime);
+        out_.Append('"');
+    }
+
+    ExportWriter &out_;
+    ExportFormat format_;
+    const StoredScan &scan_;
+    const bool journal_;
+    std::string reasons_;
+};
+
+} // namespace
+
+bool ExportScan(const StoredScan &scan, const ExportOptions &options, ExportStats &stats, std::string &error) {
+    const DeletedTree &tree = scan.tree;
+    stats = ExportStats{};
+    if (options.nodeId >= tree.NodeCount()) {
+        error = "Node " + std::to_string(options.nodeId) + " is not part of the scan";
+        return false;
+    }
+
+    ExportWriter out;
+    if (!out.Open(options.path, options.gzip, error)) {
+        return false;
+    }
+    RowWriter writer(out, options.format, scan);
+    writer.Header();
+
+    auto start = std::chrono::steady_clock::now();
+    auto visit = [&](uint32_t id, const std::string &path) {
+        const TreeNode &node = tree.Node(id);
+        if (node.kind == TreeNodeKind::Deleted) {
+            writer.Write(tree.Entries()[node.item], node.item, path);
+            ++stats.rows;
+        }
+    };
+
+    // The path buffer holds the current node's path; each frame remembers
+    // how long it was at that depth so a sibling just truncates and appends.
+    struct Frame {
+        uint32_t node;
+        uint32_t next;
+        size_t pathLength;
+    };
+    std::string path = options.nodeId == 0 ? std::string() : tree.Path(options.nodeId);
+    visit(options.nodeId, path);
+    std::vector<Frame> stack{ { options.nodeId, 0, path.size() } };
+    while (!stack.empty()) {
+        Frame &frame = stack.back();
+        if (frame.next == tree.Node(frame.node).childCount) {
+            stack.pop_back();
+            continue;
+        }
+        uint32_t child = tree.Children(frame.node)[frame.next++];
+        path.resize(frame.pathLength);
+        const std::string &name = tree.Name(child);
+        if (!path.empty() && path.back() != '\\' && (name.empty() || name.front() != '\\')) {
+            path.push_back('\\');
+        }
+        path += name;
+        visit(child, path);
+        if (tree.Node(child).childCount != 0) {
+            stack.push_back({ child, 0, path.size() });
+        }
+    }
+
+    if (!out.Close(error)) {
+        return false;
+    }
+    stats.bytes = out.BytesWritten();
+    stats.fileBytes = out.FileBytes();
+    stats.writeMs = MillisecondsSince(start);
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "result_store.h"
+
+#include <cstdint>
+#include <string>
+
+namespace usnscanner {
+
+enum class ExportFormat : uint8_t {
+    Csv,
+    JsonLines
+};
+
+struct ExportOptions {
+    std::string path;
+    ExportFormat format;
+    bool gzip;
+    // Subtree to export; 0 is the whole scan.
+    uint32_t nodeId;
+};
+
+struct ExportStats {
+    uint64_t rows;
+    // Text produced, and the file size after compression.
+    uint64_t bytes;
+    uint64_t fileBytes;
+    double writeMs;
+};
+
+// Writes one row per deleted file and directory of a stored scan, in tree
+// order (directories first, then by name). The tree is walked depth first
+// with one path buffer that grows and shrinks with the walk, so no row ever
+// exists as anything but bytes in the writer's buffer and memory does not
+// depend on the number of rows. Journal columns are empty when the scan was
+// taken without the change journal; the volume column names the source each
+// row came from, which only varies in a multi-volume scan.
+bool ExportScan(const StoredScan &scan, const ExportOptions &options, ExportStats &stats, std::string &error);
+
+} // namespace usnscanner
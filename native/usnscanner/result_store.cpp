@@ -0,0 +1,64 @@
+#include "result_store.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace usnscanner {
+
+namespace {
+
+std::mutex storeMutex;
+std::unordered_map<uint32_t, std::shared_ptr<const StoredScan>> store;
+uint32_t nextScanId = 1;
+
+} // namespace
+
+uint32_t StoreScan(std::shared_ptr<const StoredScan> scan) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    uint32_t id = nextScanId++;
+    if (nextScanId == 0) {
+        nextScanId = 1;
+    }
+    store[id] = std::move(scan);
+    return id;
+}
+
+std::shared_ptr<const StoredScan> FindScan(uint32_t scanId) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto it = store.find(scanId);
+    return it != store.end() ? it->second : nullptr;
+}
+
+bool ReleaseScan(uint32_t scanId) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return store.erase(scanId) != 0;
+}
+
+const std::string &EntrySource(const StoredScan &scan, uint32_t item) {
+    if (scan.volumes.empty()) {
+        return scan.source;
+    }
+    auto next = std::upper_bound(scan.volumeFirstEntry.begin(), scan.volumeFirstEntry.end(), item);
+    size_t volume = next == scan.volumeFirstEntry.begin() ? 0 : static_cast<size_t>(next - scan.volumeFirstEntry.begin()) - 1;
+    return scan.volumes[std::min(volume, scan.volumes.size() - 1)];
+}
+
+bool NodeSource(const StoredScan &scan, uint32_t nodeId, std::string &source) {
+    if (scan.volumes.empty()) {
+        source = scan.source;
+        return true;
+    }
+    const DeletedTree &tree = scan.tree;
+    uint32_t node = nodeId;
+    for (size_t guard = 0; node != 0 && tree.Node(node).kind != TreeNodeKind::Volume && guard < tree.NodeCount(); ++guard) {
+        node = tree.Node(node).parent;
+    }
+    if (node == 0 || tree.Node(node).reference >= scan.volumes.size()) {
+        return false;
+    }
+    source = scan.volumes[static_cast<size_t>(tree.Node(node).reference)];
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "deleted_tree.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// Scan results kept on the native side between calls, so JS can page
+// through, aggregate or export them by id instead of receiving every row.
+struct StoredScan {
+    std::string source;
+    DeletedTree tree;
+    // Per tree entry, filled when the change journal was read alongside the
+    // MFT (empty otherwise): every reason logged for the file, and the
+    // FILETIME of its delete record or 0.
+    std::vector<uint32_t> reasons;
+    std::vector<uint64_t> deletedAt;
+    // Multi-volume scans: the source behind each Volume node under the root,
+    // in order, and the index of its first entry, entries being grouped by
+    // volume. Both empty for a single-volume scan of `source`.
+    std::vector<std::string> volumes;
+    std::vector<uint32_t> volumeFirstEntry;
+};
+
+// Source a tree entry was read from.
+const std::string &EntrySource(const StoredScan &scan, uint32_t item);
+// Source holding a node's files. Fails for the root of a multi-volume scan,
+// which spans several.
+bool NodeSource(const StoredScan &scan, uint32_t nodeId, std::string &source);
+
+// Registers a scan and returns its id (never 0). Entries stay alive until
+// released, and a reader holding the shared_ptr keeps its scan valid even
+// across a concurrent release.
+uint32_t StoreScan(std::shared_ptr<const StoredScan> scan);
+std::shared_ptr<const StoredScan> FindScan(uint32_t scanId);
+bool ReleaseScan(uint32_t scanId);
+
+} // namespace usnscanner
@@ -0,0 +1,229 @@
+#include "scan_aggregate.h"
+#include "deletion_analytics.h"
+#include "ntfs_record.h"
+#include "usn_journal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+
+namespace usnscanner {
+
+namespace {
+
+const int64_t kFileTimeTicksPerSecond = 10000000;
+const int64_t kUnixEpochSeconds = 11644473600LL;
+const uint32_t kAllReasons = 0xFFFFFFFF;
+
+struct Bucket {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// 0000-01-01 and 9999-12-31 as days since 1970-01-01.
+const int64_t kFirstDay = -719528;
+const int64_t kLastDay = 2932896;
+
+void PutDigits(char *out, int width, uint32_t value) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// Days since 1970-01-01 to a civil date (proleptic Gregorian), clamped to
+// four-digit years.
+std::string DayString(int64_t days) {
+    days = std::clamp(days, kFirstDay, kLastDay) + 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    char text[] = "0000-00-00";
+    PutDigits(text, 4, static_cast<uint32_t>(year));
+    PutDigits(text + 5, 2, static_cast<uint32_t>(month));
+    PutDigits(text + 8, 2, static_cast<uint32_t>(day));
+    return text;
+}
+
+int64_t FileTimeDay(uint64_t fileTime, int32_t utcOffsetMinutes) {
+    int64_t seconds = static_cast<int64_t>(fileTime / kFileTimeTicksPerSecond) - kUnixEpochSeconds + static_cast<int64_t>(utcOffsetMinutes) * 60;
+    return seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+}
+
+template <typename Key>
+std::vector<std::pair<Key, Bucket>> LargestFirst(const std::unordered_map<Key, Bucket> &buckets, size_t top, AggregateTable &table) {
+    std::vector<std::pair<Key, Bucket>> rows(buckets.begin(), buckets.end());
+    auto larger = [](const std::pair<Key, Bucket> &a, const std::pair<Key, Bucket> &b) {
+        return a.second.count != b.second.count ? a.second.count > b.second.count : a.second.bytes > b.second.bytes;
+    };
+    if (rows.size() > top) {
+        std::nth_element(rows.begin(), rows.begin() + top, rows.end(), larger);
+        for (size_t i = top; i < rows.size(); ++i) {
+            ++table.otherKeys;
+            table.otherCount += rows[i].second.count;
+            table.otherBytes += rows[i].second.bytes;
+        }
+        rows.resize(top);
+    }
+    std::sort(rows.begin(), rows.end(), larger);
+    return rows;
+}
+
+} // namespace
+
+AggregateSummary Aggregate(const StoredScan &scan, const std::vector<AggregateKey> &keys, const AggregateOptions &options) {
+    const DeletedTree &tree = scan.tree;
+    const auto &entries = tree.Entries();
+    const bool journal = scan.reasons.size() == entries.size() && !entries.empty();
+
+    bool byReason = false;
+    bool byExtension = false;
+    bool byDirectory = false;
+    bool byDay = false;
+    for (AggregateKey key : keys) {
+        byReason |= key == AggregateKey::Reason;
+        byExtension |= key == AggregateKey::Extension;
+        byDirectory |= key == AggregateKey::Directory;
+        byDay |= key == AggregateKey::Day;
+    }
+
+    AggregateSummary summary{};
+    Bucket reasons[32] = {};
+    std::unordered_map<std::string, Bucket> extensions;
+    std::unordered_map<uint32_t, Bucket> directories;
+    std::map<int64_t, Bucket> days;
+    Bucket undated{ 0, 0 };
+
+    std::vector<uint32_t> pending{ options.nodeId };
+    while (!pending.empty()) {
+        uint32_t id = pending.back();
+        pending.pop_back();
+        const TreeNode &node = tree.Node(id);
+        const uint32_t *children = tree.Children(id);
+        pending.insert(pending.end(), children, children + node.childCount);
+        if (node.kind != TreeNodeKind::Deleted) {
+            continue;
+        }
+
+        const DeletedEntry &entry = entries[node.item];
+        if (entry.isDirectory) {
+            continue;
+        }
+        ++summary.files;
+        summary.bytes += entry.size;
+
+        uint32_t reason = journal ? scan.reasons[node.item] : 0;
+        if (reason == 0) {
+            ++summary.withoutJournal;
+        }
+        if (byReason) {
+            for (uint32_t bit = 0; bit < 32 && (reason >> bit) != 0; ++bit) {
+                if ((reason >> bit) & 1) {
+                    ++reasons[bit].count;
+                    reasons[bit].bytes += entry.size;
+                }
+            }
+        }
+        if (byExtension) {
+            Bucket &bucket = extensions[DeletionExtension(entry.name)];
+            ++bucket.count;
+            bucket.bytes += entry.size;
+        }
+        if (byDirectory) {
+            Bucket &bucket = directories[node.parent];
+            ++bucket.count;
+            bucket.bytes += entry.size;
+        }
+        if (byDay) {
+            uint64_t when = journal && scan.deletedAt[node.item] != 0 ? scan.deletedAt[node.item] : entry.mftModified;
+            Bucket &bucket = when != 0 ? days[FileTimeDay(when, options.utcOffsetMinutes)] : undated;
+            ++bucket.count;
+            bucket.bytes += entry.size;
+        }
+    }
+
+    for (AggregateKey key : keys) {
+        AggregateTable table{ key, {}, 0, 0, 0 };
+        switch (key) {
+            case AggregateKey::Reason:
+                for (uint32_t bit = 0; bit < 32; ++bit) {
+                    if (reasons[bit].count == 0) {
+                        continue;
+                    }
+                    const char *name = UsnReasonName(1u << bit);
+                    char unknown[16];
+                    if (!name) {
+                        std::snprintf(unknown, sizeof(unknown), "0x%08X", 1u << bit);
+                        name = unknown;
+                    }
+                    table.rows.push_back({ name, reasons[bit].count, reasons[bit].bytes });
+                }
+                break;
+            case AggregateKey::Extension:
+                for (auto &row : LargestFirst(extensions, options.top, table)) {
+                    table.rows.push_back({ row.first, row.second.count, row.second.bytes });
+                }
+                break;
+            case AggregateKey::Directory:
+                for (auto &row : LargestFirst(directories, options.top, table)) {
+                    table.rows.push_back({ tree.Path(row.first), row.second.count, row.second.bytes });
+                }
+                break;
+            case AggregateKey::Day:
+                for (const auto &row : days) {
+                    table.rows.push_back({ DayString(row.first), row.second.count, row.second.bytes });
+                }
+                if (undated.count != 0) {
+                    table.rows.push_back({ std::string(), undated.count, undated.bytes });
+                }
+                break;
+        }
+        summary.tables.push_back(std::move(table));
+    }
+    return summary;
+}
+
+bool AttachJournal(StoredScan &scan, const std::string &journalSource, std::string &error) {
+    UsnJournalReader journal;
+    if (!journal.Open(journalSource, kAllReasons, true, error)) {
+        return false;
+    }
+
+    const auto &entries = scan.tree.Entries();
+    std::unordered_map<uint64_t, uint32_t> byRecord;
+    byRecord.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        byRecord.emplace(entries[i].recordNumber, static_cast<uint32_t>(i));
+    }
+    scan.reasons.assign(entries.size(), 0);
+    scan.deletedAt.assign(entries.size(), 0);
+
+    std::vector<CarvedUsnRecord> records;
+    while (true) {
+        if (!journal.Next(records, error)) {
+            return false;
+        }
+        if (records.empty()) {
+            return true;
+        }
+        for (const auto &record : records) {
+            auto found = byRecord.find(ReferenceRecordNumber(record.fileRef));
+            if (found == byRecord.end() || SlotReused(record.fileRef, entries[found->second].sequence, false)) {
+                continue;
+            }
+            scan.reasons[found->second] |= record.reason;
+            if ((record.reason & kUsnReasonFileDelete) != 0) {
+                scan.deletedAt[found->second] = record.timestamp;
+            }
+        }
+    }
+}
+
+} // namespace usnscanner
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "result_store.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+enum class AggregateKey : uint8_t {
+    // One row per USN reason bit seen in the journal for the file.
+    Reason,
+    // Lower-cased extension; "" for names without one.
+    Extension,
+    // Path of the directory the file was deleted from.
+    Directory,
+    // Deletion day, "YYYY-MM-DD".
+    Day
+};
+
+struct AggregateOptions {
+    // Subtree to aggregate; 0 is the whole scan.
+    uint32_t nodeId;
+    // Extension and directory tables keep this many rows, largest first,
+    // and fold the rest into the other* totals.
+    size_t top;
+    // Added to timestamps before they are cut into days.
+    int32_t utcOffsetMinutes;
+};
+
+struct AggregateRow {
+    std::string key;
+    uint64_t count;
+    uint64_t bytes;
+};
+
+struct AggregateTable {
+    AggregateKey key;
+    std::vector<AggregateRow> rows;
+    uint64_t otherKeys;
+    uint64_t otherCount;
+    uint64_t otherBytes;
+};
+
+struct AggregateSummary {
+    uint64_t files;
+    uint64_t bytes;
+    // Files the journal said nothing about; they have no reason row and are
+    // dated by their last MFT change instead of their delete record.
+    uint64_t withoutJournal;
+    std::vector<AggregateTable> tables;
+};
+
+// Hash aggregation over the deleted files (not directories) of a stored
+// scan: one pass fills a table per requested key, and only the rows that
+// survive the top cut are turned into strings.
+AggregateSummary Aggregate(const StoredScan &scan, const std::vector<AggregateKey> &keys, const AggregateOptions &options);
+
+// Reads a change journal (drive letter or $J copy) once and records, for
+// every deleted entry of the scan, the union of reasons logged for the file
+// and the time of its delete record. Records of earlier files that used the
+// same MFT slot are told apart by sequence number.
+bool AttachJournal(StoredScan &scan, const std::string &journalSource, std::string &error);
+
+} // namespace usnscanner
@@ -0,0 +1,453 @@
+#include "snapshot.h"
+#include "export_writer.h"
+#include "mft_reader.h"
+#include "ntfs_record.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+namespace usnscanner {
+
+namespace {
+
+// File layout, little endian:
+//   header  "NTFSSNAP", version, cluster size, total sectors, MFT cluster,
+//           time taken, reserved (48 bytes)
+//   entries record number, parent reference, size, modified, sequence,
+//           flags, reserved, name length (38 bytes), then the UTF-8 name
+//   footer  entry count, "SNAPEND" (16 bytes)
+const char kSnapshotMagic[8] = { 'N', 'T', 'F', 'S', 'S', 'N', 'A', 'P' };
+const char kSnapshotEnd[8] = { 'S', 'N', 'A', 'P', 'E', 'N', 'D', 0 };
+const uint32_t kSnapshotVersion = 1;
+const size_t kHeaderSize = 48;
+const size_t kEntrySize = 38;
+const size_t kFooterSize = 16;
+const size_t kReadSize = 1 << 20;
+
+const uint16_t kRecordInUse = 0x0001;
+const uint64_t kRootDirectory = 5;
+const uint8_t kEntryInUse = 0x01;
+const uint8_t kEntryDirectory = 0x02;
+
+template <typename T>
+T Load(const char *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void Store(char *data, T value) {
+    std::memcpy(data, &value, sizeof(T));
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct SnapshotHeader {
+    uint32_t clusterSize;
+    uint64_t totalSectors;
+    uint64_t mftCluster;
+    uint64_t takenAt;
+};
+
+struct SnapshotRecord {
+    uint64_t recordNumber;
+    uint64_t parentReference;
+    uint64_t size;
+    uint64_t modified;
+    uint16_t sequence;
+    uint8_t flags;
+    std::string name;
+};
+
+// Streams a snapshot's entries front to back through one read buffer.
+class SnapshotReader {
+  public:
+    SnapshotReader() : buffer_(kReadSize), begin_(0), end_(0), remaining_(0), count_(0), last_(0) {}
+
+    bool Open(const std::string &path, std::string &error) {
+        in_.open(std::filesystem::u8path(path), std::ios::binary);
+        if (!in_) {
+            error = "Cannot open snapshot " + path;
+            return false;
+        }
+        in_.seekg(0, std::ios::end);
+        const uint64_t fileSize = static_cast<uint64_t>(in_.tellg());
+        char header[kHeaderSize];
+        char footer[kFooterSize];
+        bool read = fileSize >= kHeaderSize + kFooterSize;
+        if (read) {
+            in_.seekg(static_cast<std::streamoff>(fileSize - kFooterSize));
+            in_.read(footer, kFooterSize);
+            in_.seekg(0);
+            in_.read(header, kHeaderSize);
+            read = static_cast<bool>(in_);
+        }
+        if (!read || std::memcmp(header, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+            Load<uint32_t>(header + 8) != kSnapshotVersion) {
+            error = path + " is not a snapshot";
+            return false;
+        }
+        if (std::memcmp(footer + 8, kSnapshotEnd, sizeof(kSnapshotEnd)) != 0) {
+            error = "Snapshot " + path + " is incomplete";
+            return false;
+        }
+        header_.clusterSize = Load<uint32_t>(header + 12);
+        header_.totalSectors = Load<uint64_t>(header + 16);
+        header_.mftCluster = Load<uint64_t>(header + 24);
+        header_.takenAt = Load<uint64_t>(header + 32);
+        count_ = Load<uint64_t>(footer);
+        remaining_ = fileSize - kHeaderSize - kFooterSize;
+        path_ = path;
+        return true;
+    }
+
+    const SnapshotHeader &Header() const { return header_; }
+    uint64_t Count() const { return count_; }
+
+    // False at the end of the entries, and on a corrupt or unsorted entry
+    // with `error` set.
+    bool Next(SnapshotRecord &record, std::string &error) {
+        if (!Fill(kEntrySize)) {
+            if (begin_ != end_) {
+                error = "Snapshot " + path_ + " is truncated";
+            }
+            return false;
+        }
+        const char *entry = buffer_.data() + begin_;
+        record.recordNumber = Load<uint64_t>(entry);
+        record.parentReference = Load<uint64_t>(entry + 8);
+        record.size = Load<uint64_t>(entry + 16);
+        record.modified = Load<uint64_t>(entry + 24);
+        record.sequence = Load<uint16_t>(entry + 32);
+        record.flags = Load<uint8_t>(entry + 34);
+        const size_t nameLength = Load<uint16_t>(entry + 36);
+        if (!Fill(kEntrySize + nameLength)) {
+            error = "Snapshot " + path_ + " is truncated";
+            return false;
+        }
+        record.name.assign(buffer_.data() + begin_ + kEntrySize, nameLength);
+        begin_ += kEntrySize + nameLength;
+
+        // The merge relies on ascending record numbers.
+        if (record.recordNumber < last_) {
+            error = "Snapshot " + path_ + " is not in record order";
+            return false;
+        }
+        last_ = record.recordNumber + 1;
+        return true;
+    }
+
+  private:
+    // Makes at least `want` unread bytes available; false when the entries
+    // end first.
+    bool Fill(size_t want) {
+        if (end_ - begin_ >= want) {
+            return true;
+        }
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+        size_t step = static_cast<size_t>(std::min<uint64_t>(remaining_, buffer_.size() - end_));
+        if (step > 0) {
+            in_.read(buffer_.data() + end_, static_cast<std::streamsize>(step));
+            step = static_cast<size_t>(in_.gcount());
+            end_ += step;
+            remaining_ -= step;
+        }
+        return end_ >= want;
+    }
+
+    std::ifstream in_;
+    std::string path_;
+    SnapshotHeader header_{};
+    std::vector<char> buffer_;
+    size_t begin_;
+    size_t end_;
+    uint64_t remaining_;
+    uint64_t count_;
+    uint64_t last_;
+};
+
+struct DirectoryName {
+    uint64_t parentReference;
+    uint16_t sequence;
+    bool inUse;
+    std::string name;
+};
+
+// Directory paths of one snapshot, resolved on demand and cached by
+// reference. A parent that is missing or whose slot was reused ends the
+// path in an "$Orphan" group, as in the tree view.
+class SnapshotPaths {
+  public:
+    void Add(const SnapshotRecord &record) {
+        directories_[record.recordNumber] = { record.parentReference, record.sequence, (record.flags & kEntryInUse) != 0, record.name };
+    }
+
+    std::string Path(uint64_t parentReference, const std::string &name) {
+        std::string path = Directory(parentReference);
+        path.push_back('\\');
+        path += name;
+        return path;
+    }
+
+  private:
+    const std::string &Directory(uint64_t parentReference) {
+        auto cached = paths_.find(parentReference);
+        if (cached != paths_.end()) {
+            return cached->second;
+        }
+
+        std::string resolved;
+        std::vector<uint64_t> chain;
+        uint64_t current = parentReference;
+        while (ReferenceRecordNumber(current) != kRootDirectory) {
+            auto found = paths_.find(current);
+            if (found != paths_.end()) {
+                resolved = found->second;
+                break;
+            }
+            const uint64_t recordNumber = ReferenceRecordNumber(current);
+            auto directory = directories_.find(recordNumber);
+            if (directory == directories_.end() || chain.size() >= 1024 ||
+                SlotReused(current, directory->second.sequence, directory->second.inUse)) {
+                resolved = "$Orphan\\$Orphan_" + std::to_string(recordNumber);
+                break;
+            }
+            chain.push_back(current);
+            current = directory->second.parentReference;
+        }
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            resolved.push_back('\\');
+            resolved += directories_[ReferenceRecordNumber(*it)].name;
+            paths_.emplace(*it, resolved);
+        }
+        return paths_.emplace(parentReference, resolved).first->second;
+    }
+
+    std::unordered_map<uint64_t, DirectoryName> directories_;
+    std::unordered_map<uint64_t, std::string> paths_;
+};
+
+// Names an entry's path is built from, kept until every directory of both
+// snapshots has been seen.
+struct PendingNames {
+    uint64_t parentReference;
+    std::string name;
+    uint64_t newParentReference;
+    std::string newName;
+    bool fromOld;
+};
+
+} // namespace
+
+bool WriteSnapshot(VolumeReader &reader, const std::string &path, SnapshotStats &stats, std::string &error) {
+    stats = SnapshotStats{};
+    MftReader mft(reader);
+    if (!mft.Open(error)) {
+        return false;
+    }
+
+    ExportWriter out;
+    if (!out.Open(path, false, error)) {
+        return false;
+    }
+    const NtfsGeometry &geometry = mft.Geometry();
+    char header[kHeaderSize] = {};
+    std::memcpy(header, kSnapshotMagic, sizeof(kSnapshotMagic));
+    Store<uint32_t>(header + 8, kSnapshotVersion);
+    Store<uint32_t>(header + 12, geometry.clusterSize);
+    Store<uint64_t>(header + 16, geometry.totalSectors);
+    Store<uint64_t>(header + 24, geometry.mftCluster);
+    Store<uint64_t>(header + 32, CurrentFileTime());
+    out.Append(header, sizeof(header));
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t next = 0;
+    bool swept = mft.Sweep([&](uint64_t recordNumber, const uint8_t *data, uint32_t size) {
+        FileRecordHeader record;
+        std::memcpy(&record, data, sizeof(record));
+        if (record.BaseFileRecord != 0 || recordNumber < next) {
+            return;
+        }
+        FileRecordDetails details{};
+        if (!ParseFileRecord(data, size, details)) {
+            return;
+        }
+        std::vector<FileNameInfo> names = ReadLinkNames(details);
+        if (names.empty()) {
+            return;
+        }
+        const FileNameInfo &name = names.front();
+        uint64_t modified = name.modified;
+        for (const auto &attribute : details.attributes) {
+            StandardInformation info{};
+            if (attribute.type == kAttributeStandardInformation && !attribute.nonResident &&
+                ParseStandardInformation(attribute.residentData, info)) {
+                modified = info.modified;
+                break;
+            }
+        }
+        DataStreamSummary stream = SummarizeData(details);
+        const size_t nameLength = std::min<size_t>(name.name.size(), UINT16_MAX);
+
+        char entry[kEntrySize] = {};
+        Store<uint64_t>(entry, recordNumber);
+        Store<uint64_t>(entry + 8, name.parentReference);
+        Store<uint64_t>(entry + 16, stream.present ? stream.dataSize : name.dataSize);
+        Store<uint64_t>(entry + 24, modified);
+        Store<uint16_t>(entry + 32, record.SequenceNumber);
+        Store<uint8_t>(entry + 34, static_cast<uint8_t>(((record.Flags & kRecordInUse) ? kEntryInUse : 0) | (details.isDirectory ? kEntryDirectory : 0)));
+        Store<uint16_t>(entry + 36, static_cast<uint16_t>(nameLength));
+        out.Append(entry, sizeof(entry));
+        out.Append(name.name.data(), nameLength);
+
+        ++stats.records;
+        stats.directories += details.isDirectory ? 1 : 0;
+        next = recordNumber + 1;
+    }, error);
+    if (!swept) {
+        std::string ignored;
+        out.Close(ignored);
+        return false;
+    }
+
+    char footer[kFooterSize];
+    Store<uint64_t>(footer, stats.records);
+    std::memcpy(footer + 8, kSnapshotEnd, sizeof(kSnapshotEnd));
+    out.Append(footer, sizeof(footer));
+    if (!out.Close(error)) {
+        return false;
+    }
+    stats.bytes = out.BytesWritten();
+    stats.sweepMs = MillisecondsSince(start);
+    return true;
+}
+
+bool DiffSnapshots(
+    const std::string &oldPath,
+    const std::string &newPath,
+    const SnapshotDiffOptions &options,
+    SnapshotDiff &diff,
+    std::string &error) {
+    diff = SnapshotDiff{};
+    SnapshotReader before;
+    SnapshotReader after;
+    if (!before.Open(oldPath, error) || !after.Open(newPath, error)) {
+        return false;
+    }
+    const SnapshotHeader &a = before.Header();
+    const SnapshotHeader &b = after.Header();
+    if (a.clusterSize != b.clusterSize || a.totalSectors != b.totalSectors || a.mftCluster != b.mftCluster) {
+        error = "The snapshots are of different volumes";
+        return false;
+    }
+    diff.oldTakenAt = a.takenAt;
+    diff.newTakenAt = b.takenAt;
+    diff.oldRecords = before.Count();
+    diff.newRecords = after.Count();
+
+    SnapshotPaths oldPaths;
+    SnapshotPaths newPaths;
+    std::vector<PendingNames> pending;
+    size_t kept[3] = {};
+
+    auto add = [&](SnapshotChange change, const SnapshotRecord *o, const SnapshotRecord *n) {
+        uint64_t &count = change == SnapshotChange::Deleted ? diff.deleted : change == SnapshotChange::Renamed ? diff.renamed : diff.reused;
+        ++count;
+        size_t &slots = kept[static_cast<size_t>(change)];
+        if (slots >= options.limit) {
+            return;
+        }
+        ++slots;
+        const SnapshotRecord &primary = o ? *o : *n;
+        SnapshotDiffEntry entry{};
+        entry.change = change;
+        entry.recordNumber = primary.recordNumber;
+        entry.oldSequence = o ? o->sequence : 0;
+        entry.newSequence = n ? n->sequence : 0;
+        entry.directory = (primary.flags & kEntryDirectory) != 0;
+        entry.inPrevious = o != nullptr;
+        entry.size = primary.size;
+        entry.modified = primary.modified;
+        diff.entries.push_back(std::move(entry));
+        pending.push_back({ primary.parentReference, primary.name, n ? n->parentReference : 0, n ? n->name : std::string(), o != nullptr });
+    };
+
+    // One record number, either side possibly absent. A slot still holds
+    // the same file when SlotReused says so for the old reference: same
+    // sequence while live, one more once freed.
+    auto compare = [&](const SnapshotRecord *o, const SnapshotRecord *n) {
+        const bool oldLive = o && (o->flags & kEntryInUse) != 0;
+        const bool newLive = n && (n->flags & kEntryInUse) != 0;
+        if (oldLive) {
+            const bool same = n && !SlotReused(MakeFileReference(o->recordNumber, o->sequence), n->sequence, newLive);
+            if (newLive && same) {
+                if (o->parentReference != n->parentReference || o->name != n->name) {
+                    add(SnapshotChange::Renamed, o, n);
+                }
+            } else if (newLive) {
+                add(SnapshotChange::Reused, o, n);
+            } else {
+                add(SnapshotChange::Deleted, o, n);
+                if (n && !same) {
+                    // The slot was reused and freed again in between.
+                    add(SnapshotChange::Deleted, nullptr, n);
+                }
+            }
+        } else if (newLive) {
+            ++diff.created;
+        } else if (n && (!o || o->sequence != n->sequence)) {
+            add(SnapshotChange::Deleted, nullptr, n);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    SnapshotRecord o;
+    SnapshotRecord n;
+    bool haveOld = before.Next(o, error);
+    bool haveNew = error.empty() && after.Next(n, error);
+    while (error.empty() && (haveOld || haveNew)) {
+        const bool takeOld = haveOld && (!haveNew || o.recordNumber <= n.recordNumber);
+        const bool takeNew = haveNew && (!haveOld || n.recordNumber <= o.recordNumber);
+        compare(takeOld ? &o : nullptr, takeNew ? &n : nullptr);
+        if (takeOld) {
+            if (o.flags & kEntryDirectory) {
+                oldPaths.Add(o);
+            }
+            haveOld = before.Next(o, error);
+        }
+        if (takeNew && error.empty()) {
+            if (n.flags & kEntryDirectory) {
+                newPaths.Add(n);
+            }
+            haveNew = after.Next(n, error);
+        }
+    }
+    if (!error.empty()) {
+        return false;
+    }
+    diff.mergeMs = MillisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < diff.entries.size(); ++i) {
+        SnapshotDiffEntry &entry = diff.entries[i];
+        const PendingNames &names = pending[i];
+        entry.path = names.fromOld ? oldPaths.Path(names.parentReference, names.name) : newPaths.Path(names.parentReference, names.name);
+        if (entry.change != SnapshotChange::Deleted) {
+            entry.newPath = newPaths.Path(names.newParentReference, names.newName);
+        }
+    }
+    diff.resolveMs = MillisecondsSince(start);
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+struct SnapshotStats {
+    uint64_t records;
+    uint64_t directories;
+    uint64_t bytes;
+    double sweepMs;
+};
+
+// Writes every named base record of the volume's MFT, live or freed, to
+// `path`: record number, sequence, in-use and directory flags, primary name
+// with its parent reference, size and modification time. Records go out in
+// ascending record number straight from the MFT sweep, so a snapshot is
+// already sorted by file reference and two of them diff in one merge.
+bool WriteSnapshot(VolumeReader &reader, const std::string &path, SnapshotStats &stats, std::string &error);
+
+enum class SnapshotChange : uint8_t {
+    // Live in the old snapshot and gone from the new one, or created and
+    // deleted in between (inPrevious false).
+    Deleted,
+    // Same file, other name or parent directory.
+    Renamed,
+    // The old file is gone and its MFT slot holds a new one.
+    Reused
+};
+
+struct SnapshotDiffEntry {
+    SnapshotChange change;
+    uint64_t recordNumber;
+    uint16_t oldSequence;
+    uint16_t newSequence;
+    bool directory;
+    bool inPrevious;
+    uint64_t size;
+    uint64_t modified;
+    // Where the file lived: the old snapshot's path when it was in it.
+    std::string path;
+    // Renamed and Reused: the new snapshot's path for the record.
+    std::string newPath;
+};
+
+struct SnapshotDiffOptions {
+    // Entries kept per change kind; the counts cover everything.
+    size_t limit;
+};
+
+struct SnapshotDiff {
+    uint64_t oldTakenAt;
+    uint64_t newTakenAt;
+    uint64_t oldRecords;
+    uint64_t newRecords;
+    uint64_t deleted;
+    uint64_t renamed;
+    uint64_t reused;
+    uint64_t created;
+    // In record order.
+    std::vector<SnapshotDiffEntry> entries;
+    double mergeMs;
+    double resolveMs;
+};
+
+// Merges two snapshots of the same volume on record number, both streamed
+// front to back, and classifies each record by comparing its sequence
+// numbers and in-use flags on either side. Directory names are kept from
+// both passes so paths resolve against the snapshot the file was seen in.
+// Time and reads are linear in the snapshot sizes.
+bool DiffSnapshots(
+    const std::string &oldPath,
+    const std::string &newPath,
+    const SnapshotDiffOptions &options,
+    SnapshotDiff &diff,
+    std::string &error);
+
+} // namespace usnscanner
@@ -0,0 +1,36 @@
+// LZNT1 compression units, driven through decodeCompressionUnit.
+const test = require('node:test');
+const assert = require('node:assert');
+const { decodeCompressionUnit } = require('..');
+
+// A compressed chunk holding only literals: one flag byte of zeros per eight.
+function literalChunk(text) {
+  const literals = Buffer.from(text);
+  assert.ok(literals.length <= 8);
+  const data = Buffer.concat([Buffer.from([0]), literals]);
+  const header = Buffer.alloc(2);
+  header.writeUInt16LE(0xb000 | (data.length - 1));
+  return Buffer.concat([header, data]);
+}
+
+test('a short chunk in the middle of a unit is padded to 4 KB', () => {
+  const stored = Buffer.concat([literalChunk('ABCDEFGH'), literalChunk('IJKLMNOP'), Buffer.alloc(2)]);
+  const { data, corrupt } = decodeCompressionUnit(stored, 16384);
+
+  const expected = Buffer.alloc(16384);
+  expected.write('ABCDEFGH', 0);
+  expected.write('IJKLMNOP', 4096);
+  assert.strictEqual(corrupt, false);
+  assert.deepStrictEqual(data, expected);
+});
+
+test('a corrupt chunk keeps what decoded before it', () => {
+  // A back-reference as the first token points before the chunk.
+  const stored = Buffer.concat([literalChunk('ABCDEFGH'), Buffer.from([0x02, 0xb0, 0x01, 0x00, 0x00])]);
+  const { data, corrupt } = decodeCompressionUnit(stored, 8192);
+
+  const expected = Buffer.alloc(8192);
+  expected.write('ABCDEFGH', 0);
+  assert.strictEqual(corrupt, true);
+  assert.deepStrictEqual(data, expected);
+});
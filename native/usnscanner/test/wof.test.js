@@ -0,0 +1,74 @@
+// Known-vector checks for the WOF chunk table, driven through decompressWof.
+// Run with `npm test` after `npm run build:native`.
+const test = require('node:test');
+const assert = require('node:assert');
+const { decompressWof } = require('..');
+
+const XPRESS_4K = 0;
+const LZX = 1;
+
+// 4096 bytes of text, and the same bytes XPRESS Huffman compressed.
+const knownText = Buffer.concat(Array.from({ length: 114 }, (_, i) =>
+  Buffer.from(`Chunk line ${String(i % 50).padStart(3, '0')} of the known vector.\n`))).subarray(0, 4096);
+const knownXpress = Buffer.from(
+  'AAAAAAAHAAAAAAAAAAAAAAQAAAAAAAAHRkRzd3cAAAAAcAAAAAAAAAAAAAAAAAAAAHBQB3ZgB1UAB3Z3AAAAAAAAAAAAAAAAAAAA' +
+  'AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAAAAAAAAAA' +
+  'AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAHAEAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAACAAAAAAAAAAAAAAAAAAAABgAAAAAAAAAAAA' +
+  'AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAJ/r6Lt83s1eWZY7Nrm2tNk+vr7dtlv1uHe/PfIoEkSTERFOVBFOFBFONBFO' +
+  'VBFOdBFHlBEcGhBxaBERxqERGocRaBwRoXERh8YRHBoRgWgREQaiERqIEWggEaKBEYgGESAaEYFoEREGohEaiRFoJBGikRGJRhEk' +
+  'GhGRaBERRqIRGokRaCQRQkMREBoRhtARETSEEaEhEQgNEUNoEREaQhHCNhEAP//pCAAA',
+  'base64');
+
+// Too short for an XPRESS code-length table or an LZX block header.
+const garbage = Buffer.from('not a compressed chunk');
+
+// Table of chunk end offsets (every chunk but the last) followed by the chunks.
+function wofStream(chunks, entrySize, trailingEmpty = 0) {
+  const count = chunks.length + trailingEmpty;
+  const table = Buffer.alloc((count - 1) * entrySize);
+  let offset = 0;
+  for (let i = 0; i < count - 1; i++) {
+    offset += i < chunks.length ? chunks[i].length : 0;
+    if (entrySize === 8) {
+      table.writeBigUInt64LE(BigInt(offset), i * 8);
+    } else {
+      table.writeUInt32LE(offset, i * 4);
+    }
+  }
+  return Buffer.concat([table, ...chunks]);
+}
+
+test('4-byte table with a compressed, a raw and a corrupt chunk', async () => {
+  const raw = Buffer.alloc(4096, 0x5a);
+  const size = 4096 * 2 + 1000;
+  const stream = wofStream([knownXpress, raw, garbage], 4);
+
+  const result = await decompressWof(stream, { algorithm: XPRESS_4K, size });
+  assert.strictEqual(result.chunks, 3);
+  assert.strictEqual(result.storedChunks, 1);
+  assert.strictEqual(result.corruptChunks, 1);
+  assert.strictEqual(result.data.length, size);
+  assert.deepStrictEqual(result.data.subarray(0, 4096), knownText);
+  assert.deepStrictEqual(result.data.subarray(4096, 8192), raw);
+  assert.deepStrictEqual(result.data.subarray(8192), Buffer.alloc(1000));
+});
+
+test('8-byte table for a file of 4 GiB and more', async () => {
+  // 131073 LZX chunks; only the first two are decoded.
+  const size = 4 * 1024 ** 3 + 32768;
+  const raw = Buffer.alloc(32768, 0xa5);
+  const stream = wofStream([raw, garbage], 8, 131071);
+
+  const result = await decompressWof(stream, { algorithm: LZX, size, length: 65536 });
+  assert.strictEqual(result.chunks, 2);
+  assert.strictEqual(result.storedChunks, 1);
+  assert.strictEqual(result.corruptChunks, 1);
+  assert.deepStrictEqual(result.data.subarray(0, 32768), raw);
+  assert.deepStrictEqual(result.data.subarray(32768), Buffer.alloc(32768));
+});
+
+test('rejects a table that is not monotonic', async () => {
+  const stream = wofStream([knownXpress, garbage], 4);
+  stream.writeUInt32LE(stream.length, 0);
+  await assert.rejects(decompressWof(stream, { algorithm: XPRESS_4K, size: 8192 }), /not monotonic/);
+});
@@ -0,0 +1,502 @@
+#include "timeline.h"
+#include "export_writer.h"
+#include "mft_reader.h"
+#include "ntfs_record.h"
+#include "usn_journal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+
+namespace usnscanner {
+
+namespace {
+
+const uint16_t kRecordInUse = 0x0001;
+const uint64_t kRootDirectory = 5;
+const uint64_t kDefaultMemoryBudget = 256ULL << 20;
+const uint32_t kAllReasons = 0xFFFFFFFF;
+const uint32_t kNoName = 0xFFFFFFFF;
+// Events read ahead per run while merging, at least.
+const size_t kMinRunBuffer = 4096;
+// Rough cost of one pooled journal name beyond its characters: the vector's
+// string, the map key's string and the hash node.
+const size_t kPooledNameOverhead = 2 * sizeof(std::string) + 32;
+
+enum EventSource : uint8_t {
+    kSourceStandardInformation = 0,
+    kSourceFileName = 1,
+    kSourceJournal = 2
+};
+
+const uint32_t kMacbModified = 1;
+const uint32_t kMacbAccessed = 2;
+const uint32_t kMacbChanged = 4;
+const uint32_t kMacbBorn = 8;
+
+// Fixed size so buffers sort in place and runs are plain arrays on disk.
+struct Event {
+    uint64_t time;
+    uint64_t reference;
+    // Journal events only: where the record said the file lived.
+    uint64_t parentReference;
+    // MACB flags for MFT events, the reason mask for journal events.
+    uint32_t detail;
+    // Journal events only: index into the journal name pool.
+    uint32_t name;
+    uint8_t source;
+    uint8_t padding[7];
+};
+
+bool EventBefore(const Event &a, const Event &b) {
+    if (a.time != b.time) {
+        return a.time < b.time;
+    }
+    if (a.source != b.source) {
+        return a.source < b.source;
+    }
+    return a.reference < b.reference;
+}
+
+const uint8_t kNameKnown = 0x01;
+const uint8_t kNameInUse = 0x02;
+
+struct RecordName {
+    uint64_t parentReference;
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint16_t sequence;
+    uint8_t flags;
+};
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AddTimes(std::vector<Event> &out, uint64_t reference, uint8_t source, const uint64_t (&times)[4]) {
+    static const uint32_t kFlags[4] = { kMacbModified, kMacbAccessed, kMacbChanged, kMacbBorn };
+    for (int i = 0; i < 4; ++i) {
+        if (times[i] == 0) {
+            continue;
+        }
+        bool seen = false;
+        for (int j = 0; j < i; ++j) {
+            seen |= times[j] == times[i];
+        }
+        if (seen) {
+            continue;
+        }
+        uint32_t flags = 0;
+        for (int j = i; j < 4; ++j) {
+            if (times[j] == times[i]) {
+                flags |= kFlags[j];
+            }
+        }
+        Event event{};
+        event.time = times[i];
+        event.reference = reference;
+        event.detail = flags;
+        event.name = kNoName;
+        event.source = source;
+        out.push_back(event);
+    }
+}
+
+// Removes spilled runs however the build ends.
+struct RunFiles {
+    std::vector<std::filesystem::path> paths;
+    ~RunFiles() {
+        for (const auto &path : paths) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+};
+
+class RunReader {
+  public:
+    RunReader(const std::filesystem::path &path, size_t capacity) : buffer_(capacity), position_(0), count_(0) {
+        in_.open(path, std::ios::binary);
+    }
+
+    bool Next(Event &event) {
+        if (position_ == count_) {
+            in_.read(reinterpret_cast<char *>(buffer_.data()), static_cast<std::streamsize>(buffer_.size() * sizeof(Event)));
+            count_ = static_cast<size_t>(in_.gcount()) / sizeof(Event);
+            position_ = 0;
+            if (count_ == 0) {
+                return false;
+            }
+        }
+        event = buffer_[position_++];
+        return true;
+    }
+
+  private:
+    std::ifstream in_;
+    std::vector<Event> buffer_;
+    size_t position_;
+    size_t count_;
+};
+
+class TimelineWriter {
+  public:
+    TimelineWriter(
+        ExportWriter &out,
+        TimelineFormat format,
+        const std::vector<RecordName> &records,
+        const std::string &names,
+        const std::vector<std::string> &journalNames)
+        : out_(out), format_(format), records_(records), names_(names), journalNames_(journalNames) {}
+
+    void Header() {
+        if (format_ == TimelineFormat::Csv) {
+            out_.Append("time,macb,source,record,sequence,deleted,path,reasons\n");
+        }
+    }
+
+    void Write(const Event &event) {
+        static const char *kSources[] = { "SI", "FN", "USN" };
+        const uint64_t recordNumber = ReferenceRecordNumber(event.reference);
+        const RecordName *record = recordNumber < records_.size() ? &records_[recordNumber] : nullptr;
+
+        path_.clear();
+        bool deleted = true;
+        if (event.source == kSourceJournal) {
+            AppendParentPath(event.parentReference, path_);
+            path_.push_back('\\');
+            path_ += journalNames_[event.name];
+            // The file is gone when its slot is free or holds another file.
+            deleted = !record || (record->flags & kNameInUse) == 0 || SlotReused(event.reference, record->sequence, true);
+        } else {
+            if (recordNumber == kRootDirectory) {
+                path_.push_back('\\');
+            } else {
+                AppendParentPath(record->parentReference, path_);
+                path_.push_back('\\');
+                path_.append(names_, record->nameOffset, record->nameLength);
+            }
+            deleted = (record->flags & kNameInUse) == 0;
+        }
+
+        macb_.clear();
+        reasons_.clear();
+        if (event.source == kSourceJournal) {
+            AppendUsnReasons(event.detail, reasons_);
+        } else {
+            macb_.push_back((event.detail & kMacbModified) ? 'M' : '.');
+            macb_.push_back((event.detail & kMacbAccessed) ? 'A' : '.');
+            macb_.push_back((event.detail & kMacbChanged) ? 'C' : '.');
+            macb_.push_back((event.detail & kMacbBorn) ? 'B' : '.');
+        }
+
+        if (format_ == TimelineFormat::Csv) {
+            out_.AppendFileTime(event.time);
+            out_.Append(',');
+            out_.Append(macb_);
+            out_.Append(',');
+            out_.Append(kSources[event.source]);
+            out_.Append(',');
+            out_.AppendUnsigned(recordNumber);
+            out_.Append(',');
+            out_.AppendUnsigned(ReferenceSequence(event.reference));
+            out_.Append(deleted ? ",1," : ",0,");
+            out_.AppendCsvField(path_);
+            out_.Append(',');
+            out_.Append(reasons_);
+            out_.Append('\n');
+            return;
+        }
+
+        out_.Append("{\"time\":\"");
+        out_.AppendFileTime(event.time);
+        out_.Append("\",\"source\":\"");
+        out_.Append(kSources[event.source]);
+        if (!macb_.empty()) {
+            out_.Append("\",\"macb\":\"");
+            out_.Append(macb_);
+        }
+        out_.Append("\",\"record\":");
+        out_.AppendUnsigned(recordNumber);
+        out_.Append(",\"sequence\":");
+        out_.AppendUnsigned(ReferenceSequence(event.reference));
+        out_.Append(deleted ? ",\"deleted\":true,\"path\":" : ",\"deleted\":false,\"path\":");
+        out_.AppendJsonString(path_);
+        if (!reasons_.empty()) {
+            out_.Append(",\"reasons\":\"");
+            out_.Append(reasons_);
+            out_.Append('"');
+        }
+        out_.Append("}\n");
+    }
+
+  private:
+    // Directory paths are cached by reference; files are never cached, so
+    // the cache grows with the number of directories only. A parent whose
+    // slot was freed and reused is not followed: the path ends in an
+    // "$Orphan" group named after the missing record, as in the tree view.
+    void AppendParentPath(uint64_t parentReference, std::string &path) {
+        auto cached = directories_.find(parentReference);
+        if (cached != directories_.end()) {
+            path += cached->second;
+            return;
+        }
+
+        std::string resolved;
+        std::vector<uint64_t> chain;
+        uint64_t current = parentReference;
+        while (ReferenceRecordNumber(current) != kRootDirectory) {
+            auto found = directories_.find(current);
+            if (found != directories_.end()) {
+                resolved = found->second;
+                break;
+            }
+            uint64_t recordNumber = ReferenceRecordNumber(current);
+            const RecordName *record = recordNumber < records_.size() ? &records_[recordNumber] : nullptr;
+            if (!record || (record->flags & kNameKnown) == 0 || chain.size() >= 1024 ||
+                SlotReused(current, record->sequence, (record->flags & kNameInUse) != 0)) {
+                resolved = "$Orphan\\$Orphan_" + std::to_string(recordNumber);
+                break;
+            }
+            chain.push_back(current);
+            current = record->parentReference;
+        }
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            const RecordName &record = records_[ReferenceRecordNumber(*it)];
+            resolved.push_back('\\');
+            resolved.append(names_, record.nameOffset, record.nameLength);
+            directories_.emplace(*it, resolved);
+        }
+        if (chain.empty()) {
+            directories_.emplace(parentReference, resolved);
+        }
+        path += resolved;
+    }
+
+    ExportWriter &out_;
+    TimelineFormat format_;
+    const std::vector<RecordName> &records_;
+    const std::string &names_;
+    const std::vector<std::string> &journalNames_;
+    std::unordered_map<uint64_t, std::string> directories_;
+    std::string path_;
+    std::string macb_;
+    std::string reasons_;
+};
+
+} // namespace
+
+TimelineBuilder::TimelineBuilder(VolumeReader &reader, const TimelineOptions &options)
+    : reader_(reader), options_(options), stats_{} {}
+
+bool TimelineBuilder::Run(std::string &error) {
+    stats_ = TimelineStats{};
+
+    MftReader mft(reader_);
+    if (!mft.Open(error)) {
+        return false;
+    }
+
+    const uint64_t budget = options_.memoryBudget != 0 ? options_.memoryBudget : kDefaultMemoryBudget;
+    const size_t capacity = std::max<size_t>(kMinRunBuffer, static_cast<size_t>(budget / sizeof(Event)));
+    std::vector<Event> events;
+    events.reserve(std::min<size_t>(capacity, 1 << 20));
+
+    RunFiles runs;
+    bool spillFailed = false;
+    double sortMs = 0;
+    // Sorts the buffer and writes it out as one run.
+    auto spill = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        std::sort(events.begin(), events.end(), EventBefore);
+        std::filesystem::path path = std::filesystem::u8path(options_.outputPath + ".run" + std::to_string(runs.paths.size()) + ".tmp");
+        runs.paths.push_back(path);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(events.data()), static_cast<std::streamsize>(events.size() * sizeof(Event)));
+        out.close();
+        spillFailed |= !out;
+        events.clear();
+        sortMs += MillisecondsSince(start);
+    };
+
+    std::vector<RecordName> records(static_cast<size_t>(mft.RecordCount()));
+    std::string names;
+
+    auto start = std::chrono::steady_clock::now();
+    bool swept = mft.Sweep([&](uint64_t recordNumber, const uint8_t *data, uint32_t size) {
+        FileRecordHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.BaseFileRecord != 0) {
+            return;
+        }
+        FileRecordDetails details{};
+        if (!ParseFileRecord(data, size, details)) {
+            return;
+        }
+        std::vector<FileNameInfo> links = ReadLinkNames(details);
+        if (links.empty()) {
+            return;
+        }
+        ++stats_.records;
+
+        const bool inUse = (header.Flags & kRecordInUse) != 0;
+        if (recordNumber >= records.size()) {
+            records.resize(static_cast<size_t>(recordNumber) + 1);
+        }
+        const FileNameInfo &name = links.front();
+        RecordName &entry = records[static_cast<size_t>(recordNumber)];
+        entry.parentReference = name.parentReference;
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint16_t>(name.name.size());
+        entry.sequence = header.SequenceNumber;
+        entry.flags = kNameKnown | (inUse ? kNameInUse : 0);
+        names += name.name;
+
+        if (inUse && options_.deletedOnly) {
+            return;
+        }
+        const uint64_t reference = MakeFileReference(recordNumber, header.SequenceNumber);
+        size_t before = events.size();
+        for (const auto &attribute : details.attributes) {
+            StandardInformation info{};
+            if (attribute.type == kAttributeStandardInformation && !attribute.nonResident &&
+                ParseStandardInformation(attribute.residentData, info)) {
+                const uint64_t times[4] = { info.modified, info.accessed, info.mftModified, info.created };
+                AddTimes(events, reference, kSourceStandardInformation, times);
+                break;
+            }
+        }
+        stats_.standardInformationEvents += events.size() - before;
+        before = events.size();
+        const uint64_t times[4] = { name.modified, name.accessed, name.mftModified, name.created };
+        AddTimes(events, reference, kSourceFileName, times);
+        stats_.fileNameEvents += events.size() - before;
+
+        if (events.size() + 8 > capacity) {
+            spill();
+        }
+    }, error);
+    stats_.sweepMs = MillisecondsSince(start);
+    if (!swept) {
+        return false;
+    }
+
+    std::vector<std::string> journalNames;
+    // The name pool stays resident until the output is written, so each name
+    // it takes leaves that much less of the budget for buffered events.
+    uint64_t poolBytes = 0;
+    if (!options_.journal.empty()) {
+        start = std::chrono::steady_clock::now();
+        UsnJournalReader journal;
+        if (!journal.Open(options_.journal, kAllReasons, false, error)) {
+            return false;
+        }
+        std::unordered_map<std::string, uint32_t> nameIds;
+        std::vector<CarvedUsnRecord> batch;
+        while (true) {
+            if (!journal.Next(batch, error)) {
+                return false;
+            }
+            if (batch.empty()) {
+                break;
+            }
+            for (auto &record : batch) {
+                auto inserted = nameIds.emplace(record.name, static_cast<uint32_t>(journalNames.size()));
+                if (inserted.second) {
+                    poolBytes += 2 * record.name.size() + kPooledNameOverhead;
+                    journalNames.push_back(std::move(record.name));
+                }
+                Event event{};
+                event.time = record.timestamp;
+                event.reference = record.fileRef;
+                event.parentReference = record.parentRef;
+                event.detail = record.reason;
+                event.name = inserted.first->second;
+                event.source = kSourceJournal;
+                events.push_back(event);
+                ++stats_.journalEvents;
+                if (events.size() >= capacity ||
+                    (events.size() >= kMinRunBuffer && events.size() * sizeof(Event) + poolBytes >= budget)) {
+                    spill();
+                }
+            }
+        }
+        stats_.journalMs = MillisecondsSince(start);
+    }
+
+    if (spillFailed) {
+        error = "Writing a sorted run next to " + options_.outputPath + " failed";
+        return false;
+    }
+
+    ExportWriter out;
+    if (!out.Open(options_.outputPath, false, error)) {
+        return false;
+    }
+    TimelineWriter writer(out, options_.format, records, names, journalNames);
+    writer.Header();
+
+    start = std::chrono::steady_clock::now();
+    if (runs.paths.empty()) {
+        auto sortStart = std::chrono::steady_clock::now();
+        std::sort(events.begin(), events.end(), EventBefore);
+        sortMs += MillisecondsSince(sortStart);
+        for (const auto &event : events) {
+            writer.Write(event);
+        }
+    } else {
+        if (!events.empty()) {
+            spill();
+        }
+        std::vector<Event>().swap(events);
+        if (spillFailed) {
+            error = "Writing a sorted run next to " + options_.outputPath + " failed";
+            return false;
+        }
+
+        // k-way merge: the smallest head of all runs goes out next.
+        const uint64_t mergeBudget = budget > poolBytes ? budget - poolBytes : 0;
+        const size_t perRun = std::max<size_t>(kMinRunBuffer,
+            static_cast<size_t>(mergeBudget / sizeof(Event) / runs.paths.size()));
+        std::vector<std::unique_ptr<RunReader>> readers;
+        for (const auto &path : runs.paths) {
+            readers.push_back(std::make_unique<RunReader>(path, perRun));
+        }
+        typedef std::pair<Event, size_t> Head;
+        auto later = [](const Head &a, const Head &b) {
+            return EventBefore(b.first, a.first);
+        };
+        std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+        Event event;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            if (readers[i]->Next(event)) {
+                heads.push({ event, i });
+            }
+        }
+        while (!heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+            writer.Write(head.first);
+            if (readers[head.second]->Next(event)) {
+                heads.push({ event, head.second });
+            }
+        }
+    }
+    stats_.runs = runs.paths.size();
+    stats_.sortMs = sortMs;
+
+    if (!out.Close(error)) {
+        return false;
+    }
+    stats_.bytesWritten = out.BytesWritten();
+    stats_.writeMs = MillisecondsSince(start);
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+enum class TimelineFormat : uint8_t {
+    Csv,
+    JsonLines
+};
+
+struct TimelineOptions {
+    std::string outputPath;
+    TimelineFormat format;
+    // Change journal to merge in: a drive letter or a copy of $J; empty for
+    // MFT timestamps only.
+    std::string journal;
+    // Only freed records (their USN events are kept regardless).
+    bool deletedOnly;
+    // Bytes of events sorted in memory plus the pool of distinct journal
+    // names; beyond that sorted runs are spilled next to the output and
+    // merged. The per-record name table is not counted. 0 picks a default.
+    uint64_t memoryBudget;
+};
+
+struct TimelineStats {
+    uint64_t records;
+    uint64_t standardInformationEvents;
+    uint64_t fileNameEvents;
+    uint64_t journalEvents;
+    // Sorted runs spilled to disk; 0 when everything fit in memory.
+    uint64_t runs;
+    uint64_t bytesWritten;
+    double sweepMs;
+    double journalMs;
+    double sortMs;
+    double writeMs;
+};
+
+// Builds a MACB super-timeline of a volume. One MFT sweep turns the
+// $STANDARD_INFORMATION and primary $FILE_NAME times of every named record
+// into events, the equal timestamps of one attribute folded into one event
+// ("M.CB"); the change journal adds one event per record. Events are fixed
+// size and carry only references, so 50M of them sort in bounded memory:
+// full buffers are sorted and spilled as runs, and a k-way merge streams
+// them to the writer. Paths are resolved only while writing, from a name
+// table kept per MFT record.
+class TimelineBuilder {
+  public:
+    TimelineBuilder(VolumeReader &reader, const TimelineOptions &options);
+
+    bool Run(std::string &error);
+
+    const TimelineStats &Stats() const { return stats_; }
+
+  private:
+    VolumeReader &reader_;
+    TimelineOptions options_;
+    TimelineStats stats_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,712 @@
+#include "tree_recovery.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "io_profile.h"
+#include "lznt1.h"
+#include "mft_reader.h"
+#include "ntfs_record.h"
+#include "wof.h"
+#include "work_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace usnscanner {
+
+namespace {
+
+const uint16_t kRecordInUse = 0x0001;
+const uint32_t kAttributeList = 0x20;
+const uint64_t kMaxCompressionUnitBytes = 16 * 1024 * 1024;
+const uint64_t kMaxWofStreamBytes = 1024ULL * 1024 * 1024;
+const auto kProgressInterval = std::chrono::milliseconds(200);
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One path component that every file system the output may land on accepts.
+std::string SafeName(const std::string &name) {
+    std::string result;
+    result.reserve(name.size());
+    for (char c : name) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        result.push_back(byte < 0x20 || std::strchr("<>:\"/\\|?*", c) ? '_' : c);
+    }
+    if (result.empty() || result == "." || result == "..") {
+        return "_";
+    }
+    // Windows drops trailing dots and spaces.
+    if (result.back() == '.' || result.back() == ' ') {
+        result.back() = '_';
+    }
+    return result;
+}
+
+// "name.ext" becomes "name~<record>.ext" when another file already took the
+// name in the same output directory.
+std::string DisambiguatedName(const std::string &name, uint64_t recordNumber) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos || dot == 0) {
+        dot = name.size();
+    }
+    return name.substr(0, dot) + "~" + std::to_string(recordNumber) + name.substr(dot);
+}
+
+// Output paths are compared case-insensitively (ASCII only) because the
+// output usually lives on a case-insensitive volume.
+std::string PathKey(const std::filesystem::path &path) {
+    std::string key = path.u8string();
+    for (char &c : key) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return key;
+}
+
+// Write-only file addressed by absolute offsets, so extents can be written
+// in disk order rather than file order.
+class OutputFile {
+  public:
+#ifdef _WIN32
+    OutputFile() : handle_(INVALID_HANDLE_VALUE) {}
+#else
+    OutputFile() : fd_(-1) {}
+#endif
+    ~OutputFile() { Close(); }
+
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    // Creates or truncates the file and sets its length, so unwritten ranges
+    // (sparse runs, the uninitialised tail) read back as zeros.
+    bool Create(const std::filesystem::path &path, uint64_t size) {
+#ifdef _WIN32
+        handle_ = ::CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle_ == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER length;
+        length.QuadPart = static_cast<LONGLONG>(size);
+        return ::SetFilePointerEx(handle_, length, nullptr, FILE_BEGIN) && ::SetEndOfFile(handle_);
+#else
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        return fd_ >= 0 && ::ftruncate(fd_, static_cast<off_t>(size)) == 0;
+#endif
+    }
+
+    bool WriteAt(uint64_t offset, const uint8_t *data, size_t length) {
+        while (length > 0) {
+            size_t chunk = std::min<size_t>(length, 64 * 1024 * 1024);
+#ifdef _WIN32
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD written = 0;
+            if (!::WriteFile(handle_, data, static_cast<DWORD>(chunk), &written, &overlapped) || written == 0) {
+                return false;
+            }
+#else
+            ssize_t written = ::pwrite(fd_, data, chunk, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+#endif
+            offset += static_cast<uint64_t>(written);
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool Close() {
+#ifdef _WIN32
+        if (handle_ == INVALID_HANDLE_VALUE) {
+            return true;
+        }
+        bool closed = ::CloseHandle(handle_) != 0;
+        handle_ = INVALID_HANDLE_VALUE;
+#else
+        if (fd_ < 0) {
+            return true;
+        }
+        bool closed = ::close(fd_) == 0;
+        fd_ = -1;
+#endif
+        return closed;
+    }
+
+    static unsigned long LastError() {
+#ifdef _WIN32
+        return ::GetLastError();
+#else
+        return static_cast<unsigned long>(errno);
+#endif
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE handle_;
+#else
+    int fd_;
+#endif
+};
+
+struct PlannedFile {
+    uint32_t entry;
+    std::filesystem::path path;
+    // Relative to the output directory, for failure reports.
+    std::string relative;
+};
+
+// Open state of one output file. The file is created by whichever extent
+// reaches it first and closed by the one that brings pending to zero.
+struct FileState {
+    std::mutex mutex;
+    OutputFile file;
+    bool opened = false;
+    uint64_t size = 0;
+    std::atomic<uint32_t> pending{ 0 };
+    std::atomic<bool> failed{ false };
+    std::string reason;
+};
+
+struct CopyExtent {
+    uint32_t file;
+    uint64_t fileOffset;
+    uint64_t volumeOffset;
+    uint64_t length;
+};
+
+// Extents [first, first + count) of the sorted queue, served by one read.
+struct ReadGroup {
+    size_t first;
+    size_t count;
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Compressed and WOF files: decoded whole by one task.
+struct DecodeJob {
+    uint32_t file;
+    // NTFS-compressed unnamed $DATA, or the WofCompressedData stream.
+    AttributeInfo stream;
+    int32_t wofAlgorithm;
+    uint64_t firstOffset;
+};
+
+uint64_t FirstAllocatedOffset(const std::vector<DataRunSegment> &runs, uint64_t clusterSize) {
+    for (const auto &run : runs) {
+        if (!run.sparse && run.lcn > 0 && run.length > 0) {
+            return static_cast<uint64_t>(run.lcn) * clusterSize;
+        }
+    }
+    return UINT64_MAX;
+}
+
+bool RunsInsideVolume(const std::vector<DataRunSegment> &runs, uint64_t clusterSize, uint64_t volumeSize) {
+    for (const auto &run : runs) {
+        if (run.sparse || run.lcn <= 0 || run.length <= 0) {
+            continue;
+        }
+        uint64_t end = (static_cast<uint64_t>(run.lcn) + static_cast<uint64_t>(run.length)) * clusterSize;
+        if (volumeSize != 0 && end > volumeSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TreeRecovery::TreeRecovery(VolumeReader &reader, const DeletedTree &tree, const TreeRecoveryOptions &options)
+    : reader_(reader), tree_(tree), options_(options), stats_{} {}
+
+bool TreeRecovery::Run(uint32_t nodeId, const std::function<void(const TreeRecoveryProgress &)> &progress, std::string &error) {
+    failures_.clear();
+    stats_ = TreeRecoveryStats{};
+
+    if (nodeId >= tree_.NodeCount()) {
+        error = "Unknown tree node " + std::to_string(nodeId);
+        return false;
+    }
+    if (options_.outputDirectory.empty()) {
+        error = "Output directory is required";
+        return false;
+    }
+
+    // Read size, gather gap and stream count follow the device; an explicit
+    // stream count still wins.
+    stats_.profile = SelectIoProfile(reader_, options_.device);
+    const uint64_t maxRead = stats_.profile.readSize;
+    const uint64_t gatherGap = stats_.profile.gatherGap;
+
+    const std::vector<DeletedEntry> &entries = tree_.Entries();
+    const std::filesystem::path root = std::filesystem::u8path(options_.outputDirectory);
+    std::error_code ec;
+    std::filesystem::create_directories(root, ec);
+    if (ec) {
+        error = "Cannot create output directory: " + ec.message();
+        return false;
+    }
+
+    // Recreate the directories breadth first and give every file its output
+    // path. Directories that map to the same path (a folder deleted twice, a
+    // live anchor inside another) are merged; files are not.
+    std::vector<PlannedFile> files;
+    std::unordered_set<std::string> taken;
+    auto isFile = [&](uint32_t id) {
+        const TreeNode &node = tree_.Node(id);
+        return node.kind == TreeNodeKind::Deleted && !entries[node.item].isDirectory;
+    };
+    auto planFile = [&](uint32_t id, const std::filesystem::path &directory) {
+        const DeletedEntry &entry = entries[tree_.Node(id).item];
+        std::string name = SafeName(entry.name);
+        std::filesystem::path path = directory / std::filesystem::u8path(name);
+        if (!taken.insert(PathKey(path)).second) {
+            path = directory / std::filesystem::u8path(DisambiguatedName(name, entry.recordNumber));
+            taken.insert(PathKey(path));
+        }
+        files.push_back({ tree_.Node(id).item, path, path.lexically_relative(root).u8string() });
+    };
+    auto directoryFor = [&](uint32_t id, const std::filesystem::path &parent) {
+        const TreeNode &node = tree_.Node(id);
+        if (node.kind == TreeNodeKind::Root) {
+            return parent;
+        }
+        if (node.kind != TreeNodeKind::Live) {
+            return parent / std::filesystem::u8path(SafeName(tree_.Name(id)));
+        }
+        // Live anchors are labelled with their full path; keep its nesting.
+        std::filesystem::path path = parent;
+        const std::string &label = tree_.Name(id);
+        size_t begin = 0;
+        while (begin <= label.size()) {
+            size_t end = label.find('\\', begin);
+            if (end == std::string::npos) {
+                end = label.size();
+            }
+            if (end > begin) {
+                path /= std::filesystem::u8path(SafeName(label.substr(begin, end - begin)));
+            }
+            begin = end + 1;
+        }
+        return path;
+    };
+
+    if (isFile(nodeId)) {
+        planFile(nodeId, root);
+    } else {
+        std::vector<std::pair<uint32_t, std::filesystem::path>> queue;
+        queue.emplace_back(nodeId, directoryFor(nodeId, root));
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const uint32_t id = queue[head].first;
+            const std::filesystem::path directory = queue[head].second;
+            if (std::filesystem::create_directories(directory, ec)) {
+                ++stats_.directories;
+            } else if (ec) {
+                // Its files fail one by one when they cannot be created.
+                failures_.push_back({ directory.lexically_relative(root).u8string(), "Cannot create the directory: " + ec.message() });
+            }
+            taken.insert(PathKey(directory));
+            const TreeNode &node = tree_.Node(id);
+            const uint32_t *children = tree_.Children(id);
+            for (uint32_t i = 0; i < node.childCount; ++i) {
+                if (isFile(children[i])) {
+                    planFile(children[i], directory);
+                } else {
+                    queue.emplace_back(children[i], directoryFor(children[i], directory));
+                }
+            }
+        }
+    }
+
+    MftReader mft(reader_);
+    if (!mft.Open(error)) {
+        return false;
+    }
+    const uint64_t clusterSize = mft.Geometry().clusterSize;
+
+    std::vector<FileState> states(files.size());
+    std::vector<CopyExtent> extents;
+    std::vector<DecodeJob> jobs;
+    std::atomic<uint64_t> filesDone{ 0 };
+    std::atomic<uint64_t> bytesDone{ 0 };
+    std::atomic<uint64_t> bytesWritten{ 0 };
+    std::atomic<uint64_t> failed{ 0 };
+    std::atomic<uint64_t> reads{ 0 };
+    TreeRecoveryProgress totals{};
+    std::mutex failuresMutex;
+    std::mutex progressMutex;
+    auto lastReport = std::chrono::steady_clock::now();
+
+    auto report = [&](bool final) {
+        if (!progress) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(progressMutex, std::defer_lock);
+        if (final) {
+            lock.lock();
+        } else if (!lock.try_lock() || std::chrono::steady_clock::now() - lastReport < kProgressInterval) {
+            return;
+        }
+        lastReport = std::chrono::steady_clock::now();
+        TreeRecoveryProgress current = totals;
+        current.filesDone = filesDone.load();
+        current.bytesDone = bytesDone.load();
+        progress(current);
+    };
+    auto fail = [&](uint32_t index, const std::string &reason) {
+        FileState &state = states[index];
+        if (!state.failed.exchange(true)) {
+            state.reason = reason;
+        }
+    };
+    // Called once per file when nothing more will be written to it.
+    auto finish = [&](uint32_t index) {
+        FileState &state = states[index];
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.opened && !state.file.Close()) {
+                fail(index, "Closing the file failed with error " + std::to_string(OutputFile::LastError()));
+            }
+        }
+        if (state.failed.load()) {
+            ++failed;
+            std::lock_guard<std::mutex> lock(failuresMutex);
+            failures_.push_back({ files[index].relative, state.reason });
+        } else {
+            bytesWritten += state.size;
+        }
+        ++filesDone;
+    };
+    // Creates the output on first use. The caller holds state.mutex.
+    auto open = [&](uint32_t index) {
+        FileState &state = states[index];
+        if (!state.opened) {
+            state.opened = true;
+            if (!state.file.Create(files[index].path, state.size)) {
+                fail(index, "Cannot create the file, error " + std::to_string(OutputFile::LastError()));
+            }
+        }
+        return !state.failed.load();
+    };
+    auto write = [&](uint32_t index, uint64_t offset, const uint8_t *data, size_t length) {
+        FileState &state = states[index];
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (open(index) && !state.file.WriteAt(offset, data, length)) {
+            fail(index, "Writing failed with error " + std::to_string(OutputFile::LastError()));
+        }
+    };
+
+    // One batched pass over the file records: check every slot still holds the
+    // file the scan saw, then sort each file into a resident write, extents in
+    // the shared queue, or a decode job.
+    std::unordered_map<uint64_t, uint32_t> byRecord;
+    std::vector<uint64_t> recordNumbers;
+    byRecord.reserve(files.size());
+    recordNumbers.reserve(files.size());
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        byRecord.emplace(entries[files[i].entry].recordNumber, i);
+        recordNumbers.push_back(entries[files[i].entry].recordNumber);
+    }
+    std::vector<uint8_t> seen(files.size(), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    bool readAll = mft.ReadRecords(std::move(recordNumbers), [&](uint64_t recordNumber, const uint8_t *record, uint32_t size) {
+        auto it = byRecord.find(recordNumber);
+        if (it == byRecord.end()) {
+            return;
+        }
+        const uint32_t index = it->second;
+        const DeletedEntry &entry = entries[files[index].entry];
+        FileState &state = states[index];
+        seen[index] = 1;
+
+        // The scan saw the record free with this sequence number; a slot that
+        // was allocated since (and maybe freed again) now describes another
+        // file, and so do its runs.
+        FileRecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        if ((header.Flags & kRecordInUse) != 0 || header.SequenceNumber != entry.sequence) {
+            ++stats_.skippedReused;
+            failures_.push_back({ files[index].relative, "MFT slot reused since the scan" });
+            seen[index] = 2;
+            return;
+        }
+
+        FileRecordDetails details{};
+        if (!ParseFileRecord(record, size, details)) {
+            fail(index, "Unreadable file record");
+            return;
+        }
+        const AttributeInfo *data = nullptr;
+        const AttributeInfo *wofStream = nullptr;
+        const AttributeInfo *reparse = nullptr;
+        bool attributeList = false;
+        for (const auto &attribute : details.attributes) {
+            if (attribute.type == kAttributeData && attribute.name.empty()) {
+                data = &attribute;
+            } else if (attribute.type == kAttributeData && attribute.name == kWofStreamName) {
+                wofStream = &attribute;
+            } else if (attribute.type == kAttributeReparsePoint && !attribute.nonResident) {
+                reparse = &attribute;
+            } else if (attribute.type == kAttributeList) {
+                attributeList = true;
+            }
+        }
+
+        uint32_t algorithm = 0;
+        if (wofStream && reparse && ParseWofReparsePoint(reparse->residentData, algorithm)) {
+            state.size = data ? data->dataSize : entry.size;
+            if (state.size > kMaxWofStreamBytes || wofStream->dataSize > kMaxWofStreamBytes) {
+                fail(index, "WOF-compressed file is too large to recover in memory");
+            } else if (wofStream->nonResident && !RunsInsideVolume(wofStream->runs, clusterSize, reader_.Size())) {
+                fail(index, "Data runs point past the end of the volume");
+            } else {
+                ++stats_.compressedFiles;
+                jobs.push_back({ index, *wofStream, static_cast<int32_t>(algorithm), FirstAllocatedOffset(wofStream->runs, clusterSize) });
+            }
+            return;
+        }
+        if (!data) {
+            fail(index, attributeList ? "$DATA lives in extension records" : "No $DATA attribute");
+            return;
+        }
+
+        state.size = data->dataSize;
+        if (!data->nonResident) {
+            const size_t length = static_cast<size_t>(std::min<uint64_t>(data->dataSize, data->residentData.size()));
+            state.size = length;
+            write(index, 0, data->residentData.data(), length);
+            ++stats_.residentFiles;
+            bytesDone += length;
+            return;
+        }
+        if (!RunsInsideVolume(data->runs, clusterSize, reader_.Size())) {
+            fail(index, "Data runs point past the end of the volume");
+            return;
+        }
+        if (data->compressionUnit != 0) {
+            if ((clusterSize << data->compressionUnit) > kMaxCompressionUnitBytes) {
+                fail(index, "Compression unit is too large");
+                return;
+            }
+            ++stats_.compressedFiles;
+            jobs.push_back({ index, *data, -1, FirstAllocatedOffset(data->runs, clusterSize) });
+            return;
+        }
+
+        uint64_t fileOffset = 0;
+        uint64_t copied = 0;
+        uint32_t pieces = 0;
+        for (const auto &run : data->runs) {
+            if (fileOffset >= state.size) {
+                break;
+            }
+            if (run.length <= 0) {
+                continue;
+            }
+            uint64_t bytes = std::min<uint64_t>(static_cast<uint64_t>(run.length) * clusterSize, state.size - fileOffset);
+            if (!run.sparse && run.lcn > 0) {
+                uint64_t volumeOffset = static_cast<uint64_t>(run.lcn) * clusterSize;
+                for (uint64_t done = 0; done < bytes; done += maxRead) {
+                    extents.push_back({ index, fileOffset + done, volumeOffset + done, std::min(maxRead, bytes - done) });
+                    ++pieces;
+                }
+                copied += bytes;
+            }
+            fileOffset += bytes;
+        }
+        // Holes are never read; count them as done up front.
+        bytesDone += state.size - copied;
+        state.pending = pieces;
+        if (pieces == 0) {
+            // Empty or entirely sparse: creating it at its size is the whole job.
+            std::lock_guard<std::mutex> lock(state.mutex);
+            open(index);
+        }
+    }, error);
+    stats_.recordMs = MillisecondsSince(start);
+    if (!readAll) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        if (seen[i] == 0) {
+            fail(i, "Unreadable file record");
+        }
+        if (seen[i] != 2) {
+            ++totals.files;
+            totals.bytes += states[i].size;
+        }
+    }
+    // Everything not waiting on the queue or a decode job is done already.
+    std::vector<uint8_t> queued(files.size(), 0);
+    for (const auto &extent : extents) {
+        queued[extent.file] = 1;
+    }
+    for (const auto &job : jobs) {
+        queued[job.file] = 1;
+    }
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        if (seen[i] != 2 && !queued[i]) {
+            finish(i);
+        }
+    }
+    report(false);
+
+    // Serve the queue in volume order, merging neighbouring extents (often
+    // from different files) into one read.
+    std::sort(extents.begin(), extents.end(), [](const CopyExtent &a, const CopyExtent &b) {
+        return a.volumeOffset < b.volumeOffset;
+    });
+    std::vector<ReadGroup> groups;
+    for (size_t i = 0; i < extents.size(); ++i) {
+        const uint64_t end = extents[i].volumeOffset + extents[i].length;
+        if (!groups.empty()) {
+            ReadGroup &group = groups.back();
+            const uint64_t groupEnd = group.offset + group.length;
+            if (extents[i].volumeOffset <= groupEnd + gatherGap && std::max(groupEnd, end) - group.offset <= maxRead) {
+                group.length = std::max(groupEnd, end) - group.offset;
+                ++group.count;
+                continue;
+            }
+        }
+        groups.push_back({ i, 1, extents[i].volumeOffset, extents[i].length });
+    }
+
+    const size_t streams = options_.streams != 0 ? options_.streams : stats_.profile.queueDepth;
+    WorkStealingPool pool(streams);
+    std::vector<std::vector<uint8_t>> buffers(pool.ThreadCount());
+
+    start = std::chrono::steady_clock::now();
+    pool.Run(groups.size(), [&](size_t task, size_t worker) {
+        const ReadGroup &group = groups[task];
+        std::vector<uint8_t> &buffer = buffers[worker];
+        buffer.resize(static_cast<size_t>(maxRead));
+        long long read = reader_.ReadAt(group.offset, buffer.data(), static_cast<size_t>(group.length));
+        ++reads;
+        const std::string readError = read < 0 ? "Reading the volume failed with error " + std::to_string(VolumeReader::LastError()) : std::string();
+        if (read >= 0 && static_cast<uint64_t>(read) < group.length) {
+            std::memset(buffer.data() + read, 0, static_cast<size_t>(group.length - static_cast<uint64_t>(read)));
+        }
+
+        for (size_t i = group.first; i < group.first + group.count; ++i) {
+            const CopyExtent &extent = extents[i];
+            FileState &state = states[extent.file];
+            if (read < 0) {
+                fail(extent.file, readError);
+            } else if (!state.failed.load()) {
+                write(extent.file, extent.fileOffset, buffer.data() + (extent.volumeOffset - group.offset), static_cast<size_t>(extent.length));
+            }
+            bytesDone += extent.length;
+            if (state.pending.fetch_sub(1) == 1) {
+                finish(extent.file);
+            }
+        }
+        report(false);
+    });
+
+    // Compressed units need a whole unit before anything can be written, and a
+    // WOF stream needs its chunk table, so these go file by file.
+    std::sort(jobs.begin(), jobs.end(), [](const DecodeJob &a, const DecodeJob &b) {
+        return a.firstOffset < b.firstOffset;
+    });
+    pool.Run(jobs.size(), [&](size_t task, size_t) {
+        const DecodeJob &job = jobs[task];
+        const uint32_t index = job.file;
+        FileState &state = states[index];
+        auto readRange = [&](uint64_t offset, uint8_t *buffer, size_t length) {
+            ++reads;
+            long long read = reader_.ReadAt(offset, buffer, length);
+            if (read < 0) {
+                fail(index, "Reading the volume failed with error " + std::to_string(VolumeReader::LastError()));
+                return false;
+            }
+            std::memset(buffer + read, 0, length - static_cast<size_t>(read));
+            return true;
+        };
+
+        if (job.wofAlgorithm >= 0) {
+            std::vector<uint8_t> stream(static_cast<size_t>(job.stream.dataSize), 0);
+            if (!job.stream.nonResident) {
+                std::memcpy(stream.data(), job.stream.residentData.data(), std::min(stream.size(), job.stream.residentData.size()));
+            }
+            size_t filled = 0;
+            for (const auto &run : job.stream.runs) {
+                if (!job.stream.nonResident || filled >= stream.size()) {
+                    break;
+                }
+                if (run.length <= 0) {
+                    continue;
+                }
+                size_t bytes = static_cast<size_t>(std::min<uint64_t>(static_cast<uint64_t>(run.length) * clusterSize, stream.size() - filled));
+                if (!run.sparse && run.lcn > 0 && !readRange(static_cast<uint64_t>(run.lcn) * clusterSize, stream.data() + filled, bytes)) {
+                    break;
+                }
+                filled += bytes;
+            }
+            std::vector<uint8_t> output(static_cast<size_t>(state.size));
+            WofStats wofStats{};
+            std::string wofError;
+            if (!state.failed.load()) {
+                if (WofDecompress(stream.data(), stream.size(), static_cast<uint32_t>(job.wofAlgorithm), state.size, output.data(), 1, wofStats, wofError)) {
+                    write(index, 0, output.data(), output.size());
+                } else {
+                    fail(index, wofError);
+                }
+            }
+        } else {
+            const uint64_t unitClusters = 1ULL << job.stream.compressionUnit;
+            const size_t unitBytes = static_cast<size_t>(unitClusters * clusterSize);
+            std::vector<uint8_t> stored(unitBytes);
+            std::vector<uint8_t> unit(unitBytes);
+            std::vector<ByteRange> ranges;
+            for (uint64_t vcn = 0, offset = 0; offset < state.size && !state.failed.load(); vcn += unitClusters, offset += unitBytes) {
+                MapCompressionUnit(job.stream.runs, clusterSize, vcn, unitClusters, ranges);
+                size_t storedBytes = 0;
+                for (const auto &range : ranges) {
+                    if (!readRange(range.offset, stored.data() + storedBytes, static_cast<size_t>(range.length))) {
+                        break;
+                    }
+                    storedBytes += static_cast<size_t>(range.length);
+                }
+                // Corrupt units keep what decoded, as a single-file recovery does.
+                DecodeCompressionUnit(stored.data(), storedBytes, unit.data(), unitBytes);
+                write(index, offset, unit.data(), static_cast<size_t>(std::min<uint64_t>(unitBytes, state.size - offset)));
+            }
+        }
+        bytesDone += state.size;
+        finish(index);
+        report(false);
+    });
+    stats_.copyMs = MillisecondsSince(start);
+
+    stats_.files = totals.files - failed.load();
+    stats_.failed = failed.load();
+    stats_.bytes = bytesWritten.load();
+    stats_.reads = reads.load();
+    report(true);
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "deleted_tree.h"
+#include "io_profile.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+struct TreeRecoveryOptions {
+    std::string outputDirectory;
+    // Concurrent read streams; 0 takes the queue depth of the device profile.
+    size_t streams;
+    IoProfileMode device;
+};
+
+struct TreeRecoveryProgress {
+    uint64_t files;
+    uint64_t filesDone;
+    uint64_t bytes;
+    uint64_t bytesDone;
+};
+
+struct TreeRecoveryFailure {
+    // Output path relative to the output directory.
+    std::string path;
+    std::string reason;
+};
+
+struct TreeRecoveryStats {
+    uint64_t directories;
+    uint64_t files;
+    uint64_t residentFiles;
+    uint64_t compressedFiles;
+    // Files whose MFT slot changed since the scan; their runs are not theirs.
+    uint64_t skippedReused;
+    uint64_t failed;
+    uint64_t bytes;
+    // Volume reads issued for non-resident data.
+    uint64_t reads;
+    double recordMs;
+    double copyMs;
+    // The profile the copy ran with.
+    IoProfile profile;
+};
+
+// Restores a subtree of a DeletedTree under an output directory. The
+// directories are recreated first, then every file record is re-read in one
+// batched pass to check its slot and collect its runs. Resident files are
+// written straight away; the extents of all other plain files go into a
+// single queue sorted by volume offset, neighbouring extents are merged into
+// large reads, and the reads are spread over several streams that each walk
+// their share of the disk in order. Read size, merge gap and stream count
+// come from the IoProfile of the device. Writes are positional, so extents
+// land in their files in whatever order the disk yields them. Compressed and
+// WOF files are decoded one file per task after the queue drains.
+class TreeRecovery {
+  public:
+    TreeRecovery(VolumeReader &reader, const DeletedTree &tree, const TreeRecoveryOptions &options);
+
+    // progress is called from worker threads, one call at a time, at most a
+    // few times a second and once at the end.
+    bool Run(uint32_t nodeId, const std::function<void(const TreeRecoveryProgress &)> &progress, std::string &error);
+
+    const std::vector<TreeRecoveryFailure> &Failures() const { return failures_; }
+    const TreeRecoveryStats &Stats() const { return stats_; }
+
+  private:
+    VolumeReader &reader_;
+    const DeletedTree &tree_;
+    TreeRecoveryOptions options_;
+    std::vector<TreeRecoveryFailure> failures_;
+    TreeRecoveryStats stats_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,190 @@
+#include "usn_carver.h"
+#include "ntfs_record.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define USNSCANNER_SSE2 1
+#endif
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kRecordAlignment = 8;
+const size_t kV2NameOffset = 0x3C;
+const size_t kV3NameOffset = 0x4C;
+// 255 UTF-16 units after the larger (V3) header, rounded to 8.
+const size_t kMaxRecordLength = 0x250;
+const uint32_t kKnownReasons = 0x81FFFF77;
+const uint32_t kKnownAttributes = 0x007FFFFF;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+bool IsVersionField(uint32_t value) {
+    // MajorVersion 2 or 3 with MinorVersion 0.
+    return value == 2 || value == 3;
+}
+
+} // namespace
+
+UsnRecordScanner::UsnRecordScanner(uint32_t pageSize, uint64_t notBefore, uint64_t notAfter)
+    : pageMask_((pageSize == 0 || pageSize > 4096 ? 4096 : pageSize) - 1),
+      notBefore_(notBefore != 0 ? notBefore : kFileTimeFloor),
+      notAfter_(notAfter != 0 ? notAfter : CurrentFileTime() + kFileTimeTicksPerDay),
+      duplicates_(0) {}
+
+void UsnRecordScanner::Begin(size_t workers) {
+    workerRecords_.assign(workers, std::vector<CarvedUsnRecord>());
+    records_.clear();
+    duplicates_ = 0;
+}
+
+size_t UsnRecordScanner::Validate(const uint8_t *data, size_t available, uint64_t offset, CarvedUsnRecord &record) const {
+    if (available < kV2NameOffset + 2) {
+        return 0;
+    }
+
+    uint32_t length = Load<uint32_t>(data);
+    uint16_t major = Load<uint16_t>(data + 4);
+    size_t nameOffsetExpected = major == 2 ? kV2NameOffset : kV3NameOffset;
+    if (length % kRecordAlignment != 0 || length < nameOffsetExpected + 2 || length > kMaxRecordLength || length > available) {
+        return 0;
+    }
+    // Journal pages are 4 KB and records never straddle them.
+    if (pageMask_ == 4095 && (offset & pageMask_) + length > 4096) {
+        return 0;
+    }
+
+    size_t fields = major == 2 ? 24 : 40;
+    uint64_t usn = Load<uint64_t>(data + fields);
+    if (usn == 0 || (usn & pageMask_) != (offset & pageMask_)) {
+        return 0;
+    }
+
+    uint64_t timestamp = Load<uint64_t>(data + fields + 8);
+    uint32_t reason = Load<uint32_t>(data + fields + 16);
+    uint32_t sourceInfo = Load<uint32_t>(data + fields + 20);
+    uint32_t attributes = Load<uint32_t>(data + fields + 28);
+    uint16_t nameLength = Load<uint16_t>(data + fields + 32);
+    uint16_t nameOffset = Load<uint16_t>(data + fields + 34);
+    if (timestamp < notBefore_ || timestamp > notAfter_) {
+        return 0;
+    }
+    if (reason == 0 || (reason & ~kKnownReasons) != 0 || (sourceInfo & ~0xFu) != 0 || (attributes & ~kKnownAttributes) != 0) {
+        return 0;
+    }
+    if (nameOffset != nameOffsetExpected || nameLength == 0 || (nameLength & 1) != 0 ||
+        ((nameOffset + nameLength + kRecordAlignment - 1) & ~(kRecordAlignment - 1)) != length) {
+        return 0;
+    }
+
+    const uint8_t *name = data + nameOffset;
+    for (size_t i = 0; i < nameLength; i += 2) {
+        uint16_t unit = Load<uint16_t>(name + i);
+        if (unit < 0x20 || unit == '/' || unit == '\\') {
+            return 0;
+        }
+    }
+
+    record.offset = offset;
+    record.usn = usn;
+    record.fileRef = Load<uint64_t>(data + 8);
+    record.parentRef = Load<uint64_t>(data + (major == 2 ? 16 : 24));
+    record.timestamp = timestamp;
+    record.reason = reason;
+    record.attributes = attributes;
+    record.majorVersion = major;
+    record.name = Utf16ToUtf8(name, nameLength / 2);
+    return length;
+}
+
+void UsnRecordScanner::Scan(const ChunkView &view, size_t worker) {
+    auto &out = workerRecords_[worker];
+
+    size_t position = static_cast<size_t>((kRecordAlignment - (view.offset % kRecordAlignment)) % kRecordAlignment);
+    while (position < view.owned && position + 8 <= view.size) {
+#ifdef USNSCANNER_SSE2
+        // Eight record slots per step: the dword at slot + 4 holds the
+        // version fields, so only the odd dwords of each vector matter.
+        if (position + 64 <= view.size) {
+            const __m128i two = _mm_set1_epi32(2);
+            const __m128i three = _mm_set1_epi32(3);
+            const __m128i lanes = _mm_set_epi32(-1, 0, -1, 0);
+            uint32_t slots = 0;
+            for (int block = 0; block < 4; ++block) {
+                __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(view.data + position + block * 16));
+                __m128i match = _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi32(words, two), _mm_cmpeq_epi32(words, three)), lanes);
+                int bits = _mm_movemask_epi8(match);
+                slots |= static_cast<uint32_t>(((bits >> 4) & 1) | (((bits >> 12) & 1) << 1)) << (block * 2);
+            }
+            if (slots == 0) {
+                position += 64;
+                continue;
+            }
+            while ((slots & 1) == 0) {
+                slots >>= 1;
+                position += kRecordAlignment;
+            }
+            if (position >= view.owned) {
+                break;
+            }
+        }
+#endif
+        if (IsVersionField(Load<uint32_t>(view.data + position + 4))) {
+            CarvedUsnRecord record{};
+            size_t length = Validate(view.data + position, view.size - position, view.offset + position, record);
+            if (length != 0) {
+                out.push_back(std::move(record));
+                position += length;
+                continue;
+            }
+        }
+        position += kRecordAlignment;
+    }
+}
+
+void UsnRecordScanner::End() {
+    size_t total = 0;
+    for (const auto &local : workerRecords_) {
+        total += local.size();
+    }
+
+    records_.clear();
+    records_.reserve(total);
+    for (auto &local : workerRecords_) {
+        std::move(local.begin(), local.end(), std::back_inserter(records_));
+        local.clear();
+    }
+
+    // Old journal pages are often copied around (defrag, $J growth), so one
+    // USN shows up several times. A USN identifies a record within a journal
+    // instance; the file reference and timestamp tell instances apart.
+    std::sort(records_.begin(), records_.end(), [](const CarvedUsnRecord &a, const CarvedUsnRecord &b) {
+        if (a.usn != b.usn) {
+            return a.usn < b.usn;
+        }
+        if (a.fileRef != b.fileRef) {
+            return a.fileRef < b.fileRef;
+        }
+        if (a.timestamp != b.timestamp) {
+            return a.timestamp < b.timestamp;
+        }
+        return a.offset < b.offset;
+    });
+    size_t before = records_.size();
+    records_.erase(std::unique(records_.begin(), records_.end(), [](const CarvedUsnRecord &a, const CarvedUsnRecord &b) {
+        return a.usn == b.usn && a.fileRef == b.fileRef && a.timestamp == b.timestamp;
+    }), records_.end());
+    duplicates_ = before - records_.size();
+}
+
+} // namespace usnscanner
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "carver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+const uint32_t kUsnReasonFileDelete = 0x00000200;
+const uint32_t kFileAttributeDirectory = 0x00000010;
+
+// A USN_RECORD_V2/V3 recovered from a stale $J page. V3 128-bit references
+// are folded to their low 64 bits (the NTFS reference).
+struct CarvedUsnRecord {
+    uint64_t offset;
+    uint64_t usn;
+    uint64_t fileRef;
+    uint64_t parentRef;
+    uint64_t timestamp;
+    uint32_t reason;
+    uint32_t attributes;
+    uint16_t majorVersion;
+    std::string name;
+};
+
+// Recognizes journal records in free space while the carve engine streams it.
+// $J pages are cluster aligned, so a record's USN (its offset in $J) agrees
+// with its on-disk offset modulo the page size; that plus version, length,
+// reason, FILETIME and name checks keeps random data out.
+class UsnRecordScanner : public ChunkScanner {
+  public:
+    // pageSize is the cluster size (capped at 4096) the USN/offset agreement
+    // is checked against; notBefore/notAfter bound plausible timestamps
+    // (FILETIME ticks, 0 for the built-in window).
+    UsnRecordScanner(uint32_t pageSize, uint64_t notBefore, uint64_t notAfter);
+
+    size_t RequiredOverlap() const override { return 1024; }
+    void Begin(size_t workers) override;
+    void Scan(const ChunkView &view, size_t worker) override;
+    void End() override;
+
+    // Unique by USN, in USN order.
+    const std::vector<CarvedUsnRecord> &Records() const { return records_; }
+    uint64_t Duplicates() const { return duplicates_; }
+
+  private:
+    // Returns the record length when a valid record starts at data.
+    size_t Validate(const uint8_t *data, size_t available, uint64_t offset, CarvedUsnRecord &record) const;
+
+    uint32_t pageMask_;
+    uint64_t notBefore_;
+    uint64_t notAfter_;
+    std::vector<std::vector<CarvedUsnRecord>> workerRecords_;
+    std::vector<CarvedUsnRecord> records_;
+    uint64_t duplicates_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,274 @@
+#include "usn_journal.h"
+#include "ntfs_record.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kV2NameOffset = 0x3C;
+const size_t kV3NameOffset = 0x4C;
+const uint64_t kJournalPageSize = 4096;
+// 255 UTF-16 units after the larger (V3) header, rounded to 8.
+const size_t kMaxRecordLength = 0x250;
+const size_t kReadSize = 1024 * 1024;
+
+struct ReasonName {
+    uint32_t bit;
+    const char *name;
+};
+
+const ReasonName kReasonNames[] = {
+    { 0x00000001, "DATA_OVERWRITE" },
+    { 0x00000002, "DATA_EXTEND" },
+    { 0x00000004, "DATA_TRUNCATION" },
+    { 0x00000010, "NAMED_DATA_OVERWRITE" },
+    { 0x00000020, "NAMED_DATA_EXTEND" },
+    { 0x00000040, "NAMED_DATA_TRUNCATION" },
+    { 0x00000100, "FILE_CREATE" },
+    { 0x00000200, "FILE_DELETE" },
+    { 0x00000400, "EA_CHANGE" },
+    { 0x00000800, "SECURITY_CHANGE" },
+    { 0x00001000, "RENAME_OLD_NAME" },
+    { 0x00002000, "RENAME_NEW_NAME" },
+    { 0x00004000, "INDEXABLE_CHANGE" },
+    { 0x00008000, "BASIC_INFO_CHANGE" },
+    { 0x00010000, "HARD_LINK_CHANGE" },
+    { 0x00020000, "COMPRESSION_CHANGE" },
+    { 0x00040000, "ENCRYPTION_CHANGE" },
+    { 0x00080000, "OBJECT_ID_CHANGE" },
+    { 0x00100000, "REPARSE_POINT_CHANGE" },
+    { 0x00200000, "STREAM_CHANGE" },
+    { 0x00400000, "TRANSACTED_CHANGE" },
+    { 0x00800000, "INTEGRITY_CHANGE" },
+    { 0x01000000, "DESIRED_STORAGE_CLASS_CHANGE" },
+    { 0x80000000, "CLOSE" },
+};
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+const char *UsnReasonName(uint32_t bit) {
+    for (const auto &entry : kReasonNames) {
+        if (entry.bit == bit) {
+            return entry.name;
+        }
+    }
+    return nullptr;
+}
+
+void AppendUsnReasons(uint32_t reason, std::string &out) {
+    bool first = true;
+    for (const auto &entry : kReasonNames) {
+        if ((reason & entry.bit) != 0) {
+            if (!first) {
+                out.push_back('|');
+            }
+            out += entry.name;
+            first = false;
+        }
+    }
+}
+
+size_t ParseUsnRecord(const uint8_t *data, size_t available, CarvedUsnRecord &record) {
+    if (available < kV2NameOffset + 2) {
+        return 0;
+    }
+
+    uint32_t length = Load<uint32_t>(data);
+    uint16_t major = Load<uint16_t>(data + 4);
+    uint16_t minor = Load<uint16_t>(data + 6);
+    if ((major != 2 && major != 3) || minor != 0) {
+        return 0;
+    }
+    size_t nameOffsetExpected = major == 2 ? kV2NameOffset : kV3NameOffset;
+    if (length % 8 != 0 || length < nameOffsetExpected + 2 || length > available) {
+        return 0;
+    }
+
+    size_t fields = major == 2 ? 24 : 40;
+    uint16_t nameLength = Load<uint16_t>(data + fields + 32);
+    uint16_t nameOffset = Load<uint16_t>(data + fields + 34);
+    if (nameOffset != nameOffsetExpected || nameLength == 0 || (nameLength & 1) != 0 || nameOffset + nameLength > length) {
+        return 0;
+    }
+
+    record.usn = Load<uint64_t>(data + fields);
+    record.fileRef = Load<uint64_t>(data + 8);
+    record.parentRef = Load<uint64_t>(data + (major == 2 ? 16 : 24));
+    record.timestamp = Load<uint64_t>(data + fields + 8);
+    record.reason = Load<uint32_t>(data + fields + 16);
+    record.attributes = Load<uint32_t>(data + fields + 28);
+    record.majorVersion = major;
+    record.name = Utf16ToUtf8(data + nameOffset, nameLength / 2);
+    return length;
+}
+
+UsnJournalReader::UsnJournalReader() : reasonMask_(0), closeOnly_(true), journalId_(0), position_(0) {}
+
+bool UsnJournalReader::Open(const std::string &source, uint32_t reasonMask, bool closeOnly, std::string &error) {
+    if (!reader_.Open(source, error)) {
+        return false;
+    }
+    reasonMask_ = reasonMask;
+    closeOnly_ = closeOnly;
+    position_ = 0;
+    buffer_.resize(kReadSize);
+
+    if (reader_.IsVolume()) {
+#ifdef _WIN32
+        USN_JOURNAL_DATA_V0 journal{};
+        unsigned long returned = 0;
+        if (!reader_.Ioctl(FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &journal, sizeof(journal), returned)) {
+            error = "FSCTL_QUERY_USN_JOURNAL failed with error " + std::to_string(VolumeReader::LastError());
+            return false;
+        }
+        journalId_ = journal.UsnJournalID;
+        position_ = static_cast<uint64_t>(journal.FirstUsn);
+#endif
+    }
+    return true;
+}
+
+bool UsnJournalReader::Next(std::vector<CarvedUsnRecord> &records, std::string &error) {
+    records.clear();
+
+    if (reader_.IsVolume()) {
+#ifdef _WIN32
+        // The volume does the filtering.
+        while (records.empty()) {
+            READ_USN_JOURNAL_DATA_V0 request{};
+            request.StartUsn = static_cast<USN>(position_);
+            request.ReasonMask = reasonMask_;
+            request.ReturnOnlyOnClose = closeOnly_ ? TRUE : FALSE;
+            request.UsnJournalID = journalId_;
+
+            unsigned long returned = 0;
+            if (!reader_.Ioctl(FSCTL_READ_USN_JOURNAL, &request, sizeof(request), buffer_.data(), buffer_.size(), returned)) {
+                error = "FSCTL_READ_USN_JOURNAL failed with error " + std::to_string(VolumeReader::LastError());
+                return false;
+            }
+            if (returned < sizeof(uint64_t)) {
+                return true;
+            }
+
+            uint64_t nextUsn = Load<uint64_t>(buffer_.data());
+            size_t position = sizeof(uint64_t);
+            while (position < returned) {
+                CarvedUsnRecord record;
+                size_t length = ParseUsnRecord(buffer_.data() + position, returned - position, record);
+                if (length == 0) {
+                    break;
+                }
+                record.offset = record.usn;
+                records.push_back(std::move(record));
+                position += length;
+            }
+
+            if (nextUsn <= position_) {
+                return true;
+            }
+            position_ = nextUsn;
+        }
+#endif
+        return true;
+    }
+
+    // A copy of $J is read front to back. Records never straddle a journal
+    // page and zeros pad each page, so a zero length skips to the next page;
+    // anything else that does not parse is stepped over one slot at a time.
+    // The copy may still be growing, so its length is taken afresh each call.
+    if (!reader_.RefreshSize(error)) {
+        return false;
+    }
+    while (records.empty()) {
+        long long got = reader_.ReadAt(position_, buffer_.data(), buffer_.size());
+        if (got < 0) {
+            error = "Journal read failed with error " + std::to_string(VolumeReader::LastError());
+            return false;
+        }
+        size_t size = static_cast<size_t>(got);
+
+        size_t position = 0;
+        while (position + 8 <= size) {
+            uint64_t offset = position_ + position;
+            uint32_t length = Load<uint32_t>(buffer_.data() + position);
+            if (length == 0) {
+                uint64_t pageEnd = (offset / kJournalPageSize + 1) * kJournalPageSize;
+                if (pageEnd - position_ > size && size < buffer_.size()) {
+                    // The last page may still be filling up.
+                    break;
+                }
+                position = static_cast<size_t>(std::min<uint64_t>(pageEnd - position_, size));
+                continue;
+            }
+            if (length > size - position && length <= kMaxRecordLength && (position != 0 || size < buffer_.size())) {
+                // Continues past this read, or is still being appended.
+                break;
+            }
+
+            CarvedUsnRecord record;
+            size_t parsed = ParseUsnRecord(buffer_.data() + position, size - position, record);
+            if (parsed == 0) {
+                position += 8;
+                continue;
+            }
+            if ((record.reason & reasonMask_) != 0 && (!closeOnly_ || (record.reason & kUsnReasonClose) != 0)) {
+                record.offset = offset;
+                records.push_back(std::move(record));
+            }
+            position += parsed;
+        }
+
+        if (position == 0) {
+            return true;
+        }
+        position_ += position;
+    }
+    return true;
+}
+
+bool UsnJournalReader::SeekToEnd(std::string &error) {
+    if (reader_.IsVolume()) {
+#ifdef _WIN32
+        USN_JOURNAL_DATA_V0 journal{};
+        unsigned long returned = 0;
+        if (!reader_.Ioctl(FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &journal, sizeof(journal), returned)) {
+            error = "FSCTL_QUERY_USN_JOURNAL failed with error " + std::to_string(VolumeReader::LastError());
+            return false;
+        }
+        journalId_ = journal.UsnJournalID;
+        position_ = static_cast<uint64_t>(journal.NextUsn);
+#endif
+        return true;
+    }
+
+    // Start on the last page and read the rest of it through, which leaves
+    // the position just past the last whole record.
+    if (!reader_.RefreshSize(error)) {
+        return false;
+    }
+    position_ = reader_.Size() / kJournalPageSize * kJournalPageSize;
+    std::vector<CarvedUsnRecord> skipped;
+    do {
+        if (!Next(skipped, error)) {
+            return false;
+        }
+    } while (!skipped.empty());
+    return true;
+}
+
+} // namespace usnscanner
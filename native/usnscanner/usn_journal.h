@@ -0,0 +1,58 @@
+#pragma once
+
+#include "usn_carver.h"
+#include "volume_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+const uint32_t kUsnReasonClose = 0x80000000;
+
+// "FILE_DELETE" for 0x200 and so on; nullptr for an unknown bit.
+const char *UsnReasonName(uint32_t bit);
+// Appends the names of the known bits in `reason`, joined by '|'.
+void AppendUsnReasons(uint32_t reason, std::string &out);
+
+// Parses the USN_RECORD_V2/V3 at data into record (offset is left to the
+// caller). Returns the record length, or 0 when data does not start a
+// well-formed record: page padding, a sparse hole or damage.
+size_t ParseUsnRecord(const uint8_t *data, size_t available, CarvedUsnRecord &record);
+
+// Streams change journal records in journal order, either from a live
+// volume's journal (drive letter, Windows only) or from a copy of
+// $Extend\$UsnJrnl:$J. Only records whose reason intersects the mask are
+// returned. With closeOnly, only the record written when the file is closed
+// is kept, which carries every reason of that session, so each change is
+// reported once; otherwise every intermediate record comes through too.
+class UsnJournalReader {
+  public:
+    UsnJournalReader();
+
+    bool Open(const std::string &source, uint32_t reasonMask, bool closeOnly, std::string &error);
+
+    // Replaces records with the next batch. An empty batch means everything
+    // written so far has been read; calling again later picks up new records.
+    bool Next(std::vector<CarvedUsnRecord> &records, std::string &error);
+    // Skips everything written so far, so Next() returns only new records:
+    // the journal's next USN when live, the end of a copy that may still be
+    // growing otherwise.
+    bool SeekToEnd(std::string &error);
+
+    bool IsLive() const { return reader_.IsVolume(); }
+    // USN (live) or file offset (copy) the next batch starts at.
+    uint64_t Position() const { return position_; }
+
+  private:
+    VolumeReader reader_;
+    uint32_t reasonMask_;
+    bool closeOnly_;
+    uint64_t journalId_;
+    uint64_t position_;
+    std::vector<uint8_t> buffer_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,566 @@
+#include "volume_reader.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include <cerrno>
+#include <filesystem>
+#endif
+
+#include "io_throttle.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+thread_local unsigned long lastError = 0;
+
+#ifndef _WIN32
+// Adds the whole disk behind a sysfs block device directory: a partition's
+// parent, or the disks under a device-mapper or md device's slaves.
+void AddBackingDisks(const std::filesystem::path &block, std::vector<std::string> &devices, int depth) {
+    std::error_code ec;
+    std::filesystem::path disk = block;
+    if (std::filesystem::exists(block / "partition", ec)) {
+        disk = block.parent_path();
+    }
+
+    bool stacked = false;
+    if (depth < 8) {
+        for (const auto &slave : std::filesystem::directory_iterator(disk / "slaves", ec)) {
+            std::filesystem::path target = std::filesystem::canonical(slave.path(), ec);
+            if (!ec) {
+                AddBackingDisks(target, devices, depth + 1);
+                stacked = true;
+            }
+        }
+    }
+    if (stacked) {
+        return;
+    }
+    std::string name = disk.filename().string();
+    if (std::find(devices.begin(), devices.end(), name) == devices.end()) {
+        devices.push_back(name);
+    }
+}
+#endif
+
+#ifdef _WIN32
+std::wstring Utf8PathToWide(const std::string &input) {
+    if (input.empty()) {
+        return std::wstring();
+    }
+
+    int required = MultiByteToWideChar(CP_UTF8, 0, input.c_str(), static_cast<int>(input.size()), nullptr, 0);
+    if (required <= 0) {
+        return std::wstring();
+    }
+
+    std::wstring output(static_cast<size_t>(required), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, input.c_str(), static_cast<int>(input.size()), output.data(), required);
+    return output;
+}
+
+// The volume handle is opened for overlapped I/O so concurrent readers are not
+// serialized by the I/O manager; each thread waits on its own event.
+HANDLE ThreadEvent() {
+    thread_local struct EventHolder {
+        HANDLE handle = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        ~EventHolder() {
+            if (handle) {
+                ::CloseHandle(handle);
+            }
+        }
+    } holder;
+    return holder.handle;
+}
+#endif
+
+} // namespace
+
+bool IsDriveLetterSource(const std::string &source, char &letter) {
+    if (source.empty() || source.size() > 3 || !std::isalpha(static_cast<unsigned char>(source[0]))) {
+        return false;
+    }
+    if (source.size() >= 2 && source[1] != ':') {
+        return false;
+    }
+    if (source.size() == 3 && source[2] != '\\' && source[2] != '/') {
+        return false;
+    }
+
+    letter = static_cast<char>(std::toupper(static_cast<unsigned char>(source[0])));
+    return true;
+}
+
+VolumeReader::VolumeReader()
+#ifdef _WIN32
+    : handle_(INVALID_HANDLE_VALUE),
+#else
+    : fd_(-1),
+#endif
+      isVolume_(false),
+      driveLetter_(0),
+      size_(0),
+      sectorSize_(512) {}
+
+VolumeReader::~VolumeReader() {
+    Close();
+}
+
+bool VolumeReader::IsOpen() const {
+#ifdef _WIN32
+    return handle_ != INVALID_HANDLE_VALUE;
+#else
+    return fd_ >= 0;
+#endif
+}
+
+unsigned long VolumeReader::LastError() {
+    return lastError;
+}
+
+#ifdef _WIN32
+
+bool VolumeReader::Open(const std::string &source, std::string &error) {
+    Close();
+
+    char letter = 0;
+    std::wstring path;
+    isVolume_ = IsDriveLetterSource(source, letter);
+    if (isVolume_) {
+        driveLetter_ = letter;
+        path = L"\\\\.\\";
+        path.push_back(static_cast<wchar_t>(letter));
+        path.push_back(L':');
+    } else {
+        path = Utf8PathToWide(source);
+    }
+
+    if (path.empty()) {
+        error = "Source path is required";
+        return false;
+    }
+
+    HANDLE handle = ::CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_OVERLAPPED | (isVolume_ ? FILE_FLAG_BACKUP_SEMANTICS : FILE_FLAG_SEQUENTIAL_SCAN),
+        nullptr
+    );
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        DWORD err = ::GetLastError();
+        error = "CreateFile failed with error " + std::to_string(err);
+        return false;
+    }
+    handle_ = handle;
+
+    if (isVolume_) {
+        std::wstring rootPath;
+        rootPath.push_back(static_cast<wchar_t>(letter));
+        rootPath.append(L":\\");
+
+        DWORD sectorsPerCluster = 0;
+        DWORD bytesPerSector = 0;
+        DWORD freeClusters = 0;
+        DWORD totalClusters = 0;
+        if (::GetDiskFreeSpaceW(rootPath.c_str(), &sectorsPerCluster, &bytesPerSector, &freeClusters, &totalClusters) && bytesPerSector != 0) {
+            sectorSize_ = bytesPerSector;
+        }
+
+        GET_LENGTH_INFORMATION lengthInfo{};
+        unsigned long returned = 0;
+        if (!Ioctl(IOCTL_DISK_GET_LENGTH_INFO, nullptr, 0, &lengthInfo, sizeof(lengthInfo), returned)) {
+            error = "IOCTL_DISK_GET_LENGTH_INFO failed with error " + std::to_string(lastError);
+            Close();
+            return false;
+        }
+        size_ = static_cast<uint64_t>(lengthInfo.Length.QuadPart);
+    } else {
+        LARGE_INTEGER fileSize{};
+        if (!::GetFileSizeEx(handle_, &fileSize)) {
+            DWORD err = ::GetLastError();
+            error = "GetFileSizeEx failed with error " + std::to_string(err);
+            Close();
+            return false;
+        }
+        size_ = static_cast<uint64_t>(fileSize.QuadPart);
+        sectorSize_ = 1;
+    }
+
+    return true;
+}
+
+bool VolumeReader::RefreshSize(std::string &error) {
+    if (isVolume_) {
+        return true;
+    }
+    LARGE_INTEGER fileSize{};
+    if (!::GetFileSizeEx(handle_, &fileSize)) {
+        error = "GetFileSizeEx failed with error " + std::to_string(::GetLastError());
+        return false;
+    }
+    size_ = static_cast<uint64_t>(fileSize.QuadPart);
+    return true;
+}
+
+bool VolumeReader::PhysicalDevices(std::vector<std::string> &devices, std::string &error) {
+    devices.clear();
+    if (isVolume_) {
+        // Room for a volume spanning 16 disks.
+        std::vector<uint8_t> buffer(sizeof(VOLUME_DISK_EXTENTS) + 15 * sizeof(DISK_EXTENT));
+        unsigned long returned = 0;
+        if (!Ioctl(IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS, nullptr, 0, buffer.data(), buffer.size(), returned)) {
+            error = "IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS failed with error " + std::to_string(lastError);
+            return false;
+        }
+        const VOLUME_DISK_EXTENTS *extents = reinterpret_cast<const VOLUME_DISK_EXTENTS *>(buffer.data());
+        for (DWORD i = 0; i < extents->NumberOfDiskExtents; ++i) {
+            std::string name = "PhysicalDrive" + std::to_string(extents->Extents[i].DiskNumber);
+            if (std::find(devices.begin(), devices.end(), name) == devices.end()) {
+                devices.push_back(name);
+            }
+        }
+        return true;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info{};
+    if (!::GetFileInformationByHandle(handle_, &info)) {
+        error = "GetFileInformationByHandle failed with error " + std::to_string(::GetLastError());
+        return false;
+    }
+    devices.push_back("Volume" + std::to_string(info.dwVolumeSerialNumber));
+    return true;
+}
+
+void VolumeReader::Close() {
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+    isVolume_ = false;
+    driveLetter_ = 0;
+    size_ = 0;
+    sectorSize_ = 512;
+}
+
+bool VolumeReader::Ioctl(unsigned long code, const void *in, size_t inLength, void *out, size_t outLength, unsigned long &returned) {
+    IoThrottleScope throttle(outLength);
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = ThreadEvent();
+    ::ResetEvent(overlapped.hEvent);
+
+    DWORD bytes = 0;
+    BOOL ok = ::DeviceIoControl(
+        handle_,
+        code,
+        const_cast<void *>(in),
+        static_cast<DWORD>(inLength),
+        out,
+        static_cast<DWORD>(outLength),
+        &bytes,
+        &overlapped
+    );
+    if (!ok && ::GetLastError() == ERROR_IO_PENDING) {
+        ok = ::GetOverlappedResult(handle_, &overlapped, &bytes, TRUE);
+    }
+
+    returned = bytes;
+    if (!ok) {
+        lastError = ::GetLastError();
+        return false;
+    }
+    return true;
+}
+
+long long VolumeReader::ReadAligned(uint64_t offset, void *buffer, size_t length) {
+    IoThrottleScope throttle(length);
+    size_t total = 0;
+    BYTE *out = static_cast<BYTE *>(buffer);
+
+    while (total < length) {
+        DWORD request = static_cast<DWORD>(std::min<size_t>(length - total, 64u * 1024u * 1024u));
+        uint64_t position = offset + total;
+
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFFull);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+        overlapped.hEvent = ThreadEvent();
+        ::ResetEvent(overlapped.hEvent);
+
+        DWORD read = 0;
+        BOOL ok = ::ReadFile(handle_, out + total, request, &read, &overlapped);
+        if (!ok && ::GetLastError() == ERROR_IO_PENDING) {
+            ok = ::GetOverlappedResult(handle_, &overlapped, &read, TRUE);
+        }
+        if (!ok) {
+            DWORD err = ::GetLastError();
+            if (err == ERROR_HANDLE_EOF) {
+                break;
+            }
+            lastError = err;
+            return -1;
+        }
+        if (read == 0) {
+            break;
+        }
+        total += read;
+    }
+
+    return static_cast<long long>(total);
+}
+
+#else
+
+bool VolumeReader::Open(const std::string &source, std::string &error) {
+    Close();
+
+    char letter = 0;
+    if (IsDriveLetterSource(source, letter)) {
+        error = "Live volumes can only be opened on Windows; pass an image path instead";
+        return false;
+    }
+
+    int fd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "open failed with error " + std::to_string(errno);
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        error = "fstat failed with error " + std::to_string(errno);
+        ::close(fd);
+        return false;
+    }
+
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (S_ISBLK(st.st_mode)) {
+        off_t end = ::lseek(fd, 0, SEEK_END);
+        size = end > 0 ? static_cast<uint64_t>(end) : 0;
+    }
+
+    fd_ = fd;
+    size_ = size;
+    sectorSize_ = 1;
+    return true;
+}
+
+bool VolumeReader::RefreshSize(std::string &error) {
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) {
+        error = "fstat failed with error " + std::to_string(errno);
+        return false;
+    }
+    if (S_ISREG(st.st_mode)) {
+        size_ = static_cast<uint64_t>(st.st_size);
+    }
+    return true;
+}
+
+bool VolumeReader::PhysicalDevices(std::vector<std::string> &devices, std::string &error) {
+    devices.clear();
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) {
+        error = "fstat failed with error " + std::to_string(errno);
+        return false;
+    }
+    const dev_t device = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    const std::string number = std::to_string(major(device)) + ":" + std::to_string(minor(device));
+    std::error_code ec;
+    std::filesystem::path block = std::filesystem::canonical("/sys/dev/block/" + number, ec);
+    if (ec) {
+        // tmpfs, overlayfs and the like have no block device.
+        devices.push_back("dev" + number);
+        return true;
+    }
+    AddBackingDisks(block, devices, 0);
+    if (devices.empty()) {
+        devices.push_back("dev" + number);
+    }
+    return true;
+}
+
+void VolumeReader::Close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    isVolume_ = false;
+    driveLetter_ = 0;
+    size_ = 0;
+    sectorSize_ = 512;
+}
+
+bool VolumeReader::Ioctl(unsigned long, const void *, size_t, void *, size_t, unsigned long &returned) {
+    returned = 0;
+    lastError = 0;
+    return false;
+}
+
+long long VolumeReader::ReadAligned(uint64_t offset, void *buffer, size_t length) {
+    IoThrottleScope throttle(length);
+    size_t total = 0;
+    char *out = static_cast<char *>(buffer);
+
+    while (total < length) {
+        ssize_t read = ::pread(fd_, out + total, length - total, static_cast<off_t>(offset + total));
+        if (read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            lastError = static_cast<unsigned long>(errno);
+            return -1;
+        }
+        if (read == 0) {
+            break;
+        }
+        total += static_cast<size_t>(read);
+    }
+
+    return static_cast<long long>(total);
+}
+
+#endif
+
+long long VolumeReader::ReadAt(uint64_t offset, void *buffer, size_t length) {
+    if (!IsOpen()) {
+        lastError = 0;
+        return -1;
+    }
+    if (length == 0 || offset >= size_) {
+        return 0;
+    }
+
+    length = static_cast<size_t>(std::min<uint64_t>(length, size_ - offset));
+
+    const uint64_t sector = sectorSize_ == 0 ? 1 : sectorSize_;
+    if (offset % sector == 0 && length % sector == 0) {
+        return ReadAligned(offset, buffer, length);
+    }
+
+    // Raw volume handles reject unaligned transfers; bounce through a sector
+    // aligned scratch buffer instead.
+    uint64_t alignedStart = offset - (offset % sector);
+    uint64_t alignedEnd = offset + length;
+    if (alignedEnd % sector != 0) {
+        alignedEnd += sector - (alignedEnd % sector);
+    }
+
+    thread_local std::vector<unsigned char> scratch;
+    scratch.resize(static_cast<size_t>(alignedEnd - alignedStart));
+
+    long long read = ReadAligned(alignedStart, scratch.data(), scratch.size());
+    if (read < 0) {
+        return -1;
+    }
+
+    uint64_t skip = offset - alignedStart;
+    if (static_cast<uint64_t>(read) <= skip) {
+        return 0;
+    }
+
+    size_t available = static_cast<size_t>(std::min<uint64_t>(length, static_cast<uint64_t>(read) - skip));
+    std::memcpy(buffer, scratch.data() + skip, available);
+    return static_cast<long long>(available);
+}
+
+bool QueryFreeSpaceRanges(VolumeReader &reader, uint64_t &clusterSize, std::vector<ByteRange> &ranges, std::string &error) {
+    ranges.clear();
+
+#ifdef _WIN32
+    if (!reader.IsVolume()) {
+        error = "Free space queries require a live volume";
+        return false;
+    }
+
+    NTFS_VOLUME_DATA_BUFFER volumeData{};
+    unsigned long returned = 0;
+    if (!reader.Ioctl(FSCTL_GET_NTFS_VOLUME_DATA, nullptr, 0, &volumeData, sizeof(volumeData), returned)) {
+        error = "FSCTL_GET_NTFS_VOLUME_DATA failed with error " + std::to_string(VolumeReader::LastError());
+        return false;
+    }
+    clusterSize = volumeData.BytesPerCluster;
+
+    const size_t bufferSize = 1024 * 1024;
+    std::vector<BYTE> buffer(bufferSize);
+    STARTING_LCN_INPUT_BUFFER input{};
+    input.StartingLcn.QuadPart = 0;
+
+    uint64_t runStart = 0;
+    uint64_t runLength = 0;
+
+    while (true) {
+        bool ok = reader.Ioctl(FSCTL_GET_VOLUME_BITMAP, &input, sizeof(input), buffer.data(), buffer.size(), returned);
+        unsigned long err = ok ? 0 : VolumeReader::LastError();
+        if (!ok && err != ERROR_MORE_DATA) {
+            error = "FSCTL_GET_VOLUME_BITMAP failed with error " + std::to_string(err);
+            return false;
+        }
+
+        auto *bitmap = reinterpret_cast<VOLUME_BITMAP_BUFFER *>(buffer.data());
+        uint64_t startLcn = static_cast<uint64_t>(bitmap->StartingLcn.QuadPart);
+        uint64_t bitmapBytes = returned - offsetof(VOLUME_BITMAP_BUFFER, Buffer);
+        uint64_t clusters = std::min<uint64_t>(static_cast<uint64_t>(bitmap->BitmapSize.QuadPart), bitmapBytes * 8);
+
+        for (uint64_t i = 0; i < clusters; ++i) {
+            if ((i & 7) == 0 && i + 8 <= clusters) {
+                BYTE bits = bitmap->Buffer[i >> 3];
+                if (bits == 0x00) {
+                    if (runLength == 0) {
+                        runStart = startLcn + i;
+                    }
+                    runLength += 8;
+                    i += 7;
+                    continue;
+                }
+                if (bits == 0xFF && runLength == 0) {
+                    i += 7;
+                    continue;
+                }
+            }
+
+            bool used = (bitmap->Buffer[i >> 3] >> (i & 7)) & 1;
+            if (!used) {
+                if (runLength == 0) {
+                    runStart = startLcn + i;
+                }
+                ++runLength;
+            } else if (runLength != 0) {
+                ranges.push_back({ runStart * clusterSize, runLength * clusterSize });
+                runLength = 0;
+            }
+        }
+
+        if (ok) {
+            break;
+        }
+        input.StartingLcn.QuadPart = static_cast<LONGLONG>(startLcn + clusters);
+    }
+
+    if (runLength != 0) {
+        ranges.push_back({ runStart * clusterSize, runLength * clusterSize });
+    }
+    return true;
+#else
+    (void)reader;
+    clusterSize = 0;
+    error = "Free space queries are only available on Windows";
+    return false;
+#endif
+}
+
+} // namespace usnscanner
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+struct ByteRange {
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Positional, thread-safe reader over a raw volume (drive letter) or an image
+// file. Reads are issued at absolute byte offsets so several workers can share
+// one handle without seeking.
+class VolumeReader {
+  public:
+    VolumeReader();
+    ~VolumeReader();
+
+    VolumeReader(const VolumeReader &) = delete;
+    VolumeReader &operator=(const VolumeReader &) = delete;
+
+    // Accepts "C", "C:" or "C:\" for a live volume, anything else is treated as
+    // a path to an image file or block device.
+    bool Open(const std::string &source, std::string &error);
+    void Close();
+
+    bool IsOpen() const;
+    bool IsVolume() const { return isVolume_; }
+    char DriveLetter() const { return driveLetter_; }
+    uint64_t Size() const { return size_; }
+    // Re-reads the length of an image file that may still be growing; a live
+    // volume keeps its size. Not safe while other threads are reading.
+    bool RefreshSize(std::string &error);
+    uint32_t SectorSize() const { return sectorSize_; }
+
+    // Returns the number of bytes read (short only at end of source) or -1 on
+    // error, in which case LastError() carries the OS error code of the calling
+    // thread.
+    long long ReadAt(uint64_t offset, void *buffer, size_t length);
+    static unsigned long LastError();
+
+    // Physical disks holding the source, as names other sources can be
+    // compared against: "PhysicalDrive<n>" for each disk a live volume
+    // spans; on Linux the whole-disk block device ("sda", "nvme0n1") under
+    // an image's filesystem or a block device, following device-mapper and
+    // md to the disks beneath. When the disk cannot be told, a name for the
+    // hosting volume or device number stands in.
+    bool PhysicalDevices(std::vector<std::string> &devices, std::string &error);
+
+    // Synchronous DeviceIoControl on the shared handle (Windows only; fails
+    // with LastError() == 0 elsewhere).
+    bool Ioctl(unsigned long code, const void *in, size_t inLength, void *out, size_t outLength, unsigned long &returned);
+
+  private:
+    long long ReadAligned(uint64_t offset, void *buffer, size_t length);
+
+#ifdef _WIN32
+    void *handle_;
+#else
+    int fd_;
+#endif
+    bool isVolume_;
+    char driveLetter_;
+    uint64_t size_;
+    uint32_t sectorSize_;
+};
+
+bool IsDriveLetterSource(const std::string &source, char &letter);
+
+// Free cluster extents of a live NTFS volume, expressed as byte ranges relative
+// to the start of the volume. Only implemented on Windows.
+bool QueryFreeSpaceRanges(VolumeReader &reader, uint64_t &clusterSize, std::vector<ByteRange> &ranges, std::string &error);
+
+} // namespace usnscanner
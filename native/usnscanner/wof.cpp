@@ -0,0 +1,144 @@
+#include "wof.h"
+#include "lzx.h"
+#include "work_pool.h"
+#include "xpress.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const uint32_t kReparseTagWof = 0x80000017;
+const uint32_t kWofProviderFile = 2;
+const size_t kReparseHeader = 8;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+uint32_t WofChunkSize(uint32_t algorithm) {
+    switch (algorithm) {
+        case kWofXpress4K: return 4096;
+        case kWofLzx: return 32768;
+        case kWofXpress8K: return 8192;
+        case kWofXpress16K: return 16384;
+        default: return 0;
+    }
+}
+
+bool ParseWofReparsePoint(const std::vector<uint8_t> &reparse, uint32_t &algorithm) {
+    // Reparse header, WOF_EXTERNAL_INFO {version, provider}, then
+    // FILE_PROVIDER_EXTERNAL_INFO_V1 {version, algorithm, flags}.
+    if (reparse.size() < kReparseHeader + 16 || Load<uint32_t>(reparse.data()) != kReparseTagWof) {
+        return false;
+    }
+    const uint8_t *data = reparse.data() + kReparseHeader;
+    if (Load<uint32_t>(data + 4) != kWofProviderFile) {
+        return false;
+    }
+    algorithm = Load<uint32_t>(data + 12);
+    return WofChunkSize(algorithm) != 0;
+}
+
+bool WofDecompress(
+    const uint8_t *stream,
+    size_t streamSize,
+    uint32_t algorithm,
+    uint64_t uncompressedSize,
+    uint8_t *output,
+    size_t threads,
+    WofStats &stats,
+    std::string &error) {
+    return WofDecompress(stream, streamSize, algorithm, uncompressedSize, uncompressedSize, output, threads, stats, error);
+}
+
+bool WofDecompress(
+    const uint8_t *stream,
+    size_t streamSize,
+    uint32_t algorithm,
+    uint64_t uncompressedSize,
+    uint64_t outputSize,
+    uint8_t *output,
+    size_t threads,
+    WofStats &stats,
+    std::string &error) {
+    stats = WofStats{};
+    const uint64_t chunkSize = WofChunkSize(algorithm);
+    if (chunkSize == 0) {
+        error = "Unknown WOF compression format " + std::to_string(algorithm);
+        return false;
+    }
+    outputSize = std::min(outputSize, uncompressedSize);
+    if (outputSize == 0) {
+        return true;
+    }
+
+    const uint64_t chunks = (uncompressedSize + chunkSize - 1) / chunkSize;
+    const size_t entrySize = uncompressedSize >= (1ULL << 32) ? 8 : 4;
+    const uint64_t tableSize = (chunks - 1) * entrySize;
+    if (tableSize > streamSize) {
+        error = "WOF chunk table exceeds the stream";
+        return false;
+    }
+
+    // Chunk i spans [offsets[i], offsets[i + 1]) of the data after the table.
+    const uint64_t dataSize = streamSize - tableSize;
+    std::vector<uint64_t> offsets(static_cast<size_t>(chunks) + 1);
+    offsets[0] = 0;
+    for (uint64_t i = 1; i < chunks; ++i) {
+        const uint8_t *entry = stream + (i - 1) * entrySize;
+        offsets[i] = entrySize == 8 ? Load<uint64_t>(entry) : Load<uint32_t>(entry);
+        if (offsets[i] < offsets[i - 1] || offsets[i] > dataSize) {
+            error = "WOF chunk table is not monotonic";
+            return false;
+        }
+    }
+    offsets[chunks] = dataSize;
+
+    // Only chunks overlapping the output are decoded.
+    const uint64_t decoded = (outputSize + chunkSize - 1) / chunkSize;
+    const uint8_t *data = stream + tableSize;
+    std::atomic<uint64_t> stored(0);
+    std::atomic<uint64_t> corrupt(0);
+    WorkStealingPool pool(threads != 0 ? threads : DefaultWorkerCount());
+    pool.Run(static_cast<size_t>(decoded), [&](size_t chunk, size_t) {
+        const uint64_t begin = chunk * chunkSize;
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(chunkSize, uncompressedSize - begin));
+        const size_t written = static_cast<size_t>(std::min<uint64_t>(length, outputSize - begin));
+        const uint8_t *input = data + offsets[chunk];
+        const size_t inputSize = static_cast<size_t>(offsets[chunk + 1] - offsets[chunk]);
+        uint8_t *target = output + begin;
+
+        if (inputSize == length) {
+            std::memcpy(target, input, written);
+            stored.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // The last chunk decoded may run past the output.
+        std::vector<uint8_t> partial(written < length ? length : 0);
+        uint8_t *decodeTarget = partial.empty() ? target : partial.data();
+        bool ok = algorithm == kWofLzx ? LzxDecompress(input, inputSize, decodeTarget, length)
+                                       : XpressHuffmanDecompress(input, inputSize, decodeTarget, length);
+        if (!ok) {
+            std::memset(target, 0, written);
+            corrupt.fetch_add(1, std::memory_order_relaxed);
+        } else if (!partial.empty()) {
+            std::memcpy(target, partial.data(), written);
+        }
+    });
+
+    stats.chunks = decoded;
+    stats.storedChunks = stored.load();
+    stats.corruptChunks = corrupt.load();
+    return true;
+}
+
+} // namespace usnscanner
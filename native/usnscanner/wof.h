@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usnscanner {
+
+// FILE_PROVIDER_EXTERNAL_INFO_V1 compression formats.
+const uint32_t kWofXpress4K = 0;
+const uint32_t kWofLzx = 1;
+const uint32_t kWofXpress8K = 2;
+const uint32_t kWofXpress16K = 3;
+
+// Named $DATA stream holding a WOF-compressed file's contents.
+const char kWofStreamName[] = "WofCompressedData";
+
+// Uncompressed bytes per chunk for a format, 0 if unknown.
+uint32_t WofChunkSize(uint32_t algorithm);
+
+// Reads the compression format from a $REPARSE_POINT value tagged
+// IO_REPARSE_TAG_WOF with the file provider.
+bool ParseWofReparsePoint(const std::vector<uint8_t> &reparse, uint32_t &algorithm);
+
+struct WofStats {
+    uint64_t chunks;
+    uint64_t storedChunks;
+    // Chunks that failed to decode; their range of the output is zeroed.
+    uint64_t corruptChunks;
+};
+
+// Decompresses a WofCompressedData stream into `output` (uncompressedSize
+// bytes). The stream starts with a table of chunk end offsets (32-bit, 64-bit
+// for files of 4 GB and more) followed by chunks compressed independently,
+// so they are decoded in parallel. Chunks whose stored size equals their
+// uncompressed size are raw. Returns false only when the table itself is
+// unusable.
+bool WofDecompress(
+    const uint8_t *stream,
+    size_t streamSize,
+    uint32_t algorithm,
+    uint64_t uncompressedSize,
+    uint8_t *output,
+    size_t threads,
+    WofStats &stats,
+    std::string &error);
+
+// As above, but fills only the first outputSize bytes of the file: the whole
+// table is still checked, and only the chunks overlapping the output are
+// decoded (and counted in `stats`). Lets a caller preview a large file
+// without buffering all of it.
+bool WofDecompress(
+    const uint8_t *stream,
+    size_t streamSize,
+    uint32_t algorithm,
+    uint64_t uncompressedSize,
+    uint64_t outputSize,
+    uint8_t *output,
+    size_t threads,
+    WofStats &stats,
+    std::string &error);
+
+} // namespace usnscanner
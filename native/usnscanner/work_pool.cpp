@@ -0,0 +1,127 @@
+#include "work_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace usnscanner {
+
+namespace {
+
+struct TaskQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+
+    bool PopFront(size_t &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+    bool PopBack(size_t &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+};
+
+} // namespace
+
+size_t DefaultWorkerCount(size_t cap) {
+    size_t hardware = std::thread::hardware_concurrency();
+    if (hardware == 0) {
+        hardware = 1;
+    }
+    return std::max<size_t>(1, std::min(hardware, cap));
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : threads_(std::max<size_t>(1, threads)),
+      counters_(threads_, WorkerCounters{ 0, 0 }) {}
+
+void WorkStealingPool::Run(size_t taskCount, const std::function<void(size_t task, size_t worker)> &body) {
+    std::fill(counters_.begin(), counters_.end(), WorkerCounters{ 0, 0 });
+    if (taskCount == 0) {
+        return;
+    }
+
+    const size_t workers = std::min(threads_, taskCount);
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    queues.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    // Contiguous blocks keep every worker on a sequential stretch of the source.
+    for (size_t w = 0; w < workers; ++w) {
+        size_t begin = taskCount * w / workers;
+        size_t end = taskCount * (w + 1) / workers;
+        for (size_t t = begin; t < end; ++t) {
+            queues[w]->tasks.push_back(t);
+        }
+    }
+
+    std::atomic<bool> failed{ false };
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto workerMain = [&](size_t self) {
+        size_t task = 0;
+        while (!failed.load(std::memory_order_relaxed)) {
+            bool stolen = false;
+            bool found = queues[self]->PopFront(task);
+            for (size_t i = 1; !found && i < workers; ++i) {
+                found = queues[(self + i) % workers]->PopBack(task);
+                stolen = found;
+            }
+            if (!found) {
+                // Nothing is ever re-queued, so an empty sweep means we are done.
+                break;
+            }
+
+            try {
+                body(task, self);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+                break;
+            }
+
+            counters_[self].tasks++;
+            if (stolen) {
+                counters_[self].stolen++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(workerMain, w);
+    }
+    workerMain(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+} // namespace usnscanner
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace usnscanner {
+
+struct WorkerCounters {
+    uint64_t tasks;
+    uint64_t stolen;
+};
+
+// Number of workers to use when the caller does not ask for a specific count:
+// hardware concurrency clamped to [1, cap].
+size_t DefaultWorkerCount(size_t cap = 32);
+
+// Fixed-size work-stealing scheduler for index-addressed tasks. Tasks are dealt
+// out in contiguous blocks so each worker walks ascending indices (and thus
+// ascending disk offsets); a worker that drains its block steals from the tail
+// of another worker's block.
+class WorkStealingPool {
+  public:
+    explicit WorkStealingPool(size_t threads);
+
+    size_t ThreadCount() const { return threads_; }
+
+    // Runs body(task, worker) once for every task in [0, taskCount) and blocks
+    // until all tasks finish. The first exception thrown by a task is rethrown
+    // on the calling thread after every worker has stopped.
+    void Run(size_t taskCount, const std::function<void(size_t task, size_t worker)> &body);
+
+    const std::vector<WorkerCounters> &Counters() const { return counters_; }
+
+  private:
+    size_t threads_;
+    std::vector<WorkerCounters> counters_;
+};
+
+} // namespace usnscanner
@@ -0,0 +1,137 @@
+#include "xpress.h"
+#include "huffman.h"
+
+#include <cstring>
+
+namespace usnscanner {
+
+namespace {
+
+const size_t kSymbols = 512;
+const size_t kTableBytes = kSymbols / 2;
+const size_t kBlockSize = 65536;
+const unsigned kMaxCodeLength = 15;
+
+template <typename T>
+T Load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+bool XpressHuffmanDecompress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputSize) {
+    size_t in = 0;
+    size_t out = 0;
+    HuffmanDecoder decoder;
+    uint8_t lengths[kSymbols];
+
+    // MS-XCA keeps a 32-bit window over 16-bit little-endian words; literal
+    // length bytes are read from the input position past the prefetched words.
+    auto word = [&](size_t position) -> uint32_t {
+        return position + 2 <= inputSize ? Load<uint16_t>(input + position) : 0;
+    };
+
+    while (out < outputSize) {
+        if (in + kTableBytes + 4 > inputSize) {
+            return false;
+        }
+        for (size_t i = 0; i < kTableBytes; ++i) {
+            lengths[2 * i] = input[in + i] & 0x0F;
+            lengths[2 * i + 1] = input[in + i] >> 4;
+        }
+        if (!decoder.Build(lengths, kSymbols, kMaxCodeLength)) {
+            return false;
+        }
+        in += kTableBytes;
+
+        uint32_t bits = (word(in) << 16) | word(in + 2);
+        int extra = 16;
+        in += 4;
+
+        auto consume = [&](unsigned count) {
+            bits = count < 32 ? bits << count : 0;
+            extra -= static_cast<int>(count);
+            if (extra < 0) {
+                bits |= word(in) << (-extra);
+                extra += 16;
+                in += 2;
+            }
+        };
+
+        const size_t blockEnd = out + kBlockSize < outputSize ? out + kBlockSize : outputSize;
+        while (out < blockEnd) {
+            if (in > inputSize + 4) {
+                return false;
+            }
+            unsigned length = 0;
+            int symbol = decoder.Decode(bits >> (32 - kMaxCodeLength), length);
+            if (symbol < 0) {
+                return false;
+            }
+            consume(length);
+
+            if (symbol < 256) {
+                output[out++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            symbol -= 256;
+            size_t matchLength = static_cast<size_t>(symbol & 15);
+            unsigned offsetBits = static_cast<unsigned>(symbol >> 4);
+            if (matchLength == 15) {
+                if (in >= inputSize) {
+                    return false;
+                }
+                matchLength = input[in++];
+                if (matchLength == 255) {
+                    if (in + 2 > inputSize) {
+                        return false;
+                    }
+                    matchLength = Load<uint16_t>(input + in);
+                    in += 2;
+                    if (matchLength == 0) {
+                        if (in + 4 > inputSize) {
+                            return false;
+                        }
+                        matchLength = Load<uint32_t>(input + in);
+                        in += 4;
+                    }
+                    if (matchLength < 15) {
+                        return false;
+                    }
+                    matchLength -= 15;
+                }
+                matchLength += 15;
+            }
+            matchLength += 3;
+
+            size_t offset = (static_cast<size_t>(1) << offsetBits);
+            if (offsetBits != 0) {
+                offset += bits >> (32 - offsetBits);
+                consume(offsetBits);
+            }
+            if (offset > out || matchLength > outputSize - out) {
+                return false;
+            }
+
+            const uint8_t *source = output + out - offset;
+            uint8_t *target = output + out;
+            if (offset >= matchLength) {
+                std::memcpy(target, source, matchLength);
+            } else {
+                for (size_t i = 0; i < matchLength; ++i) {
+                    target[i] = source[i];
+                }
+            }
+            out += matchLength;
+        }
+
+        // Prefetched bits are dropped; the next table starts at the current
+        // input position.
+    }
+    return true;
+}
+
+} // namespace usnscanner
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace usnscanner {
+
+// Decompresses XPRESS with Huffman (MS-XCA LZ77+Huffman) into exactly
+// `outputSize` bytes. Each 64 KB block starts with a 256-byte table of 4-bit
+// code lengths for 512 symbols. Returns false on corrupt input.
+bool XpressHuffmanDecompress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputSize);
+
+} // namespace usnscanner
@@ -2,8 +2,29 @@ const { contextBridge, ipcRenderer } = require('electron');
 
 contextBridge.exposeInMainWorld('electronAPI', {
     getDrives: () => ipcRenderer.invoke('get-drives'),
-    scanDrive: (drivePath) => ipcRenderer.invoke('scan-drive', drivePath),
+    scanDrive: (drivePath, options) => ipcRenderer.invoke('scan-drive', drivePath, options),
+    getScanDedupStats: () => ipcRenderer.invoke('scan-dedup-stats'),
     recoverFile: (fileInfo, options) => ipcRenderer.invoke('recover-file', fileInfo, options),
     selectRecoveryDirectory: () => ipcRenderer.invoke('select-recovery-directory'),
+    scanDeletedTree: (drivePath, options) => ipcRenderer.invoke('scan-deleted-tree', drivePath, options),
+    scanAll: (drivePaths, options) => ipcRenderer.invoke('scan-all', drivePaths, options),
+    expandTree: (scanId, nodeId, options) => ipcRenderer.invoke('expand-tree', scanId, nodeId, options),
+    aggregateScan: (scanId, groupBy, options) => ipcRenderer.invoke('aggregate-scan', scanId, groupBy, options),
+    exportResults: (scanId, format, outputPath, options) => ipcRenderer.invoke('export-results', scanId, format, outputPath, options),
+    releaseScan: (scanId) => ipcRenderer.invoke('release-scan', scanId),
+    recoverTree: (scanId, nodeId, outputDir, options) => ipcRenderer.invoke('recover-tree', scanId, nodeId, outputDir, options),
+    probeIo: (drivePath) => ipcRenderer.invoke('probe-io', drivePath),
+    setIoLimits: (limits) => ipcRenderer.invoke('set-io-limits', limits),
+    getIoThrottleStats: () => ipcRenderer.invoke('io-throttle-stats'),
+    analyzeDeletions: (drivePath, options) => ipcRenderer.invoke('analyze-deletions', drivePath, options),
+    buildTimeline: (drivePath, options) => ipcRenderer.invoke('build-timeline', drivePath, options),
+    saveSnapshot: (drivePath, snapshotPath) => ipcRenderer.invoke('save-snapshot', drivePath, snapshotPath),
+    diffSnapshots: (oldPath, newPath, options) => ipcRenderer.invoke('diff-snapshots', oldPath, newPath, options),
+    watchStart: (drivePath, options) => ipcRenderer.invoke('watch-start', drivePath, options),
+    watchStop: (watchId) => ipcRenderer.invoke('watch-stop', watchId),
+    onWatchEvents: (callback) => ipcRenderer.on('watch-events', (event, batch) => callback(batch)),
+    onWatchError: (callback) => ipcRenderer.on('watch-error', (event, failure) => callback(failure)),
+    onScanAllProgress: (callback) => ipcRenderer.on('scan-all-progress', (event, volumes) => callback(volumes)),
+    onRecoverTreeProgress: (callback) => ipcRenderer.on('recover-tree-progress', (event, progress) => callback(progress)),
     onScanProgress: (callback) => ipcRenderer.on('scan-progress', (event, progress) => callback(progress))
 });
@@ -19,6 +19,7 @@ const filterAll = document.getElementById('filter-all');
 const filterImages = document.getElementById('filter-images');
 const filterDocuments = document.getElementById('filter-documents');
 const filterVideos = document.getElementById('filter-videos');
+const deepScanCheckbox = document.getElementById('deep-scan');
 
 // Initialize
 async function init() {
@@ -118,7 +119,9 @@ async function startScan() {
     updateProgress(0);
     
     try {
-        const files = await window.electronAPI.scanDrive(selectedDrive);
+        const files = await window.electronAPI.scanDrive(selectedDrive, {
+            deepScan: Boolean(deepScanCheckbox && deepScanCheckbox.checked)
+        });
         foundFiles = files.map(file => ({
             ...file,
             recoveryStatus: 'Not recovered',
@@ -450,6 +453,18 @@ function formatSource(file) {
     if (source === 'usn-journal') {
         return 'USN Journal';
     }
+    if (source === 'carved') {
+        return 'Carved';
+    }
+    if (source === 'mft-carved') {
+        return 'Orphan MFT Record';
+    }
+    if (source === 'i30-slack') {
+        return 'Index Slack';
+    }
+    if (source === 'logfile') {
+        return '$LogFile';
+    }
     return source;
 }
 
@@ -462,6 +477,7 @@ function formatFileSize(bytes) {
 }
 
 function formatDate(dateString) {
+    if (!dateString) return 'Unknown';
     const date = new Date(dateString);
     return date.toLocaleDateString() + ' ' + date.toLocaleTimeString();
 }